@@ -53,6 +53,11 @@ D_DECLARE_INTERFACE( IDirectFBSurface )
  */
 D_DECLARE_INTERFACE( IDirectFBSurfaceAllocation )
 
+/*
+ * Interface to a display list, being a recorded sequence of surface operations that can be replayed at once.
+ */
+D_DECLARE_INTERFACE( IDirectFBDisplayList )
+
 /*
  * Interface for read/write access to the colors of a palette object and for cloning it.
  */
@@ -1507,6 +1512,30 @@ typedef struct {
      } memory;                                                   /* memory based buffers */
 } DFBDataBufferDescription;
 
+#define DFB_SOFTWARE_STATS_STAGES_LENGTH       256
+
+/*
+ * Statistics of a software rendering pipeline.
+ */
+typedef struct {
+     DFBAccelerationMask                     accel;              /* Drawing or blitting function */
+     DFBSurfacePixelFormat                   dst_format;         /* Destination pixel format */
+     DFBSurfacePixelFormat                   src_format;         /* Source pixel format, DSPF_UNKNOWN for drawing */
+     DFBSurfaceDrawingFlags                  drawingflags;       /* Drawing flags */
+     DFBSurfaceBlittingFlags                 blittingflags;      /* Blitting flags */
+     int                                     src_blend;          /* Source blend function (DFBSurfaceBlendFunction) */
+     int                                     dst_blend;          /* Destination blend function
+                                                                    (DFBSurfaceBlendFunction) */
+
+     DFBBoolean                              accumulator;        /* Generic accumulator path instead of a fast path */
+     unsigned int                            num_stages;         /* Number of span functions in the pipeline */
+     char stages[DFB_SOFTWARE_STATS_STAGES_LENGTH];              /* Names of the span functions */
+
+     unsigned int                            calls;              /* Number of operations */
+     unsigned long long                      pixels;             /* Number of destination pixels */
+     long long                               time;               /* Accumulated time in microseconds */
+} DFBSoftwarePipelineStats;
+
 /*
  * Called for each supported video mode.
  */
@@ -1948,6 +1977,26 @@ D_DEFINE_INTERFACE( IDirectFB,
           IDirectFB                         *thiz,
           DFBSurfacePixelFormat             *ret_fontformat
      );
+
+   /** Statistics **/
+
+     /*
+      * Get statistics of the software rendering pipelines.
+      *
+      * Up to 'max' pipelines are returned in 'ret_stats',
+      * the total number of pipelines is returned in 'ret_num'.
+      * Statistics are only collected if the 'software-stats'
+      * option is set, otherwise DFB_UNSUPPORTED is returned.
+      * If 'reset' is DFB_TRUE, the statistics are cleared
+      * after being retrieved.
+      */
+     DFBResult (*GetSoftwareStats) (
+          IDirectFB                         *thiz,
+          DFBSoftwarePipelineStats          *ret_stats,
+          unsigned int                       max,
+          unsigned int                      *ret_num,
+          DFBBoolean                         reset
+     );
 )
 
 /*******************
@@ -4737,6 +4786,52 @@ D_DEFINE_INTERFACE( IDirectFBSurface,
      DFBResult (*Flush) (
           IDirectFBSurface                  *thiz
      );
+
+   /** Display lists **/
+
+     /*
+      * Start recording operations into a display list.
+      *
+      * Until EndDisplayList() is called, drawing and blitting
+      * operations including text rendering are recorded with
+      * the current state instead of being executed.
+      * Operations are clipped when recorded.
+      *
+      * TextureTriangles(), FillTrapezoids(), FillQuadrangles(),
+      * BatchBlit2(), DrawMonoGlyphs() and blitting with
+      * DSBLIT_INDEX_TRANSLATION are not supported while
+      * recording.
+      */
+     DFBResult (*BeginDisplayList) (
+          IDirectFBSurface                  *thiz
+     );
+
+     /*
+      * Stop recording and return the display list.
+      *
+      * The display list can't be changed afterwards.
+      */
+     DFBResult (*EndDisplayList) (
+          IDirectFBSurface                  *thiz,
+          IDirectFBDisplayList             **ret_interface
+     );
+
+     /*
+      * Replay a display list.
+      *
+      * The recorded operations are executed with their recorded
+      * state, translated by 'x' and 'y' relative to the origin
+      * of the surface they have been recorded on.
+      *
+      * The current state of this surface is not changed, but
+      * its clipping region applies to the operations.
+      */
+     DFBResult (*PlayDisplayList) (
+          IDirectFBSurface                  *thiz,
+          IDirectFBDisplayList              *list,
+          int                                x,
+          int                                y
+     );
 )
 
 /******************************
@@ -4787,6 +4882,30 @@ D_DEFINE_INTERFACE( IDirectFBSurfaceAllocation,
      );
 )
 
+/************************
+ * IDirectFBDisplayList *
+ ************************/
+
+/*
+ * IDirectFBDisplayList is the display list interface.
+ */
+D_DEFINE_INTERFACE( IDirectFBDisplayList,
+
+   /** Retrieving information **/
+
+     /*
+      * Get the area affected by the recorded operations.
+      *
+      * The rectangle is relative to the origin of the surface
+      * the operations have been recorded on.
+      * DFB_BUFFEREMPTY is returned if nothing would be drawn.
+      */
+     DFBResult (*GetBounds) (
+          IDirectFBDisplayList              *thiz,
+          DFBRectangle                      *ret_rect
+     );
+)
+
 /********************
  * IDirectFBPalette *
  ********************/
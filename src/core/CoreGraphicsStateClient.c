@@ -20,7 +20,10 @@
 #include <core/CoreGraphicsState.h>
 #include <core/CoreGraphicsStateClient.h>
 #include <core/core.h>
+#include <core/display_list.h>
 #include <core/graphics_state.h>
+#include <core/surface.h>
+#include <direct/memcpy.h>
 #include <fusion/conf.h>
 
 D_DEBUG_DOMAIN(
@@ -103,6 +106,170 @@ RemoveClient( CoreGraphicsStateClient *client )
 
 /**********************************************************************************************************************/
 
+/* Number of blits recorded per command. */
+#define BLIT_CHUNK ((CORE_GRAPHICS_STATE_COMMANDS_SIZE - sizeof(CoreGraphicsStateCommand)) / \
+                    (sizeof(DFBRectangle) + sizeof(DFBPoint)))
+
+/*
+ * In indirect mode, rendering commands and state changes are recorded and executed with a single call when the client
+ * is flushed, before calls returning a value, or when the buffer is full.
+ */
+
+static DFBResult
+client_submit( CoreGraphicsStateClient *client )
+{
+     DFBResult    ret = DFB_OK;
+     unsigned int i;
+
+     if (client->commands_length) {
+          D_DEBUG_AT( Core_GraphicsStateClient_Flush, "%s( %p ) <- %u bytes\n", __FUNCTION__,
+                      client, client->commands_length );
+
+          ret = CoreGraphicsState_Execute( client->gfx_state, client->commands, client->commands_length );
+
+          client->commands_length = 0;
+     }
+
+     /* Surfaces are kept until the commands using them have been queued. */
+     for (i = 0; i < client->num_refs; i++)
+          dfb_surface_unref( client->refs[i] );
+
+     client->num_refs = 0;
+
+     return ret;
+}
+
+/*
+ * Return the space for the arguments of a new command, or NULL with all previous commands submitted if the command
+ * cannot be recorded and has to be executed on its own.
+ */
+static void *
+client_record( CoreGraphicsStateClient      *client,
+               CoreGraphicsStateCommandType  type,
+               u32                           num,
+               unsigned int                  size )
+{
+     CoreGraphicsStateCommand *command;
+
+     size = (size + 3) & ~3;
+
+     if (!client->commands) {
+          client->commands = D_MALLOC( CORE_GRAPHICS_STATE_COMMANDS_SIZE );
+          if (!client->commands) {
+               D_OOM();
+               return NULL;
+          }
+     }
+
+     if (sizeof(CoreGraphicsStateCommand) + size > CORE_GRAPHICS_STATE_COMMANDS_SIZE) {
+          client_submit( client );
+          return NULL;
+     }
+
+     if (client->commands_length + sizeof(CoreGraphicsStateCommand) + size > CORE_GRAPHICS_STATE_COMMANDS_SIZE)
+          client_submit( client );
+
+     command = (CoreGraphicsStateCommand*) (client->commands + client->commands_length);
+
+     command->type = type;
+     command->num  = num;
+     command->size = size;
+
+     /* Clear the padding. */
+     if (size)
+          ((u32*) (command + 1))[size / 4 - 1] = 0;
+
+     client->commands_length += sizeof(CoreGraphicsStateCommand) + size;
+
+     return command + 1;
+}
+
+static DFBResult
+client_record_value( CoreGraphicsStateClient      *client,
+                     CoreGraphicsStateCommandType  type,
+                     const void                   *value,
+                     unsigned int                  size )
+{
+     void *args;
+
+     args = client_record( client, type, 0, size );
+     if (!args)
+          return DFB_NOSYSTEMMEMORY;
+
+     direct_memcpy( args, value, size );
+
+     return DFB_OK;
+}
+
+static DFBResult
+client_record_u32( CoreGraphicsStateClient      *client,
+                   CoreGraphicsStateCommandType  type,
+                   u32                           value )
+{
+     return client_record_value( client, type, &value, sizeof(value) );
+}
+
+static DFBResult
+client_record_surface( CoreGraphicsStateClient      *client,
+                       CoreGraphicsStateCommandType  type,
+                       CoreSurface                  *surface )
+{
+     u32 *args;
+
+     args = client_record( client, type, 0, sizeof(u32) );
+     if (!args)
+          return DFB_NOSYSTEMMEMORY;
+
+     args[0] = CoreSurface_GetID( surface );
+
+     if (dfb_surface_ref( surface ) == DR_OK) {
+          client->refs[client->num_refs++] = surface;
+
+          if (client->num_refs == CORE_GRAPHICS_STATE_CLIENT_REFS)
+               client_submit( client );
+     }
+
+     return DFB_OK;
+}
+
+/*
+ * Record a command with up to three arrays of 'num' elements, returning false if it has to be executed on its own.
+ */
+static bool
+client_record_arrays( CoreGraphicsStateClient      *client,
+                      CoreGraphicsStateCommandType  type,
+                      u32                           num,
+                      const void                   *array1,
+                      unsigned int                  size1,
+                      const void                   *array2,
+                      unsigned int                  size2,
+                      const void                   *array3,
+                      unsigned int                  size3 )
+{
+     u8 *args;
+
+     if (num > CORE_GRAPHICS_STATE_COMMANDS_SIZE) {
+          client_submit( client );
+          return false;
+     }
+
+     args = client_record( client, type, num, num * (size1 + size2 + size3) );
+     if (!args)
+          return false;
+
+     direct_memcpy( args, array1, num * size1 );
+
+     if (array2)
+          direct_memcpy( args + num * size1, array2, num * size2 );
+
+     if (array3)
+          direct_memcpy( args + num * (size1 + size2), array3, num * size3 );
+
+     return true;
+}
+
+/**********************************************************************************************************************/
+
 DFBResult
 CoreGraphicsStateClient_Init( CoreGraphicsStateClient *client,
                               CardState               *state )
@@ -115,10 +282,14 @@ CoreGraphicsStateClient_Init( CoreGraphicsStateClient *client,
      D_MAGIC_ASSERT( state, CardState );
      D_MAGIC_ASSERT( state->core, CoreDFB );
 
-     client->magic     = 0;
-     client->core      = state->core;
-     client->state     = state;
-     client->gfx_state = NULL;
+     client->magic           = 0;
+     client->core            = state->core;
+     client->state           = state;
+     client->gfx_state       = NULL;
+     client->commands        = NULL;
+     client->commands_length = 0;
+     client->num_refs        = 0;
+     client->display_list    = NULL;
 
      ret = CoreDFB_CreateState( state->core, &client->gfx_state );
      if (ret)
@@ -149,6 +320,9 @@ CoreGraphicsStateClient_Deinit( CoreGraphicsStateClient *client )
 
      CoreGraphicsStateClient_Flush( client );
 
+     if (client->commands)
+          D_FREE( client->commands );
+
      dfb_graphics_state_unref( client->gfx_state );
 
      RemoveClient( client );
@@ -164,9 +338,13 @@ CoreGraphicsStateClient_Flush( CoreGraphicsStateClient *client )
      D_MAGIC_ASSERT( client, CoreGraphicsStateClient );
 
       if (!dfb_config->call_nodirect && (dfb_core_is_master( client->core ) || !fusion_config->secure_fusion)) {
+           dfb_gfxcard_state_release_locks( client->state );
+
            dfb_gfxcard_flush();
       }
       else {
+           client_submit( client );
+
            CoreGraphicsState_Flush( client->gfx_state );
       }
 }
@@ -178,7 +356,13 @@ CoreGraphicsStateClient_ReleaseSource( CoreGraphicsStateClient *client )
 
      D_MAGIC_ASSERT( client, CoreGraphicsStateClient );
 
-     CoreGraphicsState_ReleaseSource( client->gfx_state );
+     if (!dfb_config->call_nodirect && (dfb_core_is_master( client->core ) || !fusion_config->secure_fusion)) {
+          CoreGraphicsState_ReleaseSource( client->gfx_state );
+     }
+     else {
+          if (!client_record( client, CGSC_RELEASE_SOURCE, 0, 0 ))
+               CoreGraphicsState_ReleaseSource( client->gfx_state );
+     }
 
      return DFB_OK;
 }
@@ -192,11 +376,28 @@ CoreGraphicsStateClient_SetColorAndIndex( CoreGraphicsStateClient *client,
 
      D_MAGIC_ASSERT( client, CoreGraphicsStateClient );
 
-     CoreGraphicsState_SetColorAndIndex( client->gfx_state, color, index );
+     if (!dfb_config->call_nodirect && (dfb_core_is_master( client->core ) || !fusion_config->secure_fusion)) {
+          CoreGraphicsState_SetColorAndIndex( client->gfx_state, color, index );
+     }
+     else {
+          u32 *args;
+
+          args = client_record( client, CGSC_SET_COLOR_AND_INDEX, 0, sizeof(DFBColor) + sizeof(u32) );
+          if (args) {
+               direct_memcpy( args, color, sizeof(DFBColor) );
+
+               args[sizeof(DFBColor) / 4] = index;
+          }
+          else
+               CoreGraphicsState_SetColorAndIndex( client->gfx_state, color, index );
+     }
 
      return DFB_OK;
 }
 
+/*
+ * Record the state changes, only used in indirect mode.
+ */
 static DFBResult
 CoreGraphicsStateClient_SetState( CoreGraphicsStateClient *client,
                                   CardState               *state,
@@ -210,49 +411,61 @@ CoreGraphicsStateClient_SetState( CoreGraphicsStateClient *client,
      D_MAGIC_ASSERT( state, CardState );
 
      if (flags & SMF_DRAWING_FLAGS) {
-          ret = CoreGraphicsState_SetDrawingFlags( client->gfx_state, state->drawingflags );
+          ret = client_record_u32( client, CGSC_SET_DRAWING_FLAGS, state->drawingflags );
           if (ret)
                return ret;
      }
 
      if (flags & SMF_BLITTING_FLAGS) {
-          ret = CoreGraphicsState_SetBlittingFlags( client->gfx_state, state->blittingflags );
+          ret = client_record_u32( client, CGSC_SET_BLITTING_FLAGS, state->blittingflags );
           if (ret)
                return ret;
      }
 
      if (flags & SMF_CLIP) {
-          ret = CoreGraphicsState_SetClip( client->gfx_state, &state->clip );
-          if (ret)
-               return ret;
+          DFBRegion *args = NULL;
+
+          /* Always fits for up to DFB_CLIP_REGIONS_MAX regions, see dfb_state_set_clip_regions(). */
+          if (sizeof(CoreGraphicsStateCommand) + (1 + state->num_clip_regions) * sizeof(DFBRegion) <=
+              CORE_GRAPHICS_STATE_COMMANDS_SIZE)
+               args = client_record( client, CGSC_SET_CLIP, state->num_clip_regions,
+                                     (1 + state->num_clip_regions) * sizeof(DFBRegion) );
+
+          if (!args)
+               return DFB_NOSYSTEMMEMORY;
+
+          args[0] = state->clip;
+
+          if (state->num_clip_regions)
+               direct_memcpy( args + 1, state->clip_regions, state->num_clip_regions * sizeof(DFBRegion) );
      }
 
      if (flags & SMF_COLOR) {
-          ret = CoreGraphicsState_SetColor( client->gfx_state, &state->color );
+          ret = client_record_value( client, CGSC_SET_COLOR, &state->color, sizeof(DFBColor) );
           if (ret)
                return ret;
      }
 
      if (flags & SMF_SRC_BLEND) {
-          ret = CoreGraphicsState_SetSrcBlend( client->gfx_state, state->src_blend );
+          ret = client_record_u32( client, CGSC_SET_SRC_BLEND, state->src_blend );
           if (ret)
                return ret;
      }
 
      if (flags & SMF_DST_BLEND) {
-          ret = CoreGraphicsState_SetDstBlend( client->gfx_state, state->dst_blend );
+          ret = client_record_u32( client, CGSC_SET_DST_BLEND, state->dst_blend );
           if (ret)
                return ret;
      }
 
      if (flags & SMF_SRC_COLORKEY) {
-          ret = CoreGraphicsState_SetSrcColorKey( client->gfx_state, state->src_colorkey );
+          ret = client_record_u32( client, CGSC_SET_SRC_COLORKEY, state->src_colorkey );
           if (ret)
                return ret;
      }
 
      if (flags & SMF_DST_COLORKEY) {
-          ret = CoreGraphicsState_SetDstColorKey( client->gfx_state, state->dst_colorkey );
+          ret = client_record_u32( client, CGSC_SET_DST_COLORKEY, state->dst_colorkey );
           if (ret)
                return ret;
      }
@@ -261,75 +474,90 @@ CoreGraphicsStateClient_SetState( CoreGraphicsStateClient *client,
           D_DEBUG_AT( Core_GraphicsStateClient, "  -> destination %p [%u]\n",
                       state->destination, state->destination->object.id );
 
-          ret = CoreGraphicsState_SetDestination( client->gfx_state, state->destination );
+          ret = client_record_surface( client, CGSC_SET_DESTINATION, state->destination );
           if (ret)
                return ret;
      }
 
      if (flags & SMF_SOURCE) {
-          ret = CoreGraphicsState_SetSource( client->gfx_state, state->source );
+          ret = client_record_surface( client, CGSC_SET_SOURCE, state->source );
           if (ret)
                return ret;
      }
 
      if (flags & SMF_SOURCE_MASK) {
-          ret = CoreGraphicsState_SetSourceMask( client->gfx_state, state->source_mask );
+          ret = client_record_surface( client, CGSC_SET_SOURCE_MASK, state->source_mask );
           if (ret)
                return ret;
      }
 
      if (flags & SMF_SOURCE_MASK_VALS) {
-          ret = CoreGraphicsState_SetSourceMaskVals( client->gfx_state, &state->src_mask_offset,
-                                                     state->src_mask_flags );
-          if (ret)
-               return ret;
+          u32 *args;
+
+          args = client_record( client, CGSC_SET_SOURCE_MASK_VALS, 0, sizeof(DFBPoint) + sizeof(u32) );
+          if (!args)
+               return DFB_NOSYSTEMMEMORY;
+
+          direct_memcpy( args, &state->src_mask_offset, sizeof(DFBPoint) );
+
+          args[sizeof(DFBPoint) / 4] = state->src_mask_flags;
      }
 
      if (flags & SMF_INDEX_TRANSLATION) {
-          ret = CoreGraphicsState_SetIndexTranslation( client->gfx_state, state->index_translation,
-                                                       state->num_translation );
-          if (ret)
-               return ret;
+          if (!client_record_arrays( client, CGSC_SET_INDEX_TRANSLATION, state->num_translation,
+                                     state->index_translation, sizeof(s32), NULL, 0, NULL, 0 ))
+               return DFB_NOSYSTEMMEMORY;
      }
 
      if (flags & SMF_COLORKEY) {
-          ret = CoreGraphicsState_SetColorKey( client->gfx_state, &state->colorkey );
+          ret = client_record_value( client, CGSC_SET_COLORKEY, &state->colorkey, sizeof(DFBColorKey) );
           if (ret)
                return ret;
      }
 
      if (flags & SMF_RENDER_OPTIONS) {
-          ret = CoreGraphicsState_SetRenderOptions( client->gfx_state, state->render_options );
+          ret = client_record_u32( client, CGSC_SET_RENDER_OPTIONS, state->render_options );
           if (ret)
                return ret;
      }
 
      if (flags & SMF_MATRIX) {
-          ret = CoreGraphicsState_SetMatrix( client->gfx_state, state->matrix );
+          ret = client_record_value( client, CGSC_SET_MATRIX, state->matrix, 9 * sizeof(s32) );
           if (ret)
                return ret;
      }
 
      if (flags & SMF_SOURCE2) {
-          ret = CoreGraphicsState_SetSource2( client->gfx_state, state->source2 );
+          ret = client_record_surface( client, CGSC_SET_SOURCE2, state->source2 );
           if (ret)
                return ret;
      }
 
      if (flags & SMF_FROM) {
-          ret = CoreGraphicsState_SetFrom( client->gfx_state, state->from, state->from_eye );
+          u32 args[2] = { state->from, state->from_eye };
+
+          ret = client_record_value( client, CGSC_SET_FROM, args, sizeof(args) );
           if (ret)
                return ret;
      }
 
      if (flags & SMF_TO) {
-          ret = CoreGraphicsState_SetTo( client->gfx_state, state->to, state->to_eye );
+          u32 args[2] = { state->to, state->to_eye };
+
+          ret = client_record_value( client, CGSC_SET_TO, args, sizeof(args) );
           if (ret)
                return ret;
      }
 
      if (flags & SMF_SRC_CONVOLUTION) {
-          ret = CoreGraphicsState_SetSrcConvolution( client->gfx_state, &state->src_convolution );
+          ret = client_record_value( client, CGSC_SET_SRC_CONVOLUTION, &state->src_convolution,
+                                     sizeof(DFBConvolutionFilter) );
+          if (ret)
+               return ret;
+     }
+
+     if (flags & SMF_SRC_COLORMATRIX) {
+          ret = client_record_value( client, CGSC_SET_SRC_COLORMATRIX, state->src_colormatrix, 12 * sizeof(s32) );
           if (ret)
                return ret;
      }
@@ -392,6 +620,9 @@ CoreGraphicsStateClient_Update( CoreGraphicsStateClient *client,
 
           if (state->blittingflags & DSBLIT_SRC_CONVOLUTION)
                flags |= SMF_SRC_CONVOLUTION;
+
+          if (state->blittingflags & DSBLIT_SRC_COLORMATRIX)
+               flags |= SMF_SRC_COLORMATRIX;
      }
 
      ret = CoreGraphicsStateClient_SetState( client, state, state->modified & flags );
@@ -422,6 +653,8 @@ CoreGraphicsStateClient_GetAccelerationMask( CoreGraphicsStateClient *client,
                                           (client->state->source2 ? DFXL_BLIT2 : DFXL_BLIT) : DFXL_FILLRECTANGLE,
                                           client->state );
 
+          client_submit( client );
+
           ret = CoreGraphicsState_GetAccelerationMask( client->gfx_state, ret_accel );
           if (ret)
                return ret;
@@ -440,6 +673,9 @@ CoreGraphicsStateClient_FillRectangles( CoreGraphicsStateClient *client,
      D_MAGIC_ASSERT( client, CoreGraphicsStateClient );
      D_ASSERT( rects != NULL );
 
+     if (client->display_list)
+          return dfb_display_list_fill_rectangles( client->display_list, client->state, rects, num );
+
      if (!dfb_config->call_nodirect && (dfb_core_is_master( client->core ) || !fusion_config->secure_fusion)) {
           dfb_gfxcard_fillrectangles( (DFBRectangle*) rects, num, client->state );
      }
@@ -448,9 +684,11 @@ CoreGraphicsStateClient_FillRectangles( CoreGraphicsStateClient *client,
 
           CoreGraphicsStateClient_Update( client, DFXL_FILLRECTANGLE, client->state );
 
-          ret = CoreGraphicsState_FillRectangles( client->gfx_state, rects, num );
-          if (ret)
-               return ret;
+          if (!client_record_arrays( client, CGSC_FILL_RECTANGLES, num, rects, sizeof(DFBRectangle), NULL, 0, NULL, 0 )) {
+               ret = CoreGraphicsState_FillRectangles( client->gfx_state, rects, num );
+               if (ret)
+                    return ret;
+          }
      }
 
      return DFB_OK;
@@ -466,6 +704,9 @@ CoreGraphicsStateClient_DrawRectangles( CoreGraphicsStateClient *client,
      D_MAGIC_ASSERT( client, CoreGraphicsStateClient );
      D_ASSERT( rects != NULL );
 
+     if (client->display_list)
+          return dfb_display_list_draw_rectangles( client->display_list, client->state, rects, num );
+
      if (!dfb_config->call_nodirect && (dfb_core_is_master( client->core ) || !fusion_config->secure_fusion)) {
           unsigned int i;
 
@@ -477,9 +718,11 @@ CoreGraphicsStateClient_DrawRectangles( CoreGraphicsStateClient *client,
 
           CoreGraphicsStateClient_Update( client, DFXL_DRAWRECTANGLE, client->state );
 
-          ret = CoreGraphicsState_DrawRectangles( client->gfx_state, rects, num );
-          if (ret)
-               return ret;
+          if (!client_record_arrays( client, CGSC_DRAW_RECTANGLES, num, rects, sizeof(DFBRectangle), NULL, 0, NULL, 0 )) {
+               ret = CoreGraphicsState_DrawRectangles( client->gfx_state, rects, num );
+               if (ret)
+                    return ret;
+          }
      }
 
      return DFB_OK;
@@ -495,6 +738,9 @@ CoreGraphicsStateClient_DrawLines( CoreGraphicsStateClient *client,
      D_MAGIC_ASSERT( client, CoreGraphicsStateClient );
      D_ASSERT( lines != NULL );
 
+     if (client->display_list)
+          return dfb_display_list_draw_lines( client->display_list, client->state, lines, num );
+
      if (!dfb_config->call_nodirect && (dfb_core_is_master( client->core ) || !fusion_config->secure_fusion)) {
           dfb_gfxcard_drawlines( (DFBRegion*) lines, num, client->state );
      }
@@ -503,9 +749,11 @@ CoreGraphicsStateClient_DrawLines( CoreGraphicsStateClient *client,
 
           CoreGraphicsStateClient_Update( client, DFXL_DRAWLINE, client->state );
 
-          ret = CoreGraphicsState_DrawLines( client->gfx_state, lines, num );
-          if (ret)
-               return ret;
+          if (!client_record_arrays( client, CGSC_DRAW_LINES, num, lines, sizeof(DFBRegion), NULL, 0, NULL, 0 )) {
+               ret = CoreGraphicsState_DrawLines( client->gfx_state, lines, num );
+               if (ret)
+                    return ret;
+          }
      }
 
      return DFB_OK;
@@ -521,6 +769,9 @@ CoreGraphicsStateClient_FillTriangles( CoreGraphicsStateClient *client,
      D_MAGIC_ASSERT( client, CoreGraphicsStateClient );
      D_ASSERT( triangles != NULL );
 
+     if (client->display_list)
+          return dfb_display_list_fill_triangles( client->display_list, client->state, triangles, num );
+
      if (!dfb_config->call_nodirect && (dfb_core_is_master( client->core ) || !fusion_config->secure_fusion)) {
           dfb_gfxcard_filltriangles( (DFBTriangle*) triangles, num, client->state );
      }
@@ -529,9 +780,11 @@ CoreGraphicsStateClient_FillTriangles( CoreGraphicsStateClient *client,
 
           CoreGraphicsStateClient_Update( client, DFXL_FILLTRIANGLE, client->state );
 
-          ret = CoreGraphicsState_FillTriangles( client->gfx_state, triangles, num );
-          if (ret)
-               return ret;
+          if (!client_record_arrays( client, CGSC_FILL_TRIANGLES, num, triangles, sizeof(DFBTriangle), NULL, 0, NULL, 0 )) {
+               ret = CoreGraphicsState_FillTriangles( client->gfx_state, triangles, num );
+               if (ret)
+                    return ret;
+          }
      }
 
      return DFB_OK;
@@ -547,6 +800,9 @@ CoreGraphicsStateClient_FillTrapezoids( CoreGraphicsStateClient *client,
      D_MAGIC_ASSERT( client, CoreGraphicsStateClient );
      D_ASSERT( trapezoids != NULL );
 
+     if (client->display_list)
+          return DFB_UNSUPPORTED;
+
      if (!dfb_config->call_nodirect && (dfb_core_is_master( client->core ) || !fusion_config->secure_fusion)) {
           dfb_gfxcard_filltrapezoids( (DFBTrapezoid*) trapezoids, num, client->state );
      }
@@ -555,9 +811,11 @@ CoreGraphicsStateClient_FillTrapezoids( CoreGraphicsStateClient *client,
 
           CoreGraphicsStateClient_Update( client, DFXL_FILLTRAPEZOID, client->state );
 
-          ret = CoreGraphicsState_FillTrapezoids( client->gfx_state, trapezoids, num );
-          if (ret)
-               return ret;
+          if (!client_record_arrays( client, CGSC_FILL_TRAPEZOIDS, num, trapezoids, sizeof(DFBTrapezoid), NULL, 0, NULL, 0 )) {
+               ret = CoreGraphicsState_FillTrapezoids( client->gfx_state, trapezoids, num );
+               if (ret)
+                    return ret;
+          }
      }
 
      return DFB_OK;
@@ -573,6 +831,9 @@ CoreGraphicsStateClient_FillQuadrangles( CoreGraphicsStateClient *client,
      D_MAGIC_ASSERT( client, CoreGraphicsStateClient );
      D_ASSERT( points != NULL );
 
+     if (client->display_list)
+          return DFB_UNSUPPORTED;
+
      if (!dfb_config->call_nodirect && (dfb_core_is_master( client->core ) || !fusion_config->secure_fusion)) {
           dfb_gfxcard_fillquadrangles( (DFBPoint*) points, num, client->state );
      }
@@ -581,9 +842,11 @@ CoreGraphicsStateClient_FillQuadrangles( CoreGraphicsStateClient *client,
 
           CoreGraphicsStateClient_Update( client, DFXL_FILLQUADRANGLE, client->state );
 
-          ret = CoreGraphicsState_FillQuadrangles( client->gfx_state, points, num );
-          if (ret)
-               return ret;
+          if (!client_record_arrays( client, CGSC_FILL_QUADRANGLES, num, points, sizeof(DFBPoint), NULL, 0, NULL, 0 )) {
+               ret = CoreGraphicsState_FillQuadrangles( client->gfx_state, points, num );
+               if (ret)
+                    return ret;
+          }
      }
 
      return DFB_OK;
@@ -600,6 +863,9 @@ CoreGraphicsStateClient_FillSpans( CoreGraphicsStateClient *client,
      D_MAGIC_ASSERT( client, CoreGraphicsStateClient );
      D_ASSERT( spans != NULL );
 
+     if (client->display_list)
+          return dfb_display_list_fill_spans( client->display_list, client->state, y, spans, num );
+
      if (!dfb_config->call_nodirect && (dfb_core_is_master( client->core ) || !fusion_config->secure_fusion)) {
           dfb_gfxcard_fillspans( y, (DFBSpan*) spans, num, client->state );
      }
@@ -608,9 +874,21 @@ CoreGraphicsStateClient_FillSpans( CoreGraphicsStateClient *client,
 
           CoreGraphicsStateClient_Update( client, DFXL_FILLRECTANGLE, client->state );
 
-          ret = CoreGraphicsState_FillSpans( client->gfx_state, y, spans, num );
-          if (ret)
-               return ret;
+          s32 *args = NULL;
+
+          if (num <= CORE_GRAPHICS_STATE_COMMANDS_SIZE)
+               args = client_record( client, CGSC_FILL_SPANS, num, sizeof(s32) + num * sizeof(DFBSpan) );
+
+          if (args) {
+               args[0] = y;
+
+               direct_memcpy( args + 1, spans, num * sizeof(DFBSpan) );
+          }
+          else {
+               ret = CoreGraphicsState_FillSpans( client->gfx_state, y, spans, num );
+               if (ret)
+                    return ret;
+          }
      }
 
      return DFB_OK;
@@ -628,6 +906,9 @@ CoreGraphicsStateClient_Blit( CoreGraphicsStateClient *client,
      D_ASSERT( rects != NULL );
      D_ASSERT( points != NULL );
 
+     if (client->display_list)
+          return dfb_display_list_blit( client->display_list, client->state, rects, points, num );
+
      if (!dfb_config->call_nodirect && (dfb_core_is_master( client->core ) || !fusion_config->secure_fusion)) {
           dfb_gfxcard_batchblit( (DFBRectangle*) rects, (DFBPoint*) points, num, client->state );
      }
@@ -637,10 +918,15 @@ CoreGraphicsStateClient_Blit( CoreGraphicsStateClient *client,
 
           CoreGraphicsStateClient_Update( client, DFXL_BLIT, client->state );
 
-          for (i = 0; i < num; i += 200) {
-               ret = CoreGraphicsState_Blit( client->gfx_state, &rects[i], &points[i], MIN( 200, num - i ) );
-               if (ret)
-                    return ret;
+          for (i = 0; i < num; i += BLIT_CHUNK) {
+               unsigned int n = MIN( BLIT_CHUNK, num - i );
+
+               if (!client_record_arrays( client, CGSC_BLIT, n,
+                                          &rects[i], sizeof(DFBRectangle), &points[i], sizeof(DFBPoint), NULL, 0 )) {
+                    ret = CoreGraphicsState_Blit( client->gfx_state, &rects[i], &points[i], n );
+                    if (ret)
+                         return ret;
+               }
           }
      }
 
@@ -661,6 +947,9 @@ CoreGraphicsStateClient_Blit2( CoreGraphicsStateClient *client,
      D_ASSERT( points1 != NULL );
      D_ASSERT( points2 != NULL );
 
+     if (client->display_list)
+          return DFB_UNSUPPORTED;
+
      if (!dfb_config->call_nodirect && (dfb_core_is_master( client->core ) || !fusion_config->secure_fusion)) {
           dfb_gfxcard_batchblit2( (DFBRectangle*) rects, (DFBPoint*) points1, (DFBPoint*) points2, num, client->state );
      }
@@ -669,9 +958,12 @@ CoreGraphicsStateClient_Blit2( CoreGraphicsStateClient *client,
 
           CoreGraphicsStateClient_Update( client, DFXL_BLIT2, client->state );
 
-          ret = CoreGraphicsState_Blit2( client->gfx_state, rects, points1, points2, num );
-          if (ret)
-               return ret;
+          if (!client_record_arrays( client, CGSC_BLIT2, num, rects, sizeof(DFBRectangle),
+                                     points1, sizeof(DFBPoint), points2, sizeof(DFBPoint) )) {
+               ret = CoreGraphicsState_Blit2( client->gfx_state, rects, points1, points2, num );
+               if (ret)
+                    return ret;
+          }
      }
 
      return DFB_OK;
@@ -693,6 +985,9 @@ CoreGraphicsStateClient_StretchBlit( CoreGraphicsStateClient *client,
      if (num == 0)
           return DFB_OK;
 
+     if (client->display_list)
+          return dfb_display_list_stretch_blit( client->display_list, client->state, srects, drects, num );
+
      if (!dfb_config->call_nodirect && (dfb_core_is_master( client->core ) || !fusion_config->secure_fusion)) {
           if (num == 1 && srects[0].w == drects[0].w && srects[0].h == drects[0].h) {
                DFBPoint point = { drects[0].x, drects[0].y };
@@ -713,16 +1008,22 @@ CoreGraphicsStateClient_StretchBlit( CoreGraphicsStateClient *client,
                CoreGraphicsStateClient_Update( client, DFXL_BLIT, client->state );
 
                DFBPoint point = { drects[0].x, drects[0].y };
-               ret = CoreGraphicsState_Blit( client->gfx_state, srects, &point, 1 );
-               if (ret)
-                    return ret;
+               if (!client_record_arrays( client, CGSC_BLIT, 1,
+                                          srects, sizeof(DFBRectangle), &point, sizeof(DFBPoint), NULL, 0 )) {
+                    ret = CoreGraphicsState_Blit( client->gfx_state, srects, &point, 1 );
+                    if (ret)
+                         return ret;
+               }
           }
           else {
                CoreGraphicsStateClient_Update( client, DFXL_STRETCHBLIT, client->state );
 
-               ret = CoreGraphicsState_StretchBlit( client->gfx_state, srects, drects, num );
-               if (ret)
-                    return ret;
+               if (!client_record_arrays( client, CGSC_STRETCH_BLIT, num,
+                                          srects, sizeof(DFBRectangle), drects, sizeof(DFBRectangle), NULL, 0 )) {
+                    ret = CoreGraphicsState_StretchBlit( client->gfx_state, srects, drects, num );
+                    if (ret)
+                         return ret;
+               }
           }
      }
 
@@ -743,6 +1044,9 @@ CoreGraphicsStateClient_TileBlit( CoreGraphicsStateClient *client,
      D_ASSERT( points1 != NULL );
      D_ASSERT( points2 != NULL );
 
+     if (client->display_list)
+          return dfb_display_list_tile_blit( client->display_list, client->state, rects, points1, points2, num );
+
      if (!dfb_config->call_nodirect && (dfb_core_is_master( client->core ) || !fusion_config->secure_fusion)) {
           u32 i;
 
@@ -755,9 +1059,12 @@ CoreGraphicsStateClient_TileBlit( CoreGraphicsStateClient *client,
 
           CoreGraphicsStateClient_Update( client, DFXL_BLIT, client->state );
 
-          ret = CoreGraphicsState_TileBlit( client->gfx_state, rects, points1, points2, num );
-          if (ret)
-               return ret;
+          if (!client_record_arrays( client, CGSC_TILE_BLIT, num, rects, sizeof(DFBRectangle),
+                                     points1, sizeof(DFBPoint), points2, sizeof(DFBPoint) )) {
+               ret = CoreGraphicsState_TileBlit( client->gfx_state, rects, points1, points2, num );
+               if (ret)
+                    return ret;
+          }
      }
 
      return DFB_OK;
@@ -774,6 +1081,9 @@ CoreGraphicsStateClient_TextureTriangles( CoreGraphicsStateClient *client,
      D_MAGIC_ASSERT( client, CoreGraphicsStateClient );
      D_ASSERT( vertices != NULL );
 
+     if (client->display_list)
+          return DFB_UNSUPPORTED;
+
      if (!dfb_config->call_nodirect && (dfb_core_is_master( client->core ) || !fusion_config->secure_fusion)) {
           dfb_gfxcard_texture_triangles( (DFBVertex*) vertices, num, formation, client->state );
      }
@@ -782,9 +1092,21 @@ CoreGraphicsStateClient_TextureTriangles( CoreGraphicsStateClient *client,
 
           CoreGraphicsStateClient_Update( client, DFXL_TEXTRIANGLES, client->state );
 
-          ret = CoreGraphicsState_TextureTriangles( client->gfx_state, vertices, num, formation );
-          if (ret)
-               return ret;
+          u32 *args = NULL;
+
+          if (num > 0 && num <= CORE_GRAPHICS_STATE_COMMANDS_SIZE)
+               args = client_record( client, CGSC_TEXTURE_TRIANGLES, num, sizeof(u32) + num * sizeof(DFBVertex) );
+
+          if (args) {
+               args[0] = formation;
+
+               direct_memcpy( args + 1, vertices, num * sizeof(DFBVertex) );
+          }
+          else {
+               ret = CoreGraphicsState_TextureTriangles( client->gfx_state, vertices, num, formation );
+               if (ret)
+                    return ret;
+          }
      }
 
      return DFB_OK;
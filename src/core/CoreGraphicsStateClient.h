@@ -23,6 +23,8 @@
 
 /**********************************************************************************************************************/
 
+#define CORE_GRAPHICS_STATE_CLIENT_REFS 8
+
 struct __DFB_CoreGraphicsStateClient {
      int                magic;
 
@@ -32,6 +34,14 @@ struct __DFB_CoreGraphicsStateClient {
      CardState         *state;     /* Local state structure. */
 
      CoreGraphicsState *gfx_state; /* Remote object for rendering, syncing values from local state as needed. */
+
+     u8                *commands;  /* Commands recorded for the remote object, executed at once when flushing. */
+     unsigned int       commands_length;
+
+     CoreSurface       *refs[CORE_GRAPHICS_STATE_CLIENT_REFS]; /* Surfaces used by the recorded commands. */
+     unsigned int       num_refs;
+
+     CoreDisplayList   *display_list; /* Display list recording the operations instead of rendering them. */
 };
 
 /**********************************************************************************************************************/
@@ -17,6 +17,7 @@
 */
 
 #include <core/CoreGraphicsState.h>
+#include <core/core.h>
 #include <core/graphics_state.h>
 
 D_DEBUG_DOMAIN( DirectFB_CoreGraphicsState, "DirectFB/CoreGraphicsState", "DirectFB CoreGraphicsState" );
@@ -503,6 +504,8 @@ IGraphicsState_Real__Flush( CoreGraphicsState *obj )
 {
      D_DEBUG_AT( DirectFB_CoreGraphicsState, "%s( %p )\n", __FUNCTION__, obj );
 
+     dfb_gfxcard_state_release_locks( &obj->state );
+
      dfb_gfxcard_flush();
 
      return DFB_OK;
@@ -533,6 +536,19 @@ IGraphicsState_Real__SetSrcConvolution( CoreGraphicsState          *obj,
      return DFB_OK;
 }
 
+DFBResult
+IGraphicsState_Real__SetSrcColorMatrix( CoreGraphicsState *obj,
+                                        const s32         *matrix )
+{
+     D_DEBUG_AT( DirectFB_CoreGraphicsState, "%s( %p )\n", __FUNCTION__, obj );
+
+     D_ASSERT( matrix != NULL );
+
+     dfb_state_set_src_colormatrix( &obj->state, matrix );
+
+     return DFB_OK;
+}
+
 DFBResult
 IGraphicsState_Real__GetAccelerationMask( CoreGraphicsState   *obj,
                                           DFBAccelerationMask *ret_accel )
@@ -543,3 +559,341 @@ IGraphicsState_Real__GetAccelerationMask( CoreGraphicsState   *obj,
 
      return dfb_state_get_acceleration_mask( &obj->state, ret_accel );
 }
+
+/**********************************************************************************************************************/
+
+static bool
+command_valid( const CoreGraphicsStateCommand *command )
+{
+     unsigned int fixed   = 0;
+     unsigned int element = 0;
+
+     switch (command->type) {
+          case CGSC_SET_DRAWING_FLAGS:
+          case CGSC_SET_BLITTING_FLAGS:
+          case CGSC_SET_SRC_BLEND:
+          case CGSC_SET_DST_BLEND:
+          case CGSC_SET_SRC_COLORKEY:
+          case CGSC_SET_DST_COLORKEY:
+          case CGSC_SET_DESTINATION:
+          case CGSC_SET_SOURCE:
+          case CGSC_SET_SOURCE_MASK:
+          case CGSC_SET_RENDER_OPTIONS:
+          case CGSC_SET_SOURCE2:
+               fixed = sizeof(u32);
+               break;
+
+          case CGSC_SET_CLIP:
+               fixed   = sizeof(DFBRegion);
+               element = sizeof(DFBRegion);
+               break;
+
+          case CGSC_SET_COLOR:
+               fixed = sizeof(DFBColor);
+               break;
+
+          case CGSC_SET_COLOR_AND_INDEX:
+               fixed = sizeof(DFBColor) + sizeof(u32);
+               break;
+
+          case CGSC_SET_SOURCE_MASK_VALS:
+               fixed = sizeof(DFBPoint) + sizeof(u32);
+               break;
+
+          case CGSC_SET_INDEX_TRANSLATION:
+               element = sizeof(s32);
+               break;
+
+          case CGSC_SET_COLORKEY:
+               fixed = sizeof(DFBColorKey);
+               break;
+
+          case CGSC_SET_MATRIX:
+               fixed = 9 * sizeof(s32);
+               break;
+
+          case CGSC_SET_FROM:
+          case CGSC_SET_TO:
+               fixed = 2 * sizeof(u32);
+               break;
+
+          case CGSC_SET_SRC_CONVOLUTION:
+               fixed = sizeof(DFBConvolutionFilter);
+               break;
+
+          case CGSC_SET_SRC_COLORMATRIX:
+               fixed = 12 * sizeof(s32);
+               break;
+
+          case CGSC_RELEASE_SOURCE:
+               break;
+
+          case CGSC_FILL_RECTANGLES:
+          case CGSC_DRAW_RECTANGLES:
+               element = sizeof(DFBRectangle);
+               break;
+
+          case CGSC_DRAW_LINES:
+               element = sizeof(DFBRegion);
+               break;
+
+          case CGSC_FILL_TRIANGLES:
+               element = sizeof(DFBTriangle);
+               break;
+
+          case CGSC_FILL_TRAPEZOIDS:
+               element = sizeof(DFBTrapezoid);
+               break;
+
+          case CGSC_FILL_QUADRANGLES:
+               element = sizeof(DFBPoint);
+               break;
+
+          case CGSC_FILL_SPANS:
+               fixed   = sizeof(s32);
+               element = sizeof(DFBSpan);
+               break;
+
+          case CGSC_BLIT:
+               element = sizeof(DFBRectangle) + sizeof(DFBPoint);
+               break;
+
+          case CGSC_BLIT2:
+          case CGSC_TILE_BLIT:
+               element = sizeof(DFBRectangle) + 2 * sizeof(DFBPoint);
+               break;
+
+          case CGSC_STRETCH_BLIT:
+               element = 2 * sizeof(DFBRectangle);
+               break;
+
+          case CGSC_TEXTURE_TRIANGLES:
+               fixed   = sizeof(u32);
+               element = sizeof(DFBVertex);
+               break;
+
+          default:
+               return false;
+     }
+
+     if (command->size < fixed)
+          return false;
+
+     return !element || command->num <= (command->size - fixed) / element;
+}
+
+static CoreSurface *
+command_surface( const void *args )
+{
+     DFBResult    ret;
+     u32          id;
+     CoreSurface *surface;
+
+     id = *(const u32*) args;
+
+     ret = (DFBResult) CoreSurface_Lookup( core_dfb, id, Core_GetIdentity(), &surface );
+     if (ret) {
+          D_DERROR( ret, "DirectFB/CoreGraphicsState: Looking up surface by ID %u failed!\n", id );
+          return NULL;
+     }
+
+     return surface;
+}
+
+DFBResult
+IGraphicsState_Real__Execute( CoreGraphicsState *obj,
+                              const u8          *commands,
+                              u32                length )
+{
+     u32 offset = 0;
+
+     D_DEBUG_AT( DirectFB_CoreGraphicsState, "%s( %p, %u )\n", __FUNCTION__, obj, length );
+
+     D_ASSERT( commands != NULL );
+
+     while (length - offset >= sizeof(CoreGraphicsStateCommand)) {
+          const CoreGraphicsStateCommand *command = (const CoreGraphicsStateCommand*) (commands + offset);
+          const void                     *args    = command + 1;
+          const u32                      *values  = args;
+          u32                             num     = command->num;
+          CoreSurface                    *surface;
+
+          offset += sizeof(CoreGraphicsStateCommand);
+
+          if (command->size > length - offset || (command->size & 3) || !command_valid( command )) {
+               D_ERROR( "DirectFB/CoreGraphicsState: Invalid command %u (num %u, size %u)!\n",
+                        command->type, command->num, command->size );
+               dfb_gfxcard_state_release_locks( &obj->state );
+               return DFB_INVARG;
+          }
+
+          offset += command->size;
+
+          switch (command->type) {
+               case CGSC_SET_DRAWING_FLAGS:
+                    IGraphicsState_Real__SetDrawingFlags( obj, values[0] );
+                    break;
+
+               case CGSC_SET_BLITTING_FLAGS:
+                    IGraphicsState_Real__SetBlittingFlags( obj, values[0] );
+                    break;
+
+               case CGSC_SET_CLIP:
+                    IGraphicsState_Real__SetClip( obj, args );
+                    dfb_state_set_clip_regions( &obj->state, (const DFBRegion*) args + 1, num );
+                    break;
+
+               case CGSC_SET_COLOR:
+                    IGraphicsState_Real__SetColor( obj, args );
+                    break;
+
+               case CGSC_SET_COLOR_AND_INDEX:
+                    IGraphicsState_Real__SetColorAndIndex( obj, args, *(const u32*) ((const DFBColor*) args + 1) );
+                    break;
+
+               case CGSC_SET_SRC_BLEND:
+                    IGraphicsState_Real__SetSrcBlend( obj, values[0] );
+                    break;
+
+               case CGSC_SET_DST_BLEND:
+                    IGraphicsState_Real__SetDstBlend( obj, values[0] );
+                    break;
+
+               case CGSC_SET_SRC_COLORKEY:
+                    IGraphicsState_Real__SetSrcColorKey( obj, values[0] );
+                    break;
+
+               case CGSC_SET_DST_COLORKEY:
+                    IGraphicsState_Real__SetDstColorKey( obj, values[0] );
+                    break;
+
+               /* Without the surface, following operations are refused instead of using the previous one. */
+               case CGSC_SET_DESTINATION:
+                    surface = command_surface( args );
+                    if (surface)
+                         IGraphicsState_Real__SetDestination( obj, surface );
+                    else
+                         dfb_state_set_destination( &obj->state, NULL );
+                    break;
+
+               case CGSC_SET_SOURCE:
+                    surface = command_surface( args );
+                    if (surface)
+                         IGraphicsState_Real__SetSource( obj, surface );
+                    else
+                         dfb_state_set_source( &obj->state, NULL );
+                    break;
+
+               case CGSC_SET_SOURCE_MASK:
+                    surface = command_surface( args );
+                    if (surface)
+                         IGraphicsState_Real__SetSourceMask( obj, surface );
+                    else
+                         dfb_state_set_source_mask( &obj->state, NULL );
+                    break;
+
+               case CGSC_SET_SOURCE_MASK_VALS:
+                    IGraphicsState_Real__SetSourceMaskVals( obj, args, *(const u32*) ((const DFBPoint*) args + 1) );
+                    break;
+
+               case CGSC_SET_INDEX_TRANSLATION:
+                    IGraphicsState_Real__SetIndexTranslation( obj, args, num );
+                    break;
+
+               case CGSC_SET_COLORKEY:
+                    IGraphicsState_Real__SetColorKey( obj, args );
+                    break;
+
+               case CGSC_SET_RENDER_OPTIONS:
+                    IGraphicsState_Real__SetRenderOptions( obj, values[0] );
+                    break;
+
+               case CGSC_SET_MATRIX:
+                    IGraphicsState_Real__SetMatrix( obj, args );
+                    break;
+
+               case CGSC_SET_SOURCE2:
+                    surface = command_surface( args );
+                    if (surface)
+                         IGraphicsState_Real__SetSource2( obj, surface );
+                    else
+                         dfb_state_set_source2( &obj->state, NULL );
+                    break;
+
+               case CGSC_SET_FROM:
+                    IGraphicsState_Real__SetFrom( obj, values[0], values[1] );
+                    break;
+
+               case CGSC_SET_TO:
+                    IGraphicsState_Real__SetTo( obj, values[0], values[1] );
+                    break;
+
+               case CGSC_SET_SRC_CONVOLUTION:
+                    IGraphicsState_Real__SetSrcConvolution( obj, args );
+                    break;
+
+               case CGSC_SET_SRC_COLORMATRIX:
+                    IGraphicsState_Real__SetSrcColorMatrix( obj, args );
+                    break;
+
+               case CGSC_RELEASE_SOURCE:
+                    IGraphicsState_Real__ReleaseSource( obj );
+                    break;
+
+               case CGSC_FILL_RECTANGLES:
+                    IGraphicsState_Real__FillRectangles( obj, args, num );
+                    break;
+
+               case CGSC_DRAW_RECTANGLES:
+                    IGraphicsState_Real__DrawRectangles( obj, args, num );
+                    break;
+
+               case CGSC_DRAW_LINES:
+                    IGraphicsState_Real__DrawLines( obj, args, num );
+                    break;
+
+               case CGSC_FILL_TRIANGLES:
+                    IGraphicsState_Real__FillTriangles( obj, args, num );
+                    break;
+
+               case CGSC_FILL_TRAPEZOIDS:
+                    IGraphicsState_Real__FillTrapezoids( obj, args, num );
+                    break;
+
+               case CGSC_FILL_QUADRANGLES:
+                    IGraphicsState_Real__FillQuadrangles( obj, args, num );
+                    break;
+
+               case CGSC_FILL_SPANS:
+                    IGraphicsState_Real__FillSpans( obj, values[0], (const DFBSpan*) (values + 1), num );
+                    break;
+
+               case CGSC_BLIT:
+                    IGraphicsState_Real__Blit( obj, args, (const DFBPoint*) ((const DFBRectangle*) args + num), num );
+                    break;
+
+               case CGSC_BLIT2:
+                    IGraphicsState_Real__Blit2( obj, args, (const DFBPoint*) ((const DFBRectangle*) args + num),
+                                                (const DFBPoint*) ((const DFBRectangle*) args + num) + num, num );
+                    break;
+
+               case CGSC_STRETCH_BLIT:
+                    IGraphicsState_Real__StretchBlit( obj, args, (const DFBRectangle*) args + num, num );
+                    break;
+
+               case CGSC_TILE_BLIT:
+                    IGraphicsState_Real__TileBlit( obj, args, (const DFBPoint*) ((const DFBRectangle*) args + num),
+                                                   (const DFBPoint*) ((const DFBRectangle*) args + num) + num, num );
+                    break;
+
+               case CGSC_TEXTURE_TRIANGLES:
+                    IGraphicsState_Real__TextureTriangles( obj, (const DFBVertex*) (values + 1), num, values[0] );
+                    break;
+          }
+     }
+
+     /* Keep buffer locks of the software fallback within the batch only. */
+     dfb_gfxcard_state_release_locks( &obj->state );
+
+     return DFB_OK;
+}
@@ -74,6 +74,9 @@ ISurfaceAllocation_Real__Updated( CoreSurfaceAllocation *obj,
                     buffer->written = obj;
                     buffer->read    = NULL;
 
+                    /* Written outside of the graphics core, the whole surface is considered damaged. */
+                    dfb_surface_damage_add( surface, NULL );
+
                     D_DEBUG_AT( DirectFB_CoreSurfaceAllocation, "  -> serial  %lu\n", buffer->serial.value );
                }
                else {
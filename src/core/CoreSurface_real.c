@@ -91,42 +91,7 @@ manage_interlocks( CoreSurfaceAllocation  *allocation,
                    CoreSurfaceAccessorID   accessor,
                    CoreSurfaceAccessFlags  access )
 {
-     int locks;
-
-     locks = dfb_surface_allocation_locks( allocation );
-
-     /* Software read/write access. */
-     if (accessor != CSAID_GPU) {
-          /* If hardware has written or is writing. */
-          if (allocation->accessed[CSAID_GPU] & CSAF_WRITE) {
-               /* Wait for the operation to finish. */
-               dfb_gfxcard_wait_serial( &allocation->gfx_serial );
-
-               /* Software read access after hardware write requires flush of the (bus) read cache. */
-               dfb_gfxcard_flush_read_cache();
-
-               if (!locks) {
-                    /* Clear hardware write access. */
-                    allocation->accessed[CSAID_GPU] &= ~CSAF_WRITE;
-
-                    /* Clear hardware read access (to avoid syncing twice). */
-                    allocation->accessed[CSAID_GPU] &= ~CSAF_READ;
-               }
-          }
-
-          /* Software write access. */
-          if (access & CSAF_WRITE) {
-               /* If hardware has (to) read... */
-               if (allocation->accessed[CSAID_GPU] & CSAF_READ) {
-                    /* Wait for the operation to finish. */
-                    dfb_gfxcard_wait_serial( &allocation->gfx_serial );
-
-                    /* Clear hardware read access. */
-                    if (!locks)
-                         allocation->accessed[CSAID_GPU] &= ~CSAF_READ;
-               }
-          }
-     }
+     /* Waiting for the operations accessing the allocation is done by dfb_surface_pool_lock() when locking it. */
 
      /* Hardware read or write access. */
      if (accessor == CSAID_GPU && access & (CSAF_READ | CSAF_WRITE)) {
@@ -136,7 +101,7 @@ manage_interlocks( CoreSurfaceAllocation  *allocation,
                dfb_gfxcard_flush_texture_cache();
 
                /* Clear software read and write access. */
-               if (!locks)
+               if (!dfb_surface_allocation_locks( allocation ))
                     allocation->accessed[CSAID_CPU] &= ~(CSAF_READ | CSAF_WRITE);
           }
      }
@@ -524,8 +489,21 @@ ISurface_Real__Flip2( CoreSurface         *obj,
                         goto out;
                }
                else {
-                    dfb_gfx_copy_regions_client( obj, DSBR_BACK, DSSE_LEFT, obj, DSBR_FRONT, DSSE_LEFT, &l,
-                                                 1, 0, 0, NULL );
+                    DFBRegion regions[CORE_SURFACE_DAMAGE_REGIONS];
+                    int       num;
+                    bool      complete;
+
+                    /* Copy only what has been rendered since the front buffer was up to date. */
+                    if (dfb_surface_damage_get( obj, &l, regions, &num, &complete )) {
+                         if (num)
+                              dfb_gfx_copy_regions_client( obj, DSBR_BACK, DSSE_LEFT, obj, DSBR_FRONT, DSSE_LEFT,
+                                                           regions, num, 0, 0, NULL );
+                    }
+                    else
+                         dfb_gfx_copy_regions_client( obj, DSBR_BACK, DSSE_LEFT, obj, DSBR_FRONT, DSSE_LEFT, &l,
+                                                      1, 0, 0, NULL );
+
+                    dfb_surface_damage_next( obj, complete );
                }
           }
      }
@@ -127,6 +127,8 @@ typedef struct {
      unsigned int identity_count;
 
      int          calling;
+
+     bool         queue_locking; /* buffers are locked for operations queued by Genefx */
 } CoreTLS;
 
 /**********************************************************************************************************************/
@@ -27,6 +27,7 @@
 typedef struct __DFB_CardState               CardState;
 typedef struct __DFB_CoreCleanup             CoreCleanup;
 typedef struct __DFB_CoreDFB                 CoreDFB;
+typedef struct __DFB_CoreDisplayList         CoreDisplayList;
 typedef struct __DFB_CoreGraphicsState       CoreGraphicsState;
 typedef struct __DFB_CoreGraphicsStateClient CoreGraphicsStateClient;
 typedef struct __DFB_CoreFont                CoreFont;
@@ -0,0 +1,1204 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#include <core/CoreGraphicsStateClient.h>
+#include <core/display_list.h>
+#include <core/state.h>
+#include <core/surface.h>
+#include <direct/memcpy.h>
+#include <gfx/clip.h>
+
+D_DEBUG_DOMAIN( Core_DisplayList, "Core/DisplayList", "DirectFB Core Display List" );
+
+/**********************************************************************************************************************/
+
+typedef enum {
+     CDLC_STATE,           /* 'num' is the index of the recorded state */
+     CDLC_FILL_RECTANGLES, /* DFBRectangle */
+     CDLC_DRAW_RECTANGLES, /* DFBRectangle, only recorded with DSRO_MATRIX, otherwise filling the clipped outlines */
+     CDLC_DRAW_LINES,      /* DFBRegion */
+     CDLC_FILL_TRIANGLES,  /* DFBTriangle */
+     CDLC_BLIT,            /* DFBRectangle, DFBPoint */
+     CDLC_STRETCH_BLIT,    /* DFBRectangle, DFBRectangle */
+     CDLC_TILE_BLIT        /* DFBRectangle, DFBPoint, DFBPoint */
+} DisplayListCommandType;
+
+typedef struct {
+     DisplayListCommandType type;
+     unsigned int           num;  /* number of elements following the command */
+} DisplayListCommand;
+
+/*
+ * Values of the state relevant to the recorded operations, unused values are zero.
+ */
+typedef struct {
+     bool                     blitting;
+
+     DFBRegion                clip;
+     DFBSurfaceRenderOptions  render_options;
+     s32                      matrix[9];
+
+     DFBSurfaceDrawingFlags   drawingflags;
+     DFBSurfaceBlittingFlags  blittingflags;
+     DFBColor                 color;
+     unsigned int             color_index;
+     DFBSurfaceBlendFunction  src_blend;
+     DFBSurfaceBlendFunction  dst_blend;
+     u32                      src_colorkey;
+     u32                      dst_colorkey;
+     DFBColorKeyExtended      src_colorkey_extended;
+     DFBColorKeyExtended      dst_colorkey_extended;
+
+     CoreSurface             *source;
+     u32                      source_flip_count;
+     bool                     source_flip_count_used;
+     DFBSurfaceBufferRole     from;
+     DFBSurfaceStereoEye      from_eye;
+
+     CoreSurface             *source_mask;
+     DFBPoint                 src_mask_offset;
+     DFBSurfaceMaskFlags      src_mask_flags;
+
+     DFBColorKey              colorkey;
+     DFBConvolutionFilter     src_convolution;
+     s32                      src_colormatrix[12];
+} DisplayListState;
+
+struct __DFB_CoreDisplayList {
+     int                      magic;
+
+     CoreDFB                 *core;
+
+     DirectMutex              lock;       /* lock for replaying */
+
+     u8                      *commands;   /* recorded commands, each followed by its elements */
+     unsigned int             length;
+     unsigned int             size;
+     int                      last;       /* offset of the last operation, -1 if a state has been recorded after it */
+     unsigned int             max_size;   /* size of the elements of the largest operation */
+
+     DisplayListState        *states;     /* recorded states, the last one being the current state */
+     unsigned int             num_states;
+
+     CoreSurface            **refs;       /* surfaces used by the recorded states */
+     unsigned int             num_refs;
+
+     DFBRegion                bounds;     /* bounding region of the recorded operations, empty if x1 > x2 */
+
+     CardState                state;      /* state for replaying, keeping its values from one replay to the next */
+     CoreGraphicsStateClient  client;
+
+     void                    *buffer;     /* elements of the replayed operation, translated or split into arrays */
+};
+
+/**********************************************************************************************************************/
+
+static DFBResult
+list_ref( CoreDisplayList *list,
+          CoreSurface     *surface )
+{
+     DFBResult     ret;
+     CoreSurface **refs;
+     unsigned int  i;
+
+     if (!surface)
+          return DFB_OK;
+
+     for (i = 0; i < list->num_refs; i++) {
+          if (list->refs[i] == surface)
+               return DFB_OK;
+     }
+
+     refs = D_REALLOC( list->refs, (list->num_refs + 1) * sizeof(CoreSurface*) );
+     if (!refs)
+          return D_OOM();
+
+     list->refs = refs;
+
+     ret = dfb_surface_ref( surface );
+     if (ret)
+          return ret;
+
+     list->refs[list->num_refs++] = surface;
+
+     return DFB_OK;
+}
+
+/*
+ * Make sure there's space for a command with 'size' bytes of elements.
+ */
+static DFBResult
+list_reserve( CoreDisplayList *list,
+              unsigned int     size )
+{
+     unsigned int  need = list->length + sizeof(DisplayListCommand) + size;
+     u8           *commands;
+
+     if (need <= list->size)
+          return DFB_OK;
+
+     if (need < list->size * 2)
+          need = list->size * 2;
+
+     if (need < 4096)
+          need = 4096;
+
+     commands = D_REALLOC( list->commands, need );
+     if (!commands)
+          return D_OOM();
+
+     list->commands = commands;
+     list->size     = need;
+
+     return DFB_OK;
+}
+
+/*
+ * Record the state values relevant to the operation, if they differ from the current state.
+ */
+static DFBResult
+list_update_state( CoreDisplayList *list,
+                   CardState       *state,
+                   bool             blitting )
+{
+     DFBResult           ret;
+     DisplayListState    current;
+     DisplayListState   *states;
+     DisplayListCommand *command;
+
+     D_MAGIC_ASSERT( state, CardState );
+
+     memset( &current, 0, sizeof(current) );
+
+     current.blitting       = blitting;
+     current.clip           = state->clip;
+     current.render_options = state->render_options;
+
+     if (state->render_options & DSRO_MATRIX)
+          direct_memcpy( current.matrix, state->matrix, sizeof(current.matrix) );
+
+     if (!blitting) {
+          current.drawingflags = state->drawingflags;
+          current.color        = state->color;
+          current.color_index  = state->color_index;
+
+          if (state->drawingflags & DSDRAW_BLEND) {
+               current.src_blend = state->src_blend;
+               current.dst_blend = state->dst_blend;
+          }
+
+          if (state->drawingflags & DSDRAW_DST_COLORKEY)
+               current.dst_colorkey = state->dst_colorkey;
+     }
+     else {
+          if (state->blittingflags & DSBLIT_INDEX_TRANSLATION)
+               return DFB_UNSUPPORTED;
+
+          current.blittingflags = state->blittingflags;
+          current.source        = state->source;
+          current.from          = state->from;
+          current.from_eye      = state->from_eye;
+
+          if (state->source_flip_count_used) {
+               current.source_flip_count      = state->source_flip_count;
+               current.source_flip_count_used = true;
+          }
+
+          if (state->blittingflags & (DSBLIT_BLEND_COLORALPHA | DSBLIT_COLORIZE | DSBLIT_SRC_PREMULTCOLOR)) {
+               current.color       = state->color;
+               current.color_index = state->color_index;
+          }
+
+          if (state->blittingflags & (DSBLIT_BLEND_ALPHACHANNEL | DSBLIT_BLEND_COLORALPHA)) {
+               current.src_blend = state->src_blend;
+               current.dst_blend = state->dst_blend;
+          }
+
+          if (state->blittingflags & DSBLIT_SRC_COLORKEY)
+               current.src_colorkey = state->src_colorkey;
+
+          if (state->blittingflags & DSBLIT_DST_COLORKEY)
+               current.dst_colorkey = state->dst_colorkey;
+
+          if (state->blittingflags & DSBLIT_SRC_COLORKEY_EXTENDED)
+               current.src_colorkey_extended = state->src_colorkey_extended;
+
+          if (state->blittingflags & DSBLIT_DST_COLORKEY_EXTENDED)
+               current.dst_colorkey_extended = state->dst_colorkey_extended;
+
+          if (state->blittingflags & (DSBLIT_SRC_MASK_ALPHA | DSBLIT_SRC_MASK_COLOR)) {
+               current.source_mask     = state->source_mask;
+               current.src_mask_offset = state->src_mask_offset;
+               current.src_mask_flags  = state->src_mask_flags;
+          }
+
+          if (state->blittingflags & DSBLIT_COLORKEY_PROTECT)
+               current.colorkey = state->colorkey;
+
+          if (state->blittingflags & DSBLIT_SRC_CONVOLUTION)
+               current.src_convolution = state->src_convolution;
+
+          if (state->blittingflags & DSBLIT_SRC_COLORMATRIX)
+               direct_memcpy( current.src_colormatrix, state->src_colormatrix, sizeof(current.src_colormatrix) );
+     }
+
+     if (list->num_states && !memcmp( &list->states[list->num_states - 1], &current, sizeof(current) ))
+          return DFB_OK;
+
+     ret = list_ref( list, current.source );
+     if (ret)
+          return ret;
+
+     ret = list_ref( list, current.source_mask );
+     if (ret)
+          return ret;
+
+     ret = list_reserve( list, 0 );
+     if (ret)
+          return ret;
+
+     states = D_REALLOC( list->states, (list->num_states + 1) * sizeof(DisplayListState) );
+     if (!states)
+          return D_OOM();
+
+     list->states = states;
+
+     direct_memcpy( &list->states[list->num_states], &current, sizeof(current) );
+
+     command = (DisplayListCommand*) (list->commands + list->length);
+
+     command->type = CDLC_STATE;
+     command->num  = list->num_states++;
+
+     list->length += sizeof(DisplayListCommand);
+     list->last    = -1;
+
+     return DFB_OK;
+}
+
+/*
+ * Return the space for up to 'num' elements of an operation, which are appended to the last operation if it's of the
+ * same type without a state change in between.
+ */
+static void *
+list_begin( CoreDisplayList        *list,
+            DisplayListCommandType  type,
+            unsigned int            num,
+            unsigned int            size )
+{
+     DisplayListCommand *command;
+
+     if (list_reserve( list, num * size ))
+          return NULL;
+
+     if (list->last >= 0) {
+          command = (DisplayListCommand*) (list->commands + list->last);
+
+          if (command->type == type)
+               return list->commands + list->length;
+     }
+
+     return list->commands + list->length + sizeof(DisplayListCommand);
+}
+
+/*
+ * Finish the operation started with list_begin() after storing 'num' elements.
+ */
+static void
+list_end( CoreDisplayList        *list,
+          DisplayListCommandType  type,
+          unsigned int            num,
+          unsigned int            size )
+{
+     DisplayListCommand *command;
+
+     if (!num)
+          return;
+
+     if (list->last >= 0 && ((DisplayListCommand*) (list->commands + list->last))->type == type) {
+          command = (DisplayListCommand*) (list->commands + list->last);
+
+          command->num += num;
+     }
+     else {
+          command = (DisplayListCommand*) (list->commands + list->length);
+
+          command->type = type;
+          command->num  = num;
+
+          list->last    = list->length;
+          list->length += sizeof(DisplayListCommand);
+     }
+
+     list->length += num * size;
+
+     if (list->max_size < command->num * size)
+          list->max_size = command->num * size;
+}
+
+static void
+list_extend_bounds( CoreDisplayList *list,
+                    const DFBRegion *region )
+{
+     if (list->bounds.x1 > list->bounds.x2)
+          list->bounds = *region;
+     else
+          dfb_region_region_union( &list->bounds, region );
+}
+
+/*
+ * Extend the bounds by a region of the destination, returning false if it's outside of the clipping region.
+ */
+static bool
+list_extend_bounds_clipped( CoreDisplayList *list,
+                            CardState       *state,
+                            int              x1,
+                            int              y1,
+                            int              x2,
+                            int              y2 )
+{
+     DFBRegion region = { x1, y1, x2, y2 };
+
+     if (!dfb_region_region_intersect( &region, &state->clip ))
+          return false;
+
+     list_extend_bounds( list, &region );
+
+     return true;
+}
+
+/**********************************************************************************************************************/
+
+DFBResult
+dfb_display_list_create( CoreDFB          *core,
+                         CoreDisplayList **ret_list )
+{
+     DFBResult        ret;
+     CoreDisplayList *list;
+
+     D_DEBUG_AT( Core_DisplayList, "%s( %p )\n", __FUNCTION__, core );
+
+     D_ASSERT( ret_list != NULL );
+
+     list = D_CALLOC( 1, sizeof(CoreDisplayList) );
+     if (!list)
+          return D_OOM();
+
+     list->core      = core;
+     list->last      = -1;
+     list->bounds.x1 = 0;
+     list->bounds.x2 = -1;
+
+     dfb_state_init( &list->state, core );
+
+     list->state.modified = SMF_ALL;
+
+     ret = CoreGraphicsStateClient_Init( &list->client, &list->state );
+     if (ret) {
+          dfb_state_destroy( &list->state );
+          D_FREE( list );
+          return ret;
+     }
+
+     direct_mutex_init( &list->lock );
+
+     D_MAGIC_SET( list, CoreDisplayList );
+
+     *ret_list = list;
+
+     return DFB_OK;
+}
+
+void
+dfb_display_list_destroy( CoreDisplayList *list )
+{
+     unsigned int i;
+
+     D_DEBUG_AT( Core_DisplayList, "%s( %p )\n", __FUNCTION__, list );
+
+     D_MAGIC_ASSERT( list, CoreDisplayList );
+
+     CoreGraphicsStateClient_Deinit( &list->client );
+
+     dfb_state_stop_drawing( &list->state );
+
+     dfb_state_set_destination( &list->state, NULL );
+     dfb_state_set_source( &list->state, NULL );
+     dfb_state_set_source_mask( &list->state, NULL );
+
+     dfb_state_destroy( &list->state );
+
+     for (i = 0; i < list->num_refs; i++)
+          dfb_surface_unref( list->refs[i] );
+
+     if (list->refs)
+          D_FREE( list->refs );
+
+     if (list->states)
+          D_FREE( list->states );
+
+     if (list->commands)
+          D_FREE( list->commands );
+
+     if (list->buffer)
+          D_FREE( list->buffer );
+
+     direct_mutex_deinit( &list->lock );
+
+     D_MAGIC_CLEAR( list );
+
+     D_FREE( list );
+}
+
+DFBResult
+dfb_display_list_fill_rectangles( CoreDisplayList    *list,
+                                  CardState          *state,
+                                  const DFBRectangle *rects,
+                                  unsigned int        num )
+{
+     DFBResult     ret;
+     DFBRectangle *elements;
+     unsigned int  i;
+     unsigned int  n = 0;
+
+     D_DEBUG_AT( Core_DisplayList, "%s( %p, %u )\n", __FUNCTION__, list, num );
+
+     D_MAGIC_ASSERT( list, CoreDisplayList );
+     D_ASSERT( rects != NULL );
+
+     ret = list_update_state( list, state, false );
+     if (ret)
+          return ret;
+
+     elements = list_begin( list, CDLC_FILL_RECTANGLES, num, sizeof(DFBRectangle) );
+     if (!elements)
+          return DFB_NOSYSTEMMEMORY;
+
+     for (i = 0; i < num; i++) {
+          DFBRectangle rect = rects[i];
+
+          if (rect.w < 1 || rect.h < 1)
+               continue;
+
+          if (state->render_options & DSRO_MATRIX)
+               list_extend_bounds( list, &state->clip );
+          else if (dfb_clip_rectangle( &state->clip, &rect ))
+               list_extend_bounds( list, &DFB_REGION_INIT_FROM_RECTANGLE( &rect ) );
+          else
+               continue;
+
+          elements[n++] = rect;
+     }
+
+     list_end( list, CDLC_FILL_RECTANGLES, n, sizeof(DFBRectangle) );
+
+     return DFB_OK;
+}
+
+DFBResult
+dfb_display_list_draw_rectangles( CoreDisplayList    *list,
+                                  CardState          *state,
+                                  const DFBRectangle *rects,
+                                  unsigned int        num )
+{
+     DFBResult     ret;
+     DFBRectangle *elements;
+     unsigned int  i;
+     unsigned int  n = 0;
+
+     D_DEBUG_AT( Core_DisplayList, "%s( %p, %u )\n", __FUNCTION__, list, num );
+
+     D_MAGIC_ASSERT( list, CoreDisplayList );
+     D_ASSERT( rects != NULL );
+
+     ret = list_update_state( list, state, false );
+     if (ret)
+          return ret;
+
+     if (state->render_options & DSRO_MATRIX) {
+          elements = list_begin( list, CDLC_DRAW_RECTANGLES, num, sizeof(DFBRectangle) );
+          if (!elements)
+               return DFB_NOSYSTEMMEMORY;
+
+          for (i = 0; i < num; i++) {
+               if (rects[i].w < 1 || rects[i].h < 1)
+                    continue;
+
+               elements[n++] = rects[i];
+          }
+
+          if (n)
+               list_extend_bounds( list, &state->clip );
+
+          list_end( list, CDLC_DRAW_RECTANGLES, n, sizeof(DFBRectangle) );
+
+          return DFB_OK;
+     }
+
+     /* Record the visible parts of the outlines. */
+     elements = list_begin( list, CDLC_FILL_RECTANGLES, num * 4, sizeof(DFBRectangle) );
+     if (!elements)
+          return DFB_NOSYSTEMMEMORY;
+
+     for (i = 0; i < num; i++) {
+          DFBRectangle rect = rects[i];
+          int          j, outlines;
+
+          if (rect.w < 1 || rect.h < 1 || !dfb_rectangle_region_intersects( &rect, &state->clip ))
+               continue;
+
+          dfb_build_clipped_rectangle_outlines( &rect, &state->clip, &elements[n], &outlines );
+
+          for (j = 0; j < outlines; j++)
+               list_extend_bounds( list, &DFB_REGION_INIT_FROM_RECTANGLE( &elements[n + j] ) );
+
+          n += outlines;
+     }
+
+     list_end( list, CDLC_FILL_RECTANGLES, n, sizeof(DFBRectangle) );
+
+     return DFB_OK;
+}
+
+DFBResult
+dfb_display_list_draw_lines( CoreDisplayList *list,
+                             CardState       *state,
+                             const DFBRegion *lines,
+                             unsigned int     num )
+{
+     DFBResult     ret;
+     DFBRegion    *elements;
+     unsigned int  i;
+     unsigned int  n = 0;
+
+     D_DEBUG_AT( Core_DisplayList, "%s( %p, %u )\n", __FUNCTION__, list, num );
+
+     D_MAGIC_ASSERT( list, CoreDisplayList );
+     D_ASSERT( lines != NULL );
+
+     ret = list_update_state( list, state, false );
+     if (ret)
+          return ret;
+
+     elements = list_begin( list, CDLC_DRAW_LINES, num, sizeof(DFBRegion) );
+     if (!elements)
+          return DFB_NOSYSTEMMEMORY;
+
+     for (i = 0; i < num; i++) {
+          DFBRegion line = lines[i];
+
+          if (state->render_options & DSRO_MATRIX)
+               list_extend_bounds( list, &state->clip );
+          else if (dfb_clip_line( &state->clip, &line ))
+               list_extend_bounds( list, &(DFBRegion) { MIN( line.x1, line.x2 ), MIN( line.y1, line.y2 ),
+                                                        MAX( line.x1, line.x2 ), MAX( line.y1, line.y2 ) } );
+          else
+               continue;
+
+          elements[n++] = line;
+     }
+
+     list_end( list, CDLC_DRAW_LINES, n, sizeof(DFBRegion) );
+
+     return DFB_OK;
+}
+
+DFBResult
+dfb_display_list_fill_triangles( CoreDisplayList   *list,
+                                 CardState         *state,
+                                 const DFBTriangle *triangles,
+                                 unsigned int       num )
+{
+     DFBResult     ret;
+     DFBTriangle  *elements;
+     unsigned int  i;
+     unsigned int  n = 0;
+
+     D_DEBUG_AT( Core_DisplayList, "%s( %p, %u )\n", __FUNCTION__, list, num );
+
+     D_MAGIC_ASSERT( list, CoreDisplayList );
+     D_ASSERT( triangles != NULL );
+
+     ret = list_update_state( list, state, false );
+     if (ret)
+          return ret;
+
+     elements = list_begin( list, CDLC_FILL_TRIANGLES, num, sizeof(DFBTriangle) );
+     if (!elements)
+          return DFB_NOSYSTEMMEMORY;
+
+     for (i = 0; i < num; i++) {
+          const DFBTriangle *tri = &triangles[i];
+
+          if (state->render_options & DSRO_MATRIX)
+               list_extend_bounds( list, &state->clip );
+          else if (!list_extend_bounds_clipped( list, state,
+                                                MIN( tri->x1, MIN( tri->x2, tri->x3 ) ),
+                                                MIN( tri->y1, MIN( tri->y2, tri->y3 ) ),
+                                                MAX( tri->x1, MAX( tri->x2, tri->x3 ) ),
+                                                MAX( tri->y1, MAX( tri->y2, tri->y3 ) ) ))
+               continue;
+
+          elements[n++] = *tri;
+     }
+
+     list_end( list, CDLC_FILL_TRIANGLES, n, sizeof(DFBTriangle) );
+
+     return DFB_OK;
+}
+
+DFBResult
+dfb_display_list_fill_spans( CoreDisplayList *list,
+                             CardState       *state,
+                             int              y,
+                             const DFBSpan   *spans,
+                             unsigned int     num )
+{
+     DFBResult     ret;
+     DFBRectangle *rects;
+     unsigned int  i;
+
+     D_DEBUG_AT( Core_DisplayList, "%s( %p, %d, %u )\n", __FUNCTION__, list, y, num );
+
+     D_MAGIC_ASSERT( list, CoreDisplayList );
+     D_ASSERT( spans != NULL );
+
+     if (!num)
+          return DFB_OK;
+
+     rects = D_MALLOC( num * sizeof(DFBRectangle) );
+     if (!rects)
+          return D_OOM();
+
+     for (i = 0; i < num; i++)
+          rects[i] = (DFBRectangle) { spans[i].x, y + i, spans[i].w, 1 };
+
+     ret = dfb_display_list_fill_rectangles( list, state, rects, num );
+
+     D_FREE( rects );
+
+     return ret;
+}
+
+DFBResult
+dfb_display_list_blit( CoreDisplayList    *list,
+                       CardState          *state,
+                       const DFBRectangle *rects,
+                       const DFBPoint     *points,
+                       unsigned int        num )
+{
+     DFBResult     ret;
+     u8           *elements;
+     unsigned int  i;
+     unsigned int  n = 0;
+
+     D_DEBUG_AT( Core_DisplayList, "%s( %p, %u )\n", __FUNCTION__, list, num );
+
+     D_MAGIC_ASSERT( list, CoreDisplayList );
+     D_ASSERT( rects != NULL );
+     D_ASSERT( points != NULL );
+
+     ret = list_update_state( list, state, true );
+     if (ret)
+          return ret;
+
+     elements = list_begin( list, CDLC_BLIT, num, sizeof(DFBRectangle) + sizeof(DFBPoint) );
+     if (!elements)
+          return DFB_NOSYSTEMMEMORY;
+
+     for (i = 0; i < num; i++) {
+          DFBRectangle rect = rects[i];
+          int          dx   = points[i].x;
+          int          dy   = points[i].y;
+
+          if (state->render_options & DSRO_MATRIX) {
+               list_extend_bounds( list, &state->clip );
+          }
+          else if (state->blittingflags & (DSBLIT_ROTATE90 | DSBLIT_ROTATE180 | DSBLIT_ROTATE270 |
+                                           DSBLIT_FLIP_HORIZONTAL | DSBLIT_FLIP_VERTICAL)) {
+               int w = (state->blittingflags & (DSBLIT_ROTATE90 | DSBLIT_ROTATE270)) ? rect.h : rect.w;
+               int h = (state->blittingflags & (DSBLIT_ROTATE90 | DSBLIT_ROTATE270)) ? rect.w : rect.h;
+
+               if (w < 1 || h < 1 || !list_extend_bounds_clipped( list, state, dx, dy, dx + w - 1, dy + h - 1 ))
+                    continue;
+          }
+          else {
+               if (!dfb_clip_blit_precheck( &state->clip, rect.w, rect.h, dx, dy ))
+                    continue;
+
+               dfb_clip_blit( &state->clip, &rect, &dx, &dy );
+
+               list_extend_bounds( list, &DFB_REGION_INIT_FROM_RECTANGLE_VALS( dx, dy, rect.w, rect.h ) );
+          }
+
+          direct_memcpy( elements, &rect, sizeof(DFBRectangle) );
+          direct_memcpy( elements + sizeof(DFBRectangle), &(DFBPoint) { dx, dy }, sizeof(DFBPoint) );
+
+          elements += sizeof(DFBRectangle) + sizeof(DFBPoint);
+
+          n++;
+     }
+
+     list_end( list, CDLC_BLIT, n, sizeof(DFBRectangle) + sizeof(DFBPoint) );
+
+     return DFB_OK;
+}
+
+DFBResult
+dfb_display_list_stretch_blit( CoreDisplayList    *list,
+                               CardState          *state,
+                               const DFBRectangle *srects,
+                               const DFBRectangle *drects,
+                               unsigned int        num )
+{
+     DFBResult     ret;
+     DFBRectangle *elements;
+     unsigned int  i;
+     unsigned int  n = 0;
+
+     D_DEBUG_AT( Core_DisplayList, "%s( %p, %u )\n", __FUNCTION__, list, num );
+
+     D_MAGIC_ASSERT( list, CoreDisplayList );
+     D_ASSERT( srects != NULL );
+     D_ASSERT( drects != NULL );
+
+     ret = list_update_state( list, state, true );
+     if (ret)
+          return ret;
+
+     elements = list_begin( list, CDLC_STRETCH_BLIT, num, 2 * sizeof(DFBRectangle) );
+     if (!elements)
+          return DFB_NOSYSTEMMEMORY;
+
+     for (i = 0; i < num; i++) {
+          const DFBRectangle *drect = &drects[i];
+
+          if (drect->w < 1 || drect->h < 1 || srects[i].w < 1 || srects[i].h < 1)
+               continue;
+
+          /* Only culled, as clipping would change the scaling of the remaining part. */
+          if (state->render_options & DSRO_MATRIX)
+               list_extend_bounds( list, &state->clip );
+          else if (!list_extend_bounds_clipped( list, state, DFB_REGION_VALS_FROM_RECTANGLE( drect ) ))
+               continue;
+
+          elements[n * 2]     = srects[i];
+          elements[n * 2 + 1] = *drect;
+
+          n++;
+     }
+
+     list_end( list, CDLC_STRETCH_BLIT, n, 2 * sizeof(DFBRectangle) );
+
+     return DFB_OK;
+}
+
+DFBResult
+dfb_display_list_tile_blit( CoreDisplayList    *list,
+                            CardState          *state,
+                            const DFBRectangle *rects,
+                            const DFBPoint     *points1,
+                            const DFBPoint     *points2,
+                            unsigned int        num )
+{
+     DFBResult     ret;
+     u8           *elements;
+     unsigned int  i;
+     unsigned int  n = 0;
+
+     D_DEBUG_AT( Core_DisplayList, "%s( %p, %u )\n", __FUNCTION__, list, num );
+
+     D_MAGIC_ASSERT( list, CoreDisplayList );
+     D_ASSERT( rects != NULL );
+     D_ASSERT( points1 != NULL );
+     D_ASSERT( points2 != NULL );
+
+     ret = list_update_state( list, state, true );
+     if (ret)
+          return ret;
+
+     elements = list_begin( list, CDLC_TILE_BLIT, num, sizeof(DFBRectangle) + 2 * sizeof(DFBPoint) );
+     if (!elements)
+          return DFB_NOSYSTEMMEMORY;
+
+     for (i = 0; i < num; i++) {
+          if (rects[i].w < 1 || rects[i].h < 1 || points1[i].x > points2[i].x || points1[i].y > points2[i].y)
+               continue;
+
+          /* Only culled, as the tiles are aligned to the first point. */
+          if (state->render_options & DSRO_MATRIX)
+               list_extend_bounds( list, &state->clip );
+          else if (!list_extend_bounds_clipped( list, state, points1[i].x, points1[i].y, points2[i].x, points2[i].y ))
+               continue;
+
+          direct_memcpy( elements, &rects[i], sizeof(DFBRectangle) );
+          direct_memcpy( elements + sizeof(DFBRectangle), &points1[i], sizeof(DFBPoint) );
+          direct_memcpy( elements + sizeof(DFBRectangle) + sizeof(DFBPoint), &points2[i], sizeof(DFBPoint) );
+
+          elements += sizeof(DFBRectangle) + 2 * sizeof(DFBPoint);
+
+          n++;
+     }
+
+     list_end( list, CDLC_TILE_BLIT, n, sizeof(DFBRectangle) + 2 * sizeof(DFBPoint) );
+
+     return DFB_OK;
+}
+
+DFBResult
+dfb_display_list_get_bounds( CoreDisplayList *list,
+                             DFBRegion       *ret_bounds )
+{
+     D_MAGIC_ASSERT( list, CoreDisplayList );
+     D_ASSERT( ret_bounds != NULL );
+
+     if (list->bounds.x1 > list->bounds.x2)
+          return DFB_BUFFEREMPTY;
+
+     *ret_bounds = list->bounds;
+
+     return DFB_OK;
+}
+
+/**********************************************************************************************************************/
+
+/*
+ * Apply a recorded state to the replay state, returning false if nothing is visible until the next state.
+ */
+static bool
+list_apply_state( CoreDisplayList        *list,
+                  const DisplayListState *recorded,
+                  const DFBRegion        *clip,
+                  int                     dx,
+                  int                     dy )
+{
+     CardState *state = &list->state;
+     DFBRegion  region = DFB_REGION_INIT_TRANSLATED( &recorded->clip, dx, dy );
+
+     if (!dfb_region_region_intersect( &region, clip ))
+          return false;
+
+     dfb_state_set_clip( state, &region );
+
+     dfb_state_set_render_options( state, recorded->render_options );
+
+     if (recorded->render_options & DSRO_MATRIX) {
+          s32 matrix[9];
+          int i;
+
+          /* Translate the output of the transformation. */
+          for (i = 0; i < 3; i++) {
+               matrix[i]     = recorded->matrix[i]     + dx * recorded->matrix[6 + i];
+               matrix[3 + i] = recorded->matrix[3 + i] + dy * recorded->matrix[6 + i];
+               matrix[6 + i] = recorded->matrix[6 + i];
+          }
+
+          dfb_state_set_matrix( state, matrix );
+     }
+
+     if (!recorded->blitting) {
+          dfb_state_set_drawing_flags( state, recorded->drawingflags );
+
+          if (recorded->drawingflags & DSDRAW_BLEND) {
+               dfb_state_set_src_blend( state, recorded->src_blend );
+               dfb_state_set_dst_blend( state, recorded->dst_blend );
+          }
+
+          if (recorded->drawingflags & DSDRAW_DST_COLORKEY)
+               dfb_state_set_dst_colorkey( state, recorded->dst_colorkey );
+     }
+     else {
+          DFBSurfaceBlittingFlags flags = recorded->blittingflags;
+
+          dfb_state_set_blitting_flags( state, flags );
+
+          if (recorded->source_flip_count_used) {
+               dfb_state_set_source_2( state, recorded->source, recorded->source_flip_count );
+          }
+          else {
+               dfb_state_set_source( state, recorded->source );
+
+               if (state->source_flip_count_used) {
+                    state->source_flip_count_used = false;
+                    state->modified              |= SMF_SOURCE;
+               }
+          }
+
+          dfb_state_set_from( state, recorded->from, recorded->from_eye );
+
+          if (flags & (DSBLIT_BLEND_ALPHACHANNEL | DSBLIT_BLEND_COLORALPHA)) {
+               dfb_state_set_src_blend( state, recorded->src_blend );
+               dfb_state_set_dst_blend( state, recorded->dst_blend );
+          }
+
+          if (flags & DSBLIT_SRC_COLORKEY)
+               dfb_state_set_src_colorkey( state, recorded->src_colorkey );
+
+          if (flags & DSBLIT_DST_COLORKEY)
+               dfb_state_set_dst_colorkey( state, recorded->dst_colorkey );
+
+          if (flags & DSBLIT_SRC_COLORKEY_EXTENDED)
+               dfb_state_set_src_colorkey_extended( state, &recorded->src_colorkey_extended );
+
+          if (flags & DSBLIT_DST_COLORKEY_EXTENDED)
+               dfb_state_set_dst_colorkey_extended( state, &recorded->dst_colorkey_extended );
+
+          if (flags & (DSBLIT_SRC_MASK_ALPHA | DSBLIT_SRC_MASK_COLOR)) {
+               dfb_state_set_source_mask( state, recorded->source_mask );
+               dfb_state_set_source_mask_vals( state, &recorded->src_mask_offset, recorded->src_mask_flags );
+          }
+
+          if (flags & DSBLIT_COLORKEY_PROTECT)
+               dfb_state_set_colorkey( state, &recorded->colorkey );
+
+          if (flags & DSBLIT_SRC_CONVOLUTION)
+               dfb_state_set_src_convolution( state, &recorded->src_convolution );
+
+          if (flags & DSBLIT_SRC_COLORMATRIX)
+               dfb_state_set_src_colormatrix( state, recorded->src_colormatrix );
+
+          if (!(flags & (DSBLIT_BLEND_COLORALPHA | DSBLIT_COLORIZE | DSBLIT_SRC_PREMULTCOLOR)))
+               return true;
+     }
+
+     if (state->color_index != recorded->color_index) {
+          CoreGraphicsStateClient_SetColorAndIndex( &list->client, &recorded->color, recorded->color_index );
+
+          dfb_state_set_color_index( state, recorded->color_index );
+     }
+
+     dfb_state_set_color( state, &recorded->color );
+
+     return true;
+}
+
+DFBResult
+dfb_display_list_play( CoreDisplayList *list,
+                       CardState       *target,
+                       int              dx,
+                       int              dy )
+{
+     CardState    *state   = &list->state;
+     bool          visible = false;
+     unsigned int  offset  = 0;
+
+     D_DEBUG_AT( Core_DisplayList, "%s( %p, %p, %d,%d )\n", __FUNCTION__, list, target, dx, dy );
+
+     D_MAGIC_ASSERT( list, CoreDisplayList );
+     D_MAGIC_ASSERT( target, CardState );
+     D_MAGIC_ASSERT( target->destination, CoreSurface );
+
+     direct_mutex_lock( &list->lock );
+
+     if (!list->buffer && list->max_size) {
+          list->buffer = D_MALLOC( list->max_size );
+          if (!list->buffer) {
+               direct_mutex_unlock( &list->lock );
+               return D_OOM();
+          }
+     }
+
+     if (target->destination_flip_count_used)
+          dfb_state_set_destination_2( state, target->destination, target->destination_flip_count );
+     else
+          dfb_state_set_destination( state, target->destination );
+
+     dfb_state_set_to( state, target->to, target->to_eye );
+
+     while (offset < list->length) {
+          DisplayListCommand *command  = (DisplayListCommand*) (list->commands + offset);
+          u8                 *elements = (u8*) (command + 1);
+          unsigned int        num      = command->num;
+          unsigned int        i;
+          bool                translate;
+
+          offset += sizeof(DisplayListCommand);
+
+          if (command->type == CDLC_STATE) {
+               visible = list_apply_state( list, &list->states[num], &target->clip, dx, dy );
+               continue;
+          }
+
+          /* With DSRO_MATRIX the translation has been applied to the matrix. */
+          translate = (dx || dy) && !(state->render_options & DSRO_MATRIX);
+
+          switch (command->type) {
+               case CDLC_FILL_RECTANGLES:
+               case CDLC_DRAW_RECTANGLES: {
+                    DFBRectangle *rects = (DFBRectangle*) elements;
+
+                    offset += num * sizeof(DFBRectangle);
+
+                    if (!visible)
+                         break;
+
+                    if (translate) {
+                         rects = list->buffer;
+
+                         for (i = 0; i < num; i++) {
+                              rects[i] = ((DFBRectangle*) elements)[i];
+
+                              dfb_rectangle_translate( &rects[i], dx, dy );
+                         }
+                    }
+
+                    if (command->type == CDLC_FILL_RECTANGLES)
+                         CoreGraphicsStateClient_FillRectangles( &list->client, rects, num );
+                    else
+                         CoreGraphicsStateClient_DrawRectangles( &list->client, rects, num );
+                    break;
+               }
+
+               case CDLC_DRAW_LINES: {
+                    DFBRegion *lines = (DFBRegion*) elements;
+
+                    offset += num * sizeof(DFBRegion);
+
+                    if (!visible)
+                         break;
+
+                    if (translate) {
+                         lines = list->buffer;
+
+                         for (i = 0; i < num; i++) {
+                              lines[i] = ((DFBRegion*) elements)[i];
+
+                              dfb_region_translate( &lines[i], dx, dy );
+                         }
+                    }
+
+                    CoreGraphicsStateClient_DrawLines( &list->client, lines, num );
+                    break;
+               }
+
+               case CDLC_FILL_TRIANGLES: {
+                    DFBTriangle *tris = (DFBTriangle*) elements;
+
+                    offset += num * sizeof(DFBTriangle);
+
+                    if (!visible)
+                         break;
+
+                    if (translate) {
+                         tris = list->buffer;
+
+                         for (i = 0; i < num; i++) {
+                              tris[i] = ((DFBTriangle*) elements)[i];
+
+                              tris[i].x1 += dx;
+                              tris[i].y1 += dy;
+                              tris[i].x2 += dx;
+                              tris[i].y2 += dy;
+                              tris[i].x3 += dx;
+                              tris[i].y3 += dy;
+                         }
+                    }
+
+                    CoreGraphicsStateClient_FillTriangles( &list->client, tris, num );
+                    break;
+               }
+
+               case CDLC_BLIT: {
+                    DFBRectangle *rects  = list->buffer;
+                    DFBPoint     *points = (DFBPoint*) (rects + num);
+
+                    offset += num * (sizeof(DFBRectangle) + sizeof(DFBPoint));
+
+                    if (!visible)
+                         break;
+
+                    for (i = 0; i < num; i++) {
+                         direct_memcpy( &rects[i], elements, sizeof(DFBRectangle) );
+                         direct_memcpy( &points[i], elements + sizeof(DFBRectangle), sizeof(DFBPoint) );
+
+                         if (translate) {
+                              points[i].x += dx;
+                              points[i].y += dy;
+                         }
+
+                         elements += sizeof(DFBRectangle) + sizeof(DFBPoint);
+                    }
+
+                    CoreGraphicsStateClient_Blit( &list->client, rects, points, num );
+                    break;
+               }
+
+               case CDLC_STRETCH_BLIT: {
+                    DFBRectangle *srects = list->buffer;
+                    DFBRectangle *drects = srects + num;
+
+                    offset += num * 2 * sizeof(DFBRectangle);
+
+                    if (!visible)
+                         break;
+
+                    for (i = 0; i < num; i++) {
+                         srects[i] = ((DFBRectangle*) elements)[i * 2];
+                         drects[i] = ((DFBRectangle*) elements)[i * 2 + 1];
+
+                         if (translate)
+                              dfb_rectangle_translate( &drects[i], dx, dy );
+                    }
+
+                    CoreGraphicsStateClient_StretchBlit( &list->client, srects, drects, num );
+                    break;
+               }
+
+               case CDLC_TILE_BLIT: {
+                    DFBRectangle *rects   = list->buffer;
+                    DFBPoint     *points1 = (DFBPoint*) (rects + num);
+                    DFBPoint     *points2 = points1 + num;
+
+                    offset += num * (sizeof(DFBRectangle) + 2 * sizeof(DFBPoint));
+
+                    if (!visible)
+                         break;
+
+                    for (i = 0; i < num; i++) {
+                         direct_memcpy( &rects[i], elements, sizeof(DFBRectangle) );
+                         direct_memcpy( &points1[i], elements + sizeof(DFBRectangle), sizeof(DFBPoint) );
+                         direct_memcpy( &points2[i], elements + sizeof(DFBRectangle) + sizeof(DFBPoint),
+                                        sizeof(DFBPoint) );
+
+                         if (translate) {
+                              points1[i].x += dx;
+                              points1[i].y += dy;
+                              points2[i].x += dx;
+                              points2[i].y += dy;
+                         }
+
+                         elements += sizeof(DFBRectangle) + 2 * sizeof(DFBPoint);
+                    }
+
+                    CoreGraphicsStateClient_TileBlit( &list->client, rects, points1, points2, num );
+                    break;
+               }
+
+               default:
+                    D_BUG( "unexpected command type %u", command->type );
+                    direct_mutex_unlock( &list->lock );
+                    return DFB_BUG;
+          }
+     }
+
+     CoreGraphicsStateClient_Flush( &list->client );
+
+     direct_mutex_unlock( &list->lock );
+
+     return DFB_OK;
+}
@@ -0,0 +1,95 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#ifndef __CORE__DISPLAY_LIST_H__
+#define __CORE__DISPLAY_LIST_H__
+
+#include <core/coretypes.h>
+
+/**********************************************************************************************************************/
+
+DFBResult dfb_display_list_create         ( CoreDFB             *core,
+                                            CoreDisplayList    **ret_list );
+
+void      dfb_display_list_destroy        ( CoreDisplayList     *list );
+
+/*
+ * Record an operation with the values of the state relevant to it.
+ * Operations are clipped to the clipping region of the state, unless DSRO_MATRIX is used.
+ */
+DFBResult dfb_display_list_fill_rectangles( CoreDisplayList     *list,
+                                            CardState           *state,
+                                            const DFBRectangle  *rects,
+                                            unsigned int         num );
+
+DFBResult dfb_display_list_draw_rectangles( CoreDisplayList     *list,
+                                            CardState           *state,
+                                            const DFBRectangle  *rects,
+                                            unsigned int         num );
+
+DFBResult dfb_display_list_draw_lines     ( CoreDisplayList     *list,
+                                            CardState           *state,
+                                            const DFBRegion     *lines,
+                                            unsigned int         num );
+
+DFBResult dfb_display_list_fill_triangles ( CoreDisplayList     *list,
+                                            CardState           *state,
+                                            const DFBTriangle   *triangles,
+                                            unsigned int         num );
+
+DFBResult dfb_display_list_fill_spans     ( CoreDisplayList     *list,
+                                            CardState           *state,
+                                            int                  y,
+                                            const DFBSpan       *spans,
+                                            unsigned int         num );
+
+DFBResult dfb_display_list_blit           ( CoreDisplayList     *list,
+                                            CardState           *state,
+                                            const DFBRectangle  *rects,
+                                            const DFBPoint      *points,
+                                            unsigned int         num );
+
+DFBResult dfb_display_list_stretch_blit   ( CoreDisplayList     *list,
+                                            CardState           *state,
+                                            const DFBRectangle  *srects,
+                                            const DFBRectangle  *drects,
+                                            unsigned int         num );
+
+DFBResult dfb_display_list_tile_blit      ( CoreDisplayList     *list,
+                                            CardState           *state,
+                                            const DFBRectangle  *rects,
+                                            const DFBPoint      *points1,
+                                            const DFBPoint      *points2,
+                                            unsigned int         num );
+
+/*
+ * Return the bounding region of the recorded operations, DFB_BUFFEREMPTY if nothing would be drawn.
+ */
+DFBResult dfb_display_list_get_bounds     ( CoreDisplayList     *list,
+                                            DFBRegion           *ret_bounds );
+
+/*
+ * Replay the operations on the destination of the target state, translated by 'dx' and 'dy'.
+ * The result is clipped to the clipping region of the target state and the translated regions used when recording.
+ */
+DFBResult dfb_display_list_play           ( CoreDisplayList     *list,
+                                            CardState           *target,
+                                            int                  dx,
+                                            int                  dy );
+
+#endif
@@ -645,7 +645,7 @@ dfb_font_create( CoreDFB                   *core,
           font->pixel_format == DSPF_ARGB4444 ||
           font->pixel_format == DSPF_RGBA4444 ||
           font->pixel_format == DSPF_ARGB1555 ||
-          font->pixel_format == DSPF_RGBA5551) && dfb_config->font_premult) {
+          font->pixel_format == DSPF_RGBA5551) && (dfb_config->font_premult || dfb_config->premultiplied)) {
           font->surface_caps = DSCAPS_PREMULTIPLIED;
      }
 
@@ -23,16 +23,20 @@
 #include <core/gfxcard.h>
 #include <core/surface_allocation.h>
 #include <core/system.h>
+#include <direct/memcpy.h>
 #include <fusion/conf.h>
 #include <fusion/shmalloc.h>
 #include <core/state.h>
 #include <gfx/clip.h>
 #include <gfx/generic/generic.h>
+#include <gfx/generic/generic_affine_blit.h>
 #include <gfx/generic/generic_blit.h>
 #include <gfx/generic/generic_draw_line.h>
 #include <gfx/generic/generic_fill_rectangle.h>
+#include <gfx/generic/generic_queue.h>
 #include <gfx/generic/generic_stretch_blit.h>
 #include <gfx/generic/generic_texture_triangles.h>
+#include <gfx/generic/generic_threads.h>
 #include <gfx/util.h>
 
 D_DEBUG_DOMAIN( Core_Graphics,    "Core/Graphics",    "DirectFB Core Graphics" );
@@ -66,6 +70,11 @@ typedef struct {
      long long                ts_start;
      long long                ts_busy;
      long long                ts_busy_sum;
+
+     unsigned int             genefx_hits;        /* Genefx pipeline cache counters at the last stats output. */
+     unsigned int             genefx_misses;
+     unsigned int             copy_uses;          /* Copy state counters at the last stats output. */
+     unsigned int             copy_waits;
 } DFBGraphicsCoreShared;
 
 typedef struct {
@@ -85,6 +94,9 @@ typedef struct {
      CardLimitations            limits;       /* local limits */
 
      GraphicsDeviceFuncs        funcs;
+
+     DirectMutex                damage_lock;  /* protects the pending damage of states */
+     CardState                 *damage_states;/* states with pending damage */
 } DFBGraphicsCore;
 
 DFB_CORE_PART( graphics_core, GraphicsCore );
@@ -199,6 +211,8 @@ dfb_graphics_core_initialize( CoreDFB               *core,
 
      card = data;
 
+     direct_mutex_init( &data->damage_lock );
+
      data->core   = core;
      data->shared = shared;
 
@@ -328,6 +342,8 @@ dfb_graphics_core_join( CoreDFB               *core,
 
      card = data;
 
+     direct_mutex_init( &data->damage_lock );
+
      data->core   = core;
      data->shared = shared;
 
@@ -396,6 +412,14 @@ dfb_graphics_core_shutdown( DFBGraphicsCore *data,
 
      dfb_gfxcard_lock( GDLF_SYNC );
 
+     Genefx_Queue_Shutdown();
+
+     Genefx_Bands_Shutdown();
+
+     D_ASSUME( data->damage_states == NULL );
+
+     direct_mutex_deinit( &data->damage_lock );
+
      if (data->driver_funcs) {
           const GraphicsDriverFuncs *funcs = data->driver_funcs;
 
@@ -430,6 +454,14 @@ dfb_graphics_core_leave( DFBGraphicsCore *data,
      D_MAGIC_ASSERT( data, DFBGraphicsCore );
      D_MAGIC_ASSERT( data->shared, DFBGraphicsCoreShared );
 
+     Genefx_Queue_Shutdown();
+
+     Genefx_Bands_Shutdown();
+
+     D_ASSUME( data->damage_states == NULL );
+
+     direct_mutex_deinit( &data->damage_lock );
+
      if (data->driver_funcs) {
           data->driver_funcs->CloseDriver( data->driver_data );
 
@@ -477,6 +509,9 @@ static void dfb_gfxcard_update_stats( long long now );
 static void dfb_gfxcard_switch_busy ( void );
 static void dfb_gfxcard_switch_idle ( void );
 
+static void gfxcard_damage_merge    ( CardState *state );
+static void gfxcard_damage_merge_all( void );
+
 DFBResult
 dfb_gfxcard_lock( GraphicsDeviceLockFlags flags )
 {
@@ -520,6 +555,10 @@ dfb_gfxcard_lock( GraphicsDeviceLockFlags flags )
 
           dfb_gfxcard_switch_idle();
      }
+     else if (flags & GDLF_SYNC) {
+          /* Nothing to wait for, but keep the stats going for software rendering. */
+          dfb_gfxcard_switch_idle();
+     }
 
      if ((shared->lock_flags & GDLF_RESET) && funcs->EngineReset)
           funcs->EngineReset( card->driver_data, card->device_data );
@@ -562,6 +601,12 @@ dfb_gfxcard_flush()
 
      D_DEBUG_AT( Core_Graphics, "%s()\n", __FUNCTION__ );
 
+     /* Make the damage of all states visible to the flips following a flush. */
+     gfxcard_damage_merge_all();
+
+     /* Release the buffer locks kept by states of the software fallback not used since the previous flush. */
+     gReleaseIdleLocks();
+
      if (dfb_config->gfx_emit_early) {
           D_DEBUG_AT( Core_Graphics, "  -> gfx-emit-early\n" );
 
@@ -867,6 +912,9 @@ dfb_gfxcard_state_acquire( CardState *state, DFBAccelerationMask accel )
      /* Push our own identity for buffer locking calls (locality of accessor). */
      Core_PushIdentity( 0 );
 
+     /* Drop buffer locks kept by the software fallback. */
+     gReleaseLocks( state );
+
      /* Lock destination. */
      ret = dfb_surface_lock_buffer2( state->destination, state->to, state->destination_flip_count_used ?
                                      state->destination_flip_count : state->destination->flips,
@@ -1268,6 +1316,9 @@ dfb_gfxcard_state_check_acquire( CardState           *state,
           return false;
      }
 
+     /* Drop buffer locks kept by the software fallback. */
+     gReleaseLocks( state );
+
      ret = dfb_surface_buffer_lock( dst_buffer, CSAID_GPU, access, &state->dst );
      if (ret) {
           D_DEBUG_AT( Core_GfxState, "  -> could not lock destination for GPU access!\n" );
@@ -1438,9 +1489,24 @@ dfb_gfxcard_state_release( CardState *state )
      shared = card->shared;
 
      if (!dfb_config->software_only) {
-          /* Store the serial of the operation. */
-          if (card->funcs.GetSerial)
-               card->funcs.GetSerial( card->driver_data, card->device_data, &state->dst.allocation->gfx_serial );
+          /* Store the serial of the operation in the destination and the sources, so that only accesses to them wait
+             for it. */
+          if (card->funcs.GetSerial) {
+               CoreGraphicsSerial serial;
+
+               card->funcs.GetSerial( card->driver_data, card->device_data, &serial );
+
+               state->dst.allocation->gfx_write_serial = serial;
+
+               if (state->flags & CSF_SOURCE_LOCKED)
+                    state->src.allocation->gfx_read_serial = serial;
+
+               if (state->flags & CSF_SOURCE_MASK_LOCKED)
+                    state->src_mask.allocation->gfx_read_serial = serial;
+
+               if (state->flags & CSF_SOURCE2_LOCKED)
+                    state->src2.allocation->gfx_read_serial = serial;
+          }
 
           if (dfb_config->gfx_emit_early && card->funcs.EmitCommands) {
                dfb_gfxcard_switch_busy();
@@ -1501,12 +1567,25 @@ dfb_gfxcard_state_destroy ( CardState *state )
 {
      D_MAGIC_ASSERT( state, CardState );
 
+     gReleaseLocks( state );
+
+     gfxcard_damage_merge( state );
+
      if (state->gfxs) {
+          int          i;
           GenefxState *gfxs = state->gfxs;
 
           if (gfxs->ABstart)
                D_FREE( gfxs->ABstart );
 
+          if (gfxs->pipelines)
+               D_FREE( gfxs->pipelines );
+
+          for (i = 0; i < GENEFX_SCALE_TABLES; i++) {
+               if (gfxs->scale_tables[i])
+                    D_FREE( gfxs->scale_tables[i] );
+          }
+
           D_FREE( gfxs );
      }
 
@@ -1522,8 +1601,353 @@ dfb_gfxcard_state_destroy ( CardState *state )
      }
 }
 
+void
+dfb_gfxcard_state_release_locks( CardState *state )
+{
+     D_MAGIC_ASSERT( state, CardState );
+
+     dfb_state_lock( state );
+
+     gReleaseLocks( state );
+
+     gfxcard_damage_merge( state );
+
+     dfb_state_unlock( state );
+}
+
 /**********************************************************************************************************************/
 
+#define DAMAGE_BOUNDS_INIT { INT_MAX, INT_MAX, INT_MIN, INT_MIN }
+
+/*
+ * Check whether the back buffer of a flipping destination is rendered to, which keeps track of damaged areas for
+ * partial back to front copies.
+ */
+static __inline__ bool
+damage_tracked( const CardState *state )
+{
+     return dfb_config->damage_tracking && state->destination && state->to == DSBR_BACK &&
+            (state->destination->config.caps & DSCAPS_FLIPPING);
+}
+
+static __inline__ void
+damage_extend( DFBRegion *bounds,
+               int        x1,
+               int        y1,
+               int        x2,
+               int        y2 )
+{
+     if (bounds->x1 > x1)
+          bounds->x1 = x1;
+
+     if (bounds->y1 > y1)
+          bounds->y1 = y1;
+
+     if (bounds->x2 < x2)
+          bounds->x2 = x2;
+
+     if (bounds->y2 < y2)
+          bounds->y2 = y2;
+}
+
+/*
+ * Record the bounds of an operation limited by the clip, without bounds or with a render matrix the whole clip.
+ *
+ * The bounds are accumulated in the state without locking the surface. The state keeps a reference to the surface
+ * until its damage is merged into it, when the state is flushed, its destination changes, or by dfb_gfxcard_flush()
+ * which precedes each flip.
+ */
+static void
+gfxcard_damage( CardState       *state,
+                const DFBRegion *bounds )
+{
+     DFBRegion region = state->clip;
+
+     if (bounds && !(state->render_options & DSRO_MATRIX) && !dfb_region_region_intersect( &region, bounds ))
+          return;
+
+     direct_mutex_lock( &card->damage_lock );
+
+     if (state->damage_surface) {
+          D_ASSERT( state->damage_surface == state->destination );
+
+          damage_extend( &state->damage, region.x1, region.y1, region.x2, region.y2 );
+     }
+     else if (!dfb_surface_ref( state->destination )) {
+          state->damage_surface = state->destination;
+          state->damage         = region;
+          state->damage_next    = card->damage_states;
+          card->damage_states   = state;
+     }
+
+     direct_mutex_unlock( &card->damage_lock );
+}
+
+/*
+ * Add the pending damage to the surface, outside of the damage lock as it locks the surface.
+ */
+static void
+damage_commit( CoreSurface     *surface,
+               const DFBRegion *damage )
+{
+     D_DEBUG_AT( Core_GraphicsOps, "%s( %p, %4d,%4d-%4dx%4d )\n", __FUNCTION__,
+                 surface, DFB_RECTANGLE_VALS_FROM_REGION( damage ) );
+
+     dfb_surface_damage_add( surface, damage );
+
+     dfb_surface_unref( surface );
+}
+
+static void
+gfxcard_damage_merge( CardState *state )
+{
+     CardState   **link;
+     CoreSurface  *surface;
+     DFBRegion     damage;
+
+     D_MAGIC_ASSERT( state, CardState );
+
+     /* Only set by the owner of the state, but may be cleared by gfxcard_damage_merge_all() meanwhile. */
+     if (!state->damage_surface)
+          return;
+
+     D_ASSERT( card != NULL );
+
+     direct_mutex_lock( &card->damage_lock );
+
+     for (link = &card->damage_states; *link; link = &(*link)->damage_next) {
+          if (*link == state) {
+               *link = state->damage_next;
+               break;
+          }
+     }
+
+     surface = state->damage_surface;
+     damage  = state->damage;
+
+     state->damage_surface = NULL;
+     state->damage_next    = NULL;
+
+     direct_mutex_unlock( &card->damage_lock );
+
+     if (surface)
+          damage_commit( surface, &damage );
+}
+
+static void
+gfxcard_damage_merge_all()
+{
+     CardState   *state;
+     CoreSurface *surface;
+     DFBRegion    damage;
+
+     D_ASSERT( card != NULL );
+
+     direct_mutex_lock( &card->damage_lock );
+
+     while ((state = card->damage_states) != NULL) {
+          card->damage_states = state->damage_next;
+
+          surface = state->damage_surface;
+          damage  = state->damage;
+
+          state->damage_surface = NULL;
+          state->damage_next    = NULL;
+
+          direct_mutex_unlock( &card->damage_lock );
+
+          damage_commit( surface, &damage );
+
+          direct_mutex_lock( &card->damage_lock );
+     }
+
+     direct_mutex_unlock( &card->damage_lock );
+}
+
+static void
+gfxcard_damage_blits( CardState          *state,
+                      const DFBRectangle *rects,
+                      const DFBPoint     *points,
+                      int                 num )
+{
+     int       i;
+     DFBRegion bounds = DAMAGE_BOUNDS_INIT;
+
+     for (i = 0; i < num; i++) {
+          int w = rects[i].w;
+          int h = rects[i].h;
+
+          /* Rotated blits swap the dimensions, be generous. */
+          if (state->blittingflags & (DSBLIT_ROTATE90 | DSBLIT_ROTATE270))
+               w = h = MAX( w, h );
+
+          damage_extend( &bounds, points[i].x, points[i].y, points[i].x + w - 1, points[i].y + h - 1 );
+     }
+
+     gfxcard_damage( state, &bounds );
+}
+
+/*
+ * Operations on a state with a set of clipping regions either clip their primitives against the whole set in one pass
+ * (rectangle fills and blits), or are repeated for each region of the set with the clip set to it.
+ */
+
+#define CLIP_REGIONS_BATCH 256
+
+typedef struct {
+     CardState       *state;
+     const DFBRegion *regions;
+     unsigned int     num;
+     unsigned int     index;
+     DFBRegion        clip;
+} ClipRegions;
+
+/*
+ * Get the clipping region for an entry of the set, which is the entry intersected with the clipping rectangle.
+ */
+static __inline__ bool
+clip_regions_get( const DFBRegion *clip,
+                  const DFBRegion *entry,
+                  DFBRegion       *ret_region )
+{
+     *ret_region = *entry;
+
+     return DFB_REGION_CHECK( ret_region ) && dfb_region_region_intersect( ret_region, clip );
+}
+
+static void
+clip_regions_start( ClipRegions *regions,
+                    CardState   *state )
+{
+     D_MAGIC_ASSERT( state, CardState );
+     D_ASSERT( state->num_clip_regions > 0 );
+
+     dfb_state_lock( state );
+
+     regions->state   = state;
+     regions->regions = state->clip_regions;
+     regions->num     = state->num_clip_regions;
+     regions->index   = 0;
+     regions->clip    = state->clip;
+
+     /* Suspend the set while the operation is executed per region. */
+     state->num_clip_regions = 0;
+}
+
+static bool
+clip_regions_next( ClipRegions *regions )
+{
+     CardState *state = regions->state;
+
+     while (regions->index < regions->num) {
+          DFBRegion clip;
+
+          if (clip_regions_get( &regions->clip, &regions->regions[regions->index++], &clip )) {
+               state->clip      = clip;
+               state->modified |= SMF_CLIP;
+
+               return true;
+          }
+     }
+
+     state->clip             = regions->clip;
+     state->num_clip_regions = regions->num;
+     state->modified        |= SMF_CLIP;
+
+     dfb_state_unlock( state );
+
+     return false;
+}
+
+static void
+fill_clip_regions( const DFBRectangle *rects,
+                   int                 num,
+                   CardState          *state )
+{
+     int              i;
+     unsigned int     r;
+     DFBRectangle     clipped[CLIP_REGIONS_BATCH];
+     int              clipped_num = 0;
+     const DFBRegion *regions     = state->clip_regions;
+     unsigned int     num_regions = state->num_clip_regions;
+
+     /* Suspend the set while the fragments are filled. */
+     state->num_clip_regions = 0;
+
+     for (i = 0; i < num; i++) {
+          for (r = 0; r < num_regions && regions[r].y1 < rects[i].y + rects[i].h; r++) {
+               DFBRegion    clip;
+               DFBRectangle rect = rects[i];
+
+               if (!clip_regions_get( &state->clip, &regions[r], &clip ) || !dfb_clip_rectangle( &clip, &rect ))
+                    continue;
+
+               clipped[clipped_num] = rect;
+
+               if (++clipped_num == CLIP_REGIONS_BATCH) {
+                    dfb_gfxcard_fillrectangles( clipped, clipped_num, state );
+                    clipped_num = 0;
+               }
+          }
+     }
+
+     if (clipped_num)
+          dfb_gfxcard_fillrectangles( clipped, clipped_num, state );
+
+     state->num_clip_regions = num_regions;
+}
+
+static void
+blit_clip_regions( const DFBRectangle      *rects,
+                   const DFBPoint          *points,
+                   int                      num,
+                   DFBSurfaceBlittingFlags  flags,
+                   CardState               *state )
+{
+     int              i;
+     unsigned int     r;
+     DFBRectangle     clipped_rects[CLIP_REGIONS_BATCH];
+     DFBPoint         clipped_points[CLIP_REGIONS_BATCH];
+     int              clipped_num = 0;
+     const DFBRegion *regions     = state->clip_regions;
+     unsigned int     num_regions = state->num_clip_regions;
+
+     /* Suspend the set while the fragments are blitted. */
+     state->num_clip_regions = 0;
+
+     for (i = 0; i < num; i++) {
+          DFBRectangle drect = { points[i].x, points[i].y, rects[i].w, rects[i].h };
+
+          if (flags & DSBLIT_ROTATE90)
+               D_UTIL_SWAP( drect.w, drect.h );
+
+          for (r = 0; r < num_regions && regions[r].y1 < drect.y + drect.h; r++) {
+               DFBRegion    clip;
+               DFBRectangle srect = rects[i];
+               DFBRectangle dst   = drect;
+
+               if (!clip_regions_get( &state->clip, &regions[r], &clip ) ||
+                   !dfb_clip_blit_precheck( &clip, dst.w, dst.h, dst.x, dst.y ))
+                    continue;
+
+               dfb_clip_blit_flipped_rotated( &clip, &srect, &dst, flags );
+
+               clipped_rects[clipped_num]  = srect;
+               clipped_points[clipped_num] = (DFBPoint) { dst.x, dst.y };
+
+               if (++clipped_num == CLIP_REGIONS_BATCH) {
+                    dfb_gfxcard_batchblit( clipped_rects, clipped_points, clipped_num, state );
+                    clipped_num = 0;
+               }
+          }
+     }
+
+     if (clipped_num)
+          dfb_gfxcard_batchblit( clipped_rects, clipped_points, clipped_num, state );
+
+     state->num_clip_regions = num_regions;
+}
+
 #define DFB_TRANSFORM(x,y,m,affine)                                   \
 do {                                                                  \
      s32 _x, _y, _w;                                                  \
@@ -1669,6 +2093,31 @@ dfb_gfxcard_fillrectangles( DFBRectangle *rects,
      /* Signal beginning of sequence of operations if not already done. */
      dfb_state_start_drawing( state );
 
+     if (state->num_clip_regions) {
+          if (state->render_options & DSRO_MATRIX) {
+               ClipRegions regions;
+
+               for (clip_regions_start( &regions, state ); clip_regions_next( &regions );)
+                    dfb_gfxcard_fillrectangles( rects, num, state );
+          }
+          else
+               fill_clip_regions( rects, num, state );
+
+          dfb_state_unlock( state );
+          return;
+     }
+
+     if (damage_tracked( state )) {
+          int       i;
+          DFBRegion bounds = DAMAGE_BOUNDS_INIT;
+
+          for (i = 0; i < num; i++)
+               damage_extend( &bounds, rects[i].x, rects[i].y,
+                              rects[i].x + rects[i].w - 1, rects[i].y + rects[i].h - 1 );
+
+          gfxcard_damage( state, &bounds );
+     }
+
      if (!(state->render_options & DSRO_MATRIX)) {
           while (num > 0) {
                if (dfb_rectangle_region_intersects( rects, &state->clip ))
@@ -1837,6 +2286,22 @@ dfb_gfxcard_drawrectangle( DFBRectangle *rect,
      /* Signal beginning of sequence of operations if not already done. */
      dfb_state_start_drawing( state );
 
+     if (state->num_clip_regions) {
+          ClipRegions regions;
+
+          for (clip_regions_start( &regions, state ); clip_regions_next( &regions );)
+               dfb_gfxcard_drawrectangle( rect, state );
+
+          dfb_state_unlock( state );
+          return;
+     }
+
+     if (damage_tracked( state )) {
+          DFBRegion bounds = DFB_REGION_INIT_FROM_RECTANGLE( rect );
+
+          gfxcard_damage( state, &bounds );
+     }
+
      if (!(state->render_options & DSRO_MATRIX) &&
          !dfb_rectangle_region_intersects( rect, &state->clip )) {
           dfb_state_unlock( state );
@@ -1943,6 +2408,39 @@ dfb_gfxcard_drawlines( DFBRegion *lines,
      /* Signal beginning of sequence of operations if not already done. */
      dfb_state_start_drawing( state );
 
+     if (state->num_clip_regions) {
+          ClipRegions  regions;
+          DFBRegion   *copy = D_MALLOC( sizeof(DFBRegion) * num );
+
+          if (copy) {
+               /* The lines are clipped in place. */
+               for (clip_regions_start( &regions, state ); clip_regions_next( &regions );) {
+                    direct_memcpy( copy, lines, sizeof(DFBRegion) * num );
+                    dfb_gfxcard_drawlines( copy, num, state );
+               }
+          }
+          else
+               D_OOM();
+
+          if (copy)
+               D_FREE( copy );
+
+          dfb_state_unlock( state );
+          return;
+     }
+
+     if (damage_tracked( state )) {
+          DFBRegion bounds = DAMAGE_BOUNDS_INIT;
+
+          for (i = 0; i < num; i++)
+               damage_extend( &bounds, MIN( lines[i].x1, lines[i].x2 ), MIN( lines[i].y1, lines[i].y2 ),
+                              MAX( lines[i].x1, lines[i].x2 ), MAX( lines[i].y1, lines[i].y2 ) );
+
+          gfxcard_damage( state, &bounds );
+
+          i = 0;
+     }
+
      if (dfb_gfxcard_state_check_acquire( state, DFXL_DRAWLINE )) {
           for (; i < num; i++) {
                if (!D_FLAGS_IS_SET( card->caps.flags, CCF_CLIPPING ) &&
@@ -1999,6 +2497,30 @@ dfb_gfxcard_filltriangles( DFBTriangle *tris,
      /* Signal beginning of sequence of operations if not already done. */
      dfb_state_start_drawing( state );
 
+     if (state->num_clip_regions) {
+          ClipRegions regions;
+
+          for (clip_regions_start( &regions, state ); clip_regions_next( &regions );)
+               dfb_gfxcard_filltriangles( tris, num, state );
+
+          dfb_state_unlock( state );
+          return;
+     }
+
+     if (damage_tracked( state )) {
+          DFBRegion bounds = DAMAGE_BOUNDS_INIT;
+
+          for (i = 0; i < num; i++)
+               damage_extend( &bounds, MIN( tris[i].x1, MIN( tris[i].x2, tris[i].x3 ) ),
+                              MIN( tris[i].y1, MIN( tris[i].y2, tris[i].y3 ) ),
+                              MAX( tris[i].x1, MAX( tris[i].x2, tris[i].x3 ) ),
+                              MAX( tris[i].y1, MAX( tris[i].y2, tris[i].y3 ) ) );
+
+          gfxcard_damage( state, &bounds );
+
+          i = 0;
+     }
+
      if (dfb_gfxcard_state_check_acquire( state, DFXL_FILLTRIANGLE )) {
           if (!D_FLAGS_IS_SET( card->caps.flags, CCF_CLIPPING ) &&
               !D_FLAGS_IS_SET( card->caps.clip, DFXL_FILLTRIANGLE )) {
@@ -2167,6 +2689,29 @@ dfb_gfxcard_filltrapezoids( DFBTrapezoid *traps,
      /* Signal beginning of sequence of operations if not already done. */
      dfb_state_start_drawing( state );
 
+     if (state->num_clip_regions) {
+          ClipRegions regions;
+
+          for (clip_regions_start( &regions, state ); clip_regions_next( &regions );)
+               dfb_gfxcard_filltrapezoids( traps, num, state );
+
+          dfb_state_unlock( state );
+          return;
+     }
+
+     if (damage_tracked( state )) {
+          DFBRegion bounds = DAMAGE_BOUNDS_INIT;
+
+          for (i = 0; i < num; i++)
+               damage_extend( &bounds, MIN( traps[i].x1, traps[i].x2 ), MIN( traps[i].y1, traps[i].y2 ),
+                              MAX( traps[i].x1 + traps[i].w1, traps[i].x2 + traps[i].w2 ) - 1,
+                              MAX( traps[i].y1, traps[i].y2 ) );
+
+          gfxcard_damage( state, &bounds );
+
+          i = 0;
+     }
+
      if (dfb_gfxcard_state_check_acquire( state, DFXL_FILLTRAPEZOID )) {
           if (D_FLAGS_IS_SET( card->caps.flags, CCF_CLIPPING )      ||
               D_FLAGS_IS_SET( card->caps.clip, DFXL_FILLTRAPEZOID ) ||
@@ -2317,6 +2862,26 @@ dfb_gfxcard_fillquadrangles( DFBPoint  *points,
      /* Signal beginning of sequence of operations if not already done. */
      dfb_state_start_drawing( state );
 
+     if (state->num_clip_regions) {
+          ClipRegions regions;
+
+          for (clip_regions_start( &regions, state ); clip_regions_next( &regions );)
+               dfb_gfxcard_fillquadrangles( points, num, state );
+
+          dfb_state_unlock( state );
+          return;
+     }
+
+     if (damage_tracked( state )) {
+          int       i;
+          DFBRegion bounds = DAMAGE_BOUNDS_INIT;
+
+          for (i = 0; i < num * 4; i++)
+               damage_extend( &bounds, points[i].x, points[i].y, points[i].x, points[i].y );
+
+          gfxcard_damage( state, &bounds );
+     }
+
      if (dfb_gfxcard_state_check_acquire( state, DFXL_FILLQUADRANGLE )) {
           if (!D_FLAGS_IS_SET( card->caps.flags, CCF_CLIPPING ) &&
               !D_FLAGS_IS_SET( card->caps.clip, DFXL_FILLQUADRANGLE ))
@@ -2389,6 +2954,27 @@ dfb_gfxcard_fillspans( int        y,
      /* Signal beginning of sequence of operations if not already done. */
      dfb_state_start_drawing( state );
 
+     if (state->num_clip_regions) {
+          ClipRegions regions;
+
+          for (clip_regions_start( &regions, state ); clip_regions_next( &regions );)
+               dfb_gfxcard_fillspans( y, spans, num, state );
+
+          dfb_state_unlock( state );
+          return;
+     }
+
+     if (damage_tracked( state )) {
+          DFBRegion bounds = DAMAGE_BOUNDS_INIT;
+
+          for (i = 0; i < num; i++)
+               damage_extend( &bounds, spans[i].x, y + i, spans[i].x + spans[i].w - 1, y + i );
+
+          gfxcard_damage( state, &bounds );
+
+          i = 0;
+     }
+
      if (dfb_gfxcard_state_check_acquire( state, DFXL_FILLRECTANGLE )) {
           if (card->funcs.BatchFill) {
                unsigned int done = 0;
@@ -2558,6 +3144,19 @@ dfb_gfxcard_draw_mono_glyphs( const void                   *glyph[],
      /* Signal beginning of sequence of operations if not already done. */
      dfb_state_start_drawing( state );
 
+     if (state->num_clip_regions) {
+          ClipRegions regions;
+
+          for (clip_regions_start( &regions, state ); clip_regions_next( &regions );)
+               dfb_gfxcard_draw_mono_glyphs( glyph, attributes, points, num, state );
+
+          dfb_state_unlock( state );
+          return;
+     }
+
+     if (damage_tracked( state ))
+          gfxcard_damage( state, NULL );
+
      if (dfb_gfxcard_state_check_acquire( state, DFXL_DRAWMONOGLYPH )) {
           for (i = 0; i < num; i++) {
                const DFBMonoGlyphAttributes *attri = &attributes[i];
@@ -2614,6 +3213,47 @@ GenefxVertexAffine_Transform( GenefxVertexAffine *v,
      }
 }
 
+/*
+ * Software fallback for a blit of 'srect' to 'drect' transformed by a matrix that is not a plain scale, with a pipeline
+ * acquired for DFXL_TEXTRIANGLES. Affine matrices are rendered directly, projective ones as two textured triangles.
+ */
+static void
+Genefx_TransformedBlit( CardState    *state,
+                        DFBRectangle *srect,
+                        DFBRectangle *drect )
+{
+     GenefxVertexAffine v[4];
+
+     if (state->affine_matrix) {
+          gAffineBlit( state, srect, drect );
+          return;
+     }
+
+     v[0].x = drect->x;
+     v[0].y = drect->y;
+     v[0].s = srect->x * 0x10000;
+     v[0].t = srect->y * 0x10000;
+
+     v[1].x = drect->x + drect->w - 1;
+     v[1].y = drect->y;
+     v[1].s = (srect->x + srect->w - 1) * 0x10000;
+     v[1].t = v[0].t;
+
+     v[2].x = drect->x + drect->w - 1;
+     v[2].y = drect->y + drect->h - 1;
+     v[2].s = v[1].s;
+     v[2].t = (srect->y + srect->h - 1) * 0x10000;
+
+     v[3].x = drect->x;
+     v[3].y = drect->y + drect->h - 1;
+     v[3].s = v[0].s;
+     v[3].t = v[2].t;
+
+     GenefxVertexAffine_Transform( v, 4, state->matrix, state->affine_matrix );
+
+     Genefx_TextureTrianglesAffine( state, v, 4, DTTF_FAN, &state->clip );
+}
+
 static void
 dfb_gfxcard_blit_locked( DFBRectangle *rect,
                          int           dx,
@@ -2692,31 +3332,9 @@ dfb_gfxcard_blit_locked( DFBRectangle *rect,
                    state->matrix[3] != 0 || state->matrix[4] < 0  ||
                    state->matrix[6] != 0 || state->matrix[7] != 0) {
                     if (gAcquire( state, DFXL_TEXTRIANGLES )) {
-                         GenefxVertexAffine v[4];
+                         drect = (DFBRectangle) { dx, dy, rect->w, rect->h };
 
-                         v[0].x = dx;
-                         v[0].y = dy;
-                         v[0].s = rect->x * 0x10000;
-                         v[0].t = rect->y * 0x10000;
-
-                         v[1].x = dx + rect->w - 1;
-                         v[1].y = dy;
-                         v[1].s = (rect->x + rect->w - 1) * 0x10000;
-                         v[1].t = v[0].t;
-
-                         v[2].x = dx + rect->w - 1;
-                         v[2].y = dy + rect->h - 1;
-                         v[2].s = v[1].s;
-                         v[2].t = (rect->y + rect->h - 1) * 0x10000;
-
-                         v[3].x = dx;
-                         v[3].y = dy + rect->h - 1;
-                         v[3].s = v[0].s;
-                         v[3].t = v[2].t;
-
-                         GenefxVertexAffine_Transform( v, 4, state->matrix, state->affine_matrix );
-
-                         Genefx_TextureTrianglesAffine( state, v, 4, DTTF_FAN, &state->clip );
+                         Genefx_TransformedBlit( state, rect, &drect );
 
                          gRelease( state );
                     }
@@ -2745,8 +3363,22 @@ dfb_gfxcard_blit( DFBRectangle *rect,
                   int           dy,
                   CardState    *state )
 {
+     if (state->num_clip_regions) {
+          DFBPoint point = { dx, dy };
+
+          dfb_gfxcard_batchblit( rect, &point, 1, state );
+          return;
+     }
+
      /* The state is locked during graphics operations. */
      dfb_state_lock( state );
+
+     if (damage_tracked( state )) {
+          DFBPoint point = { dx, dy };
+
+          gfxcard_damage_blits( state, rect, &point, 1 );
+     }
+
      dfb_gfxcard_blit_locked( rect, dx, dy, state );
      dfb_state_unlock( state );
 }
@@ -2822,6 +3454,23 @@ dfb_gfxcard_batchblit( DFBRectangle *rects,
      /* Signal beginning of sequence of operations if not already done. */
      dfb_state_start_drawing( state );
 
+     if (state->num_clip_regions) {
+          if (state->render_options & DSRO_MATRIX) {
+               ClipRegions regions;
+
+               for (clip_regions_start( &regions, state ); clip_regions_next( &regions );)
+                    dfb_gfxcard_batchblit( rects, points, num, state );
+          }
+          else
+               blit_clip_regions( rects, points, num, blittingflags, state );
+
+          dfb_state_unlock( state );
+          return;
+     }
+
+     if (damage_tracked( state ))
+          gfxcard_damage_blits( state, rects, points, num );
+
      if (dfb_gfxcard_state_check_acquire( state, DFXL_BLIT )) {
           if (card->funcs.BatchBlit) {
                unsigned int done = 0;
@@ -2913,31 +3562,9 @@ dfb_gfxcard_batchblit( DFBRectangle *rects,
                    state->matrix[6] != 0 || state->matrix[7] != 0) {
                     if (gAcquire( state, DFXL_TEXTRIANGLES )) {
                          for (; i < num; i++) {
-                              GenefxVertexAffine v[4];
-
-                              v[0].x = points[i].x;
-                              v[0].y = points[i].y;
-                              v[0].s = rects[i].x * 0x10000;
-                              v[0].t = rects[i].y * 0x10000;
-
-                              v[1].x = points[i].x + rects[i].w - 1;
-                              v[1].y = points[i].y;
-                              v[1].s = (rects[i].x + rects[i].w - 1) * 0x10000;
-                              v[1].t = v[0].t;
+                              DFBRectangle drect = { points[i].x, points[i].y, rects[i].w, rects[i].h };
 
-                              v[2].x = points[i].x + rects[i].w - 1;
-                              v[2].y = points[i].y + rects[i].h - 1;
-                              v[2].s = v[1].s;
-                              v[2].t = (rects[i].y + rects[i].h - 1) * 0x10000;
-
-                              v[3].x = points[i].x;
-                              v[3].y = points[i].y + rects[i].h - 1;
-                              v[3].s = v[0].s;
-                              v[3].t = v[2].t;
-
-                              GenefxVertexAffine_Transform( v, 4, state->matrix, state->affine_matrix );
-
-                              Genefx_TextureTrianglesAffine( state, v, 4, DTTF_FAN, &state->clip );
+                              Genefx_TransformedBlit( state, &rects[i], &drect );
                          }
 
                          gRelease( state );
@@ -3011,6 +3638,35 @@ dfb_gfxcard_batchblit2( DFBRectangle *rects,
      /* Signal beginning of sequence of operations if not already done. */
      dfb_state_start_drawing( state );
 
+     if (state->num_clip_regions) {
+          ClipRegions   regions;
+          DFBRectangle *copy_rects   = D_MALLOC( sizeof(DFBRectangle) * num );
+          DFBPoint     *copy_points2 = D_MALLOC( sizeof(DFBPoint) * num );
+
+          if (copy_rects && copy_points2) {
+               /* The rectangles and second source points are clipped in place. */
+               for (clip_regions_start( &regions, state ); clip_regions_next( &regions );) {
+                    direct_memcpy( copy_rects, rects, sizeof(DFBRectangle) * num );
+                    direct_memcpy( copy_points2, points2, sizeof(DFBPoint) * num );
+                    dfb_gfxcard_batchblit2( copy_rects, points, copy_points2, num, state );
+               }
+          }
+          else
+               D_OOM();
+
+          if (copy_points2)
+               D_FREE( copy_points2 );
+
+          if (copy_rects)
+               D_FREE( copy_rects );
+
+          dfb_state_unlock( state );
+          return;
+     }
+
+     if (damage_tracked( state ))
+          gfxcard_damage_blits( state, rects, points, num );
+
      if (dfb_gfxcard_state_check_acquire( state, DFXL_BLIT2 )) {
           for (; i < num; i++) {
                if ((state->render_options & DSRO_MATRIX) ||
@@ -3100,6 +3756,42 @@ dfb_gfxcard_batchstretchblit( DFBRectangle *srects,
      /* Signal beginning of sequence of operations if not already done. */
      dfb_state_start_drawing( state );
 
+     if (state->num_clip_regions) {
+          ClipRegions   regions;
+          DFBRectangle *copy_srects = D_MALLOC( sizeof(DFBRectangle) * num );
+          DFBRectangle *copy_drects = D_MALLOC( sizeof(DFBRectangle) * num );
+
+          if (copy_srects && copy_drects) {
+               /* The rectangles are clipped and transformed in place. */
+               for (clip_regions_start( &regions, state ); clip_regions_next( &regions );) {
+                    direct_memcpy( copy_srects, srects, sizeof(DFBRectangle) * num );
+                    direct_memcpy( copy_drects, drects, sizeof(DFBRectangle) * num );
+                    dfb_gfxcard_batchstretchblit( copy_srects, copy_drects, num, state );
+               }
+          }
+          else
+               D_OOM();
+
+          if (copy_drects)
+               D_FREE( copy_drects );
+
+          if (copy_srects)
+               D_FREE( copy_srects );
+
+          dfb_state_unlock( state );
+          return;
+     }
+
+     if (damage_tracked( state )) {
+          DFBRegion bounds = DAMAGE_BOUNDS_INIT;
+
+          for (i = 0; i < num; i++)
+               damage_extend( &bounds, drects[i].x, drects[i].y,
+                              drects[i].x + drects[i].w - 1, drects[i].y + drects[i].h - 1 );
+
+          gfxcard_damage( state, &bounds );
+     }
+
      need_clip = (!D_FLAGS_IS_SET( card->caps.flags, CCF_CLIPPING ) &&
                   !D_FLAGS_IS_SET( card->caps.clip, DFXL_STRETCHBLIT ));
 
@@ -3143,34 +3835,7 @@ dfb_gfxcard_batchstretchblit( DFBRectangle *srects,
                state->matrix[6] != 0 || state->matrix[7] != 0)) {
                if (gAcquire( state, DFXL_TEXTRIANGLES )) {
                     for (; i < num; ++i) {
-                         DFBRectangle *srect = &srects[i];
-                         DFBRectangle *drect = &drects[i];
-
-                         GenefxVertexAffine v[4];
-
-                         v[0].x = drect->x;
-                         v[0].y = drect->y;
-                         v[0].s = srect->x * 0x10000;
-                         v[0].t = srect->y * 0x10000;
-
-                         v[1].x = drect->x + drect->w - 1;
-                         v[1].y = drect->y;
-                         v[1].s = (srect->x + srect->w - 1) * 0x10000;
-                         v[1].t = v[0].t;
-
-                         v[2].x = drect->x + drect->w - 1;
-                         v[2].y = drect->y + drect->h - 1;
-                         v[2].s = v[1].s;
-                         v[2].t = (srect->y + srect->h - 1) * 0x10000;
-
-                         v[3].x = drect->x;
-                         v[3].y = drect->y + drect->h - 1;
-                         v[3].s = v[0].s;
-                         v[3].t = v[2].t;
-
-                         GenefxVertexAffine_Transform( v, 4, state->matrix, state->affine_matrix );
-
-                         Genefx_TextureTrianglesAffine( state, v, 4, DTTF_FAN, &state->clip );
+                         Genefx_TransformedBlit( state, &srects[i], &drects[i] );
                     }
 
                     gRelease( state );
@@ -3242,6 +3907,22 @@ dfb_gfxcard_tileblit( DFBRectangle *rect,
      /* Signal beginning of sequence of operations if not already done. */
      dfb_state_start_drawing( state );
 
+     if (state->num_clip_regions) {
+          ClipRegions regions;
+
+          for (clip_regions_start( &regions, state ); clip_regions_next( &regions );)
+               dfb_gfxcard_tileblit( rect, dx1, dy1, dx2, dy2, state );
+
+          dfb_state_unlock( state );
+          return;
+     }
+
+     if (damage_tracked( state )) {
+          DFBRegion bounds = { dx1, dy1, dx2, dy2 };
+
+          gfxcard_damage( state, &bounds );
+     }
+
      clip = &state->clip;
 
      /* Check if anything is drawn at all. */
@@ -3318,31 +3999,9 @@ dfb_gfxcard_tileblit( DFBRectangle *rect,
                          /* Build mesh. */
                          for (; dy1 < dy2; dy1 += rect->h) {
                               for (; dx1 < dx2; dx1 += rect->w) {
-                                   GenefxVertexAffine v[4];
+                                   DFBRectangle drect = { dx1, dy1, rect->w, rect->h };
 
-                                   v[0].x = dx1;
-                                   v[0].y = dy1;
-                                   v[0].s = rect->x * 0x10000;
-                                   v[0].t = rect->y * 0x10000;
-
-                                   v[1].x = dx1 + rect->w - 1;
-                                   v[1].y = dy1;
-                                   v[1].s = (rect->x + rect->w - 1) * 0x10000;
-                                   v[1].t = v[0].t;
-
-                                   v[2].x = dx1 + rect->w - 1;
-                                   v[2].y = dy1 + rect->h - 1;
-                                   v[2].s = v[1].s;
-                                   v[2].t = (rect->y + rect->h - 1) * 0x10000;
-
-                                   v[3].x = dx1;
-                                   v[3].y = dy1 + rect->h - 1;
-                                   v[3].s = v[0].s;
-                                   v[3].t = v[2].t;
-
-                                   GenefxVertexAffine_Transform( v, 4, state->matrix, state->affine_matrix );
-
-                                   Genefx_TextureTrianglesAffine( state, v, 4, DTTF_FAN, &state->clip );
+                                   Genefx_TransformedBlit( state, rect, &drect );
                               }
 
                               dx1 = odx;
@@ -3426,6 +4085,37 @@ dfb_gfxcard_texture_triangles( DFBVertex            *vertices,
      /* Signal beginning of sequence of operations if not already done. */
      dfb_state_start_drawing( state );
 
+     if (state->num_clip_regions) {
+          ClipRegions  regions;
+          DFBVertex   *copy = D_MALLOC( sizeof(DFBVertex) * num );
+
+          if (copy) {
+               /* The vertices are transformed in place. */
+               for (clip_regions_start( &regions, state ); clip_regions_next( &regions );) {
+                    direct_memcpy( copy, vertices, sizeof(DFBVertex) * num );
+                    dfb_gfxcard_texture_triangles( copy, num, formation, state );
+               }
+          }
+          else
+               D_OOM();
+
+          if (copy)
+               D_FREE( copy );
+
+          dfb_state_unlock( state );
+          return;
+     }
+
+     if (damage_tracked( state )) {
+          int       i;
+          DFBRegion bounds = DAMAGE_BOUNDS_INIT;
+
+          for (i = 0; i < num; i++)
+               damage_extend( &bounds, vertices[i].x - 1, vertices[i].y - 1, vertices[i].x + 1, vertices[i].y + 1 );
+
+          gfxcard_damage( state, &bounds );
+     }
+
      if ((D_FLAGS_IS_SET( card->caps.flags, CCF_CLIPPING ) ||
           D_FLAGS_IS_SET( card->caps.clip, DFXL_TEXTRIANGLES )) &&
          dfb_gfxcard_state_check_acquire( state, DFXL_TEXTRIANGLES )) {
@@ -3436,18 +4126,7 @@ dfb_gfxcard_texture_triangles( DFBVertex            *vertices,
 
      if (!hw) {
           if (gAcquire( state, DFXL_TEXTRIANGLES )) {
-               int                i;
-               GenefxVertexAffine v[num];
-
-               /* Convert vertices. */
-               for (i = 0; i < num; i++) {
-                    v[i].x = vertices[i].x;
-                    v[i].y = vertices[i].y;
-                    v[i].s = vertices[i].s * state->source->config.size.w * 0x10000;
-                    v[i].t = vertices[i].t * state->source->config.size.h * 0x10000;
-               }
-
-               Genefx_TextureTrianglesAffine( state, v, num, formation, &state->clip );
+               Genefx_TextureTriangles( state, vertices, num, formation, &state->clip );
 
                gRelease( state );
           }
@@ -3752,6 +4431,8 @@ dfb_gfxcard_sync()
 {
      DFBResult ret;
 
+     Genefx_Queue_Sync();
+
      if (!card)
           return DFB_OK;
 
@@ -3811,6 +4492,14 @@ dfb_gfxcard_wait_serial( const CoreGraphicsSerial *serial )
      return ret;
 }
 
+void
+dfb_gfxcard_wait_software( const CoreGraphicsSerial *serial )
+{
+     D_ASSERT( serial != NULL );
+
+     Genefx_Queue_Wait( serial );
+}
+
 void
 dfb_gfxcard_flush_texture_cache()
 {
@@ -4052,9 +4741,27 @@ dfb_gfxcard_update_stats( long long now )
           total  = now - shared->ts_start;
 
           if (total > dfb_config->gfxcard_stats * 1000LL) {
+               unsigned int hits, misses, uses, waits;
+
                D_INFO( "DirectFB/Graphics: Stats: busy %lld / %lld -> %3lld.%lld%%\n", shared->ts_busy_sum, total,
                        (1000 * shared->ts_busy_sum / total) / 10LL, (1000 * shared->ts_busy_sum / total) % 10LL );
 
+               gGetPipelineCacheStats( &hits, &misses );
+
+               D_INFO( "DirectFB/Graphics: Stats: Genefx pipeline cache %u hits, %u misses\n",
+                       hits - shared->genefx_hits, misses - shared->genefx_misses );
+
+               shared->genefx_hits   = hits;
+               shared->genefx_misses = misses;
+
+               dfb_gfx_get_copy_stats( &uses, &waits );
+
+               D_INFO( "DirectFB/Graphics: Stats: copy states %u uses, %u waits\n",
+                       uses - shared->copy_uses, waits - shared->copy_waits );
+
+               shared->copy_uses  = uses;
+               shared->copy_waits = waits;
+
                shared->ts_start    = now;
                shared->ts_busy_sum = 0;
           }
@@ -4103,6 +4810,9 @@ dfb_gfxcard_switch_idle()
                shared->ts_busy = 0;
           }
 
+          if (!shared->ts_start)
+               shared->ts_start = now;
+
           dfb_gfxcard_update_stats( now );
      }
 }
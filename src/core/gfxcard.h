@@ -357,6 +357,11 @@ void           dfb_gfxcard_state_init            ( CardState
 
 void           dfb_gfxcard_state_destroy         ( CardState                     *state );
 
+/*
+ * Unlock the buffers the software fallback keeps locked for following operations with the same state.
+ */
+void           dfb_gfxcard_state_release_locks   ( CardState                     *state );
+
 /*
  * Drawing functions, lock source and destination surfaces, handle clipping and drawing method (hardware/software).
  */
@@ -463,6 +468,11 @@ DFBResult      dfb_gfxcard_sync                  ( void );
 
 DFBResult      dfb_gfxcard_wait_serial           ( const CoreGraphicsSerial      *serial );
 
+/*
+ * Wait until the software operation with the specified serial has been rendered, see 'software-queue' option.
+ */
+void           dfb_gfxcard_wait_software         ( const CoreGraphicsSerial      *serial );
+
 void           dfb_gfxcard_flush_texture_cache   ( void );
 
 void           dfb_gfxcard_flush_read_cache      ( void );
@@ -34,6 +34,60 @@ struct __DFB_CoreGraphicsState {
 
 /**********************************************************************************************************************/
 
+/*
+ * Size of the buffer recording the commands of an indirect graphics state client.
+ */
+#define CORE_GRAPHICS_STATE_COMMANDS_SIZE 8192
+
+/*
+ * Commands executed by CoreGraphicsState_Execute(), with the arguments following the command header.
+ */
+typedef enum {
+     CGSC_SET_DRAWING_FLAGS,        /* u32 flags */
+     CGSC_SET_BLITTING_FLAGS,       /* u32 flags */
+     CGSC_SET_CLIP,                 /* DFBRegion region, DFBRegion regions[num] */
+     CGSC_SET_COLOR,                /* DFBColor color */
+     CGSC_SET_COLOR_AND_INDEX,      /* DFBColor color, u32 index */
+     CGSC_SET_SRC_BLEND,            /* u32 function */
+     CGSC_SET_DST_BLEND,            /* u32 function */
+     CGSC_SET_SRC_COLORKEY,         /* u32 key */
+     CGSC_SET_DST_COLORKEY,         /* u32 key */
+     CGSC_SET_DESTINATION,          /* u32 surface id */
+     CGSC_SET_SOURCE,               /* u32 surface id */
+     CGSC_SET_SOURCE_MASK,          /* u32 surface id */
+     CGSC_SET_SOURCE_MASK_VALS,     /* DFBPoint offset, u32 flags */
+     CGSC_SET_INDEX_TRANSLATION,    /* s32 indices[num] */
+     CGSC_SET_COLORKEY,             /* DFBColorKey key */
+     CGSC_SET_RENDER_OPTIONS,       /* u32 options */
+     CGSC_SET_MATRIX,               /* s32 values[9] */
+     CGSC_SET_SOURCE2,              /* u32 surface id */
+     CGSC_SET_FROM,                 /* u32 role, u32 eye */
+     CGSC_SET_TO,                   /* u32 role, u32 eye */
+     CGSC_SET_SRC_CONVOLUTION,      /* DFBConvolutionFilter filter */
+     CGSC_SET_SRC_COLORMATRIX,      /* s32 matrix[12] */
+     CGSC_RELEASE_SOURCE,           /* - */
+     CGSC_FILL_RECTANGLES,          /* DFBRectangle rects[num] */
+     CGSC_DRAW_RECTANGLES,          /* DFBRectangle rects[num] */
+     CGSC_DRAW_LINES,               /* DFBRegion lines[num] */
+     CGSC_FILL_TRIANGLES,           /* DFBTriangle triangles[num] */
+     CGSC_FILL_TRAPEZOIDS,          /* DFBTrapezoid trapezoids[num] */
+     CGSC_FILL_QUADRANGLES,         /* DFBPoint points[num] */
+     CGSC_FILL_SPANS,               /* s32 y, DFBSpan spans[num] */
+     CGSC_BLIT,                     /* DFBRectangle rects[num], DFBPoint points[num] */
+     CGSC_BLIT2,                    /* DFBRectangle rects[num], DFBPoint points1[num], DFBPoint points2[num] */
+     CGSC_STRETCH_BLIT,             /* DFBRectangle srects[num], DFBRectangle drects[num] */
+     CGSC_TILE_BLIT,                /* DFBRectangle rects[num], DFBPoint points1[num], DFBPoint points2[num] */
+     CGSC_TEXTURE_TRIANGLES         /* u32 formation, DFBVertex vertices[num] */
+} CoreGraphicsStateCommandType;
+
+typedef struct {
+     u32 type;                      /* CoreGraphicsStateCommandType */
+     u32 num;                       /* Number of elements of array arguments. */
+     u32 size;                      /* Size of the arguments following, a multiple of 4. */
+} CoreGraphicsStateCommand;
+
+/**********************************************************************************************************************/
+
 typedef enum {
      CGSNF_NONE = 0x00000000,
 } CoreGraphicsStateNotificationFlags;
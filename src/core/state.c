@@ -162,6 +162,9 @@ dfb_state_destroy( CardState *state )
      else
           D_ASSERT( state->index_translation == NULL );
 
+     if (state->clip_regions)
+          D_FREE( state->clip_regions );
+
      direct_mutex_deinit( &state->lock );
 }
 
@@ -187,6 +190,8 @@ dfb_state_set_destination( CardState   *state,
                validate_clip( state, destination->config.size.w - 1, destination->config.size.h - 1, false );
           }
 
+          dfb_gfxcard_state_release_locks( state );
+
           if (state->destination) {
                D_ASSERT( D_FLAGS_IS_SET( state->flags, CSF_DESTINATION ) );
 
@@ -233,6 +238,8 @@ dfb_state_set_destination_2( CardState   *state,
                validate_clip( state, destination->config.size.w - 1, destination->config.size.h - 1, false );
           }
 
+          dfb_gfxcard_state_release_locks( state );
+
           if (state->destination) {
                D_ASSERT( D_FLAGS_IS_SET( state->flags, CSF_DESTINATION ) );
 
@@ -279,6 +286,8 @@ dfb_state_set_source( CardState   *state,
                return DFB_DEAD;
           }
 
+          dfb_gfxcard_state_release_locks( state );
+
           if (state->source) {
                D_ASSERT( D_FLAGS_IS_SET( state->flags, CSF_SOURCE ) );
 
@@ -318,6 +327,8 @@ dfb_state_set_source_2( CardState   *state,
                return DFB_DEAD;
           }
 
+          dfb_gfxcard_state_release_locks( state );
+
           if (state->source) {
                D_ASSERT( D_FLAGS_IS_SET( state->flags, CSF_SOURCE ) );
 
@@ -402,6 +413,8 @@ dfb_state_set_source_mask( CardState   *state,
                return DFB_DEAD;
           }
 
+          dfb_gfxcard_state_release_locks( state );
+
           if (state->source_mask) {
                D_ASSERT( D_FLAGS_IS_SET( state->flags, CSF_SOURCE_MASK ) );
 
@@ -576,6 +589,70 @@ dfb_state_set_index_translation( CardState *state,
      return DFB_OK;
 }
 
+static int
+clip_region_compare( const void *a,
+                     const void *b )
+{
+     const DFBRegion *ra = a;
+     const DFBRegion *rb = b;
+
+     if (ra->y1 != rb->y1)
+          return (ra->y1 < rb->y1) ? -1 : 1;
+
+     if (ra->x1 != rb->x1)
+          return (ra->x1 < rb->x1) ? -1 : 1;
+
+     return 0;
+}
+
+DFBResult
+dfb_state_set_clip_regions( CardState       *state,
+                            const DFBRegion *regions,
+                            unsigned int     num )
+{
+     D_MAGIC_ASSERT( state, CardState );
+     D_ASSERT( regions != NULL || num == 0 );
+
+     if (num > DFB_CLIP_REGIONS_MAX)
+          return DFB_LIMITEXCEEDED;
+
+     dfb_state_lock( state );
+
+     if (state->num_clip_regions == num &&
+         (!num || !memcmp( state->clip_regions, regions, num * sizeof(DFBRegion) ))) {
+          dfb_state_unlock( state );
+          return DFB_OK;
+     }
+
+     if (num) {
+          DFBRegion *new_regions = D_REALLOC( state->clip_regions, num * sizeof(DFBRegion) );
+
+          if (!new_regions) {
+               dfb_state_unlock( state );
+               return D_OOM();
+          }
+
+          direct_memcpy( new_regions, regions, num * sizeof(DFBRegion) );
+
+          qsort( new_regions, num, sizeof(DFBRegion), clip_region_compare );
+
+          state->clip_regions = new_regions;
+     }
+     else if (state->clip_regions) {
+          D_FREE( state->clip_regions );
+
+          state->clip_regions = NULL;
+     }
+
+     state->num_clip_regions = num;
+
+     state->modified |= SMF_CLIP;
+
+     dfb_state_unlock( state );
+
+     return DFB_OK;
+}
+
 void
 dfb_state_set_matrix( CardState *state,
                       const s32 *matrix )
@@ -31,6 +31,11 @@
  */
 #define DFB_COLOR_IDS_MAX 8
 
+/*
+ * Maximum number of clipping regions, the whole set is recorded with a single command by the graphics state client.
+ */
+#define DFB_CLIP_REGIONS_MAX 256
+
 typedef enum {
      CSF_NONE               = 0x00000000, /* none of these */
 
@@ -176,6 +181,10 @@ struct __DFB_CardState {
 
      DFBConvolutionFilter     src_convolution;                  /* 3x3 kernel, scale and bias */
 
+     DFBRegion               *clip_regions;                     /* set of non-overlapping rectangles further restricting
+                                                                   the clipping rectangle, sorted by y1 */
+     unsigned int             num_clip_regions;                 /* number of rectangles in the set, 0 if unused */
+
      void                    *gfxcard_data;                     /* gfx driver specific state data */
 
      u32                      source_flip_count;                /* source flip count */
@@ -185,6 +194,10 @@ struct __DFB_CardState {
 
      u32                      destination_flip_count;           /* destination flip count */
      bool                     destination_flip_count_used;      /* destination flip count used */
+
+     CoreSurface             *damage_surface;                   /* destination with pending back buffer damage */
+     DFBRegion                damage;                           /* bounds of the pending damage */
+     CardState               *damage_next;                      /* next state with pending damage */
 };
 
 /**********************************************************************************************************************/
@@ -226,6 +239,15 @@ DFBResult dfb_state_set_index_translation( CardState                  *state,
                                            const int                  *indices,
                                            int                         num_indices );
 
+/*
+ * Restrict clipping to the union of a set of non-overlapping regions intersected with the clipping rectangle,
+ * or remove the restriction if 'num' is 0. The regions are copied and kept sorted from top to bottom.
+ * Returns DFB_LIMITEXCEEDED for more than DFB_CLIP_REGIONS_MAX regions.
+ */
+DFBResult dfb_state_set_clip_regions     ( CardState                  *state,
+                                           const DFBRegion            *regions,
+                                           unsigned int                num );
+
 void      dfb_state_set_matrix           ( CardState                  *state,
                                            const s32                  *matrix );
 
@@ -291,6 +313,9 @@ dfb_state_stop_drawing( CardState *state )
                state->flags = state->flags & ~CSF_DRAWING;
           }
      }
+
+     /* Do not keep the buffers locked beyond the sequence of operations. */
+     dfb_gfxcard_state_release_locks( state );
 }
 
 static __inline__ void
@@ -370,6 +370,9 @@ dfb_surface_create( CoreDFB                  *core,
 
      fusion_hash_create( surface->shmpool, HASH_INT, HASH_PTR, 7, &surface->frames );
 
+     for (i = 0; i < CORE_SURFACE_DAMAGE_FRAMES; i++)
+          dfb_updates_init( &surface->damage[i], surface->damage_regions[i], CORE_SURFACE_DAMAGE_REGIONS );
+
      D_MAGIC_SET( surface, CoreSurface );
 
      if (dfb_config->warn.flags & DCWF_CREATE_SURFACE                         &&
@@ -842,6 +845,145 @@ dfb_surface_check_acks( CoreSurface *surface )
      return DFB_OK;
 }
 
+static inline bool
+damage_tracking_enabled( void )
+{
+#if FUSION_BUILD_MULTI
+     /* Slaves cannot record their buffer access in secure mode, damage is not tracked at all then. */
+     if (fusion_config->secure_fusion)
+          return false;
+#endif /* FUSION_BUILD_MULTI */
+
+     return dfb_config->damage_tracking;
+}
+
+void
+dfb_surface_damage_add( CoreSurface     *surface,
+                        const DFBRegion *region )
+{
+     DFBRegion area;
+
+     D_MAGIC_ASSERT( surface, CoreSurface );
+     DFB_REGION_ASSERT_IF( region );
+
+     if (!damage_tracking_enabled() || !(surface->config.caps & DSCAPS_FLIPPING))
+          return;
+
+     area = DFB_REGION_INIT_FROM_DIMENSION( &surface->config.size );
+
+     if (region && !dfb_region_region_intersect( &area, region ))
+          return;
+
+     D_DEBUG_AT( Core_Surface_Updates, "%s( %p [%u], %4d,%4d-%4dx%4d )\n", __FUNCTION__,
+                 surface, surface->object.id, DFB_RECTANGLE_VALS_FROM_REGION( &area ) );
+
+     dfb_surface_lock( surface );
+
+     dfb_updates_add( &surface->damage[surface->damage_frame], &area );
+
+     dfb_surface_unlock( surface );
+}
+
+bool
+dfb_surface_damage_get( CoreSurface     *surface,
+                        const DFBRegion *update,
+                        DFBRegion       *ret_regions,
+                        int             *ret_num,
+                        bool            *ret_complete )
+{
+     int           i, n;
+     int           num = 0;
+     DFBRegion     area;
+     DFBUpdates    damage;
+     DFBRegion     regions[CORE_SURFACE_DAMAGE_REGIONS];
+     DFBRectangle  rects[CORE_SURFACE_DAMAGE_REGIONS];
+
+     D_MAGIC_ASSERT( surface, CoreSurface );
+     FUSION_SKIRMISH_ASSERT( &surface->lock );
+     DFB_REGION_ASSERT_IF( update );
+     D_ASSERT( ret_regions != NULL );
+     D_ASSERT( ret_num != NULL );
+     D_ASSERT( ret_complete != NULL );
+
+     area = DFB_REGION_INIT_FROM_DIMENSION( &surface->config.size );
+
+     /* Without damage the update brings the front buffer up to date if it covers the whole surface. */
+     *ret_complete = !update || dfb_region_region_contains( update, &area );
+
+     if (!damage_tracking_enabled() || !surface->damage_age || (surface->config.caps & DSCAPS_STEREO))
+          return false;
+
+     if (update && !dfb_region_region_intersect( &area, update )) {
+          *ret_num = 0;
+          return true;
+     }
+
+     /* Unite the damage of the frames the front buffer is lagging behind. */
+     dfb_updates_init( &damage, regions, CORE_SURFACE_DAMAGE_REGIONS );
+
+     for (i = 0; i < surface->damage_age; i++) {
+          DFBUpdates *frame = &surface->damage[(surface->damage_frame + CORE_SURFACE_DAMAGE_FRAMES - i) %
+                                               CORE_SURFACE_DAMAGE_FRAMES];
+
+          for (n = 0; n < frame->num_regions; n++)
+               dfb_updates_add( &damage, &frame->regions[n] );
+     }
+
+     dfb_updates_get_rectangles( &damage, rects, &n );
+
+     dfb_updates_deinit( &damage );
+
+     *ret_complete = true;
+
+     for (i = 0; i < n; i++) {
+          DFBRegion region = DFB_REGION_INIT_FROM_RECTANGLE( &rects[i] );
+
+          if (!dfb_region_region_contains( &area, &region ))
+               *ret_complete = false;
+
+          if (dfb_region_region_intersect( &region, &area ))
+               ret_regions[num++] = region;
+     }
+
+     D_DEBUG_AT( Core_Surface_Updates, "%s( %p [%u] ) -> %d regions of %d frames%s\n", __FUNCTION__,
+                 surface, surface->object.id, num, surface->damage_age, *ret_complete ? "" : " (incomplete)" );
+
+     *ret_num = num;
+
+     return true;
+}
+
+void
+dfb_surface_damage_next( CoreSurface *surface,
+                         bool         front_synced )
+{
+     D_MAGIC_ASSERT( surface, CoreSurface );
+     FUSION_SKIRMISH_ASSERT( &surface->lock );
+
+     if (front_synced)
+          surface->damage_age = 1;
+     else if (surface->damage_age && ++surface->damage_age > CORE_SURFACE_DAMAGE_FRAMES)
+          surface->damage_age = 0;
+
+     surface->damage_frame = (surface->damage_frame + 1) % CORE_SURFACE_DAMAGE_FRAMES;
+
+     dfb_updates_reset( &surface->damage[surface->damage_frame] );
+}
+
+void
+dfb_surface_damage_reset( CoreSurface *surface )
+{
+     int i;
+
+     D_MAGIC_ASSERT( surface, CoreSurface );
+     FUSION_SKIRMISH_ASSERT( &surface->lock );
+
+     for (i = 0; i < CORE_SURFACE_DAMAGE_FRAMES; i++)
+          dfb_updates_reset( &surface->damage[i] );
+
+     surface->damage_age = 0;
+}
+
 DFBResult
 dfb_surface_reconfig( CoreSurface             *surface,
                       const CoreSurfaceConfig *config )
@@ -882,6 +1024,8 @@ dfb_surface_reconfig( CoreSurface             *surface,
 
           direct_serial_increase( &surface->config_serial );
 
+          dfb_surface_damage_reset( surface );
+
           fusion_skirmish_dismiss( &surface->lock );
 
           return DFB_OK;
@@ -940,6 +1084,8 @@ dfb_surface_reconfig( CoreSurface             *surface,
      surface->num_buffers = 0;
      surface->flips++;
 
+     dfb_surface_damage_reset( surface );
+
      Core_Resource_UpdateSurface( surface, &new_config );
 
      surface->config = new_config;
@@ -1052,6 +1198,8 @@ dfb_surface_destroy_buffers( CoreSurface *surface )
 
      surface->num_buffers = 0;
 
+     dfb_surface_damage_reset( surface );
+
      fusion_skirmish_dismiss( &surface->lock );
 
      return DFB_OK;
@@ -1085,6 +1233,8 @@ dfb_surface_deallocate_buffers( CoreSurface *surface )
      }
      dfb_surface_set_stereo_eye( surface, DSSE_LEFT );
 
+     dfb_surface_damage_reset( surface );
+
      fusion_skirmish_dismiss( &surface->lock );
 
      return DFB_OK;
@@ -1355,6 +1505,12 @@ dfb_surface_write_buffer( CoreSurface          *surface,
      D_DEBUG_AT( Core_Surface, "  -> PreLockBuffer returned allocation %p (%s)\n", allocation,
                  allocation->pool->desc.name );
 
+     if (role == DSBR_BACK) {
+          DFBRegion region = DFB_REGION_INIT_FROM_RECTANGLE( &rectangle );
+
+          dfb_surface_damage_add( surface, &region );
+     }
+
      /* Try writing to allocation directly... */
      ret = source ? dfb_surface_pool_write( allocation->pool, allocation, source, pitch, &rectangle ) : DFB_UNSUPPORTED;
      if (ret) {
@@ -1490,6 +1646,8 @@ dfb_surface_dump_buffer2( CoreSurface          *surface,
      CoreSurfaceAllocation *allocation;
      CoreSurfaceBufferLock  lock;
      DirectFile             fd_p, fd_g;
+     u8                    *conv_p = NULL;
+     u8                    *conv_g = NULL;
 
      D_MAGIC_ASSERT( surface, CoreSurface );
      D_ASSERT( path != NULL );
@@ -1665,6 +1823,36 @@ dfb_surface_dump_buffer2( CoreSurface          *surface,
           direct_file_write( &fd_g, head, strlen( head ), &bytes );
      }
 
+     /* Convert the whole buffer at once if possible, falling back to single rows below. */
+     if (lock.buffer->config.format != DSPF_LUT8) {
+          u8  *srces[3]   = { NULL, NULL, NULL };
+          int  pitches[3] = { 0, 0, 0 };
+          int  w          = surface->config.size.w;
+          int  h          = surface->config.size.h;
+
+          dfb_surface_get_data_offsets( &surface->config, lock.addr, lock.pitch, 0, 0, 3, srces, pitches );
+
+          if (rgb) {
+               conv_p = D_CALLOC( h, w * 3 );
+               if (conv_p && dfb_convert_buffer( lock.buffer->config.format, lock.buffer->config.colorspace,
+                                                 srces[0], pitches[0], srces[1], pitches[1], srces[2], pitches[2],
+                                                 h, DSPF_RGB24, conv_p, w * 3, w, h )) {
+                    D_FREE( conv_p );
+                    conv_p = NULL;
+               }
+          }
+
+          if (alpha) {
+               conv_g = D_CALLOC( h, w );
+               if (conv_g && dfb_convert_buffer( lock.buffer->config.format, lock.buffer->config.colorspace,
+                                                 srces[0], pitches[0], srces[1], pitches[1], srces[2], pitches[2],
+                                                 h, DSPF_A8, conv_g, w, w, h )) {
+                    D_FREE( conv_g );
+                    conv_g = NULL;
+               }
+          }
+     }
+
      /* Write the pixmap (and graymap) data. */
      for (i = 0; i < surface->config.size.h; i++) {
           int n3;
@@ -1678,7 +1866,9 @@ dfb_surface_dump_buffer2( CoreSurface          *surface,
           src8 = srces[0];
 
           /* Write color buffer to pixmap file. */
-          if (rgb) {
+          if (rgb && conv_p)
+               direct_file_write( &fd_p, conv_p + i * surface->config.size.w * 3, surface->config.size.w * 3, &bytes );
+          else if (rgb) {
                u8 buf_p[surface->config.size.w*3];
 
                if (lock.buffer->config.format == DSPF_LUT8) {
@@ -1698,7 +1888,9 @@ dfb_surface_dump_buffer2( CoreSurface          *surface,
           }
 
           /* Write alpha buffer to graymap file. */
-          if (alpha) {
+          if (alpha && conv_g)
+               direct_file_write( &fd_g, conv_g + i * surface->config.size.w, surface->config.size.w, &bytes );
+          else if (alpha) {
                u8 buf_g[surface->config.size.w];
 
                if (lock.buffer->config.format == DSPF_LUT8) {
@@ -1716,6 +1908,12 @@ dfb_surface_dump_buffer2( CoreSurface          *surface,
      /* Unlock the surface buffer. */
      dfb_surface_buffer_unlock( &lock );
 
+     if (conv_p)
+          D_FREE( conv_p );
+
+     if (conv_g)
+          D_FREE( conv_g );
+
      /* Release the palette. */
      if (palette)
           dfb_palette_unref( palette );
@@ -22,6 +22,7 @@
 #include <core/coredefs.h>
 #include <core/coretypes.h>
 #include <direct/serial.h>
+#include <directfb_util.h>
 #include <fusion/object.h>
 
 /**********************************************************************************************************************/
@@ -102,6 +103,9 @@ typedef enum {
      CSNF_ALL                       = 0x00000FF9  /* all of these */
 } CoreSurfaceNotificationFlags;
 
+#define CORE_SURFACE_DAMAGE_FRAMES     4  /* frames of damage history kept for the front buffer age */
+#define CORE_SURFACE_DAMAGE_REGIONS    8  /* regions per frame before collapsing to the bounding box */
+
 struct __DFB_CoreSurface
 {
      FusionObject                   object;
@@ -151,6 +155,11 @@ struct __DFB_CoreSurface
      FusionHash                    *frames;
 
      DirectSerial                   config_serial;
+
+     DFBUpdates                     damage[CORE_SURFACE_DAMAGE_FRAMES];  /* rendered to back buffer, per frame */
+     DFBRegion                      damage_regions[CORE_SURFACE_DAMAGE_FRAMES][CORE_SURFACE_DAMAGE_REGIONS];
+     unsigned int                   damage_frame;                        /* index of the current frame */
+     int                            damage_age;                          /* frames the front buffer lags, 0 if unknown */
 };
 
 /**********************************************************************************************************************/
@@ -260,6 +269,26 @@ DFBResult          dfb_surface_dispatch_update   ( CoreSurface
 
 DFBResult          dfb_surface_check_acks        ( CoreSurface                   *surface );
 
+/*
+ * Damage tracking of the back buffer of flipping surfaces.
+ * All but dfb_surface_damage_add() are called with the surface being locked. Rendering accumulates its damage in
+ * the graphics state, which is merged into the surface when the state is flushed, see dfb_gfxcard_flush().
+ */
+
+void               dfb_surface_damage_add        ( CoreSurface                   *surface,
+                                                   const DFBRegion               *region );
+
+bool               dfb_surface_damage_get        ( CoreSurface                   *surface,
+                                                   const DFBRegion               *update,
+                                                   DFBRegion                     *ret_regions,
+                                                   int                           *ret_num,
+                                                   bool                          *ret_complete );
+
+void               dfb_surface_damage_next       ( CoreSurface                   *surface,
+                                                   bool                           front_synced );
+
+void               dfb_surface_damage_reset      ( CoreSurface                   *surface );
+
 DFBResult          dfb_surface_reconfig          ( CoreSurface                   *surface,
                                                    const CoreSurfaceConfig       *config );
 
@@ -573,4 +602,14 @@ dfb_surface_calc_buffer_size( CoreSurface *surface,
           *ret_size = pitch * DFB_PLANE_MULTIPLY( format, surface->config.size.h );
 }
 
+/*
+ * Whether the format has colors along with an alpha channel, i.e. can hold premultiplied pixels.
+ */
+static __inline__ bool
+dfb_surface_format_can_premultiply( DFBSurfacePixelFormat format )
+{
+     return DFB_PIXELFORMAT_HAS_ALPHA( format ) && DFB_COLOR_BITS_PER_PIXEL( format ) &&
+            !DFB_PIXELFORMAT_IS_INDEXED( format );
+}
+
 #endif
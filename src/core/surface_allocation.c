@@ -50,6 +50,9 @@ surface_allocation_destructor( FusionObject *object,
 
           CORE_SURFACE_ALLOCATION_ASSERT( allocation );
 
+          /* Wait for the operations to finish. */
+          dfb_surface_allocation_wait( allocation, CSAID_CPU, CSAF_READ | CSAF_WRITE );
+
           dfb_surface_pool_deallocate( allocation->pool, allocation );
 
           if (allocation->surface)
@@ -167,9 +170,8 @@ dfb_surface_allocation_decouple( CoreSurfaceAllocation *allocation )
 
      locks = dfb_surface_allocation_locks( allocation );
      if (!locks) {
-          if (allocation->accessed[CSAID_GPU] & (CSAF_READ | CSAF_WRITE))
-               /* Wait for the operation to finish. */
-               dfb_gfxcard_wait_serial( &allocation->gfx_serial );
+          /* Wait for the operations to finish. */
+          dfb_surface_allocation_wait( allocation, CSAID_CPU, CSAF_READ | CSAF_WRITE );
 
           dfb_surface_pool_deallocate( allocation->pool, allocation );
      }
@@ -511,6 +513,56 @@ dfb_surface_allocation_update( CoreSurfaceAllocation  *allocation,
      return DFB_OK;
 }
 
+void
+dfb_surface_allocation_wait( CoreSurfaceAllocation  *allocation,
+                             CoreSurfaceAccessorID   accessor,
+                             CoreSurfaceAccessFlags  access )
+{
+     CoreSurfaceAccessFlags synced = CSAF_NONE;
+
+     D_MAGIC_ASSERT( allocation, CoreSurfaceAllocation );
+
+     D_DEBUG_AT( Core_SurfAllocation, "%s( %p, 0x%02x, 0x%02x )\n", __FUNCTION__, allocation, accessor, access );
+
+     /* Queued software operations writing to the allocation. */
+     dfb_gfxcard_wait_software( &allocation->sw_write_serial );
+
+     /* Queued software operations reading from the allocation. */
+     if (access & CSAF_WRITE)
+          dfb_gfxcard_wait_software( &allocation->sw_read_serial );
+
+     /* Hardware operations are executed in order. */
+     if (accessor == CSAID_GPU)
+          return;
+
+     /* If hardware has written or is writing, wait for the last operation writing to finish. */
+     if (allocation->accessed[CSAID_GPU] & CSAF_WRITE) {
+          dfb_gfxcard_wait_serial( &allocation->gfx_write_serial );
+
+          /* Software read access after hardware write requires flush of the (bus) read cache. */
+          dfb_gfxcard_flush_read_cache();
+
+          synced |= CSAF_WRITE;
+     }
+
+     /* If hardware has (to) read, wait for the last operation reading to finish in case of writing. */
+     if (access & CSAF_WRITE && allocation->accessed[CSAID_GPU] & CSAF_READ) {
+          dfb_gfxcard_wait_serial( &allocation->gfx_read_serial );
+
+          synced |= CSAF_READ;
+     }
+
+     /* Clear the hardware access waited for, unless other locks may still use it. */
+     if (synced && allocation->surface) {
+          dfb_surface_lock( allocation->surface );
+
+          if (!dfb_surface_allocation_locks( allocation ))
+               allocation->accessed[CSAID_GPU] &= ~synced;
+
+          dfb_surface_unlock( allocation->surface );
+     }
+}
+
 DFBResult
 dfb_surface_allocation_dump( CoreSurfaceAllocation *allocation,
                              const char            *directory,
@@ -63,7 +63,11 @@ struct __DFB_CoreSurfaceAllocation {
      unsigned long                 resource_id;         /* layer id, window id, or user specified */
      int                           index;               /* index of surface buffer */
 
-     CoreGraphicsSerial            gfx_serial;          /* graphics serial */
+     CoreGraphicsSerial            gfx_write_serial;    /* serial of the last hardware operation writing to it */
+     CoreGraphicsSerial            gfx_read_serial;     /* serial of the last hardware operation reading from it */
+     CoreGraphicsSerial            sw_write_serial;     /* serial of the last operation queued by Genefx writing to it */
+     CoreGraphicsSerial            sw_read_serial;      /* serial of the last operation queued by Genefx reading from
+                                                           it */
 
      FusionCall                    call;                /* dispatch */
 
@@ -131,6 +135,15 @@ DFBResult         dfb_surface_allocation_dump       ( CoreSurfaceAllocation   *a
                                                       const char              *prefix,
                                                       bool                     raw );
 
+/*
+ * Wait for the operations conflicting with the access, i.e. the ones writing to the allocation for read access and all
+ * of them for write access. Hardware operations are only waited for if the accessor is not the GPU, followed by a read
+ * cache flush after hardware writes, and their access is cleared if the allocation is not locked otherwise.
+ */
+void              dfb_surface_allocation_wait       ( CoreSurfaceAllocation   *allocation,
+                                                      CoreSurfaceAccessorID    accessor,
+                                                      CoreSurfaceAccessFlags   access );
+
 /**********************************************************************************************************************/
 
 static __inline__ int
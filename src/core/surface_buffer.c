@@ -468,6 +468,8 @@ dfb_surface_buffer_dump_type_locked2( CoreSurfaceBuffer *buffer,
      size_t       bytes;
      CorePalette *palette = NULL;
      DirectFile   fd_p, fd_g;
+     u8          *conv_p = NULL;
+     u8          *conv_g = NULL;
 
      D_MAGIC_ASSERT( buffer, CoreSurfaceBuffer );
      D_MAGIC_ASSERT( buffer->surface, CoreSurface );
@@ -621,6 +623,36 @@ dfb_surface_buffer_dump_type_locked2( CoreSurfaceBuffer *buffer,
           }
      }
 
+     /* Convert the whole buffer at once if possible, falling back to single rows below. */
+     if (buffer->config.format != DSPF_LUT8) {
+          u8  *srces[3]   = { NULL, NULL, NULL };
+          int  pitches[3] = { 0, 0, 0 };
+          int  w          = buffer->config.size.w;
+          int  h          = buffer->config.size.h;
+
+          dfb_surface_get_data_offsets( &buffer->config, addr, pitch, 0, 0, 3, srces, pitches );
+
+          if (rgb) {
+               conv_p = D_CALLOC( h, w * (raw ? 4 : 3) );
+               if (conv_p && dfb_convert_buffer( buffer->config.format, buffer->config.colorspace,
+                                                 srces[0], pitches[0], srces[1], pitches[1], srces[2], pitches[2],
+                                                 h, raw ? DSPF_ARGB : DSPF_RGB24, conv_p, w * (raw ? 4 : 3), w, h )) {
+                    D_FREE( conv_p );
+                    conv_p = NULL;
+               }
+          }
+
+          if (alpha && !raw) {
+               conv_g = D_CALLOC( h, w );
+               if (conv_g && dfb_convert_buffer( buffer->config.format, buffer->config.colorspace,
+                                                 srces[0], pitches[0], srces[1], pitches[1], srces[2], pitches[2],
+                                                 h, DSPF_A8, conv_g, w, w, h )) {
+                    D_FREE( conv_g );
+                    conv_g = NULL;
+               }
+          }
+     }
+
      /* Write the pixmap (and graymap) data. */
      for (i = 0; i < buffer->config.size.h; i++) {
           int n3;
@@ -634,7 +666,12 @@ dfb_surface_buffer_dump_type_locked2( CoreSurfaceBuffer *buffer,
           src8 = srces[0];
 
           /* Write color buffer to pixmap file. */
-          if (rgb) {
+          if (rgb && conv_p) {
+               int row = buffer->config.size.w * (raw ? 4 : 3);
+
+               direct_file_write( &fd_p, conv_p + i * row, row, &bytes );
+          }
+          else if (rgb) {
                if (raw) {
                     u8 buf_p[buffer->config.size.w*4];
 
@@ -675,7 +712,9 @@ dfb_surface_buffer_dump_type_locked2( CoreSurfaceBuffer *buffer,
           }
 
           /* Write alpha buffer to graymap file. */
-          if (alpha && !raw) {
+          if (alpha && !raw && conv_g)
+               direct_file_write( &fd_g, conv_g + i * buffer->config.size.w, buffer->config.size.w, &bytes );
+          else if (alpha && !raw) {
                u8 buf_g[buffer->config.size.w];
 
                if (buffer->config.format == DSPF_LUT8) {
@@ -690,6 +729,12 @@ dfb_surface_buffer_dump_type_locked2( CoreSurfaceBuffer *buffer,
           }
      }
 
+     if (conv_p)
+          D_FREE( conv_p );
+
+     if (conv_g)
+          D_FREE( conv_g );
+
      /* Release the palette. */
      if (palette)
           dfb_palette_unref( palette );
@@ -1047,6 +1047,9 @@ dfb_surface_pool_lock( CoreSurfacePool       *pool,
 
      D_ASSERT( funcs->Lock != NULL );
 
+     /* Wait only for the operations accessing this allocation. */
+     dfb_surface_allocation_wait( allocation, lock->accessor, lock->access );
+
      lock->allocation = allocation;
      lock->buffer     = allocation->buffer;
 
@@ -420,6 +420,10 @@ dfb_window_create( CoreWindowStack             *stack,
           }
      }
 
+     /* Keep the window contents premultiplied for composition. */
+     if (dfb_config->premultiplied && dfb_surface_format_can_premultiply( pixelformat ))
+          surface_caps |= DSCAPS_PREMULTIPLIED;
+
      /* Set the color space. */
      if (colorspace == DSCS_UNKNOWN) {
           colorspace = DFB_COLORSPACE_DEFAULT( pixelformat );
@@ -0,0 +1,109 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#include <core/display_list.h>
+#include <directfb_util.h>
+#include <display/idirectfbdisplaylist.h>
+
+D_DEBUG_DOMAIN( DisplayList, "IDirectFBDisplayList", "IDirectFBDisplayList Interface" );
+
+/**********************************************************************************************************************/
+
+static void
+IDirectFBDisplayList_Destruct( IDirectFBDisplayList *thiz )
+{
+     IDirectFBDisplayList_data *data = thiz->priv;
+
+     D_DEBUG_AT( DisplayList, "%s( %p )\n", __FUNCTION__, thiz );
+
+     dfb_display_list_destroy( data->list );
+
+     DIRECT_DEALLOCATE_INTERFACE( thiz );
+}
+
+static DirectResult
+IDirectFBDisplayList_AddRef( IDirectFBDisplayList *thiz )
+{
+     DIRECT_INTERFACE_GET_DATA( IDirectFBDisplayList )
+
+     D_DEBUG_AT( DisplayList, "%s( %p )\n", __FUNCTION__, thiz );
+
+     data->ref++;
+
+     return DFB_OK;
+}
+
+static DirectResult
+IDirectFBDisplayList_Release( IDirectFBDisplayList *thiz )
+{
+     DIRECT_INTERFACE_GET_DATA( IDirectFBDisplayList )
+
+     D_DEBUG_AT( DisplayList, "%s( %p )\n", __FUNCTION__, thiz );
+
+     if (--data->ref == 0)
+          IDirectFBDisplayList_Destruct( thiz );
+
+     return DFB_OK;
+}
+
+static DFBResult
+IDirectFBDisplayList_GetBounds( IDirectFBDisplayList *thiz,
+                                DFBRectangle         *ret_rect )
+{
+     DFBResult ret;
+     DFBRegion bounds;
+
+     DIRECT_INTERFACE_GET_DATA( IDirectFBDisplayList )
+
+     D_DEBUG_AT( DisplayList, "%s( %p )\n", __FUNCTION__, thiz );
+
+     if (!ret_rect)
+          return DFB_INVARG;
+
+     ret = dfb_display_list_get_bounds( data->list, &bounds );
+     if (ret)
+          return ret;
+
+     dfb_region_translate( &bounds, -data->origin.x, -data->origin.y );
+
+     *ret_rect = DFB_RECTANGLE_INIT_FROM_REGION( &bounds );
+
+     return DFB_OK;
+}
+
+DFBResult
+IDirectFBDisplayList_Construct( IDirectFBDisplayList *thiz,
+                                CoreDisplayList      *list,
+                                int                   x,
+                                int                   y )
+{
+     DIRECT_ALLOCATE_INTERFACE_DATA( thiz, IDirectFBDisplayList )
+
+     D_DEBUG_AT( DisplayList, "%s( %p )\n", __FUNCTION__, thiz );
+
+     data->ref      = 1;
+     data->list     = list;
+     data->origin.x = x;
+     data->origin.y = y;
+
+     thiz->AddRef    = IDirectFBDisplayList_AddRef;
+     thiz->Release   = IDirectFBDisplayList_Release;
+     thiz->GetBounds = IDirectFBDisplayList_GetBounds;
+
+     return DFB_OK;
+}
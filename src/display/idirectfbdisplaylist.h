@@ -0,0 +1,43 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#ifndef __DISPLAY__IDIRECTFBDISPLAYLIST_H__
+#define __DISPLAY__IDIRECTFBDISPLAYLIST_H__
+
+#include <core/coretypes.h>
+
+/*
+ * private data struct of IDirectFBDisplayList
+ */
+typedef struct {
+     int              ref;    /* reference counter */
+
+     CoreDisplayList *list;   /* the recorded operations */
+
+     DFBPoint         origin; /* origin of the surface used for recording */
+} IDirectFBDisplayList_data;
+
+/*
+ * initializes interface struct and private data, taking over the display list
+ */
+DFBResult IDirectFBDisplayList_Construct( IDirectFBDisplayList *thiz,
+                                          CoreDisplayList      *list,
+                                          int                   x,
+                                          int                   y );
+
+#endif
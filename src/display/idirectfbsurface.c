@@ -20,6 +20,7 @@
 #include <core/CoreSurface.h>
 #include <core/CoreSurfaceClient.h>
 #include <core/core.h>
+#include <core/display_list.h>
 #include <core/fonts.h>
 #include <core/palette.h>
 #include <core/surface_allocation.h>
@@ -27,6 +28,7 @@
 #include <core/surface_pool.h>
 #include <direct/memcpy.h>
 #include <direct/thread.h>
+#include <display/idirectfbdisplaylist.h>
 #include <display/idirectfbpalette.h>
 #include <display/idirectfbsurface.h>
 #include <display/idirectfbsurfaceallocation.h>
@@ -152,6 +154,9 @@ IDirectFBSurface_Destruct( IDirectFBSurface *thiz )
           dfb_surface_detach( data->surface, &data->reaction_frame );
      }
 
+     if (data->state_client.display_list)
+          dfb_display_list_destroy( data->state_client.display_list );
+
      CoreGraphicsStateClient_Deinit( &data->state_client );
 
      dfb_state_stop_drawing( &data->state );
@@ -575,6 +580,15 @@ IDirectFBSurface_Lock( IDirectFBSurface     *thiz,
 
                dfb_surface_allocation_ref( allocation );
 
+               data->allocations[index] = allocation = NULL;
+          }
+          else if (!dfb_core_is_master( core_dfb ) &&
+                   (allocation->sw_write_serial.serial || allocation->sw_read_serial.serial)) {
+               /* Operations queued by Genefx can only be waited for by the master. */
+               D_DEBUG_AT( Surface, "    -> software queued!\n" );
+
+               dfb_surface_allocation_unref( allocation );
+
                data->allocations[index] = allocation = NULL;
           }
      }
@@ -615,6 +629,12 @@ IDirectFBSurface_Lock( IDirectFBSurface     *thiz,
 
      data->locked = true;
 
+     if (access & CSAF_WRITE) {
+          DFBRegion region = DFB_REGION_INIT_FROM_RECTANGLE( &data->area.current );
+
+          dfb_surface_damage_add( data->surface, &region );
+     }
+
      *ret_ptr   = data->lock.addr + data->lock.pitch * data->area.current.y +
                   DFB_BYTES_PER_LINE( data->surface->config.format, data->area.current.x );
      *ret_pitch = data->lock.pitch;
@@ -1675,6 +1695,9 @@ IDirectFBSurface_TextureTriangles( IDirectFBSurface     *thiz,
      if (data->locked)
           return DFB_LOCKED;
 
+     if (data->state_client.display_list)
+          return DFB_UNSUPPORTED;
+
      if (!texture || !vertices || num < 3)
           return DFB_INVARG;
 
@@ -2909,6 +2932,9 @@ IDirectFBSurface_BatchBlit2( IDirectFBSurface   *thiz,
      if (data->locked)
           return DFB_LOCKED;
 
+     if (data->state_client.display_list)
+          return DFB_UNSUPPORTED;
+
      if (!source || !source2 || !source_rects || !dest_points || !source2_points || num < 1)
           return DFB_INVARG;
 
@@ -3037,6 +3063,9 @@ IDirectFBSurface_FillTrapezoids( IDirectFBSurface   *thiz,
      if (data->locked)
           return DFB_LOCKED;
 
+     if (data->state_client.display_list)
+          return DFB_UNSUPPORTED;
+
      if (!traps || !num_traps)
           return DFB_INVARG;
 
@@ -3088,6 +3117,9 @@ IDirectFBSurface_FillQuadrangles( IDirectFBSurface *thiz,
      if (data->locked)
           return DFB_LOCKED;
 
+     if (data->state_client.display_list)
+          return DFB_UNSUPPORTED;
+
      if (!points || !num_points)
           return DFB_INVARG;
 
@@ -3157,6 +3189,9 @@ IDirectFBSurface_DrawMonoGlyphs( IDirectFBSurface             *thiz,
      if (data->locked)
           return DFB_LOCKED;
 
+     if (data->state_client.display_list)
+          return DFB_UNSUPPORTED;
+
      if (!glyphs || !attributes || !dest_points || num < 1)
           return DFB_INVARG;
 
@@ -3716,6 +3751,99 @@ IDirectFBSurface_Flush( IDirectFBSurface     *thiz )
      return DFB_OK;
 }
 
+static DFBResult
+IDirectFBSurface_BeginDisplayList( IDirectFBSurface *thiz )
+{
+     DIRECT_INTERFACE_GET_DATA( IDirectFBSurface )
+
+     D_DEBUG_AT( Surface, "%s( %p )\n", __FUNCTION__, thiz );
+
+     if (!data->surface)
+          return DFB_DESTROYED;
+
+     if (data->state_client.display_list)
+          return DFB_BUSY;
+
+     return dfb_display_list_create( data->core, &data->state_client.display_list );
+}
+
+static DFBResult
+IDirectFBSurface_EndDisplayList( IDirectFBSurface      *thiz,
+                                 IDirectFBDisplayList **ret_interface )
+{
+     DFBResult             ret;
+     CoreDisplayList      *list;
+     IDirectFBDisplayList *iface;
+
+     DIRECT_INTERFACE_GET_DATA( IDirectFBSurface )
+
+     D_DEBUG_AT( Surface, "%s( %p )\n", __FUNCTION__, thiz );
+
+     if (!ret_interface)
+          return DFB_INVARG;
+
+     list = data->state_client.display_list;
+     if (!list)
+          return DFB_NOCONTEXT;
+
+     data->state_client.display_list = NULL;
+
+     DIRECT_ALLOCATE_INTERFACE( iface, IDirectFBDisplayList );
+
+     if (iface)
+          ret = IDirectFBDisplayList_Construct( iface, list, data->area.wanted.x, data->area.wanted.y );
+     else
+          ret = DFB_NOSYSTEMMEMORY;
+
+     if (ret) {
+          dfb_display_list_destroy( list );
+          return ret;
+     }
+
+     *ret_interface = iface;
+
+     return DFB_OK;
+}
+
+static DFBResult
+IDirectFBSurface_PlayDisplayList( IDirectFBSurface     *thiz,
+                                  IDirectFBDisplayList *list,
+                                  int                   x,
+                                  int                   y )
+{
+     IDirectFBDisplayList_data *list_data;
+
+     DIRECT_INTERFACE_GET_DATA( IDirectFBSurface )
+
+     D_DEBUG_AT( Surface, "%s( %p, %p, %d,%d )\n", __FUNCTION__, thiz, list, x, y );
+
+     if (!data->surface)
+          return DFB_DESTROYED;
+
+     if (!data->area.current.w || !data->area.current.h)
+          return DFB_INVAREA;
+
+     if (data->locked)
+          return DFB_LOCKED;
+
+     if (data->state_client.display_list)
+          return DFB_UNSUPPORTED;
+
+     if (!list)
+          return DFB_INVARG;
+
+     list_data = list->priv;
+     if (!list_data)
+          return DFB_DEAD;
+
+     /* Keep the order with previous operations recorded for this surface. */
+     CoreGraphicsStateClient_Flush( &data->state_client );
+
+     return dfb_display_list_play( list_data->list, &data->state,
+                                   data->area.wanted.x + x - list_data->origin.x,
+                                   data->area.wanted.y + y - list_data->origin.y );
+}
+
 static ReactionResult
 IDirectFBSurface_React( const void *msg_data,
                         void       *ctx )
@@ -4026,6 +4154,9 @@ IDirectFBSurface_Construct( IDirectFBSurface       *thiz,
      thiz->GetAllocation          = IDirectFBSurface_GetAllocation;
      thiz->GetAllocations         = IDirectFBSurface_GetAllocations;
      thiz->Flush                  = IDirectFBSurface_Flush;
+     thiz->BeginDisplayList       = IDirectFBSurface_BeginDisplayList;
+     thiz->EndDisplayList         = IDirectFBSurface_EndDisplayList;
+     thiz->PlayDisplayList        = IDirectFBSurface_PlayDisplayList;
 
      return DFB_OK;
 }
@@ -18,7 +18,9 @@
 
 #include <config.h>
 #include <direct/memcpy.h>
+#include <direct/thread.h>
 #include <gfx/convert.h>
+#include <misc/conf.h>
 
 D_DEBUG_DOMAIN( GFX_Converter, "GFX/Converter", "DirectFB Graphics Converter" );
 
@@ -61,6 +63,98 @@ static const u8 lookup2to8[] = { 0x00, 0x55, 0xaa, 0xff };
 
 /**********************************************************************************************************************/
 
+/*
+ * Row converters for common format pairs, used instead of the generic code of the functions below if the CPU supports
+ * them. The tables are indexed by the source format.
+ */
+typedef void (*ConvertRowFunc)( const void *src, void *dst, int width );
+
+static ConvertRowFunc to_rgb16_rows[DFB_NUM_PIXELFORMATS];
+static ConvertRowFunc to_rgb32_rows[DFB_NUM_PIXELFORMATS];
+static ConvertRowFunc to_argb_rows[DFB_NUM_PIXELFORMATS];
+static ConvertRowFunc to_rgb24_rows[DFB_NUM_PIXELFORMATS];
+static ConvertRowFunc to_a8_rows[DFB_NUM_PIXELFORMATS];
+
+#ifdef USE_SSE2
+#include "convert_sse2.h"
+
+static void
+convert_rows_init_SSE2( void )
+{
+     to_rgb16_rows[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)]    = argb_to_rgb16_SSE2;
+     to_rgb16_rows[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]     = argb_to_rgb16_SSE2;
+     to_rgb16_rows[DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]     = abgr_to_rgb16_SSE2;
+
+     to_rgb32_rows[DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]     = abgr_to_rgb32_SSE2;
+     to_rgb32_rows[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]    = rgb16_to_argb_SSE2;
+     to_rgb32_rows[DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)] = argb4444_to_rgb32_SSE2;
+
+     to_argb_rows[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)]     = rgb32_to_argb_SSE2;
+     to_argb_rows[DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]      = abgr_to_argb_SSE2;
+     to_argb_rows[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]     = rgb16_to_argb_SSE2;
+     to_argb_rows[DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)]  = argb4444_to_argb_SSE2;
+
+     to_rgb24_rows[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)]    = argb_to_rgb24_SSE2;
+     to_rgb24_rows[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]     = argb_to_rgb24_SSE2;
+     to_rgb24_rows[DFB_PIXELFORMAT_INDEX(DSPF_AiRGB)]    = argb_to_rgb24_SSE2;
+     to_rgb24_rows[DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]     = abgr_to_rgb24_SSE2;
+
+     to_a8_rows[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]        = argb_to_a8_SSE2;
+     to_a8_rows[DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]        = argb_to_a8_SSE2;
+     to_a8_rows[DFB_PIXELFORMAT_INDEX(DSPF_AYUV)]        = argb_to_a8_SSE2;
+     to_a8_rows[DFB_PIXELFORMAT_INDEX(DSPF_AVYU)]        = argb_to_a8_SSE2;
+     to_a8_rows[DFB_PIXELFORMAT_INDEX(DSPF_AiRGB)]       = airgb_to_a8_SSE2;
+}
+#endif
+
+static void
+convert_rows_init( void )
+{
+     static bool initialized = false;
+
+     if (initialized)
+          return;
+
+#ifdef USE_SSE2
+     __builtin_cpu_init();
+
+     if ((!dfb_config || dfb_config->sse2) && __builtin_cpu_supports( "sse2" ))
+          convert_rows_init_SSE2();
+#endif
+
+     initialized = true;
+}
+
+static bool
+convert_rows( ConvertRowFunc        *funcs,
+              DFBSurfacePixelFormat  format,
+              const void            *src,
+              int                    spitch,
+              void                  *dst,
+              int                    dpitch,
+              int                    width,
+              int                    height )
+{
+     ConvertRowFunc func;
+
+     convert_rows_init();
+
+     func = funcs[DFB_PIXELFORMAT_INDEX(format)];
+     if (!func)
+          return false;
+
+     while (height--) {
+          func( src, dst, width );
+
+          src += spitch;
+          dst += dpitch;
+     }
+
+     return true;
+}
+
+/**********************************************************************************************************************/
+
 void
 dfb_pixel_to_color( DFBSurfacePixelFormat  format,
                     DFBSurfaceColorSpace   colorspace,
@@ -524,6 +618,9 @@ dfb_convert_to_rgb16( DFBSurfacePixelFormat  format,
           return;
      }
 
+     if (convert_rows( to_rgb16_rows, format, src, spitch, dst, dpitch, width, height ))
+          return;
+
      switch (format) {
           case DSPF_RGB16:
                while (height--) {
@@ -1364,6 +1461,9 @@ dfb_convert_to_rgb32( DFBSurfacePixelFormat  format,
           return;
      }
 
+     if (convert_rows( to_rgb32_rows, format, src, spitch, dst, dpitch, width, height ))
+          return;
+
      switch (format) {
           case DSPF_RGB32:
           case DSPF_ARGB:
@@ -1803,6 +1903,9 @@ dfb_convert_to_argb( DFBSurfacePixelFormat  format,
           return;
      }
 
+     if (convert_rows( to_argb_rows, format, src, spitch, dst, dpitch, width, height ))
+          return;
+
      switch (format) {
           case DSPF_ARGB:
                while (height--) {
@@ -2288,6 +2391,9 @@ dfb_convert_to_rgb24( DFBSurfacePixelFormat  format,
           return;
      }
 
+     if (convert_rows( to_rgb24_rows, format, src, spitch, dst, dpitch, width, height ))
+          return;
+
      switch (format) {
           case DSPF_A8:
                while (height--) {
@@ -2866,6 +2972,9 @@ dfb_convert_to_a8( DFBSurfacePixelFormat  format,
 
      D_DEBUG_AT( GFX_Converter, "%s()\n", __FUNCTION__ );
 
+     if (convert_rows( to_a8_rows, format, src, spitch, dst, dpitch, width, height ))
+          return;
+
      switch (format) {
           case DSPF_A8:
                while (height--) {
@@ -3149,3 +3258,179 @@ dfb_convert_to_a4( DFBSurfacePixelFormat  format,
                     D_ONCE( "unsupported format" );
      }
 }
+
+/**********************************************************************************************************************/
+
+#define CONVERT_MAX_THREADS 16
+#define CONVERT_MIN_LINES   16
+
+typedef struct {
+     DFBSurfacePixelFormat  format;
+     DFBSurfaceColorSpace   colorspace;
+     const void            *src;
+     int                    spitch;
+     const void            *src_cb;
+     int                    scbpitch;
+     const void            *src_cr;
+     int                    scrpitch;
+     int                    surface_height;
+     DFBSurfacePixelFormat  dst_format;
+     void                  *dst;
+     int                    dpitch;
+     int                    width;
+     int                    height;
+
+     DirectThread          *thread;
+     bool                   done;
+} ConvertJob;
+
+static void
+convert_job( const ConvertJob *job )
+{
+     switch (job->dst_format) {
+          case DSPF_RGB16:
+               dfb_convert_to_rgb16( job->format, job->colorspace, job->src, job->spitch, job->src_cb, job->scbpitch,
+                                     job->src_cr, job->scrpitch, job->surface_height, job->dst, job->dpitch,
+                                     job->width, job->height );
+               break;
+
+          case DSPF_RGB555:
+               dfb_convert_to_rgb555( job->format, job->colorspace, job->src, job->spitch, job->src_cb, job->scbpitch,
+                                      job->src_cr, job->scrpitch, job->surface_height, job->dst, job->dpitch,
+                                      job->width, job->height );
+               break;
+
+          case DSPF_RGB32:
+               dfb_convert_to_rgb32( job->format, job->colorspace, job->src, job->spitch, job->src_cb, job->scbpitch,
+                                     job->src_cr, job->scrpitch, job->surface_height, job->dst, job->dpitch,
+                                     job->width, job->height );
+               break;
+
+          case DSPF_ARGB:
+               dfb_convert_to_argb( job->format, job->colorspace, job->src, job->spitch, job->src_cb, job->scbpitch,
+                                    job->src_cr, job->scrpitch, job->surface_height, job->dst, job->dpitch,
+                                    job->width, job->height );
+               break;
+
+          case DSPF_RGB24:
+               dfb_convert_to_rgb24( job->format, job->colorspace, job->src, job->spitch, job->src_cb, job->scbpitch,
+                                     job->src_cr, job->scrpitch, job->surface_height, job->dst, job->dpitch,
+                                     job->width, job->height );
+               break;
+
+          case DSPF_A8:
+               dfb_convert_to_a8( job->format, job->src, job->spitch, job->surface_height, job->dst, job->dpitch,
+                                  job->width, job->height );
+               break;
+
+          case DSPF_A4:
+               dfb_convert_to_a4( job->format, job->src, job->spitch, job->surface_height, job->dst, job->dpitch,
+                                  job->width, job->height );
+               break;
+
+          default:
+               D_BUG( "unexpected format" );
+     }
+}
+
+static void *
+convert_thread_main( DirectThread *thread,
+                     void         *arg )
+{
+     ConvertJob *job = arg;
+
+     convert_job( job );
+
+     job->done = true;
+
+     return NULL;
+}
+
+DFBResult
+dfb_convert_buffer( DFBSurfacePixelFormat  format,
+                    DFBSurfaceColorSpace   colorspace,
+                    const void            *src,
+                    int                    spitch,
+                    const void            *src_cb,
+                    int                    scbpitch,
+                    const void            *src_cr,
+                    int                    scrpitch,
+                    int                    surface_height,
+                    DFBSurfacePixelFormat  dst_format,
+                    void                  *dst,
+                    int                    dpitch,
+                    int                    width,
+                    int                    height )
+{
+     ConvertJob jobs[CONVERT_MAX_THREADS];
+     int        num = 1;
+     int        i, y;
+
+     D_DEBUG_AT( GFX_Converter, "%s( %s -> %s, %dx%d )\n", __FUNCTION__,
+                 dfb_pixelformat_name( format ), dfb_pixelformat_name( dst_format ), width, height );
+
+     switch (dst_format) {
+          case DSPF_RGB16:
+          case DSPF_RGB555:
+          case DSPF_RGB32:
+          case DSPF_ARGB:
+          case DSPF_RGB24:
+          case DSPF_A8:
+          case DSPF_A4:
+               break;
+
+          default:
+               return DFB_UNSUPPORTED;
+     }
+
+     /* Lines of formats with vertically subsampled chroma depend on their neighbours, these are done in one piece. */
+     if (dfb_config && dfb_config->software_threads > 1 && width * height >= dfb_config->software_threads_min &&
+         format != DSPF_I420 && format != DSPF_YV12 && format != DSPF_NV12 && format != DSPF_NV21) {
+          num = MIN( dfb_config->software_threads, CONVERT_MAX_THREADS );
+          num = MAX( MIN( num, height / CONVERT_MIN_LINES ), 1 );
+     }
+
+     for (i = 0, y = 0; i < num; i++) {
+          int h = (height - y) / (num - i);
+
+          jobs[i].format         = format;
+          jobs[i].colorspace     = colorspace;
+          jobs[i].src            = src + y * spitch;
+          jobs[i].spitch         = spitch;
+          jobs[i].src_cb         = src_cb ? src_cb + y * scbpitch : NULL;
+          jobs[i].scbpitch       = scbpitch;
+          jobs[i].src_cr         = src_cr ? src_cr + y * scrpitch : NULL;
+          jobs[i].scrpitch       = scrpitch;
+          jobs[i].surface_height = surface_height;
+          jobs[i].dst_format     = dst_format;
+          jobs[i].dst            = dst + y * dpitch;
+          jobs[i].dpitch         = dpitch;
+          jobs[i].width          = width;
+          jobs[i].height         = h;
+          jobs[i].thread         = NULL;
+          jobs[i].done           = false;
+
+          y += h;
+     }
+
+     /* Pick the row converters before any thread uses them. */
+     convert_rows_init();
+
+     for (i = 1; i < num; i++)
+          jobs[i].thread = direct_thread_create( DTT_DEFAULT, convert_thread_main, &jobs[i], "Convert" );
+
+     convert_job( &jobs[0] );
+
+     /* A thread joined before entering its main routine returns without running it. */
+     for (i = 1; i < num; i++) {
+          if (jobs[i].thread) {
+               direct_thread_join( jobs[i].thread );
+               direct_thread_destroy( jobs[i].thread );
+          }
+
+          if (!jobs[i].done)
+               convert_job( &jobs[i] );
+     }
+
+     return DFB_OK;
+}
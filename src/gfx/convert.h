@@ -579,6 +579,25 @@ void          dfb_convert_to_a4      ( DFBSurfacePixelFormat  format,
                                        int                    width,
                                        int                    height );
 
+/*
+ * Convert a whole buffer to RGB16, RGB555, RGB32, ARGB, RGB24, A8 or A4 like the functions above. Buffers of at least
+ * 'software-threads-min' pixels are split into groups of lines converted by up to 'software-threads' threads.
+ */
+DFBResult     dfb_convert_buffer     ( DFBSurfacePixelFormat  format,
+                                       DFBSurfaceColorSpace   colorspace,
+                                       const void            *src,
+                                       int                    spitch,
+                                       const void            *src_cb,
+                                       int                    scbpitch,
+                                       const void            *src_cr,
+                                       int                    scrpitch,
+                                       int                    surface_height,
+                                       DFBSurfacePixelFormat  dst_format,
+                                       void                  *dst,
+                                       int                    dpitch,
+                                       int                    width,
+                                       int                    height );
+
 /**********************************************************************************************************************/
 
 static __inline__ u32
@@ -0,0 +1,363 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#include <emmintrin.h>
+
+/*
+ * The functions below are only called after a runtime check of the CPU features, the target attribute allows them to
+ * be built without enabling SSE2 for the whole library (e.g. on 32 bit x86).
+ */
+#define SSE2_FUNC __attribute__((target("sse2")))
+
+/*
+ * Row converters, the results are the same as those of the scalar code in convert.c, which also handles the pixels
+ * left over at the end of a row.
+ */
+
+/**********************************************************************************************************************/
+
+/* Swap the bytes 0 and 2 of each pixel, ABGR <-> ARGB. */
+static inline __m128i SSE2_FUNC
+swap_rb_SSE2( __m128i v )
+{
+     const __m128i ag = _mm_set1_epi32( 0xff00ff00 );
+     const __m128i lo = _mm_set1_epi32( 0x000000ff );
+
+     return _mm_or_si128( _mm_and_si128( v, ag ),
+                          _mm_or_si128( _mm_and_si128( _mm_srli_epi32( v, 16 ), lo ),
+                                        _mm_slli_epi32( _mm_and_si128( v, lo ), 16 ) ) );
+}
+
+static inline u32
+swap_rb( u32 v )
+{
+     return (v & 0xff00ff00) | ((v >> 16) & 0xff) | ((v & 0xff) << 16);
+}
+
+/* Expand eight RGB16 pixels to ARGB with the given alpha. */
+static inline void SSE2_FUNC
+expand_rgb16_SSE2( __m128i  s,
+                   __m128i  alpha,
+                   __m128i *lo,
+                   __m128i *hi )
+{
+     __m128i r = _mm_srli_epi16( s, 11 );
+     __m128i g = _mm_and_si128( _mm_srli_epi16( s, 5 ), _mm_set1_epi16( 0x3f ) );
+     __m128i b = _mm_and_si128( s, _mm_set1_epi16( 0x1f ) );
+
+     r = _mm_or_si128( _mm_slli_epi16( r, 3 ), _mm_srli_epi16( r, 2 ) );
+     g = _mm_or_si128( _mm_slli_epi16( g, 2 ), _mm_srli_epi16( g, 4 ) );
+     b = _mm_or_si128( _mm_slli_epi16( b, 3 ), _mm_srli_epi16( b, 2 ) );
+
+     g = _mm_or_si128( _mm_slli_epi16( g, 8 ), b );
+     r = _mm_or_si128( alpha, r );
+
+     *lo = _mm_unpacklo_epi16( g, r );
+     *hi = _mm_unpackhi_epi16( g, r );
+}
+
+/* Expand eight ARGB4444 pixels to ARGB, the alpha is only kept where set in 'amask'. */
+static inline void SSE2_FUNC
+expand_argb4444_SSE2( __m128i  s,
+                      __m128i  amask,
+                      __m128i *lo,
+                      __m128i *hi )
+{
+     const __m128i n = _mm_set1_epi16( 0x0f0f );
+
+     /* The bytes 0xGB and 0xAR are split into their nibbles, interleaving them gives 0x0B 0x0G 0x0R 0x0A. */
+     __m128i l = _mm_and_si128( s, n );
+     __m128i h = _mm_and_si128( _mm_srli_epi16( s, 4 ), n );
+     __m128i a = _mm_unpacklo_epi8( l, h );
+     __m128i b = _mm_unpackhi_epi8( l, h );
+
+     *lo = _mm_and_si128( _mm_or_si128( _mm_slli_epi16( a, 4 ), a ), amask );
+     *hi = _mm_and_si128( _mm_or_si128( _mm_slli_epi16( b, 4 ), b ), amask );
+}
+
+/* Convert four ARGB pixels to RGB16, in the lower half of each 32 bit lane. */
+static inline __m128i SSE2_FUNC
+pack_rgb16_SSE2( __m128i v )
+{
+     __m128i r = _mm_and_si128( _mm_srli_epi32( v, 8 ), _mm_set1_epi32( 0xf800 ) );
+     __m128i g = _mm_and_si128( _mm_srli_epi32( v, 5 ), _mm_set1_epi32( 0x07e0 ) );
+     __m128i b = _mm_and_si128( _mm_srli_epi32( v, 3 ), _mm_set1_epi32( 0x001f ) );
+
+     /* Sign extended for the saturating pack. */
+     return _mm_srai_epi32( _mm_slli_epi32( _mm_or_si128( _mm_or_si128( r, g ), b ), 16 ), 16 );
+}
+
+/* Store the lower three bytes of four pixels. */
+static inline void SSE2_FUNC
+store_24_SSE2( u8      *D,
+               __m128i  v )
+{
+     const __m128i lo = _mm_set_epi32( 0, 0x00ffffff, 0, 0x00ffffff );
+     const __m128i hi = _mm_set_epi32( 0x00ffffff, 0, 0x00ffffff, 0 );
+     u32           last;
+
+     /* Two pixels in each 64 bit lane first, then the upper six bytes are moved next to the lower ones. */
+     v = _mm_or_si128( _mm_and_si128( v, lo ), _mm_srli_epi64( _mm_and_si128( v, hi ), 8 ) );
+     v = _mm_or_si128( _mm_and_si128( v, _mm_set_epi32( 0, 0, 0x0000ffff, 0xffffffff ) ),
+                       _mm_and_si128( _mm_srli_si128( v, 2 ), _mm_set_epi32( 0, 0xffffffff, 0xffff0000, 0 ) ) );
+
+     _mm_storel_epi64( (__m128i*) D, v );
+
+     last = _mm_cvtsi128_si32( _mm_srli_si128( v, 8 ) );
+
+     direct_memcpy( D + 8, &last, 4 );
+}
+
+/**********************************************************************************************************************/
+
+static void SSE2_FUNC
+rgb32_to_argb_SSE2( const void *src,
+                    void       *dst,
+                    int         width )
+{
+     const u32 *S = src;
+     u32       *D = dst;
+     int        i = 0;
+
+     for (; i + 4 <= width; i += 4)
+          _mm_storeu_si128( (__m128i*) (D + i), _mm_or_si128( _mm_loadu_si128( (const __m128i*) (S + i) ),
+                                                              _mm_set1_epi32( 0xff000000 ) ) );
+
+     for (; i < width; i++)
+          D[i] = S[i] | 0xff000000;
+}
+
+static void SSE2_FUNC
+abgr_to_argb_SSE2( const void *src,
+                   void       *dst,
+                   int         width )
+{
+     const u32 *S = src;
+     u32       *D = dst;
+     int        i = 0;
+
+     for (; i + 4 <= width; i += 4)
+          _mm_storeu_si128( (__m128i*) (D + i), swap_rb_SSE2( _mm_loadu_si128( (const __m128i*) (S + i) ) ) );
+
+     for (; i < width; i++)
+          D[i] = swap_rb( S[i] );
+}
+
+static void SSE2_FUNC
+abgr_to_rgb32_SSE2( const void *src,
+                    void       *dst,
+                    int         width )
+{
+     const u32 *S = src;
+     u32       *D = dst;
+     int        i = 0;
+
+     for (; i + 4 <= width; i += 4) {
+          __m128i v = swap_rb_SSE2( _mm_loadu_si128( (const __m128i*) (S + i) ) );
+
+          _mm_storeu_si128( (__m128i*) (D + i), _mm_or_si128( v, _mm_set1_epi32( 0xff000000 ) ) );
+     }
+
+     for (; i < width; i++)
+          D[i] = swap_rb( S[i] ) | 0xff000000;
+}
+
+static void SSE2_FUNC
+rgb16_to_argb_SSE2( const void *src,
+                    void       *dst,
+                    int         width )
+{
+     const u16 *S = src;
+     u32       *D = dst;
+     int        i = 0;
+
+     for (; i + 8 <= width; i += 8) {
+          __m128i lo, hi;
+
+          expand_rgb16_SSE2( _mm_loadu_si128( (const __m128i*) (S + i) ), _mm_set1_epi16( 0xff00 ), &lo, &hi );
+
+          _mm_storeu_si128( (__m128i*) (D + i),     lo );
+          _mm_storeu_si128( (__m128i*) (D + i + 4), hi );
+     }
+
+     for (; i < width; i++)
+          D[i] = PIXEL_ARGB( 0xff,
+                             ((S[i] & 0xf800) >> 8) | ((S[i] & 0xe000) >> 13),
+                             ((S[i] & 0x07e0) >> 3) | ((S[i] & 0x0600) >>  9),
+                             ((S[i] & 0x001f) << 3) | ((S[i] & 0x001c) >>  2) );
+}
+
+static void SSE2_FUNC
+argb4444_to_argb_SSE2( const void *src,
+                       void       *dst,
+                       int         width )
+{
+     const u16 *S = src;
+     u32       *D = dst;
+     int        i = 0;
+
+     for (; i + 8 <= width; i += 8) {
+          __m128i lo, hi;
+
+          expand_argb4444_SSE2( _mm_loadu_si128( (const __m128i*) (S + i) ), _mm_set1_epi32( 0xffffffff ), &lo, &hi );
+
+          _mm_storeu_si128( (__m128i*) (D + i),     lo );
+          _mm_storeu_si128( (__m128i*) (D + i + 4), hi );
+     }
+
+     for (; i < width; i++)
+          D[i] = ARGB4444_TO_ARGB( S[i] );
+}
+
+static void SSE2_FUNC
+argb4444_to_rgb32_SSE2( const void *src,
+                        void       *dst,
+                        int         width )
+{
+     const u16 *S = src;
+     u32       *D = dst;
+     int        i = 0;
+
+     for (; i + 8 <= width; i += 8) {
+          __m128i lo, hi;
+
+          expand_argb4444_SSE2( _mm_loadu_si128( (const __m128i*) (S + i) ), _mm_set1_epi32( 0x00ffffff ), &lo, &hi );
+
+          _mm_storeu_si128( (__m128i*) (D + i),     lo );
+          _mm_storeu_si128( (__m128i*) (D + i + 4), hi );
+     }
+
+     for (; i < width; i++)
+          D[i] = ARGB4444_TO_RGB32( S[i] );
+}
+
+static void SSE2_FUNC
+argb_to_rgb16_SSE2( const void *src,
+                    void       *dst,
+                    int         width )
+{
+     const u32 *S = src;
+     u16       *D = dst;
+     int        i = 0;
+
+     for (; i + 8 <= width; i += 8) {
+          __m128i lo = pack_rgb16_SSE2( _mm_loadu_si128( (const __m128i*) (S + i) ) );
+          __m128i hi = pack_rgb16_SSE2( _mm_loadu_si128( (const __m128i*) (S + i + 4) ) );
+
+          _mm_storeu_si128( (__m128i*) (D + i), _mm_packs_epi32( lo, hi ) );
+     }
+
+     for (; i < width; i++)
+          D[i] = PIXEL_RGB16( (S[i] & 0xff0000) >> 16, (S[i] & 0x00ff00) >> 8, S[i] & 0x0000ff );
+}
+
+static void SSE2_FUNC
+abgr_to_rgb16_SSE2( const void *src,
+                    void       *dst,
+                    int         width )
+{
+     const u32 *S = src;
+     u16       *D = dst;
+     int        i = 0;
+
+     for (; i + 8 <= width; i += 8) {
+          __m128i lo = pack_rgb16_SSE2( swap_rb_SSE2( _mm_loadu_si128( (const __m128i*) (S + i) ) ) );
+          __m128i hi = pack_rgb16_SSE2( swap_rb_SSE2( _mm_loadu_si128( (const __m128i*) (S + i + 4) ) ) );
+
+          _mm_storeu_si128( (__m128i*) (D + i), _mm_packs_epi32( lo, hi ) );
+     }
+
+     for (; i < width; i++)
+          D[i] = PIXEL_RGB16( S[i] & 0x0000ff, (S[i] & 0x00ff00) >> 8, (S[i] & 0xff0000) >> 16 );
+}
+
+/* The 24 bit output of dfb_convert_to_rgb24() is in R, G, B byte order. */
+static void SSE2_FUNC
+argb_to_rgb24_SSE2( const void *src,
+                    void       *dst,
+                    int         width )
+{
+     const u32 *S = src;
+     u8        *D = dst;
+     int        i = 0;
+
+     for (; i + 4 <= width; i += 4, D += 12)
+          store_24_SSE2( D, swap_rb_SSE2( _mm_loadu_si128( (const __m128i*) (S + i) ) ) );
+
+     for (; i < width; i++, D += 3) {
+          D[0] = (S[i] & 0xff0000) >> 16;
+          D[1] = (S[i] & 0x00ff00) >>  8;
+          D[2] =  S[i] & 0x0000ff;
+     }
+}
+
+static void SSE2_FUNC
+abgr_to_rgb24_SSE2( const void *src,
+                    void       *dst,
+                    int         width )
+{
+     const u32 *S = src;
+     u8        *D = dst;
+     int        i = 0;
+
+     for (; i + 4 <= width; i += 4, D += 12)
+          store_24_SSE2( D, _mm_loadu_si128( (const __m128i*) (S + i) ) );
+
+     for (; i < width; i++, D += 3) {
+          D[0] =  S[i] & 0x0000ff;
+          D[1] = (S[i] & 0x00ff00) >>  8;
+          D[2] = (S[i] & 0xff0000) >> 16;
+     }
+}
+
+static void SSE2_FUNC
+argb_to_a8_SSE2( const void *src,
+                 void       *dst,
+                 int         width )
+{
+     const u32 *S = src;
+     u8        *D = dst;
+     int        i = 0;
+
+     for (; i + 16 <= width; i += 16) {
+          __m128i a0 = _mm_srli_epi32( _mm_loadu_si128( (const __m128i*) (S + i) ),      24 );
+          __m128i a1 = _mm_srli_epi32( _mm_loadu_si128( (const __m128i*) (S + i + 4) ),  24 );
+          __m128i a2 = _mm_srli_epi32( _mm_loadu_si128( (const __m128i*) (S + i + 8) ),  24 );
+          __m128i a3 = _mm_srli_epi32( _mm_loadu_si128( (const __m128i*) (S + i + 12) ), 24 );
+
+          _mm_storeu_si128( (__m128i*) (D + i), _mm_packus_epi16( _mm_packs_epi32( a0, a1 ),
+                                                                  _mm_packs_epi32( a2, a3 ) ) );
+     }
+
+     for (; i < width; i++)
+          D[i] = S[i] >> 24;
+}
+
+static void SSE2_FUNC
+airgb_to_a8_SSE2( const void *src,
+                  void       *dst,
+                  int         width )
+{
+     u8  *D = dst;
+     int  i;
+
+     argb_to_a8_SSE2( src, dst, width );
+
+     for (i = 0; i < width; i++)
+          D[i] = ~D[i];
+}
@@ -0,0 +1,152 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#include <emmintrin.h>
+
+/*
+ * The functions below are only called after a runtime check of the CPU features, the target attribute allows them to
+ * be built without enabling SSE2 for the whole library (e.g. on 32 bit x86).
+ */
+#define SSE2_FUNC __attribute__((target("sse2")))
+
+/**********************************************************************************************************************/
+/* Rotating copies
+ *
+ * Blocks of 4x4 (32 bit) or 8x8 (16 bit) pixels are transposed in registers, the source lines of a block end up as the
+ * columns of the destination block. When the destination pixels of a source column are stored from right to left, the
+ * transposed lines are reversed before being stored.
+ */
+
+static inline __m128i SSE2_FUNC
+rotate_reverse_32_SSE2( __m128i v )
+{
+     return _mm_shuffle_epi32( v, 0x1b );
+}
+
+static inline __m128i SSE2_FUNC
+rotate_reverse_16_SSE2( __m128i v )
+{
+     return _mm_shuffle_epi32( _mm_shufflehi_epi16( _mm_shufflelo_epi16( v, 0x1b ), 0x1b ), 0x4e );
+}
+
+static void SSE2_FUNC
+rotate_tile_32_SSE2( const u8 *S,
+                     int       sadv,
+                     u8       *D,
+                     int       dadv,
+                     int       dstep,
+                     int       w,
+                     int       h )
+{
+     int i, j;
+
+     for (j = 0; j + 4 <= h; j += 4) {
+          const u8 *s = S + j * sadv;
+          u8       *d = D + (dadv > 0 ? j : j + 3) * dadv;
+
+          for (i = 0; i + 4 <= w; i += 4) {
+               __m128i r0 = _mm_loadu_si128( (const __m128i*) (s + i * 4) );
+               __m128i r1 = _mm_loadu_si128( (const __m128i*) (s + i * 4 + sadv) );
+               __m128i r2 = _mm_loadu_si128( (const __m128i*) (s + i * 4 + sadv * 2) );
+               __m128i r3 = _mm_loadu_si128( (const __m128i*) (s + i * 4 + sadv * 3) );
+               __m128i t0 = _mm_unpacklo_epi32( r0, r1 );
+               __m128i t1 = _mm_unpacklo_epi32( r2, r3 );
+               __m128i t2 = _mm_unpackhi_epi32( r0, r1 );
+               __m128i t3 = _mm_unpackhi_epi32( r2, r3 );
+               __m128i c0 = _mm_unpacklo_epi64( t0, t1 );
+               __m128i c1 = _mm_unpackhi_epi64( t0, t1 );
+               __m128i c2 = _mm_unpacklo_epi64( t2, t3 );
+               __m128i c3 = _mm_unpackhi_epi64( t2, t3 );
+               u8     *p  = d + i * dstep;
+
+               if (dadv < 0) {
+                    c0 = rotate_reverse_32_SSE2( c0 );
+                    c1 = rotate_reverse_32_SSE2( c1 );
+                    c2 = rotate_reverse_32_SSE2( c2 );
+                    c3 = rotate_reverse_32_SSE2( c3 );
+               }
+
+               _mm_storeu_si128( (__m128i*) p,               c0 );
+               _mm_storeu_si128( (__m128i*) (p + dstep),     c1 );
+               _mm_storeu_si128( (__m128i*) (p + dstep * 2), c2 );
+               _mm_storeu_si128( (__m128i*) (p + dstep * 3), c3 );
+          }
+
+          if (i < w)
+               rotate_tile_32( s + i * 4, sadv, D + j * dadv + i * dstep, dadv, dstep, w - i, 4 );
+     }
+
+     if (j < h)
+          rotate_tile_32( S + j * sadv, sadv, D + j * dadv, dadv, dstep, w, h - j );
+}
+
+static void SSE2_FUNC
+rotate_tile_16_SSE2( const u8 *S,
+                     int       sadv,
+                     u8       *D,
+                     int       dadv,
+                     int       dstep,
+                     int       w,
+                     int       h )
+{
+     int i, j, k;
+
+     for (j = 0; j + 8 <= h; j += 8) {
+          const u8 *s = S + j * sadv;
+          u8       *d = D + (dadv > 0 ? j : j + 7) * dadv;
+
+          for (i = 0; i + 8 <= w; i += 8) {
+               __m128i r[8], t[8], c[8];
+               u8     *p = d + i * dstep;
+
+               for (k = 0; k < 8; k++)
+                    r[k] = _mm_loadu_si128( (const __m128i*) (s + i * 2 + sadv * k) );
+
+               for (k = 0; k < 4; k++) {
+                    t[k]     = _mm_unpacklo_epi16( r[2*k], r[2*k+1] );
+                    t[k + 4] = _mm_unpackhi_epi16( r[2*k], r[2*k+1] );
+               }
+
+               for (k = 0; k < 2; k++) {
+                    r[4*k]     = _mm_unpacklo_epi32( t[4*k],     t[4*k + 1] );
+                    r[4*k + 1] = _mm_unpackhi_epi32( t[4*k],     t[4*k + 1] );
+                    r[4*k + 2] = _mm_unpacklo_epi32( t[4*k + 2], t[4*k + 3] );
+                    r[4*k + 3] = _mm_unpackhi_epi32( t[4*k + 2], t[4*k + 3] );
+               }
+
+               for (k = 0; k < 2; k++) {
+                    c[2*k]     = _mm_unpacklo_epi64( r[k],     r[k + 2] );
+                    c[2*k + 1] = _mm_unpackhi_epi64( r[k],     r[k + 2] );
+                    c[2*k + 4] = _mm_unpacklo_epi64( r[k + 4], r[k + 6] );
+                    c[2*k + 5] = _mm_unpackhi_epi64( r[k + 4], r[k + 6] );
+               }
+
+               for (k = 0; k < 8; k++) {
+                    _mm_storeu_si128( (__m128i*) p, dadv < 0 ? rotate_reverse_16_SSE2( c[k] ) : c[k] );
+
+                    p += dstep;
+               }
+          }
+
+          if (i < w)
+               rotate_tile_16( s + i * 2, sadv, D + j * dadv + i * dstep, dadv, dstep, w - i, 8 );
+     }
+
+     if (j < h)
+          rotate_tile_16( S + j * sadv, sadv, D + j * dadv, dadv, dstep, w, h - j );
+}
@@ -0,0 +1,84 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#include <emmintrin.h>
+#include <unistd.h>
+
+/*
+ * The functions below are only called after a runtime check of the CPU features, the target attribute allows them to
+ * be built without enabling SSE2 for the whole library (e.g. on 32 bit x86).
+ */
+#define SSE2_FUNC __attribute__((target("sse2")))
+
+/**********************************************************************************************************************/
+/* Streaming copies
+ *
+ * The source is a line or block of the fill that has just been written and is still cached, the destination is written
+ * with non-temporal stores from the first 16 byte boundary on.
+ */
+
+static void SSE2_FUNC
+fill_copy_stream_SSE2( u8       *D,
+                       const u8 *S,
+                       int       bytes )
+{
+     int head = (16 - ((unsigned long) D & 15)) & 15;
+
+     if (bytes < head + 64) {
+          direct_memcpy( D, S, bytes );
+          return;
+     }
+
+     if (head) {
+          direct_memcpy( D, S, head );
+
+          D     += head;
+          S     += head;
+          bytes -= head;
+     }
+
+     while (bytes >= 64) {
+          __m128i s0 = _mm_loadu_si128( (const __m128i*) S );
+          __m128i s1 = _mm_loadu_si128( (const __m128i*) (S + 16) );
+          __m128i s2 = _mm_loadu_si128( (const __m128i*) (S + 32) );
+          __m128i s3 = _mm_loadu_si128( (const __m128i*) (S + 48) );
+
+          _mm_stream_si128( (__m128i*) D,        s0 );
+          _mm_stream_si128( (__m128i*) (D + 16), s1 );
+          _mm_stream_si128( (__m128i*) (D + 32), s2 );
+          _mm_stream_si128( (__m128i*) (D + 48), s3 );
+
+          D     += 64;
+          S     += 64;
+          bytes -= 64;
+     }
+
+     while (bytes >= 16) {
+          _mm_stream_si128( (__m128i*) D, _mm_loadu_si128( (const __m128i*) S ) );
+
+          D     += 16;
+          S     += 16;
+          bytes -= 16;
+     }
+
+     if (bytes)
+          direct_memcpy( D, S, bytes );
+
+     /* Make the stores visible before the fill returns. */
+     _mm_sfence();
+}
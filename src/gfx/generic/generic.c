@@ -19,11 +19,18 @@
 #include <config.h>
 #include <core/core.h>
 #include <core/state.h>
+#include <core/surface_allocation.h>
 #include <core/palette.h>
+#include <direct/atomic.h>
 #include <direct/memcpy.h>
 #include <gfx/convert.h>
 #include <gfx/generic/duffs_device.h>
 #include <gfx/generic/generic.h>
+#include <gfx/generic/generic_blit.h>
+#include <gfx/generic/generic_fill_rectangle.h>
+#include <gfx/generic/generic_queue.h>
+#include <gfx/generic/generic_stats.h>
+#include <gfx/generic/generic_stretch_blit.h>
 #include <gfx/util.h>
 
 /**********************************************************************************************************************/
@@ -1144,7 +1151,7 @@ Sop_uyvy_to_Dacc( GenefxState *gfxs )
 static void
 Sop_i420_to_Dacc( GenefxState *gfxs )
 {
-    int                 w  = (gfxs->length >> 1) + 1;
+     int                w  = (gfxs->length >> 1) + 1;
      u8                *Sy =  gfxs->Sop[0];
      u8                *Su =  gfxs->Sop[1];
      u8                *Sv =  gfxs->Sop[2];
@@ -1160,6 +1167,13 @@ Sop_i420_to_Dacc( GenefxState *gfxs )
           Sy += 2; ++Su; ++Sv;
           D  += 2;
      }
+
+     if (gfxs->length & 1) {
+          D->YUV.a = 0xff;
+          D->YUV.y = *Sy;
+          D->YUV.u = *Su;
+          D->YUV.v = *Sv;
+     }
 }
 
 static void
@@ -1221,6 +1235,13 @@ Sop_nv12_to_Dacc( GenefxState *gfxs )
           Sy += 2; ++Suv;
           D  += 2;
      }
+
+     if (gfxs->length & 1) {
+          D->YUV.a = 0xff;
+          D->YUV.y = *Sy;
+          D->YUV.u = Suv[0] & 0xff;
+          D->YUV.v = Suv[0] >> 8;
+     }
 }
 
 static void
@@ -1241,6 +1262,13 @@ Sop_nv21_to_Dacc( GenefxState *gfxs )
           Sy += 2; ++Svu;
           D  += 2;
      }
+
+     if (gfxs->length & 1) {
+          D->YUV.a = 0xff;
+          D->YUV.y = *Sy;
+          D->YUV.u = Svu[0] >> 8;
+          D->YUV.v = Svu[0] & 0xff;
+     }
 }
 
 static void
@@ -2794,6 +2822,105 @@ static GenefxFunc Sop_PFI_TEX_Kto_Dacc[DFB_NUM_PIXELFORMATS] = {
      [DFB_PIXELFORMAT_INDEX(DSPF_BGR24)]      = Sop_bgr24_TEX_Kto_Dacc,
 };
 
+/**********************************************************************************************************************
+ ********************************* Sop_PFI_TEX_smooth_to_Dacc *********************************************************
+ **********************************************************************************************************************/
+
+/*
+ * Bilinear lookups sample around texel centers, the neighbours are clamped to the edges of the texture. Lines are
+ * interpolated first, the same way as in the SIMD versions.
+ */
+static inline void
+tex_smooth_coords( const GenefxState *gfxs,
+                   int                s,
+                   int                t,
+                   int               *ret_x,
+                   int               *ret_y,
+                   int               *ret_dx,
+                   int               *ret_dy,
+                   int               *ret_fx,
+                   int               *ret_fy )
+{
+     s = MAX( s - 0x8000, 0 );
+     t = MAX( t - 0x8000, 0 );
+
+     *ret_x  = s >> 16;
+     *ret_y  = t >> 16;
+     *ret_dx = (*ret_x < gfxs->src_width  - 1) ? 1 : 0;
+     *ret_dy = (*ret_y < gfxs->src_height - 1) ? 1 : 0;
+     *ret_fx = (s >> 8) & 0xff;
+     *ret_fy = (t >> 8) & 0xff;
+}
+
+/* Interpolates all four channels of 8888 pixels, two of them per multiplication. */
+static inline u32
+tex_smooth_lerp( u32 a,
+                 u32 b,
+                 int f )
+{
+     u32 rb = (((a & 0x00ff00ff) * (256 - f) + (b & 0x00ff00ff) * f) >> 8) & 0x00ff00ff;
+     u32 ag = (((a >> 8) & 0x00ff00ff) * (256 - f) + ((b >> 8) & 0x00ff00ff) * f) & 0xff00ff00;
+
+     return rb | ag;
+}
+
+#define TEX_SMOOTH_TO_DACC( name, type, read )                                                 \
+static void                                                                                    \
+Sop_##name##_TEX_smooth_to_Dacc( GenefxState *gfxs )                                           \
+{                                                                                              \
+     int                s     = gfxs->s;                                                       \
+     int                t     = gfxs->t;                                                       \
+     int                w     = gfxs->length + 1;                                              \
+     const u8          *S     = gfxs->Sop[0];                                                  \
+     GenefxAccumulator *D     = gfxs->Dacc;                                                    \
+     int                pitch = gfxs->src_pitch;                                               \
+     int                SperD = gfxs->SperD;                                                   \
+     int                TperD = gfxs->TperD;                                                   \
+                                                                                               \
+     while (--w) {                                                                             \
+          int         x, y, dx, dy, fx, fy;                                                    \
+          const type *S0, *S1;                                                                 \
+          u32         p;                                                                       \
+                                                                                               \
+          tex_smooth_coords( gfxs, s, t, &x, &y, &dx, &dy, &fx, &fy );                         \
+                                                                                               \
+          S0 = (const type*) (S + y * pitch) + x;                                              \
+          S1 = (const type*) (S + (y + dy) * pitch) + x;                                       \
+                                                                                               \
+          p = tex_smooth_lerp( tex_smooth_lerp( read( S0[0] ),  read( S1[0] ),  fy ),          \
+                               tex_smooth_lerp( read( S0[dx] ), read( S1[dx] ), fy ), fx );    \
+                                                                                               \
+          D->RGB.a = p >> 24;                                                                  \
+          D->RGB.r = (p >> 16) & 0xff;                                                         \
+          D->RGB.g = (p >>  8) & 0xff;                                                         \
+          D->RGB.b =  p        & 0xff;                                                         \
+                                                                                               \
+          ++D;                                                                                 \
+          s += SperD;                                                                          \
+          t += TperD;                                                                          \
+     }                                                                                         \
+}
+
+#define TEX_READ_ARGB(p)  (p)
+#define TEX_READ_RGB32(p) ((p) | 0xff000000)
+#define TEX_READ_AiRGB(p) ((p) ^ 0xff000000)
+#define TEX_READ_ABGR(p)  (((p) & 0xff00ff00) | (((p) & 0xff) << 16) | (((p) >> 16) & 0xff))
+#define TEX_READ_RGB16(p) (RGB16_TO_RGB32( p ) | 0xff000000)
+
+TEX_SMOOTH_TO_DACC( argb,  u32, TEX_READ_ARGB )
+TEX_SMOOTH_TO_DACC( rgb32, u32, TEX_READ_RGB32 )
+TEX_SMOOTH_TO_DACC( airgb, u32, TEX_READ_AiRGB )
+TEX_SMOOTH_TO_DACC( abgr,  u32, TEX_READ_ABGR )
+TEX_SMOOTH_TO_DACC( rgb16, u16, TEX_READ_RGB16 )
+
+static GenefxFunc Sop_PFI_TEX_smooth_to_Dacc[DFB_NUM_PIXELFORMATS] = {
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB16)] = Sop_rgb16_TEX_smooth_to_Dacc,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB32)] = Sop_rgb32_TEX_smooth_to_Dacc,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]  = Sop_argb_TEX_smooth_to_Dacc,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AiRGB)] = Sop_airgb_TEX_smooth_to_Dacc,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]  = Sop_abgr_TEX_smooth_to_Dacc,
+};
+
 /**********************************************************************************************************************
  ********************************* Sacc_to_Aop_PFI ********************************************************************
  **********************************************************************************************************************/
@@ -6933,275 +7060,906 @@ static GenefxFunc Bop_argb_blend_alphachannel_one_invsrc_premultiply_Aop_PFI[DFB
 };
 
 /**********************************************************************************************************************
- ********************************* Bop_a8_set_alphapixel_Aop_PFI ******************************************************
+ ********************************* Bop_argb_srcover_Aop_PFI ***********************************************************
  **********************************************************************************************************************/
 
-/* change the last value to adjust the size of the device (1-4) */
-#define SET_PIXEL_DUFFS_DEVICE(D,S,w) \
-     SET_PIXEL_DUFFS_DEVICE_N( D, S, w, 3 )
+/*
+ * Single pass versions of the accumulator pipeline for an ARGB source with DSBLIT_BLEND_ALPHACHANNEL and/or
+ * DSBLIT_BLEND_COLORALPHA, optionally with DSBLIT_COLORIZE and DSBLIT_SRC_PREMULTIPLY, using DSBF_ONE or DSBF_SRCALPHA
+ * as the source blend function and DSBF_INVSRCALPHA as the destination blend function.
+ * The pixels are processed as two pairs of 8 bit channels, giving the same results as the accumulators.
+ */
 
-static void
-Bop_a8_set_alphapixel_Aop_argb1555( GenefxState *gfxs )
+static __inline__ u32
+srcover_pixel( u32                      s,
+               u32                      d,
+               GenefxSrcOverFlags       flags,
+               const GenefxAccumulator *C,
+               u8                       ca )
 {
-     int  w   = gfxs->length;
-     u8  *S   = gfxs->Bop[0];
-     u16 *D   = gfxs->Aop[0];
-     u32  Cop = gfxs->Cop;
-     u32  rb  = Cop & 0x7c1f;
-     u32  g   = Cop & 0x03e0;
-
-#define SET_PIXEL(d,s)                                                                                            \
-     switch (s) {                                                                                                 \
-          case 0xff: d = Cop;                                                                                     \
-          case 0: break;                                                                                          \
-          default: {                                                                                              \
-               u32 a  = (s >> 3) + 1;                                                                             \
-               u32 t1 = d & 0x7c1f;                                                                               \
-               u32 t2 = d & 0x03e0;                                                                               \
-               d = (d & 0x8000)      |                                                                            \
-                   ((s & 0x80) << 8) |                                                                            \
-                   ((((rb - t1) * a + (t1 << 5)) & 0x000f83e0) + (((g - t2) * a + (t2 << 5)) & 0x00007c00)) >> 5; \
-          }                                                                                                       \
-     }
+     u32 sa = s >> 24;
+     u32 rb, ag;
+     int inv;
 
-     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+     if (flags & GSOF_COLORIZE)
+          s = (C->RGB.r * ((s >> 16) & 0xff) >> 8) << 16 |
+              (C->RGB.g * ((s >>  8) & 0xff) >> 8) <<  8 |
+              (C->RGB.b * ( s        & 0xff) >> 8);
 
-#undef SET_PIXEL
-}
+     if (flags & GSOF_ALPHA_COLOR)
+          sa = ca;
+     else if (flags & GSOF_ALPHA_MOD)
+          sa = (C->RGB.a * sa) >> 8;
 
-static void
-Bop_a8_set_alphapixel_Aop_rgb16( GenefxState *gfxs )
-{
-     int  w   = gfxs->length;
-     u8  *S   = gfxs->Bop[0];
-     u16 *D   = gfxs->Aop[0];
-     u32  Cop = gfxs->Cop;
-     u32  rb  = Cop & 0xf81f;
-     u32  g   = Cop & 0x07e0;
+     rb = s & 0x00ff00ff;
+     ag = (sa << 16) | ((s >> 8) & 0xff);
 
-#define SET_PIXEL(d,s)                                                                                            \
-     switch (s) {                                                                                                 \
-          case 0xff: d = Cop;                                                                                     \
-          case 0: break;                                                                                          \
-          default: {                                                                                              \
-               u32 a  = (s >> 2) + 1;                                                                             \
-               u32 t1 = d & 0xf81f;                                                                               \
-               u32 t2 = d & 0x07e0;                                                                               \
-               d = ((((rb - t1) * a + (t1 << 6)) & 0x003e07c0) + (((g - t2) * a + (t2 << 6)) & 0x0001f800)) >> 6; \
-          }                                                                                                       \
+     if (flags & GSOF_PREMULTIPLY) {
+          rb = ((rb * (sa + 1)) >> 8) & 0x00ff00ff;
+          ag = (ag & 0x00ff0000) | (((ag & 0xff) * (sa + 1)) >> 8);
      }
 
-     SET_PIXEL_DUFFS_DEVICE( D, S, w );
-
-#undef SET_PIXEL
-}
+     if (flags & GSOF_SRCALPHA) {
+          rb = ((rb * (sa + 1)) >> 8) & 0x00ff00ff;
+          ag = ((ag * (sa + 1)) >> 8) & 0x00ff00ff;
+     }
 
-static void
-Bop_a8_set_alphapixel_Aop_rgb24( GenefxState *gfxs )
-{
-     int       w     = gfxs->length;
-     u8       *S     = gfxs->Bop[0];
-     u8       *D     = gfxs->Aop[0];
-     DFBColor  color = gfxs->color;
+     if (sa == 0xff)
+          return (ag << 8) | rb;
 
-#define SET_PIXEL(D,r,g,b,s)                               \
-     switch (s) {                                          \
-         case 0xff:                                        \
-               D[0] = b;                                   \
-               D[1] = g;                                   \
-               D[2] = r;                                   \
-          case 0: break;                                   \
-          default: {                                       \
-               u16 a = s + 1;                              \
-               D[0] = ((b - D[0]) * a + (D[0] << 8)) >> 8; \
-               D[1] = ((g - D[1]) * a + (D[1] << 8)) >> 8; \
-               D[2] = ((r - D[2]) * a + (D[2] << 8)) >> 8; \
-          }                                                \
-     }
+     inv = 0x100 - sa;
 
-     while (w > 4) {
-          SET_PIXEL( D, color.r, color.g, color.b, *S ); D += 3; ++S;
-          SET_PIXEL( D, color.r, color.g, color.b, *S ); D += 3; ++S;
-          SET_PIXEL( D, color.r, color.g, color.b, *S ); D += 3; ++S;
-          SET_PIXEL( D, color.r, color.g, color.b, *S ); D += 3; ++S;
-          w -= 4;
-     }
+     rb += ((d        & 0x00ff00ff) * inv >> 8) & 0x00ff00ff;
+     ag += (((d >> 8) & 0x00ff00ff) * inv >> 8) & 0x00ff00ff;
 
-     while (w--) {
-          SET_PIXEL( D, color.r, color.g, color.b, *S ); D += 3; ++S;
-     }
+     /* Saturate each channel to 0xff. */
+     rb = (rb | ((rb & 0x01000100) - ((rb & 0x01000100) >> 8))) & 0x00ff00ff;
+     ag = (ag | ((ag & 0x01000100) - ((ag & 0x01000100) >> 8))) & 0x00ff00ff;
 
-#undef SET_PIXEL
+     return (ag << 8) | rb;
 }
 
-static void
-Bop_a8_set_alphapixel_Aop_rgb32( GenefxState *gfxs )
+/* Returns true if the destination would be left unchanged by the pixel. */
+static __inline__ bool
+srcover_transparent( u32                      s,
+                     GenefxSrcOverFlags       flags,
+                     const GenefxAccumulator *C,
+                     u8                       ca )
 {
-     int  w   = gfxs->length;
-     u8  *S   = gfxs->Bop[0];
-     u32 *D   = gfxs->Aop[0];
-     u32  Cop = gfxs->Cop;
-     u32  rb  = Cop & 0xff00ff;
-     u32  g   = Cop & 0x00ff00;
+     u32 sa;
 
-#define SET_PIXEL(d,s)                                                                                            \
-     switch (s) {                                                                                                 \
-          case 0xff: d = Cop;                                                                                     \
-          case 0: break;                                                                                          \
-          default: {                                                                                              \
-               u32 a  = s + 1;                                                                                    \
-               u32 t1 = d & 0x00ff00ff;                                                                           \
-               u32 t2 = d & 0x0000ff00;                                                                           \
-               d = ((((rb - t1) * a + (t1 << 8)) & 0xff00ff00) + (((g - t2) * a + (t2 << 8)) & 0x00ff0000)) >> 8; \
-          }                                                                                                       \
-     }
+     if (!(flags & (GSOF_PREMULTIPLY | GSOF_SRCALPHA)))
+          return false;
 
-     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+     if (flags & GSOF_ALPHA_COLOR)
+          sa = ca;
+     else if (flags & GSOF_ALPHA_MOD)
+          sa = (C->RGB.a * (s >> 24)) >> 8;
+     else
+          sa = s >> 24;
 
-#undef SET_PIXEL
+     return !sa;
 }
 
 static void
-Bop_a8_set_alphapixel_Aop_argb( GenefxState *gfxs )
+Bop_argb_srcover_Aop_argb( GenefxState *gfxs )
 {
-     int  w   = gfxs->length;
-     u8  *S   = gfxs->Bop[0];
-     u32 *D   = gfxs->Aop[0];
-     u32  Cop = gfxs->Cop | 0xff000000;
-     u32  rb  = Cop & 0x00ff00ff;
-     u32  g   = gfxs->color.g;
+     int                       w     = gfxs->length + 1;
+     u32                      *S     = gfxs->Bop[0];
+     u32                      *D     = gfxs->Aop[0];
+     int                       Sstep = gfxs->Bstep;
+     int                       Dstep = gfxs->Astep;
+     GenefxSrcOverFlags        flags = gfxs->srcover_flags;
+     const GenefxAccumulator  *C     = &gfxs->Cacc;
+     u8                        ca    = gfxs->color.a;
 
-#define SET_PIXEL(d,s)                                                                 \
-     switch (s) {                                                                      \
-          case 0xff: d = Cop;                                                          \
-          case 0: break;                                                               \
-          default: {                                                                   \
-               u32 a  = s + 1;                                                         \
-               u32 a1 = 256 - s;                                                       \
-               u32 sa = (((d >> 24) * a1) >> 8) + s;                                   \
-               d = (sa << 24)                                                        + \
-                    (((((d & 0x00ff00ff)       * a1) + (rb * a)) >> 8) & 0x00ff00ff) + \
-                    (((((d & 0x0000ff00) >> 8) * a1) + ( g * a))       & 0x0000ff00);  \
-          }                                                                            \
-     }
+     while (--w) {
+          u32 s = *S;
 
-     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+          if (!srcover_transparent( s, flags, C, ca ))
+               *D = srcover_pixel( s, *D, flags, C, ca );
 
-#undef SET_PIXEL
+          S += Sstep;
+          D += Dstep;
+     }
 }
 
 static void
-Bop_a8_set_alphapixel_Aop_a8( GenefxState *gfxs )
+Bop_argb_srcover_Aop_rgb32( GenefxState *gfxs )
 {
-     int  w = gfxs->length;
-     u8  *S = gfxs->Bop[0];
-     u8  *D = gfxs->Aop[0];
+     int                       w     = gfxs->length + 1;
+     u32                      *S     = gfxs->Bop[0];
+     u32                      *D     = gfxs->Aop[0];
+     int                       Sstep = gfxs->Bstep;
+     int                       Dstep = gfxs->Astep;
+     GenefxSrcOverFlags        flags = gfxs->srcover_flags;
+     const GenefxAccumulator  *C     = &gfxs->Cacc;
+     u8                        ca    = gfxs->color.a;
 
-#define SET_PIXEL(d,s)                  \
-     switch (s) {                       \
-          case 0xff: d = 0xff;          \
-          case 0: break;                \
-          default: {                    \
-               u16 a1 = 255 - s;        \
-               d = ((d * a1) >> 8) + s; \
-          }                             \
-     }
+     while (--w) {
+          u32 s = *S;
 
-     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+          if (!srcover_transparent( s, flags, C, ca ))
+               *D = srcover_pixel( s, *D | 0xff000000, flags, C, ca ) | 0xff000000;
+          else
+               *D |= 0xff000000;
 
-#undef SET_PIXEL
+          S += Sstep;
+          D += Dstep;
+     }
 }
 
 static void
-Bop_a8_set_alphapixel_Aop_yuy2( GenefxState *gfxs )
+Bop_argb_srcover_Aop_airgb( GenefxState *gfxs )
 {
-     int  w = gfxs->length;
-     u8  *S = gfxs->Bop[0];
-     u16 *D = gfxs->Aop[0];
-     u32  y = gfxs->YCop;
-     u32  u = gfxs->CbCop;
-     u32  v = gfxs->CrCop;
+     int                       w     = gfxs->length + 1;
+     u32                      *S     = gfxs->Bop[0];
+     u32                      *D     = gfxs->Aop[0];
+     int                       Sstep = gfxs->Bstep;
+     int                       Dstep = gfxs->Astep;
+     GenefxSrcOverFlags        flags = gfxs->srcover_flags;
+     const GenefxAccumulator  *C     = &gfxs->Cacc;
+     u8                        ca    = gfxs->color.a;
 
-#ifdef WORDS_BIGENDIAN
-     u16 Cop0 = u | (y << 8);
-     u16 Cop1 = v | (y << 8);
-#define SET_PIXEL(d,s)                                                                             \
-     switch (s) {                                                                                  \
-          case 0xff:                                                                               \
-               d = ((long) &(d) & 2) ? Cop1 : Cop0;                                                \
-          case 0x00: break;                                                                        \
-          default: {                                                                               \
-               u32 a  = s + 1;                                                                     \
-               u32 t1 = d & 0xff;                                                                  \
-               u32 t2 = d >> 8;                                                                    \
-               if ((long) &(d) & 2)                                                                \
-                    d = (((v - t1) * a + (t1 << 8)) >> 8) | (((y - t2) * a + (t2 << 8)) & 0xff00); \
-               else                                                                                \
-                    d = (((u - t1) * a + (t1 << 8)) >> 8) | (((y - t2) * a + (t2 << 8)) & 0xff00); \
-          }                                                                                        \
-     }
-#else
-     u16 Cop0 = y | (u << 8);
-     u16 Cop1 = y | (v << 8);
-#define SET_PIXEL(d,s)                                                                             \
-     switch (s) {                                                                                  \
-          case 0xff:                                                                               \
-               d = ((long) &(d) & 2) ? Cop1 : Cop0;                                                \
-          case 0x00: break;                                                                        \
-          default: {                                                                               \
-               u32 a  = s + 1;                                                                     \
-               u32 t1 = d & 0xff;                                                                  \
-               u32 t2 = d >> 8;                                                                    \
-               if ((long) &(d) & 2)                                                                \
-                    d = (((y - t1) * a + (t1 << 8)) >> 8) | (((v - t2) * a + (t2 << 8)) & 0xff00); \
-               else                                                                                \
-                    d = (((y - t1) * a + (t1 << 8)) >> 8) | (((u - t2) * a + (t2 << 8)) & 0xff00); \
-          }                                                                                        \
-     }
-#endif
+     while (--w) {
+          u32 s = *S;
 
-     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+          if (!srcover_transparent( s, flags, C, ca ))
+               *D = srcover_pixel( s, *D ^ 0xff000000, flags, C, ca ) ^ 0xff000000;
 
-#undef SET_PIXEL
+          S += Sstep;
+          D += Dstep;
+     }
 }
 
 static void
-Bop_a8_set_alphapixel_Aop_rgb332( GenefxState *gfxs )
+Bop_argb_srcover_Aop_rgb16( GenefxState *gfxs )
 {
-     int  w   = gfxs->length;
-     u8  *S   = gfxs->Bop[0];
-     u8  *D   = gfxs->Aop[0];
-     u32  Cop = gfxs->Cop;
-     u32  rgb = ((Cop & 0xe0) << 16) | ((Cop & 0x1c) << 8) | (Cop & 0x03);
+     int                       w     = gfxs->length + 1;
+     u32                      *S     = gfxs->Bop[0];
+     u16                      *D     = gfxs->Aop[0];
+     int                       Sstep = gfxs->Bstep;
+     int                       Dstep = gfxs->Astep;
+     GenefxSrcOverFlags        flags = gfxs->srcover_flags;
+     const GenefxAccumulator  *C     = &gfxs->Cacc;
+     u8                        ca    = gfxs->color.a;
 
-#define SET_PIXEL(d,s)                                                      \
-     switch (s) {                                                           \
-          case 0xff: d = Cop;                                               \
-          case 0: break;                                                    \
-          default: {                                                        \
-               u32 a = s + 1;                                               \
-               u32 t = ((d & 0xe0) << 16) | ((d & 0x1c) << 8) | (d & 0x03); \
-               u32 c = ((rgb - t) * a + (t << 8)) & 0xe01c0300;             \
-               d = (c >> 24) | ((c >> 16) & 0xff) | ((c >> 8) & 0xff);      \
-          }                                                                 \
-     }
+     while (--w) {
+          u32 s = *S;
 
-     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+          if (!srcover_transparent( s, flags, C, ca )) {
+               u16 d = *D;
+               u32 p = srcover_pixel( s, 0xff000000                             |
+                                         EXPAND_5to8( d >> 11 )           << 16 |
+                                         EXPAND_6to8( (d & 0x07e0) >> 5 ) <<  8 |
+                                         EXPAND_5to8( d & 0x001f ), flags, C, ca );
 
-#undef SET_PIXEL
+               *D = ARGB_TO_RGB16( p );
+          }
+
+          S += Sstep;
+          D += Dstep;
+     }
 }
 
-static void
-Bop_a8_set_alphapixel_Aop_uyvy( GenefxState *gfxs )
-{
-     int  w    = gfxs->length;
-     u8  *S    = gfxs->Bop[0];
-     u16 *D    = gfxs->Aop[0];
-     u32  y    = gfxs->YCop;
-     u32  u    = gfxs->CbCop;
-     u32  v    = gfxs->CrCop;
-     u16  Cop0 = u | (y << 8);
-     u16  Cop1 = v | (y << 8);
+static GenefxFunc Bop_argb_srcover_Aop_PFI[DFB_NUM_PIXELFORMATS] = {
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]      = Bop_argb_srcover_Aop_rgb16,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB24)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB32)]      = Bop_argb_srcover_Aop_rgb32,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]       = Bop_argb_srcover_Aop_argb,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A8)]         = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YUY2)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB332)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_UYVY)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_I420)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YV12)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_LUT8)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ALUT44)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AiRGB)]      = Bop_argb_srcover_Aop_airgb,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A1)]         = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV12)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV16)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB2554)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGBA4444)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV21)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AYUV)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A4)]         = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB1666)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB6666)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB18)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_LUT2)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGBA5551)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_Y444)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB8565)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AVYU)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_VYU)]        = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A1_LSB)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YV16)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGBAF88871)] = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_LUT1)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV61)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_Y42B)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YV24)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV24)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV42)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_BGR24)]      = NULL,
+};
+
+/**********************************************************************************************************************
+ ********************************* Bop_PFI_blend_coloralpha_Aop_PFI / Cop_blend_coloralpha_Aop_PFI ********************
+ **********************************************************************************************************************/
+
+/*
+ * Blits within the same format and fills blending with the color alpha (DSBF_SRCALPHA / DSBF_INVSRCALPHA) without the
+ * accumulators, the functions are set up by gInit_64bit().
+ */
+static GenefxFunc Bop_PFI_blend_coloralpha_Aop_PFI[DFB_NUM_PIXELFORMATS];
+static GenefxFunc Cop_blend_coloralpha_Aop_PFI[DFB_NUM_PIXELFORMATS];
+
+/**********************************************************************************************************************
+ ********************************* Bop_PFI_to_Aop_rgb32 / Bop_PFI_Sto_Aop_rgb32 ***************************************
+ **********************************************************************************************************************/
+
+#ifndef WORDS_BIGENDIAN
+
+/*
+ * Single pass versions of the accumulator pipeline for a YCbCr source blitted or stretched without any effects to an
+ * ARGB or RGB32 destination, replacing Sop_PFI_to_Dacc, Dacc_YCbCr_to_RGB_BT601/BT709 and Sacc_to_Aop_PFI or
+ * Sacc_Sto_Aop_PFI. The conversion uses the integer arithmetic of the YCBCR_TO_RGB_BT601/BT709 macros and both
+ * destination formats get an opaque alpha, so the results are the same as with the accumulators.
+ */
+
+typedef struct {
+     int cr_r;
+     int cb_g;
+     int cr_g;
+     int cb_b;
+} GenefxYCbCrMatrix;
+
+static const GenefxYCbCrMatrix ycbcr_BT601 = { 409, -100, -208, 516 };
+static const GenefxYCbCrMatrix ycbcr_BT709 = { 459,  -55, -136, 541 };
+
+static __inline__ u32
+ycbcr_to_rgb32( int                      y,
+                int                      cb,
+                int                      cr,
+                const GenefxYCbCrMatrix *m )
+{
+     int _y  = 298 * (y - 16) + 128;
+     int _cb = cb - 128;
+     int _cr = cr - 128;
+
+     int r = (_y                  + m->cr_r * _cr) >> 8;
+     int g = (_y + m->cb_g * _cb + m->cr_g * _cr) >> 8;
+     int b = (_y + m->cb_b * _cb                 ) >> 8;
+
+     return PIXEL_RGB32( CLAMP( r, 0, 255 ), CLAMP( g, 0, 255 ), CLAMP( b, 0, 255 ) );
+}
+
+static __inline__ void
+yuy2_to_rgb32( const u8                *S,
+               u32                     *D,
+               int                      len,
+               const GenefxYCbCrMatrix *m )
+{
+     int w = (len >> 1) + 1;
+
+     while (--w) {
+          D[0] = ycbcr_to_rgb32( S[0], S[1], S[3], m );
+          D[1] = ycbcr_to_rgb32( S[2], S[1], S[3], m );
+
+          S += 4;
+          D += 2;
+     }
+
+     /* A trailing odd pixel has no Cr sample, as in Sop_yuy2_to_Dacc(). */
+     if (len & 1)
+          *D = ycbcr_to_rgb32( S[0], S[1], 0x00, m );
+}
+
+/*
+ * Planar or semi-planar source, 'cstep' is the distance between two chroma samples. A span starting at an odd pixel
+ * ('odd') converts it with the chroma shared with its left neighbour first, unlike the accumulator path which pairs
+ * the pixels from the start of the span.
+ */
+static __inline__ void
+planar_to_rgb32( const u8                *Sy,
+                 const u8                *Su,
+                 const u8                *Sv,
+                 int                      cstep,
+                 int                      odd,
+                 u32                     *D,
+                 int                      len,
+                 const GenefxYCbCrMatrix *m )
+{
+     int w;
+
+     if (len && odd) {
+          *D++ = ycbcr_to_rgb32( *Sy++, *Su, *Sv, m );
+
+          Su += cstep;
+          Sv += cstep;
+          len--;
+     }
+
+     w = (len >> 1) + 1;
+
+     while (--w) {
+          D[0] = ycbcr_to_rgb32( Sy[0], *Su, *Sv, m );
+          D[1] = ycbcr_to_rgb32( Sy[1], *Su, *Sv, m );
+
+          Sy += 2;
+          Su += cstep;
+          Sv += cstep;
+          D  += 2;
+     }
+
+     if (len & 1)
+          *D = ycbcr_to_rgb32( *Sy, *Su, *Sv, m );
+}
+
+static __inline__ void
+yuy2_line_to_rgb32( GenefxState             *gfxs,
+                    u32                     *D,
+                    int                      len,
+                    const GenefxYCbCrMatrix *m )
+{
+     yuy2_to_rgb32( gfxs->Bop[0], D, len, m );
+}
+
+static __inline__ void
+i420_line_to_rgb32( GenefxState             *gfxs,
+                    u32                     *D,
+                    int                      len,
+                    const GenefxYCbCrMatrix *m )
+{
+     planar_to_rgb32( gfxs->Bop[0], gfxs->Bop[1], gfxs->Bop[2], 1, gfxs->BopX & 1, D, len, m );
+}
+
+static __inline__ void
+nv12_line_to_rgb32( GenefxState             *gfxs,
+                    u32                     *D,
+                    int                      len,
+                    const GenefxYCbCrMatrix *m )
+{
+     const u8 *Suv = gfxs->Bop[1];
+
+     planar_to_rgb32( gfxs->Bop[0], Suv, Suv + 1, 2, gfxs->BopX & 1, D, len, m );
+}
+
+static __inline__ void
+nv21_line_to_rgb32( GenefxState             *gfxs,
+                    u32                     *D,
+                    int                      len,
+                    const GenefxYCbCrMatrix *m )
+{
+     const u8 *Svu = gfxs->Bop[1];
+
+     planar_to_rgb32( gfxs->Bop[0], Svu + 1, Svu, 2, gfxs->BopX & 1, D, len, m );
+}
+
+/* Picks destination pixels from a converted source span, like Sacc_Sto_Aop_PFI. */
+static __inline__ void
+rgb32_Sto_Aop( GenefxState *gfxs,
+               const u32   *S )
+{
+     int  i     = gfxs->Xphase;
+     int  w     = gfxs->length + 1;
+     u32 *D     = gfxs->Aop[0];
+     int  SperD = gfxs->SperD;
+
+     while (--w) {
+          *D++ = S[i>>16];
+
+          i += SperD;
+     }
+}
+
+/*
+ * Generates the blit and stretch blit functions for a source format and a color space, the stretch blit converts the
+ * source span into the accumulator memory first.
+ */
+#define BOP_YCBCR_TO_AOP_RGB32(fmt,cs,sfx,attr)                                   \
+                                                                                  \
+static void attr                                                                  \
+Bop_##fmt##_to_Aop_rgb32_##cs##sfx( GenefxState *gfxs )                           \
+{                                                                                 \
+     fmt##_line_to_rgb32##sfx( gfxs, gfxs->Aop[0], gfxs->length, &ycbcr_##cs );   \
+}                                                                                 \
+                                                                                  \
+static void attr                                                                  \
+Bop_##fmt##_Sto_Aop_rgb32_##cs##sfx( GenefxState *gfxs )                          \
+{                                                                                 \
+     u32 *S = (u32*) gfxs->Sacc;                                                  \
+                                                                                  \
+     fmt##_line_to_rgb32##sfx( gfxs, S, gfxs->Slen, &ycbcr_##cs );                \
+                                                                                  \
+     rgb32_Sto_Aop( gfxs, S );                                                    \
+}
+
+BOP_YCBCR_TO_AOP_RGB32( yuy2, BT601, , )
+BOP_YCBCR_TO_AOP_RGB32( yuy2, BT709, , )
+BOP_YCBCR_TO_AOP_RGB32( i420, BT601, , )
+BOP_YCBCR_TO_AOP_RGB32( i420, BT709, , )
+BOP_YCBCR_TO_AOP_RGB32( nv12, BT601, , )
+BOP_YCBCR_TO_AOP_RGB32( nv12, BT709, , )
+BOP_YCBCR_TO_AOP_RGB32( nv21, BT601, , )
+BOP_YCBCR_TO_AOP_RGB32( nv21, BT709, , )
+
+static GenefxFunc Bop_PFI_to_Aop_rgb32_BT601[DFB_NUM_PIXELFORMATS] = {
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB24)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB32)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A8)]         = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YUY2)]       = Bop_yuy2_to_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB332)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_UYVY)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_I420)]       = Bop_i420_to_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YV12)]       = Bop_i420_to_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_LUT8)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ALUT44)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AiRGB)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A1)]         = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV12)]       = Bop_nv12_to_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV16)]       = Bop_nv12_to_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB2554)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGBA4444)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV21)]       = Bop_nv21_to_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AYUV)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A4)]         = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB1666)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB6666)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB18)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_LUT2)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGBA5551)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_Y444)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB8565)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AVYU)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_VYU)]        = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A1_LSB)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YV16)]       = Bop_i420_to_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGBAF88871)] = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_LUT1)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV61)]       = Bop_nv21_to_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_Y42B)]       = Bop_i420_to_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YV24)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV24)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV42)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_BGR24)]      = NULL,
+};
+
+static GenefxFunc Bop_PFI_to_Aop_rgb32_BT709[DFB_NUM_PIXELFORMATS] = {
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB24)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB32)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A8)]         = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YUY2)]       = Bop_yuy2_to_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB332)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_UYVY)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_I420)]       = Bop_i420_to_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YV12)]       = Bop_i420_to_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_LUT8)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ALUT44)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AiRGB)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A1)]         = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV12)]       = Bop_nv12_to_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV16)]       = Bop_nv12_to_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB2554)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGBA4444)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV21)]       = Bop_nv21_to_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AYUV)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A4)]         = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB1666)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB6666)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB18)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_LUT2)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGBA5551)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_Y444)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB8565)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AVYU)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_VYU)]        = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A1_LSB)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YV16)]       = Bop_i420_to_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGBAF88871)] = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_LUT1)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV61)]       = Bop_nv21_to_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_Y42B)]       = Bop_i420_to_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YV24)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV24)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV42)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_BGR24)]      = NULL,
+};
+
+static GenefxFunc Bop_PFI_Sto_Aop_rgb32_BT601[DFB_NUM_PIXELFORMATS] = {
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB24)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB32)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A8)]         = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YUY2)]       = Bop_yuy2_Sto_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB332)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_UYVY)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_I420)]       = Bop_i420_Sto_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YV12)]       = Bop_i420_Sto_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_LUT8)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ALUT44)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AiRGB)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A1)]         = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV12)]       = Bop_nv12_Sto_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV16)]       = Bop_nv12_Sto_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB2554)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGBA4444)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV21)]       = Bop_nv21_Sto_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AYUV)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A4)]         = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB1666)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB6666)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB18)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_LUT2)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGBA5551)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_Y444)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB8565)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AVYU)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_VYU)]        = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A1_LSB)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YV16)]       = Bop_i420_Sto_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGBAF88871)] = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_LUT1)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV61)]       = Bop_nv21_Sto_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_Y42B)]       = Bop_i420_Sto_Aop_rgb32_BT601,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YV24)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV24)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV42)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_BGR24)]      = NULL,
+};
+
+static GenefxFunc Bop_PFI_Sto_Aop_rgb32_BT709[DFB_NUM_PIXELFORMATS] = {
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB24)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB32)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A8)]         = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YUY2)]       = Bop_yuy2_Sto_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB332)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_UYVY)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_I420)]       = Bop_i420_Sto_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YV12)]       = Bop_i420_Sto_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_LUT8)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ALUT44)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AiRGB)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A1)]         = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV12)]       = Bop_nv12_Sto_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV16)]       = Bop_nv12_Sto_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB2554)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGBA4444)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV21)]       = Bop_nv21_Sto_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AYUV)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A4)]         = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB1666)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB6666)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB18)]      = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_LUT2)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGBA5551)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_Y444)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ARGB8565)]   = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_AVYU)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_VYU)]        = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_A1_LSB)]     = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YV16)]       = Bop_i420_Sto_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_RGBAF88871)] = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_LUT1)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV61)]       = Bop_nv21_Sto_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_Y42B)]       = Bop_i420_Sto_Aop_rgb32_BT709,
+     [DFB_PIXELFORMAT_INDEX(DSPF_YV24)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV24)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_NV42)]       = NULL,
+     [DFB_PIXELFORMAT_INDEX(DSPF_BGR24)]      = NULL,
+};
+
+#endif
+
+/**********************************************************************************************************************
+ ********************************* Bop_a8_set_alphapixel_Aop_PFI ******************************************************
+ **********************************************************************************************************************/
+
+/* change the last value to adjust the size of the device (1-4) */
+#define SET_PIXEL_DUFFS_DEVICE(D,S,w) \
+     SET_PIXEL_DUFFS_DEVICE_N( D, S, w, 3 )
+
+static void
+Bop_a8_set_alphapixel_Aop_argb1555( GenefxState *gfxs )
+{
+     int  w   = gfxs->length;
+     u8  *S   = gfxs->Bop[0];
+     u16 *D   = gfxs->Aop[0];
+     u32  Cop = gfxs->Cop;
+     u32  rb  = Cop & 0x7c1f;
+     u32  g   = Cop & 0x03e0;
+
+#define SET_PIXEL(d,s)                                                                                            \
+     switch (s) {                                                                                                 \
+          case 0xff: d = Cop;                                                                                     \
+          case 0: break;                                                                                          \
+          default: {                                                                                              \
+               u32 a  = (s >> 3) + 1;                                                                             \
+               u32 t1 = d & 0x7c1f;                                                                               \
+               u32 t2 = d & 0x03e0;                                                                               \
+               d = (d & 0x8000)      |                                                                            \
+                   ((s & 0x80) << 8) |                                                                            \
+                   ((((rb - t1) * a + (t1 << 5)) & 0x000f83e0) + (((g - t2) * a + (t2 << 5)) & 0x00007c00)) >> 5; \
+          }                                                                                                       \
+     }
+
+     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+
+#undef SET_PIXEL
+}
+
+static void
+Bop_a8_set_alphapixel_Aop_rgb16( GenefxState *gfxs )
+{
+     int  w   = gfxs->length;
+     u8  *S   = gfxs->Bop[0];
+     u16 *D   = gfxs->Aop[0];
+     u32  Cop = gfxs->Cop;
+     u32  rb  = Cop & 0xf81f;
+     u32  g   = Cop & 0x07e0;
+
+#define SET_PIXEL(d,s)                                                                                            \
+     switch (s) {                                                                                                 \
+          case 0xff: d = Cop;                                                                                     \
+          case 0: break;                                                                                          \
+          default: {                                                                                              \
+               u32 a  = (s >> 2) + 1;                                                                             \
+               u32 t1 = d & 0xf81f;                                                                               \
+               u32 t2 = d & 0x07e0;                                                                               \
+               d = ((((rb - t1) * a + (t1 << 6)) & 0x003e07c0) + (((g - t2) * a + (t2 << 6)) & 0x0001f800)) >> 6; \
+          }                                                                                                       \
+     }
+
+     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+
+#undef SET_PIXEL
+}
+
+static void
+Bop_a8_set_alphapixel_Aop_rgb24( GenefxState *gfxs )
+{
+     int       w     = gfxs->length;
+     u8       *S     = gfxs->Bop[0];
+     u8       *D     = gfxs->Aop[0];
+     DFBColor  color = gfxs->color;
+
+#define SET_PIXEL(D,r,g,b,s)                               \
+     switch (s) {                                          \
+         case 0xff:                                        \
+               D[0] = b;                                   \
+               D[1] = g;                                   \
+               D[2] = r;                                   \
+          case 0: break;                                   \
+          default: {                                       \
+               u16 a = s + 1;                              \
+               D[0] = ((b - D[0]) * a + (D[0] << 8)) >> 8; \
+               D[1] = ((g - D[1]) * a + (D[1] << 8)) >> 8; \
+               D[2] = ((r - D[2]) * a + (D[2] << 8)) >> 8; \
+          }                                                \
+     }
+
+     while (w > 4) {
+          SET_PIXEL( D, color.r, color.g, color.b, *S ); D += 3; ++S;
+          SET_PIXEL( D, color.r, color.g, color.b, *S ); D += 3; ++S;
+          SET_PIXEL( D, color.r, color.g, color.b, *S ); D += 3; ++S;
+          SET_PIXEL( D, color.r, color.g, color.b, *S ); D += 3; ++S;
+          w -= 4;
+     }
+
+     while (w--) {
+          SET_PIXEL( D, color.r, color.g, color.b, *S ); D += 3; ++S;
+     }
+
+#undef SET_PIXEL
+}
+
+static void
+Bop_a8_set_alphapixel_Aop_rgb32( GenefxState *gfxs )
+{
+     int  w   = gfxs->length;
+     u8  *S   = gfxs->Bop[0];
+     u32 *D   = gfxs->Aop[0];
+     u32  Cop = gfxs->Cop;
+     u32  rb  = Cop & 0xff00ff;
+     u32  g   = Cop & 0x00ff00;
+
+#define SET_PIXEL(d,s)                                                                                            \
+     switch (s) {                                                                                                 \
+          case 0xff: d = Cop;                                                                                     \
+          case 0: break;                                                                                          \
+          default: {                                                                                              \
+               u32 a  = s + 1;                                                                                    \
+               u32 t1 = d & 0x00ff00ff;                                                                           \
+               u32 t2 = d & 0x0000ff00;                                                                           \
+               d = ((((rb - t1) * a + (t1 << 8)) & 0xff00ff00) + (((g - t2) * a + (t2 << 8)) & 0x00ff0000)) >> 8; \
+          }                                                                                                       \
+     }
+
+     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+
+#undef SET_PIXEL
+}
+
+static void
+Bop_a8_set_alphapixel_Aop_argb( GenefxState *gfxs )
+{
+     int  w   = gfxs->length;
+     u8  *S   = gfxs->Bop[0];
+     u32 *D   = gfxs->Aop[0];
+     u32  Cop = gfxs->Cop | 0xff000000;
+     u32  rb  = Cop & 0x00ff00ff;
+     u32  g   = gfxs->color.g;
+
+#define SET_PIXEL(d,s)                                                                 \
+     switch (s) {                                                                      \
+          case 0xff: d = Cop;                                                          \
+          case 0: break;                                                               \
+          default: {                                                                   \
+               u32 a  = s + 1;                                                         \
+               u32 a1 = 256 - s;                                                       \
+               u32 sa = (((d >> 24) * a1) >> 8) + s;                                   \
+               d = (sa << 24)                                                        + \
+                    (((((d & 0x00ff00ff)       * a1) + (rb * a)) >> 8) & 0x00ff00ff) + \
+                    (((((d & 0x0000ff00) >> 8) * a1) + ( g * a))       & 0x0000ff00);  \
+          }                                                                            \
+     }
+
+     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+
+#undef SET_PIXEL
+}
+
+static void
+Bop_a8_set_alphapixel_Aop_a8( GenefxState *gfxs )
+{
+     int  w = gfxs->length;
+     u8  *S = gfxs->Bop[0];
+     u8  *D = gfxs->Aop[0];
+
+#define SET_PIXEL(d,s)                  \
+     switch (s) {                       \
+          case 0xff: d = 0xff;          \
+          case 0: break;                \
+          default: {                    \
+               u16 a1 = 255 - s;        \
+               d = ((d * a1) >> 8) + s; \
+          }                             \
+     }
+
+     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+
+#undef SET_PIXEL
+}
+
+static void
+Bop_a8_set_alphapixel_Aop_yuy2( GenefxState *gfxs )
+{
+     int  w = gfxs->length;
+     u8  *S = gfxs->Bop[0];
+     u16 *D = gfxs->Aop[0];
+     u32  y = gfxs->YCop;
+     u32  u = gfxs->CbCop;
+     u32  v = gfxs->CrCop;
+
+#ifdef WORDS_BIGENDIAN
+     u16 Cop0 = u | (y << 8);
+     u16 Cop1 = v | (y << 8);
+#define SET_PIXEL(d,s)                                                                             \
+     switch (s) {                                                                                  \
+          case 0xff:                                                                               \
+               d = ((long) &(d) & 2) ? Cop1 : Cop0;                                                \
+          case 0x00: break;                                                                        \
+          default: {                                                                               \
+               u32 a  = s + 1;                                                                     \
+               u32 t1 = d & 0xff;                                                                  \
+               u32 t2 = d >> 8;                                                                    \
+               if ((long) &(d) & 2)                                                                \
+                    d = (((v - t1) * a + (t1 << 8)) >> 8) | (((y - t2) * a + (t2 << 8)) & 0xff00); \
+               else                                                                                \
+                    d = (((u - t1) * a + (t1 << 8)) >> 8) | (((y - t2) * a + (t2 << 8)) & 0xff00); \
+          }                                                                                        \
+     }
+#else
+     u16 Cop0 = y | (u << 8);
+     u16 Cop1 = y | (v << 8);
+#define SET_PIXEL(d,s)                                                                             \
+     switch (s) {                                                                                  \
+          case 0xff:                                                                               \
+               d = ((long) &(d) & 2) ? Cop1 : Cop0;                                                \
+          case 0x00: break;                                                                        \
+          default: {                                                                               \
+               u32 a  = s + 1;                                                                     \
+               u32 t1 = d & 0xff;                                                                  \
+               u32 t2 = d >> 8;                                                                    \
+               if ((long) &(d) & 2)                                                                \
+                    d = (((y - t1) * a + (t1 << 8)) >> 8) | (((v - t2) * a + (t2 << 8)) & 0xff00); \
+               else                                                                                \
+                    d = (((y - t1) * a + (t1 << 8)) >> 8) | (((u - t2) * a + (t2 << 8)) & 0xff00); \
+          }                                                                                        \
+     }
+#endif
+
+     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+
+#undef SET_PIXEL
+}
+
+static void
+Bop_a8_set_alphapixel_Aop_rgb332( GenefxState *gfxs )
+{
+     int  w   = gfxs->length;
+     u8  *S   = gfxs->Bop[0];
+     u8  *D   = gfxs->Aop[0];
+     u32  Cop = gfxs->Cop;
+     u32  rgb = ((Cop & 0xe0) << 16) | ((Cop & 0x1c) << 8) | (Cop & 0x03);
+
+#define SET_PIXEL(d,s)                                                      \
+     switch (s) {                                                           \
+          case 0xff: d = Cop;                                               \
+          case 0: break;                                                    \
+          default: {                                                        \
+               u32 a = s + 1;                                               \
+               u32 t = ((d & 0xe0) << 16) | ((d & 0x1c) << 8) | (d & 0x03); \
+               u32 c = ((rgb - t) * a + (t << 8)) & 0xe01c0300;             \
+               d = (c >> 24) | ((c >> 16) & 0xff) | ((c >> 8) & 0xff);      \
+          }                                                                 \
+     }
+
+     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+
+#undef SET_PIXEL
+}
+
+static void
+Bop_a8_set_alphapixel_Aop_uyvy( GenefxState *gfxs )
+{
+     int  w    = gfxs->length;
+     u8  *S    = gfxs->Bop[0];
+     u16 *D    = gfxs->Aop[0];
+     u32  y    = gfxs->YCop;
+     u32  u    = gfxs->CbCop;
+     u32  v    = gfxs->CrCop;
+     u16  Cop0 = u | (y << 8);
+     u16  Cop1 = v | (y << 8);
 
 #define SET_PIXEL(d,s)                                                                             \
      switch (s) {                                                                                  \
@@ -9466,118 +10224,359 @@ Dacc_RGB_to_YCbCr_BT709_C( GenefxState *gfxs )
           RGB_TO_YCBCR_BT709( s.RGB.r, s.RGB.g, s.RGB.b, d.YUV.y, d.YUV.u, d.YUV.v ); \
      }
 
-     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+
+#undef SET_PIXEL
+}
+
+static void
+Dacc_RGB_to_YCbCr_BT2020_C( GenefxState *gfxs )
+{
+     int                w = gfxs->length;
+     GenefxAccumulator *S = gfxs->Dacc;
+     GenefxAccumulator *D = gfxs->Dacc;
+
+#define SET_PIXEL(d,s)                                                                 \
+     if (!(s.RGB.a & 0xf000)) {                                                        \
+          RGB_TO_YCBCR_BT2020( s.RGB.r, s.RGB.g, s.RGB.b, d.YUV.y, d.YUV.u, d.YUV.v ); \
+     }
+
+     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+
+#undef SET_PIXEL
+}
+
+#undef SET_PIXEL_DUFFS_DEVICE
+
+static GenefxFunc Dacc_RGB_to_YCbCr_BT601  = Dacc_RGB_to_YCbCr_BT601_C;
+static GenefxFunc Dacc_RGB_to_YCbCr_BT709  = Dacc_RGB_to_YCbCr_BT709_C;
+static GenefxFunc Dacc_RGB_to_YCbCr_BT2020 = Dacc_RGB_to_YCbCr_BT2020_C;
+
+/**********************************************************************************************************************/
+
+/* change the last value to adjust the size of the device (1-4) */
+#define SET_PIXEL_DUFFS_DEVICE(D,S,w) \
+     SET_PIXEL_DUFFS_DEVICE_N( D, S, w, 2 )
+
+static void
+Dacc_YCbCr_to_RGB_BT601_C( GenefxState *gfxs )
+{
+     int                w = gfxs->length;
+     GenefxAccumulator *S = gfxs->Dacc;
+     GenefxAccumulator *D = gfxs->Dacc;
+
+#define SET_PIXEL(d,s)                                                                \
+     if (!(s.YUV.a & 0xf000)) {                                                       \
+          YCBCR_TO_RGB_BT601( s.YUV.y, s.YUV.u, s.YUV.v, d.RGB.r, d.RGB.g, d.RGB.b ); \
+     }
+
+     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+
+#undef SET_PIXEL
+}
+
+static void
+Dacc_YCbCr_to_RGB_BT709_C( GenefxState *gfxs )
+{
+     int                w = gfxs->length;
+     GenefxAccumulator *S = gfxs->Dacc;
+     GenefxAccumulator *D = gfxs->Dacc;
+
+#define SET_PIXEL(d,s)                                                                \
+     if (!(s.YUV.a & 0xf000)) {                                                       \
+          YCBCR_TO_RGB_BT709( s.YUV.y, s.YUV.u, s.YUV.v, d.RGB.r, d.RGB.g, d.RGB.b ); \
+     }
+
+     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+
+#undef SET_PIXEL
+}
+
+static void
+Dacc_YCbCr_to_RGB_BT2020_C( GenefxState *gfxs )
+{
+     int                w = gfxs->length;
+     GenefxAccumulator *S = gfxs->Dacc;
+     GenefxAccumulator *D = gfxs->Dacc;
+
+#define SET_PIXEL(d,s)                                                                 \
+     if (!(s.YUV.a & 0xf000)) {                                                        \
+          YCBCR_TO_RGB_BT2020( s.YUV.y, s.YUV.u, s.YUV.v, d.RGB.r, d.RGB.g, d.RGB.b ); \
+     }
+
+     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+
+#undef SET_PIXEL
+}
+
+#undef SET_PIXEL_DUFFS_DEVICE
+
+static GenefxFunc Dacc_YCbCr_to_RGB_BT601  = Dacc_YCbCr_to_RGB_BT601_C;
+static GenefxFunc Dacc_YCbCr_to_RGB_BT709  = Dacc_YCbCr_to_RGB_BT709_C;
+static GenefxFunc Dacc_YCbCr_to_RGB_BT2020 = Dacc_YCbCr_to_RGB_BT2020_C;
+
+/**********************************************************************************************************************/
+
+static void
+Dacc_Alpha_to_YCbCr_C( GenefxState *gfxs )
+{
+     int                w = gfxs->length + 1;
+     GenefxAccumulator *D = gfxs->Dacc;
+
+     while (--w) {
+          if (!(D->RGB.a & 0xf000)) {
+               D->YUV.y = 235;
+               D->YUV.u = 128;
+               D->YUV.v = 128;
+          }
+
+          ++D;
+     }
+}
+
+static GenefxFunc Dacc_Alpha_to_YCbCr = Dacc_Alpha_to_YCbCr_C;
+
+/**********************************************************************************************************************
+ ********************************* Source color matrix ****************************************************************
+ **********************************************************************************************************************/
+
+/*
+ * Coefficients are 4.12 fixed point, the same products and sums are computed by the SIMD versions.
+ */
+static void
+Dacc_colormatrix_C( GenefxState *gfxs )
+{
+     int                w = gfxs->length + 1;
+     GenefxAccumulator *D = gfxs->Dacc;
+     const s32         *M = gfxs->CMcoef;
+
+     while (--w) {
+          if (!(D->RGB.a & 0xf000)) {
+               int r = D->RGB.r;
+               int g = D->RGB.g;
+               int b = D->RGB.b;
+
+               D->RGB.r = CLAMP( (M[0] * r + M[1] * g + M[2]  * b + M[3]  + 0x800) >> 12, 0, 0xff );
+               D->RGB.g = CLAMP( (M[4] * r + M[5] * g + M[6]  * b + M[7]  + 0x800) >> 12, 0, 0xff );
+               D->RGB.b = CLAMP( (M[8] * r + M[9] * g + M[10] * b + M[11] + 0x800) >> 12, 0, 0xff );
+          }
+
+          ++D;
+     }
+}
+
+static GenefxFunc Dacc_colormatrix = Dacc_colormatrix_C;
+
+/*
+ * Coefficients of 8.0 and above are applied with the original 16.16 precision.
+ */
+static void
+Dacc_colormatrix_wide( GenefxState *gfxs )
+{
+     int                w = gfxs->length + 1;
+     GenefxAccumulator *D = gfxs->Dacc;
+     const s32         *M = gfxs->CMcoef;
+
+     while (--w) {
+          if (!(D->RGB.a & 0xf000)) {
+               long long r = D->RGB.r;
+               long long g = D->RGB.g;
+               long long b = D->RGB.b;
+
+               D->RGB.r = CLAMP( (M[0] * r + M[1] * g + M[2]  * b + M[3]  + 0x8000) >> 16, 0, 0xff );
+               D->RGB.g = CLAMP( (M[4] * r + M[5] * g + M[6]  * b + M[7]  + 0x8000) >> 16, 0, 0xff );
+               D->RGB.b = CLAMP( (M[8] * r + M[9] * g + M[10] * b + M[11] + 0x8000) >> 16, 0, 0xff );
+          }
+
+          ++D;
+     }
+}
+
+/**********************************************************************************************************************
+ ********************************* Source convolution *****************************************************************
+ **********************************************************************************************************************/
+
+/*
+ * Convert the columns 'x'-1 to 'x'+'len' of a source line into 'K', replicating the pixels at the edges of the source.
+ */
+static void
+Kacc_load( GenefxState       *gfxs,
+           GenefxAccumulator *K,
+           int                line,
+           int                x,
+           int                len )
+{
+     void              *Sop[3] = { NULL, NULL, NULL };
+     void             **Sop_old    = gfxs->Sop;
+     GenefxAccumulator *Dacc_old   = gfxs->Dacc;
+     int                length_old = gfxs->length;
+     int                Ostep_old  = gfxs->Ostep;
+     int                x1         = MAX( x - 1, 0 );
+     int                x2         = MIN( x + len, gfxs->src_width - 1 );
+
+     Sop[0] = gfxs->src_org[0] + line * gfxs->src_pitch + x1 * gfxs->src_bpp;
+
+     gfxs->Sop    = Sop;
+     gfxs->Dacc   = K + x1 - (x - 1);
+     gfxs->length = x2 - x1 + 1;
+     gfxs->Ostep  = 1;
+
+     gfxs->Kload( gfxs );
+
+     gfxs->Sop    = Sop_old;
+     gfxs->Dacc   = Dacc_old;
+     gfxs->length = length_old;
+     gfxs->Ostep  = Ostep_old;
 
-#undef SET_PIXEL
+     if (x1 > x - 1)
+          K[0] = K[1];
+
+     if (x2 < x + len)
+          K[len+1] = K[len];
 }
 
+/*
+ * Get the source lines 'y'-1 to 'y'+1, converting only those not held already. When going through the source line by
+ * line, this converts each line once.
+ */
 static void
-Dacc_RGB_to_YCbCr_BT2020_C( GenefxState *gfxs )
+Kacc_lines( GenefxState        *gfxs,
+            int                 y,
+            int                 x,
+            int                 len,
+            GenefxAccumulator **K )
 {
-     int                w = gfxs->length;
-     GenefxAccumulator *S = gfxs->Dacc;
-     GenefxAccumulator *D = gfxs->Dacc;
+     int i, n;
+     int lines[3];
 
-#define SET_PIXEL(d,s)                                                                 \
-     if (!(s.RGB.a & 0xf000)) {                                                        \
-          RGB_TO_YCBCR_BT2020( s.RGB.r, s.RGB.g, s.RGB.b, d.YUV.y, d.YUV.u, d.YUV.v ); \
+     if (gfxs->Kx != x || gfxs->Klen != len) {
+          gfxs->Kline[0] = gfxs->Kline[1] = gfxs->Kline[2] = -1;
+          gfxs->Kx       = x;
+          gfxs->Klen     = len;
      }
 
-     SET_PIXEL_DUFFS_DEVICE( D, S, w );
-
-#undef SET_PIXEL
-}
+     for (n = 0; n < 3; n++) {
+          lines[n] = CLAMP( y - 1 + n, 0, gfxs->src_height - 1 );
+          K[n]     = NULL;
 
-#undef SET_PIXEL_DUFFS_DEVICE
+          for (i = 0; i < 3; i++) {
+               if (gfxs->Kline[i] == lines[n])
+                    K[n] = gfxs->Kacc[i];
+          }
+     }
 
-static GenefxFunc Dacc_RGB_to_YCbCr_BT601  = Dacc_RGB_to_YCbCr_BT601_C;
-static GenefxFunc Dacc_RGB_to_YCbCr_BT709  = Dacc_RGB_to_YCbCr_BT709_C;
-static GenefxFunc Dacc_RGB_to_YCbCr_BT2020 = Dacc_RGB_to_YCbCr_BT2020_C;
+     for (n = 0; n < 3; n++) {
+          if (K[n])
+               continue;
 
-/**********************************************************************************************************************/
+          /* Take a slot not holding any of the lines needed, lines are repeated at the top and bottom edges. */
+          for (i = 0; i < 3; i++) {
+               if (gfxs->Kacc[i] != K[0] && gfxs->Kacc[i] != K[1] && gfxs->Kacc[i] != K[2])
+                    break;
+          }
 
-/* change the last value to adjust the size of the device (1-4) */
-#define SET_PIXEL_DUFFS_DEVICE(D,S,w) \
-     SET_PIXEL_DUFFS_DEVICE_N( D, S, w, 2 )
+          D_ASSERT( i < 3 );
 
-static void
-Dacc_YCbCr_to_RGB_BT601_C( GenefxState *gfxs )
-{
-     int                w = gfxs->length;
-     GenefxAccumulator *S = gfxs->Dacc;
-     GenefxAccumulator *D = gfxs->Dacc;
+          Kacc_load( gfxs, gfxs->Kacc[i], lines[n], x, len );
 
-#define SET_PIXEL(d,s)                                                                \
-     if (!(s.YUV.a & 0xf000)) {                                                       \
-          YCBCR_TO_RGB_BT601( s.YUV.y, s.YUV.u, s.YUV.v, d.RGB.r, d.RGB.g, d.RGB.b ); \
-     }
+          gfxs->Kline[i] = lines[n];
 
-     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+          K[n] = gfxs->Kacc[i];
 
-#undef SET_PIXEL
+          if (n < 2 && lines[n+1] == lines[n])
+               K[n+1] = K[n];
+     }
 }
 
 static void
-Dacc_YCbCr_to_RGB_BT709_C( GenefxState *gfxs )
+Sop_convolve_to_Dacc( GenefxState *gfxs )
 {
-     int                w = gfxs->length;
-     GenefxAccumulator *S = gfxs->Dacc;
-     GenefxAccumulator *D = gfxs->Dacc;
+     int                 i, j;
+     int                 len    = gfxs->length;
+     GenefxAccumulator  *D      = gfxs->Dacc;
+     int                 Dstep  = 1;
+     const s32          *C      = gfxs->Kcoef;
+     s32                 bias   = gfxs->Kbias;
+     long                offset = (u8*) gfxs->Sop[0] - (u8*) gfxs->src_org[0];
+     GenefxAccumulator  *K[3];
+     int                 x, y;
 
-#define SET_PIXEL(d,s)                                                                \
-     if (!(s.YUV.a & 0xf000)) {                                                       \
-          YCBCR_TO_RGB_BT709( s.YUV.y, s.YUV.u, s.YUV.v, d.RGB.r, d.RGB.g, d.RGB.b ); \
+     /* Rotated blits don't track the source line, take the position from the span itself. */
+     y = offset / gfxs->src_pitch;
+     x = offset % gfxs->src_pitch / gfxs->src_bpp;
+
+     /* The span is read from right to left, the accumulators are still filled from the start. */
+     if (gfxs->Ostep < 0) {
+          x     -= len - 1;
+          D     += len - 1;
+          Dstep  = -1;
      }
 
-     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+     /* Mark pixels matching the source color key, depending on the center pixel only. */
+     if (gfxs->Kkey)
+          gfxs->Kkey( gfxs );
 
-#undef SET_PIXEL
-}
+     Kacc_lines( gfxs, y, x, len, K );
 
-static void
-Dacc_YCbCr_to_RGB_BT2020_C( GenefxState *gfxs )
-{
-     int                w = gfxs->length;
-     GenefxAccumulator *S = gfxs->Dacc;
-     GenefxAccumulator *D = gfxs->Dacc;
+     if (gfxs->Ksymmetric) {
+          s32       *S  = gfxs->Ksum;
+          const s32 *Kh = gfxs->Kh;
+          const s32 *Kv = gfxs->Kv;
 
-#define SET_PIXEL(d,s)                                                                 \
-     if (!(s.YUV.a & 0xf000)) {                                                        \
-          YCBCR_TO_RGB_BT2020( s.YUV.y, s.YUV.u, s.YUV.v, d.RGB.r, d.RGB.g, d.RGB.b ); \
-     }
+          /* Vertical pass, once per column. */
+          for (i = 0; i < len + 2; i++) {
+               const GenefxAccumulator *K0 = &K[0][i];
+               const GenefxAccumulator *K1 = &K[1][i];
+               const GenefxAccumulator *K2 = &K[2][i];
 
-     SET_PIXEL_DUFFS_DEVICE( D, S, w );
+               S[i*4+0] = Kv[0] * (K0->RGB.a + K2->RGB.a) + Kv[1] * K1->RGB.a;
+               S[i*4+1] = Kv[0] * (K0->RGB.r + K2->RGB.r) + Kv[1] * K1->RGB.r;
+               S[i*4+2] = Kv[0] * (K0->RGB.g + K2->RGB.g) + Kv[1] * K1->RGB.g;
+               S[i*4+3] = Kv[0] * (K0->RGB.b + K2->RGB.b) + Kv[1] * K1->RGB.b;
+          }
 
-#undef SET_PIXEL
-}
+          /* Horizontal pass. */
+          for (i = 0; i < len; i++, D += Dstep, S += 4) {
+               long long a, r, g, b;
 
-#undef SET_PIXEL_DUFFS_DEVICE
+               if (gfxs->Kkey && (D->RGB.a & 0xf000))
+                    continue;
 
-static GenefxFunc Dacc_YCbCr_to_RGB_BT601  = Dacc_YCbCr_to_RGB_BT601_C;
-static GenefxFunc Dacc_YCbCr_to_RGB_BT709  = Dacc_YCbCr_to_RGB_BT709_C;
-static GenefxFunc Dacc_YCbCr_to_RGB_BT2020 = Dacc_YCbCr_to_RGB_BT2020_C;
+               a = Kh[0] * ((long long) S[0] + S[8])  + (long long) Kh[1] * S[4];
+               r = Kh[0] * ((long long) S[1] + S[9])  + (long long) Kh[1] * S[5];
+               g = Kh[0] * ((long long) S[2] + S[10]) + (long long) Kh[1] * S[6];
+               b = Kh[0] * ((long long) S[3] + S[11]) + (long long) Kh[1] * S[7];
 
-/**********************************************************************************************************************/
+               D->RGB.a = CLAMP( (a + 0x80000000LL) >> 32, 0, 0xff );
+               D->RGB.r = CLAMP( (r + ((long long) bias << 16) + 0x80000000LL) >> 32, 0, 0xff );
+               D->RGB.g = CLAMP( (g + ((long long) bias << 16) + 0x80000000LL) >> 32, 0, 0xff );
+               D->RGB.b = CLAMP( (b + ((long long) bias << 16) + 0x80000000LL) >> 32, 0, 0xff );
+          }
+     }
+     else {
+          for (i = 0; i < len; i++, D += Dstep) {
+               long long a = 0, r = 0, g = 0, b = 0;
 
-static void
-Dacc_Alpha_to_YCbCr_C( GenefxState *gfxs )
-{
-     int                w = gfxs->length + 1;
-     GenefxAccumulator *D = gfxs->Dacc;
+               if (gfxs->Kkey && (D->RGB.a & 0xf000))
+                    continue;
 
-     while (--w) {
-          if (!(D->RGB.a & 0xf000)) {
-               D->YUV.y = 235;
-               D->YUV.u = 128;
-               D->YUV.v = 128;
-          }
+               for (j = 0; j < 9; j++) {
+                    const GenefxAccumulator *P = &K[j/3][i+j%3];
 
-          ++D;
+                    a += (long long) C[j] * P->RGB.a;
+                    r += (long long) C[j] * P->RGB.r;
+                    g += (long long) C[j] * P->RGB.g;
+                    b += (long long) C[j] * P->RGB.b;
+               }
+
+               D->RGB.a = CLAMP( (a + 0x8000) >> 16, 0, 0xff );
+               D->RGB.r = CLAMP( (r + bias + 0x8000) >> 16, 0, 0xff );
+               D->RGB.g = CLAMP( (g + bias + 0x8000) >> 16, 0, 0xff );
+               D->RGB.b = CLAMP( (b + bias + 0x8000) >> 16, 0, 0xff );
+          }
      }
 }
 
-static GenefxFunc Dacc_Alpha_to_YCbCr = Dacc_Alpha_to_YCbCr_C;
-
 /**********************************************************************************************************************/
 
 static void Sop_is_Aop  ( GenefxState *gfxs ) { gfxs->Sop = gfxs->Aop; gfxs->Ostep = gfxs->Astep; }
@@ -9611,6 +10610,8 @@ static void Len_is_Dlen ( GenefxState *gfxs ) { gfxs->length = gfxs->Dlen; }
                           DSBLIT_SRC_PREMULTIPLY    | \
                           DSBLIT_SRC_PREMULTCOLOR   | \
                           DSBLIT_DEMULTIPLY         | \
+                          DSBLIT_SRC_COLORMATRIX    | \
+                          DSBLIT_SRC_CONVOLUTION    | \
                           DSBLIT_XOR)
 
 /**********************************************************************************************************************/
@@ -9768,16 +10769,260 @@ gInit_NEON()
 
 #endif
 
-#if SIZEOF_LONG == 8
+#ifdef USE_SSE2
+
+#include "generic_sse2.h"
+#include "generic_avx2.h"
+
+/* ARGB1555 / RGB555 / BGR555 / RGBA5551 */
+#define RGB_MASK 0x7fff
+#define Cop_OP_Aop_PFI(op) Cop_##op##_Aop_15
+#define Bop_PFI_OP_Aop_PFI(op) Bop_15_##op##_Aop
+#include "template_colorkey_16_sse2.h"
+
+/* RGB16 */
+#define RGB_MASK 0xffff
+#define Cop_OP_Aop_PFI(op) Cop_##op##_Aop_16
+#define Bop_PFI_OP_Aop_PFI(op) Bop_16_##op##_Aop
+#include "template_colorkey_16_sse2.h"
+
+/* RGB32 / ARGB / ABGR / AiRGB / AYUV / AVYU */
+#define RGB_MASK 0x00ffffff
+#define Cop_OP_Aop_PFI(op) Cop_##op##_Aop_32
+#define Bop_PFI_OP_Aop_PFI(op) Bop_32_##op##_Aop
+#include "template_colorkey_32_sse2.h"
+
+/* ARGB2554 */
+#define RGB_MASK 0x3fff
+#define Cop_OP_Aop_PFI(op) Cop_##op##_Aop_14
+#define Bop_PFI_OP_Aop_PFI(op) Bop_14_##op##_Aop
+#include "template_colorkey_16_sse2.h"
+
+/* ARGB4444 / RGB444 */
+#define RGB_MASK 0x0fff
+#define Cop_OP_Aop_PFI(op) Cop_##op##_Aop_12
+#define Bop_PFI_OP_Aop_PFI(op) Bop_12_##op##_Aop
+#include "template_colorkey_16_sse2.h"
+
+/* RGBA4444 */
+#define RGB_MASK 0xfff0
+#define Cop_OP_Aop_PFI(op) Cop_##op##_Aop_12vv
+#define Bop_PFI_OP_Aop_PFI(op) Bop_12vv_##op##_Aop
+#include "template_colorkey_16_sse2.h"
+
+/* RGBAF88871 */
+#define RGB_MASK 0xffffff00
+#define Cop_OP_Aop_PFI(op) Cop_##op##_Aop_32_24
+#define Bop_PFI_OP_Aop_PFI(op) Bop_32_24_##op##_Aop
+#include "template_colorkey_32_sse2.h"
+
+/*
+ * patches function pointers to SSE2 functions
+ */
+static void
+gInit_SSE2( void )
+{
+/********************************* Sop_PFI_to_Dacc ********************************/
+     Sop_PFI_to_Dacc[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)] = Sop_rgb16_to_Dacc_SSE2;
+     Sop_PFI_to_Dacc[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)] = Sop_rgb32_to_Dacc_SSE2;
+     Sop_PFI_to_Dacc[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]  = Sop_argb_to_Dacc_SSE2;
+/********************************* Sop_PFI_TEX_smooth_to_Dacc *********************/
+     Sop_PFI_TEX_smooth_to_Dacc[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)] = Sop_rgb32_TEX_smooth_to_Dacc_SSE2;
+     Sop_PFI_TEX_smooth_to_Dacc[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]  = Sop_argb_TEX_smooth_to_Dacc_SSE2;
+/********************************* Sacc_to_Aop_PFI ********************************/
+     Sacc_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)] = Sacc_to_Aop_rgb16_SSE2;
+     Sacc_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)] = Sacc_to_Aop_rgb32_SSE2;
+     Sacc_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]  = Sacc_to_Aop_argb_SSE2;
+/********************************* Xacc_blend *************************************/
+     Xacc_blend[DSBF_SRCALPHA-1]    = Xacc_blend_srcalpha_SSE2;
+     Xacc_blend[DSBF_INVSRCALPHA-1] = Xacc_blend_invsrcalpha_SSE2;
+/********************************* Dacc_modulation ********************************/
+     Dacc_modulation[DSBLIT_COLORIZE]                                                       = Dacc_modulate_rgb_SSE2;
+     Dacc_modulation[DSBLIT_COLORIZE | DSBLIT_BLEND_ALPHACHANNEL]                           = Dacc_modulate_rgb_SSE2;
+     Dacc_modulation[DSBLIT_COLORIZE | DSBLIT_BLEND_ALPHACHANNEL | DSBLIT_BLEND_COLORALPHA] = Dacc_modulate_argb_SSE2;
+/********************************* Misc accumulator operations ********************/
+     SCacc_add_to_Dacc            = SCacc_add_to_Dacc_SSE2;
+     Sacc_add_to_Dacc             = Sacc_add_to_Dacc_SSE2;
+     Dacc_premultiply             = Dacc_premultiply_SSE2;
+     Dacc_premultiply_color_alpha = Dacc_premultiply_color_alpha_SSE2;
+     Dacc_colormatrix             = Dacc_colormatrix_SSE2;
+/********************************* Bop_argb_srcover_Aop_PFI ***********************/
+     Bop_argb_srcover_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)] = Bop_argb_srcover_Aop_rgb16_SSE2;
+     Bop_argb_srcover_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)] = Bop_argb_srcover_Aop_rgb32_SSE2;
+     Bop_argb_srcover_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]  = Bop_argb_srcover_Aop_argb_SSE2;
+     Bop_argb_srcover_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AiRGB)] = Bop_argb_srcover_Aop_airgb_SSE2;
+/********************************* Bop_PFI_to_Aop_rgb32_BT601 *********************/
+     Bop_PFI_to_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_YUY2)] = Bop_yuy2_to_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_I420)] = Bop_i420_to_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_YV12)] = Bop_i420_to_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_Y42B)] = Bop_i420_to_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_YV16)] = Bop_i420_to_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_NV12)] = Bop_nv12_to_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_NV16)] = Bop_nv12_to_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_NV21)] = Bop_nv21_to_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_NV61)] = Bop_nv21_to_Aop_rgb32_BT601_SSE2;
+/********************************* Bop_PFI_to_Aop_rgb32_BT709 *********************/
+     Bop_PFI_to_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_YUY2)] = Bop_yuy2_to_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_I420)] = Bop_i420_to_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_YV12)] = Bop_i420_to_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_Y42B)] = Bop_i420_to_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_YV16)] = Bop_i420_to_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_NV12)] = Bop_nv12_to_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_NV16)] = Bop_nv12_to_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_NV21)] = Bop_nv21_to_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_to_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_NV61)] = Bop_nv21_to_Aop_rgb32_BT709_SSE2;
+/********************************* Bop_PFI_Sto_Aop_rgb32_BT601 ********************/
+     Bop_PFI_Sto_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_YUY2)] = Bop_yuy2_Sto_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_I420)] = Bop_i420_Sto_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_YV12)] = Bop_i420_Sto_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_Y42B)] = Bop_i420_Sto_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_YV16)] = Bop_i420_Sto_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_NV12)] = Bop_nv12_Sto_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_NV16)] = Bop_nv12_Sto_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_NV21)] = Bop_nv21_Sto_Aop_rgb32_BT601_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT601[DFB_PIXELFORMAT_INDEX(DSPF_NV61)] = Bop_nv21_Sto_Aop_rgb32_BT601_SSE2;
+/********************************* Bop_PFI_Sto_Aop_rgb32_BT709 ********************/
+     Bop_PFI_Sto_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_YUY2)] = Bop_yuy2_Sto_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_I420)] = Bop_i420_Sto_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_YV12)] = Bop_i420_Sto_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_Y42B)] = Bop_i420_Sto_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_YV16)] = Bop_i420_Sto_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_NV12)] = Bop_nv12_Sto_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_NV16)] = Bop_nv12_Sto_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_NV21)] = Bop_nv21_Sto_Aop_rgb32_BT709_SSE2;
+     Bop_PFI_Sto_Aop_rgb32_BT709[DFB_PIXELFORMAT_INDEX(DSPF_NV61)] = Bop_nv21_Sto_Aop_rgb32_BT709_SSE2;
+/********************************* Cop_toK_Aop_PFI ********************************/
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]      = Cop_toK_Aop_16_SSE2;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)]   = Cop_toK_Aop_15_SSE2;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]     = Cop_toK_Aop_15_SSE2;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]     = Cop_toK_Aop_15_SSE2;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA5551)]   = Cop_toK_Aop_15_SSE2;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB2554)]   = Cop_toK_Aop_14_SSE2;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)]   = Cop_toK_Aop_12_SSE2;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]     = Cop_toK_Aop_12_SSE2;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA4444)]   = Cop_toK_Aop_12vv_SSE2;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)]      = Cop_toK_Aop_32_SSE2;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]       = Cop_toK_Aop_32_SSE2;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AiRGB)]      = Cop_toK_Aop_32_SSE2;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AYUV)]       = Cop_toK_Aop_32_SSE2;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]       = Cop_toK_Aop_32_SSE2;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBAF88871)] = Cop_toK_Aop_32_24_SSE2;
+/********************************* Bop_PFI_toK_Aop_PFI ****************************/
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]      = Bop_16_toK_Aop_SSE2;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)]   = Bop_15_toK_Aop_SSE2;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]     = Bop_15_toK_Aop_SSE2;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]     = Bop_15_toK_Aop_SSE2;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA5551)]   = Bop_15_toK_Aop_SSE2;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB2554)]   = Bop_14_toK_Aop_SSE2;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)]   = Bop_12_toK_Aop_SSE2;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]     = Bop_12_toK_Aop_SSE2;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA4444)]   = Bop_12vv_toK_Aop_SSE2;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)]      = Bop_32_toK_Aop_SSE2;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]       = Bop_32_toK_Aop_SSE2;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AiRGB)]      = Bop_32_toK_Aop_SSE2;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AYUV)]       = Bop_32_toK_Aop_SSE2;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AVYU)]       = Bop_32_toK_Aop_SSE2;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]       = Bop_32_toK_Aop_SSE2;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBAF88871)] = Bop_32_24_toK_Aop_SSE2;
+/********************************* Bop_PFI_Kto_Aop_PFI ****************************/
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]      = Bop_16_Kto_Aop_SSE2;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)]   = Bop_15_Kto_Aop_SSE2;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]     = Bop_15_Kto_Aop_SSE2;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]     = Bop_15_Kto_Aop_SSE2;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA5551)]   = Bop_15_Kto_Aop_SSE2;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB2554)]   = Bop_14_Kto_Aop_SSE2;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)]   = Bop_12_Kto_Aop_SSE2;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]     = Bop_12_Kto_Aop_SSE2;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA4444)]   = Bop_12vv_Kto_Aop_SSE2;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)]      = Bop_32_Kto_Aop_SSE2;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]       = Bop_32_Kto_Aop_SSE2;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AiRGB)]      = Bop_32_Kto_Aop_SSE2;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AYUV)]       = Bop_32_Kto_Aop_SSE2;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AVYU)]       = Bop_32_Kto_Aop_SSE2;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]       = Bop_32_Kto_Aop_SSE2;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBAF88871)] = Bop_32_24_Kto_Aop_SSE2;
+/********************************* Bop_PFI_KtoK_Aop_PFI ***************************/
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]      = Bop_16_KtoK_Aop_SSE2;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)]   = Bop_15_KtoK_Aop_SSE2;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]     = Bop_15_KtoK_Aop_SSE2;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]     = Bop_15_KtoK_Aop_SSE2;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA5551)]   = Bop_15_KtoK_Aop_SSE2;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB2554)]   = Bop_14_KtoK_Aop_SSE2;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)]   = Bop_12_KtoK_Aop_SSE2;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]     = Bop_12_KtoK_Aop_SSE2;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA4444)]   = Bop_12vv_KtoK_Aop_SSE2;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)]      = Bop_32_KtoK_Aop_SSE2;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]       = Bop_32_KtoK_Aop_SSE2;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AiRGB)]      = Bop_32_KtoK_Aop_SSE2;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AYUV)]       = Bop_32_KtoK_Aop_SSE2;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AVYU)]       = Bop_32_KtoK_Aop_SSE2;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ABGR)]       = Bop_32_KtoK_Aop_SSE2;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBAF88871)] = Bop_32_24_KtoK_Aop_SSE2;
+/********************************* Rotated blits **********************************/
+     gInitBlit_SSE2();
+/********************************* Solid fills ************************************/
+     gInitFillRectangle_SSE2();
+/********************************* Smooth scaling *********************************/
+     gInitStretchBlit_SSE2();
+}
+
+/*
+ * patches function pointers to AVX2 functions
+ */
+static void
+gInit_AVX2( void )
+{
+/********************************* Sop_PFI_to_Dacc ********************************/
+     Sop_PFI_to_Dacc[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)] = Sop_rgb16_to_Dacc_AVX2;
+     Sop_PFI_to_Dacc[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)] = Sop_rgb32_to_Dacc_AVX2;
+     Sop_PFI_to_Dacc[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]  = Sop_argb_to_Dacc_AVX2;
+/********************************* Sacc_to_Aop_PFI ********************************/
+     Sacc_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)] = Sacc_to_Aop_rgb16_AVX2;
+     Sacc_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)] = Sacc_to_Aop_rgb32_AVX2;
+     Sacc_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]  = Sacc_to_Aop_argb_AVX2;
+/********************************* Xacc_blend *************************************/
+     Xacc_blend[DSBF_SRCALPHA-1]    = Xacc_blend_srcalpha_AVX2;
+     Xacc_blend[DSBF_INVSRCALPHA-1] = Xacc_blend_invsrcalpha_AVX2;
+/********************************* Dacc_modulation ********************************/
+     Dacc_modulation[DSBLIT_COLORIZE]                                                       = Dacc_modulate_rgb_AVX2;
+     Dacc_modulation[DSBLIT_COLORIZE | DSBLIT_BLEND_ALPHACHANNEL]                           = Dacc_modulate_rgb_AVX2;
+     Dacc_modulation[DSBLIT_COLORIZE | DSBLIT_BLEND_ALPHACHANNEL | DSBLIT_BLEND_COLORALPHA] = Dacc_modulate_argb_AVX2;
+/********************************* Misc accumulator operations ********************/
+     SCacc_add_to_Dacc            = SCacc_add_to_Dacc_AVX2;
+     Sacc_add_to_Dacc             = Sacc_add_to_Dacc_AVX2;
+     Dacc_premultiply             = Dacc_premultiply_AVX2;
+     Dacc_premultiply_color_alpha = Dacc_premultiply_color_alpha_AVX2;
+}
+
+#endif
 
 #include "generic_64.h"
 
+/* ARGB1555 / RGB555 / BGR555 / RGBA5551 */
+#define RGB_MASK 0x7fff
+#define Cop_OP_Aop_PFI(op) Cop_##op##_Aop_15
+#define Bop_PFI_OP_Aop_PFI(op) Bop_15_##op##_Aop
+#include "template_colorkey_16_64.h"
+
+/* RGB16 */
+#define RGB_MASK 0xffff
+#define Cop_OP_Aop_PFI(op) Cop_##op##_Aop_16
+#define Bop_PFI_OP_Aop_PFI(op) Bop_16_##op##_Aop
+#include "template_colorkey_16_64.h"
+
+/* ARGB4444 / RGB444 */
+#define RGB_MASK 0x0fff
+#define Cop_OP_Aop_PFI(op) Cop_##op##_Aop_12
+#define Bop_PFI_OP_Aop_PFI(op) Bop_12_##op##_Aop
+#include "template_colorkey_16_64.h"
+
 /*
  * patches function pointers to 64 bits functions
  */
 static void
 gInit_64bit( void )
 {
+#if SIZEOF_LONG == 8
 /********************************* Cop_to_Aop_PFI *********************************/
      Cop_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)] = Cop_to_Aop_32_64;
      Cop_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)]  = Cop_to_Aop_32_64;
@@ -9796,10 +11041,76 @@ gInit_64bit( void )
      Bop_PFI_Sto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_AiRGB)] = Bop_32_Sto_Aop_64;
 /********************************* Misc accumulator operations ********************/
      Dacc_xor = Dacc_xor_64;
-}
-
 #endif
 
+/********************************* Cop_to_Aop_PFI *********************************/
+     Cop_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)] = Cop_to_Aop_16_64;
+     Cop_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]    = Cop_to_Aop_16_64;
+     Cop_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB2554)] = Cop_to_Aop_16_64;
+     Cop_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)] = Cop_to_Aop_16_64;
+     Cop_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA4444)] = Cop_to_Aop_16_64;
+     Cop_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]   = Cop_to_Aop_16_64;
+     Cop_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]   = Cop_to_Aop_16_64;
+     Cop_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]   = Cop_to_Aop_16_64;
+     Cop_to_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA5551)] = Cop_to_Aop_16_64;
+/********************************* Cop_toK_Aop_PFI ********************************/
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]    = Cop_toK_Aop_16_64;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)] = Cop_toK_Aop_15_64;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]   = Cop_toK_Aop_15_64;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]   = Cop_toK_Aop_15_64;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA5551)] = Cop_toK_Aop_15_64;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)] = Cop_toK_Aop_12_64;
+     Cop_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]   = Cop_toK_Aop_12_64;
+/********************************* Cop_blend_coloralpha_Aop_PFI *******************/
+     Cop_blend_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]    = Cop_rgb16_blend_coloralpha_Aop_64;
+     Cop_blend_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)] = Cop_argb1555_blend_coloralpha_Aop_64;
+     Cop_blend_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]   = Cop_rgb555_blend_coloralpha_Aop_64;
+     Cop_blend_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]   = Cop_bgr555_blend_coloralpha_Aop_64;
+     Cop_blend_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)] = Cop_argb4444_blend_coloralpha_Aop_64;
+     Cop_blend_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]   = Cop_rgb444_blend_coloralpha_Aop_64;
+/********************************* Bop_PFI_toK_Aop_PFI ****************************/
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]    = Bop_16_toK_Aop_64;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)] = Bop_15_toK_Aop_64;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]   = Bop_15_toK_Aop_64;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]   = Bop_15_toK_Aop_64;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA5551)] = Bop_15_toK_Aop_64;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)] = Bop_12_toK_Aop_64;
+     Bop_PFI_toK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]   = Bop_12_toK_Aop_64;
+/********************************* Bop_PFI_Kto_Aop_PFI ****************************/
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]    = Bop_16_Kto_Aop_64;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)] = Bop_15_Kto_Aop_64;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]   = Bop_15_Kto_Aop_64;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]   = Bop_15_Kto_Aop_64;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA5551)] = Bop_15_Kto_Aop_64;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)] = Bop_12_Kto_Aop_64;
+     Bop_PFI_Kto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]   = Bop_12_Kto_Aop_64;
+/********************************* Bop_PFI_KtoK_Aop_PFI ***************************/
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]    = Bop_16_KtoK_Aop_64;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)] = Bop_15_KtoK_Aop_64;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]   = Bop_15_KtoK_Aop_64;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]   = Bop_15_KtoK_Aop_64;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA5551)] = Bop_15_KtoK_Aop_64;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)] = Bop_12_KtoK_Aop_64;
+     Bop_PFI_KtoK_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]   = Bop_12_KtoK_Aop_64;
+/********************************* Bop_PFI_Sto_Aop_PFI ****************************/
+     Bop_PFI_Sto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)] = Bop_16_Sto_Aop_64;
+     Bop_PFI_Sto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]    = Bop_16_Sto_Aop_64;
+     Bop_PFI_Sto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB2554)] = Bop_16_Sto_Aop_64;
+     Bop_PFI_Sto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)] = Bop_16_Sto_Aop_64;
+     Bop_PFI_Sto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA4444)] = Bop_16_Sto_Aop_64;
+     Bop_PFI_Sto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]   = Bop_16_Sto_Aop_64;
+     Bop_PFI_Sto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]   = Bop_16_Sto_Aop_64;
+     Bop_PFI_Sto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]   = Bop_16_Sto_Aop_64;
+     Bop_PFI_Sto_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGBA5551)] = Bop_16_Sto_Aop_64;
+/********************************* Bop_PFI_blend_coloralpha_Aop_PFI ***************/
+     Bop_PFI_blend_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)]    = Bop_rgb16_blend_coloralpha_Aop_64;
+     Bop_PFI_blend_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB1555)] = Bop_argb1555_blend_coloralpha_Aop_64;
+     Bop_PFI_blend_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB555)]   = Bop_rgb555_blend_coloralpha_Aop_64;
+     Bop_PFI_blend_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_BGR555)]   = Bop_bgr555_blend_coloralpha_Aop_64;
+     Bop_PFI_blend_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_ARGB4444)] = Bop_argb4444_blend_coloralpha_Aop_64;
+     Bop_PFI_blend_coloralpha_Aop_PFI[DFB_PIXELFORMAT_INDEX(DSPF_RGB444)]   = Bop_rgb444_blend_coloralpha_Aop_64;
+}
+
 #ifdef WORDS_BIGENDIAN
 
 /*
@@ -9854,9 +11165,7 @@ gGetDriverInfo( GraphicsDriverInfo *driver_info )
 {
      snprintf( driver_info->name, DFB_GRAPHICS_DRIVER_INFO_NAME_LENGTH, "Software Driver" );
 
-#if SIZEOF_LONG == 8
      gInit_64bit();
-#endif
 
 #ifdef WORDS_BIGENDIAN
      gInit_BigEndian();
@@ -9888,6 +11197,32 @@ gGetDriverInfo( GraphicsDriverInfo *driver_info )
      }
 #endif
 
+#ifdef USE_SSE2
+     __builtin_cpu_init();
+
+     if (!dfb_config->sse2) {
+          D_INFO( "DirectFB/Genefx: SSE2 disabled by option 'no-sse2'\n" );
+     }
+     else if (__builtin_cpu_supports( "sse2" )) {
+          gInit_SSE2();
+
+          snprintf( driver_info->name, DFB_GRAPHICS_DRIVER_INFO_NAME_LENGTH, "SSE2 Software Driver" );
+
+          D_INFO( "DirectFB/Genefx: SSE2 enabled\n" );
+
+          if (!dfb_config->avx2) {
+               D_INFO( "DirectFB/Genefx: AVX2 disabled by option 'no-avx2'\n" );
+          }
+          else if (__builtin_cpu_supports( "avx2" )) {
+               gInit_AVX2();
+
+               snprintf( driver_info->name, DFB_GRAPHICS_DRIVER_INFO_NAME_LENGTH, "AVX2 Software Driver" );
+
+               D_INFO( "DirectFB/Genefx: AVX2 enabled\n" );
+          }
+     }
+#endif
+
      snprintf( driver_info->vendor, DFB_GRAPHICS_DRIVER_INFO_VENDOR_LENGTH, "DirectFB" );
 
      driver_info->version.major = 0;
@@ -9933,36 +11268,128 @@ gAcquireCheck( CardState           *state,
           return false;
      }
 
-     if (!state->gfxs) {
-          gfxs = D_CALLOC( 1, sizeof(GenefxState) );
-          if (!gfxs) {
-               D_ERROR( "DirectFB/Genefx: Could not allocate Genefx state!\n" );
-               return false;
-          }
+     if (!state->gfxs) {
+          gfxs = D_CALLOC( 1, sizeof(GenefxState) );
+          if (!gfxs) {
+               D_ERROR( "DirectFB/Genefx: Could not allocate Genefx state!\n" );
+               return false;
+          }
+
+          state->gfxs = gfxs;
+     }
+
+     gfxs = state->gfxs;
+
+     /* Destination may have been destroyed. */
+     if (!destination)
+          return false;
+
+     /* Destination buffer may have been destroyed (suspended), i.e. by vt-switching. */
+     if (destination->num_buffers == 0)
+          return false;
+
+     /* Source may have been destroyed. */
+     if (DFB_BLITTING_FUNCTION( accel )) {
+          if (!source)
+               return false;
+
+          if (state->blittingflags & (DSBLIT_SRC_MASK_ALPHA | DSBLIT_SRC_MASK_COLOR)) {
+               if (!source_mask)
+                    return false;
+          }
+     }
+
+     return true;
+}
+
+/* states with buffer locks kept by gRelease(), see gReleaseIdleLocks() */
+static DirectMutex  locked_lock   = DIRECT_MUTEX_INITIALIZER();
+static CardState   *locked_states = NULL;
+
+static void
+gLockedStatesAdd( CardState *state )
+{
+     direct_mutex_lock( &locked_lock );
+
+     state->gfxs->locked_next = locked_states;
+     locked_states            = state;
+
+     direct_mutex_unlock( &locked_lock );
+}
+
+static void
+gLockedStatesRemove( CardState *state )
+{
+     CardState **link;
+
+     direct_mutex_lock( &locked_lock );
+
+     for (link = &locked_states; *link; link = &(*link)->gfxs->locked_next) {
+          if (*link == state) {
+               *link = state->gfxs->locked_next;
+               break;
+          }
+     }
+
+     state->gfxs->locked_next = NULL;
+
+     direct_mutex_unlock( &locked_lock );
+}
+
+/*
+ * Check if a lock kept by gRelease() still holds the buffer that would be locked now, with the allocation being the
+ * only and up to date one, not involved in hardware operations.
+ */
+static bool
+gKeptLockValid( CoreSurface            *surface,
+                DFBSurfaceBufferRole    role,
+                DFBSurfaceStereoEye     eye,
+                CoreSurfaceAccessFlags  access,
+                CoreSurfaceBufferLock  *lock )
+{
+     bool                   valid      = false;
+     CoreSurfaceBuffer     *buffer;
+     CoreSurfaceAllocation *allocation = lock->allocation;
+
+     if ((lock->access & access) != access)
+          return false;
+
+     if (dfb_surface_lock( surface ))
+          return false;
+
+     if (surface->num_buffers > 0) {
+          buffer = dfb_surface_get_buffer3( surface, role, eye, surface->flips );
+
+          valid = buffer == lock->buffer && buffer == allocation->buffer &&
+                  fusion_vector_size( &buffer->allocs ) == 1 &&
+                  direct_serial_check( &allocation->serial, &buffer->serial ) &&
+                  !allocation->accessed[CSAID_GPU];
+     }
+
+     dfb_surface_unlock( surface );
 
-          state->gfxs = gfxs;
-     }
+     return valid;
+}
 
-     gfxs = state->gfxs;
+static bool
+gAcquireKeptLocks( CardState              *state,
+                   DFBAccelerationMask     accel,
+                   CoreSurfaceAccessFlags  access )
+{
+     bool source = DFB_BLITTING_FUNCTION( accel );
+     bool mask   = source && (state->blittingflags & (DSBLIT_SRC_MASK_ALPHA | DSBLIT_SRC_MASK_COLOR));
 
-     /* Destination may have been destroyed. */
-     if (!destination)
+     if (source != !!(state->flags & CSF_SOURCE_LOCKED) || mask != !!(state->flags & CSF_SOURCE_MASK_LOCKED))
           return false;
 
-     /* Destination buffer may have been destroyed (suspended), i.e. by vt-switching. */
-     if (destination->num_buffers == 0)
+     if (!gKeptLockValid( state->destination, state->to, state->to_eye, access, &state->dst ))
           return false;
 
-     /* Source may have been destroyed. */
-     if (DFB_BLITTING_FUNCTION( accel )) {
-          if (!source)
-               return false;
+     if (source && !gKeptLockValid( state->source, state->from, state->from_eye, CSAF_READ, &state->src ))
+          return false;
 
-          if (state->blittingflags & (DSBLIT_SRC_MASK_ALPHA | DSBLIT_SRC_MASK_COLOR)) {
-               if (!source_mask)
-                    return false;
-          }
-     }
+     if (mask && !gKeptLockValid( state->source_mask, state->from, state->from_eye, CSAF_READ, &state->src_mask ))
+          return false;
 
      return true;
 }
@@ -9991,6 +11418,14 @@ gAcquireLockBuffers( CardState           *state,
      else if (state->drawingflags & (DSDRAW_BLEND | DSDRAW_DST_COLORKEY))
           access |= CSAF_READ;
 
+     /* Reuse the locks of the previous operation if they still apply, otherwise start over. */
+     if (state->gfxs->locked) {
+          if (gAcquireKeptLocks( state, accel, access ))
+               return DFB_OK;
+
+          gReleaseLocks( state );
+     }
+
      /* Lock destination. */
      ret = dfb_surface_lock_buffer2( destination, state->to, destination->flips, state->to_eye, CSAID_CPU, access,
                                      &state->dst );
@@ -10046,6 +11481,12 @@ gAcquireLockBuffers( CardState           *state,
 static DFBResult
 gAcquireUnlockBuffers( CardState *state )
 {
+     if (state->gfxs->locked) {
+          state->gfxs->locked = false;
+
+          gLockedStatesRemove( state );
+     }
+
      dfb_surface_unlock_buffer( state->destination, &state->dst );
 
      if (state->flags & CSF_SOURCE_LOCKED) {
@@ -10063,6 +11504,287 @@ gAcquireUnlockBuffers( CardState *state )
      return DFB_OK;
 }
 
+/**********************************************************************************************************************/
+
+#define GENEFX_PIPELINE_CACHE_SIZE 16
+
+/*
+ * State bits the function chain and its constants are computed from, per operation addresses are not included.
+ */
+typedef struct {
+     DFBAccelerationMask      accel;
+
+     DFBSurfacePixelFormat    dst_format;
+     DFBSurfaceColorSpace     dst_colorspace;
+     DFBSurfacePixelFormat    src_format;
+     DFBSurfaceColorSpace     src_colorspace;
+     DFBSurfacePixelFormat    mask_format;
+
+     DFBSurfaceDrawingFlags   drawingflags;
+     DFBSurfaceBlittingFlags  blittingflags;
+     DFBSurfaceBlendFunction  src_blend;
+     DFBSurfaceBlendFunction  dst_blend;
+
+     DFBColor                 color;
+     u32                      src_colorkey;
+     u32                      dst_colorkey;
+
+     DFBSurfaceRenderOptions  render_options;
+} GenefxPipelineKey;
+
+struct _GenefxPipeline {
+     bool                     valid;
+     GenefxPipelineKey        key;
+
+     GenefxFunc               funcs[32];
+     bool                     need_accumulator;
+     bool                     Sop_is_Bop;
+
+     DFBColor                 color;
+     u32                      Cop;
+     u8                       YCop;
+     u8                       CbCop;
+     u8                       CrCop;
+     u32                      Dkey;
+     u32                      Skey;
+     GenefxAccumulator        Cacc;
+     GenefxAccumulator        SCacc;
+     GenefxSrcOverFlags       srcover_flags;
+};
+
+static unsigned int pipeline_hits;
+static unsigned int pipeline_misses;
+
+/*
+ * Build the cache key, returns false if the pipeline depends on palettes or index translation and can't be cached.
+ * The coefficients derived from the source color matrix and convolution filter are not part of the key either.
+ */
+static bool
+gPipelineKey( CardState               *state,
+              DFBAccelerationMask      accel,
+              DFBSurfaceBlittingFlags  blittingflags,
+              GenefxPipelineKey       *key )
+{
+     CoreSurface *destination = state->destination;
+
+     if (DFB_PIXELFORMAT_IS_INDEXED( destination->config.format ))
+          return false;
+
+     memset( key, 0, sizeof(GenefxPipelineKey) );
+
+     key->accel          = accel;
+     key->dst_format     = destination->config.format;
+     key->dst_colorspace = destination->config.colorspace;
+     key->src_blend      = state->src_blend;
+     key->dst_blend      = state->dst_blend;
+     key->color          = state->color;
+
+     if (DFB_BLITTING_FUNCTION( accel )) {
+          CoreSurface *source = state->source;
+
+          if (DFB_PIXELFORMAT_IS_INDEXED( source->config.format ))
+               return false;
+
+          if (blittingflags & (DSBLIT_SRC_COLORMATRIX | DSBLIT_SRC_CONVOLUTION))
+               return false;
+
+          key->src_format     = source->config.format;
+          key->src_colorspace = source->config.colorspace;
+          key->blittingflags  = blittingflags;
+          key->src_colorkey   = state->src_colorkey;
+          key->dst_colorkey   = state->dst_colorkey;
+          key->render_options = state->render_options & (DSRO_SMOOTH_UPSCALE | DSRO_SMOOTH_DOWNSCALE);
+
+          if (blittingflags & (DSBLIT_SRC_MASK_ALPHA | DSBLIT_SRC_MASK_COLOR))
+               key->mask_format = state->source_mask->config.format;
+     }
+     else {
+          key->drawingflags = state->drawingflags;
+          key->dst_colorkey = state->dst_colorkey;
+     }
+
+     return true;
+}
+
+static unsigned int
+gPipelineHash( const GenefxPipelineKey *key )
+{
+     const u32    *data = (const u32*) key;
+     unsigned int  i;
+     u32           hash = 0x811c9dc5;
+
+     for (i = 0; i < sizeof(GenefxPipelineKey) / 4; i++)
+          hash = (hash ^ data[i]) * 0x01000193;
+
+     return (hash ^ (hash >> 16)) % GENEFX_PIPELINE_CACHE_SIZE;
+}
+
+/*
+ * Restore the function chain and its constants from the cache, returns false on a miss.
+ */
+static bool
+gPipelineRestore( GenefxState             *gfxs,
+                  const GenefxPipelineKey *key,
+                  unsigned int             hash )
+{
+     const GenefxPipeline *pipeline;
+
+     if (!gfxs->pipelines)
+          return false;
+
+     pipeline = &gfxs->pipelines[hash];
+
+     if (!pipeline->valid || memcmp( &pipeline->key, key, sizeof(GenefxPipelineKey) ))
+          return false;
+
+     direct_memcpy( gfxs->funcs, pipeline->funcs, sizeof(gfxs->funcs) );
+
+     gfxs->need_accumulator = pipeline->need_accumulator;
+
+     if (pipeline->Sop_is_Bop)
+          gfxs->Sop = gfxs->Bop;
+
+     gfxs->color         = pipeline->color;
+     gfxs->Cop           = pipeline->Cop;
+     gfxs->YCop          = pipeline->YCop;
+     gfxs->CbCop         = pipeline->CbCop;
+     gfxs->CrCop         = pipeline->CrCop;
+     gfxs->Dkey          = pipeline->Dkey;
+     gfxs->Skey          = pipeline->Skey;
+     gfxs->Cacc          = pipeline->Cacc;
+     gfxs->SCacc         = pipeline->SCacc;
+     gfxs->srcover_flags = pipeline->srcover_flags;
+
+     return true;
+}
+
+static void
+gPipelineStore( GenefxState             *gfxs,
+                const GenefxPipelineKey *key,
+                unsigned int             hash )
+{
+     GenefxPipeline *pipeline;
+
+     if (!gfxs->pipelines) {
+          gfxs->pipelines = D_CALLOC( GENEFX_PIPELINE_CACHE_SIZE, sizeof(GenefxPipeline) );
+          if (!gfxs->pipelines)
+               return;
+     }
+
+     pipeline = &gfxs->pipelines[hash];
+
+     pipeline->valid = true;
+     pipeline->key   = *key;
+
+     direct_memcpy( pipeline->funcs, gfxs->funcs, sizeof(gfxs->funcs) );
+
+     pipeline->need_accumulator = gfxs->need_accumulator;
+     pipeline->Sop_is_Bop       = gfxs->Sop == gfxs->Bop;
+     pipeline->color            = gfxs->color;
+     pipeline->Cop              = gfxs->Cop;
+     pipeline->YCop             = gfxs->YCop;
+     pipeline->CbCop            = gfxs->CbCop;
+     pipeline->CrCop            = gfxs->CrCop;
+     pipeline->Dkey             = gfxs->Dkey;
+     pipeline->Skey             = gfxs->Skey;
+     pipeline->Cacc             = gfxs->Cacc;
+     pipeline->SCacc            = gfxs->SCacc;
+     pipeline->srcover_flags    = gfxs->srcover_flags;
+}
+
+void
+gGetPipelineCacheStats( unsigned int *ret_hits,
+                        unsigned int *ret_misses )
+{
+     D_ASSERT( ret_hits != NULL );
+     D_ASSERT( ret_misses != NULL );
+
+     *ret_hits   = pipeline_hits;
+     *ret_misses = pipeline_misses;
+}
+
+/**********************************************************************************************************************/
+
+/*
+ * Convert the 16.16 color matrix, returns the stage applying it.
+ */
+static GenefxFunc
+gSetupColorMatrix( GenefxState *gfxs,
+                   const s32   *matrix )
+{
+     int i;
+
+     gfxs->CMwide = false;
+
+     /* 4.12 coefficients for everything but the translation must fit into 16 bits. */
+     for (i = 0; i < 12; i++) {
+          if ((i & 3) != 3 && (matrix[i] >= 0x7fff8 || matrix[i] < -0x80000))
+               gfxs->CMwide = true;
+     }
+
+     for (i = 0; i < 12; i++) {
+          if (gfxs->CMwide)
+               gfxs->CMcoef[i] = matrix[i];
+          else if ((i & 3) == 3)
+               gfxs->CMcoef[i] = matrix[i] >> 4;
+          else
+               gfxs->CMcoef[i] = (matrix[i] + 8) >> 4;
+     }
+
+     return gfxs->CMwide ? Dacc_colormatrix_wide : Dacc_colormatrix;
+}
+
+/*
+ * Scale the kernel and check if it can be applied as a horizontal and a vertical pass.
+ */
+static void
+gSetupConvolution( GenefxState                *gfxs,
+                   const DFBConvolutionFilter *filter )
+{
+     int  i, j;
+     int  p         = 0;
+     bool separable = true;
+     s32 *c         = gfxs->Kcoef;
+
+     for (i = 0; i < 9; i++) {
+          long long v = ((long long) filter->kernel[i] * filter->scale) >> 16;
+
+          c[i] = CLAMP( v, -0x7fffffffLL, 0x7fffffffLL );
+
+          if (ABS( (long long) c[i] ) > ABS( (long long) c[p] ))
+               p = i;
+     }
+
+     gfxs->Kbias      = filter->bias;
+     gfxs->Ksymmetric = false;
+
+     if (!c[p])
+          return;
+
+     /* The kernel is the product of a column and a row if all 2x2 minors with the pivot element vanish. */
+     for (i = 0; i < 3 && separable; i++) {
+          for (j = 0; j < 3; j++) {
+               if ((long long) c[i*3+j] * c[p] != (long long) c[i*3+p%3] * c[p/3*3+j]) {
+                    separable = false;
+                    break;
+               }
+          }
+     }
+
+     if (!separable)
+          return;
+
+     for (i = 0; i < 3; i++) {
+          gfxs->Kh[i] = c[p/3*3+i];
+          gfxs->Kv[i] = ((long long) c[i*3+p%3] << 16) / c[p];
+     }
+
+     /* The separable implementation adds mirrored taps first, so both passes have to be symmetric. */
+     gfxs->Ksymmetric = gfxs->Kh[0] == gfxs->Kh[2] && c[p%3] == c[6+p%3];
+}
+
+/**********************************************************************************************************************/
+
 static bool
 gAcquireSetup( CardState           *state,
                DFBAccelerationMask  accel )
@@ -10079,6 +11801,9 @@ gAcquireSetup( CardState           *state,
      bool                     dst_ycbcr            = false;
      DFBSurfaceBlittingFlags  simpld_blittingflags = state->blittingflags;
      u16                      ca;
+     GenefxPipelineKey        key;
+     unsigned int             hash                 = 0;
+     bool                     cacheable;
 
      dfb_simplify_blittingflags( &simpld_blittingflags );
 
@@ -10154,6 +11879,7 @@ gAcquireSetup( CardState           *state,
           CoreSurface *source_mask = state->source_mask;
 
           gfxs->src_caps         = source->config.caps;
+          gfxs->src_width        = source->config.size.w;
           gfxs->src_height       = source->config.size.h;
           gfxs->src_format       = source->config.format;
           gfxs->src_bpp          = DFB_BYTES_PER_PIXEL( gfxs->src_format );
@@ -10254,6 +11980,26 @@ gAcquireSetup( CardState           *state,
           }
      }
 
+     /*
+      * Pipeline setup
+      */
+
+     gfxs->Astep = gfxs->Bstep = gfxs->Ostep = 1;
+
+     gfxs->need_convolution = false;
+
+     cacheable = gPipelineKey( state, accel, simpld_blittingflags, &key );
+     if (cacheable) {
+          hash = gPipelineHash( &key );
+
+          if (gPipelineRestore( gfxs, &key, hash )) {
+               D_SYNC_ADD_AND_FETCH( &pipeline_hits, 1 );
+               goto out;
+          }
+
+          D_SYNC_ADD_AND_FETCH( &pipeline_misses, 1 );
+     }
+
      /* Premultiply source (color). */
      if (DFB_DRAWING_FUNCTION(accel) && (state->drawingflags & DSDRAW_SRC_PREMULTIPLY)) {
           ca = color.a + 1;
@@ -10485,8 +12231,6 @@ gAcquireSetup( CardState           *state,
 
      gfxs->need_accumulator = true;
 
-     gfxs->Astep = gfxs->Bstep = gfxs->Ostep = 1;
-
      switch (accel) {
           case DFXL_FILLRECTANGLE:
           case DFXL_DRAWRECTANGLE:
@@ -10520,6 +12264,14 @@ gAcquireSetup( CardState           *state,
                                    *funcs++ = Cop_to_Aop_PFI[dst_pfi];
                               break;
                          }
+                         else if (state->drawingflags == DSDRAW_BLEND &&
+                                  state->src_blend == DSBF_SRCALPHA && state->dst_blend == DSBF_INVSRCALPHA &&
+                                  Cop_blend_coloralpha_Aop_PFI[dst_pfi]) {
+                              gfxs->need_accumulator = false;
+
+                              *funcs++ = Cop_blend_coloralpha_Aop_PFI[dst_pfi];
+                              break;
+                         }
                     }
 
                     /* Load from destination. */
@@ -10705,6 +12457,16 @@ gAcquireSetup( CardState           *state,
                }
                break;
           case DFXL_BLIT:
+               if (simpld_blittingflags == DSBLIT_BLEND_COLORALPHA &&
+                   state->src_blend == DSBF_SRCALPHA &&
+                   state->dst_blend == DSBF_INVSRCALPHA) {
+                    if (gfxs->src_format == gfxs->dst_format && Bop_PFI_blend_coloralpha_Aop_PFI[dst_pfi]) {
+                         gfxs->need_accumulator = false;
+
+                         *funcs++ = Bop_PFI_blend_coloralpha_Aop_PFI[dst_pfi];
+                         break;
+                    }
+               }
                if (simpld_blittingflags == DSBLIT_BLEND_ALPHACHANNEL &&
                    state->src_blend == DSBF_SRCALPHA &&
                    state->dst_blend == DSBF_INVSRCALPHA) {
@@ -10750,6 +12512,40 @@ gAcquireSetup( CardState           *state,
                          break;
                     }
                }
+               if ((simpld_blittingflags & (DSBLIT_BLEND_ALPHACHANNEL | DSBLIT_BLEND_COLORALPHA)) &&
+                   !(simpld_blittingflags & ~(DSBLIT_BLEND_ALPHACHANNEL | DSBLIT_BLEND_COLORALPHA |
+                                              DSBLIT_COLORIZE | DSBLIT_SRC_PREMULTIPLY)) &&
+                   (state->src_blend == DSBF_ONE || state->src_blend == DSBF_SRCALPHA) &&
+                   state->dst_blend == DSBF_INVSRCALPHA) {
+                    if (gfxs->src_format == DSPF_ARGB && Bop_argb_srcover_Aop_PFI[dst_pfi]) {
+                         gfxs->srcover_flags = GSOF_NONE;
+
+                         if (simpld_blittingflags & DSBLIT_COLORIZE)
+                              gfxs->srcover_flags |= GSOF_COLORIZE;
+
+                         if (!(simpld_blittingflags & DSBLIT_BLEND_ALPHACHANNEL))
+                              gfxs->srcover_flags |= GSOF_ALPHA_COLOR;
+                         else if (simpld_blittingflags & DSBLIT_BLEND_COLORALPHA)
+                              gfxs->srcover_flags |= GSOF_ALPHA_MOD;
+
+                         if (simpld_blittingflags & DSBLIT_SRC_PREMULTIPLY)
+                              gfxs->srcover_flags |= GSOF_PREMULTIPLY;
+
+                         if (state->src_blend == DSBF_SRCALPHA)
+                              gfxs->srcover_flags |= GSOF_SRCALPHA;
+
+                         /* Modulation source. */
+                         gfxs->Cacc.RGB.a = color.a + 1;
+                         gfxs->Cacc.RGB.r = color.r + 1;
+                         gfxs->Cacc.RGB.g = color.g + 1;
+                         gfxs->Cacc.RGB.b = color.b + 1;
+
+                         gfxs->need_accumulator = false;
+
+                         *funcs++ = Bop_argb_srcover_Aop_PFI[dst_pfi];
+                         break;
+                    }
+               }
 #ifndef WORDS_BIGENDIAN
                if (simpld_blittingflags       == DSBLIT_NOFX &&
                    source->config.format      == DSPF_RGB24 &&
@@ -10767,10 +12563,40 @@ gAcquireSetup( CardState           *state,
                /* fall through */
           case DFXL_TEXTRIANGLES:
           case DFXL_STRETCHBLIT: {
-               int modulation = simpld_blittingflags & MODULATION_FLAGS;
+               int  modulation     = simpld_blittingflags & MODULATION_FLAGS;
+               bool smooth_texture = false;
+
+               /* Bilinear texture lookups, the color key still applies to the nearest texel only. */
+               if (accel == DFXL_TEXTRIANGLES                                              &&
+                   (state->render_options & (DSRO_SMOOTH_UPSCALE | DSRO_SMOOTH_DOWNSCALE)) &&
+                   !(simpld_blittingflags & DSBLIT_SRC_COLORKEY))
+                    smooth_texture = Sop_PFI_TEX_smooth_to_Dacc[src_pfi] != NULL;
+
+#ifndef WORDS_BIGENDIAN
+               if (simpld_blittingflags == DSBLIT_NOFX && accel != DFXL_TEXTRIANGLES &&
+                   (gfxs->dst_format == DSPF_ARGB || gfxs->dst_format == DSPF_RGB32)) {
+                    GenefxFunc func = NULL;
+
+                    if (source->config.colorspace == DSCS_BT601)
+                         func = (accel == DFXL_BLIT) ? Bop_PFI_to_Aop_rgb32_BT601[src_pfi] :
+                                                       Bop_PFI_Sto_Aop_rgb32_BT601[src_pfi];
+                    else if (source->config.colorspace == DSCS_BT709)
+                         func = (accel == DFXL_BLIT) ? Bop_PFI_to_Aop_rgb32_BT709[src_pfi] :
+                                                       Bop_PFI_Sto_Aop_rgb32_BT709[src_pfi];
+
+                    if (func) {
+                         /* Stretching converts the source span into the accumulator memory. */
+                         gfxs->need_accumulator = (accel == DFXL_STRETCHBLIT);
+
+                         *funcs++ = func;
+                         break;
+                    }
+               }
+#endif
 
                if (modulation                                                                   ||
-                   (accel == DFXL_TEXTRIANGLES && (src_pfi != dst_pfi || simpld_blittingflags)) ||
+                   (accel == DFXL_TEXTRIANGLES &&
+                    (src_pfi != dst_pfi || simpld_blittingflags || smooth_texture))             ||
                    (simpld_blittingflags & (DSBLIT_SRC_MASK_ALPHA | DSBLIT_SRC_MASK_COLOR))     ||
                    ((simpld_blittingflags & DSBLIT_ROTATE90) && accel == DFXL_STRETCHBLIT)) {
                     bool read_destination         = false;
@@ -10799,6 +12625,19 @@ gAcquireSetup( CardState           *state,
 
                     scale_from_accumulator = !read_destination && (accel == DFXL_STRETCHBLIT);
 
+                    /* Convolution works on packed source formats, read in lines of the original size. */
+                    if (simpld_blittingflags & DSBLIT_SRC_CONVOLUTION) {
+                         if ((accel == DFXL_BLIT || scale_from_accumulator)    &&
+                             Sop_PFI_to_Dacc[src_pfi]                          &&
+                             !DFB_PLANAR_PIXELFORMAT( gfxs->src_format )       &&
+                             !DFB_PIXELFORMAT_ALIGNMENT( gfxs->src_format )    &&
+                             gfxs->src_bpp                                     &&
+                             !(gfxs->src_caps & DSCAPS_SEPARATED))
+                              gfxs->need_convolution = true;
+                         else
+                              D_ONCE( "source convolution not supported with this source format or operation" );
+                    }
+
                     /* Read the destination if needed. */
                     if (read_destination) {
                          *funcs++ = Sop_is_Aop;
@@ -10834,10 +12673,27 @@ gAcquireSetup( CardState           *state,
 
                               *funcs++ = Sop_PFI_TEX_Kto_Dacc[src_pfi];
                          }
+                         else if (smooth_texture) {
+                              *funcs++ = Sop_PFI_TEX_smooth_to_Dacc[src_pfi];
+                         }
                          else {
                               *funcs++ = Sop_PFI_TEX_to_Dacc[src_pfi];
                          }
                     }
+                    else if (gfxs->need_convolution) {
+                         /* Unscaled source spans are convolved while converting them. */
+                         gSetupConvolution( gfxs, &state->src_convolution );
+
+                         gfxs->Kload = Sop_PFI_to_Dacc[src_pfi];
+                         gfxs->Kkey  = NULL;
+
+                         if (simpld_blittingflags & DSBLIT_SRC_COLORKEY) {
+                              gfxs->Skey = state->src_colorkey;
+                              gfxs->Kkey = Sop_PFI_Kto_Dacc[src_pfi];
+                         }
+
+                         *funcs++ = Sop_convolve_to_Dacc;
+                    }
                     else {
                          if (simpld_blittingflags & DSBLIT_SRC_COLORKEY) {
                               gfxs->Skey = state->src_colorkey;
@@ -10863,6 +12719,10 @@ gAcquireSetup( CardState           *state,
                               *funcs++ = Dacc_YCbCr_to_RGB_BT2020;
                     }
 
+                    /* Transform the source colors if requested. */
+                    if (simpld_blittingflags & DSBLIT_SRC_COLORMATRIX)
+                         *funcs++ = gSetupColorMatrix( gfxs, state->src_colormatrix );
+
                     /* Premultiply color alpha. */
                     if (simpld_blittingflags & DSBLIT_SRC_PREMULTCOLOR) {
                          gfxs->Cacc.RGB.a = color.a + 1;
@@ -11151,6 +13011,10 @@ gAcquireSetup( CardState           *state,
 
      *funcs = NULL;
 
+     if (cacheable)
+          gPipelineStore( gfxs, &key, hash );
+
+out:
      dfb_state_update( state, state->flags & CSF_SOURCE_LOCKED );
 
      return true;
@@ -11161,14 +13025,24 @@ gAcquire( CardState           *state,
           DFBAccelerationMask  accel )
 {
      DFBResult ret;
+     bool      queue;
 
      if (!gAcquireCheck( state, accel ))
           return false;
 
+     queue = Genefx_Queue_Enabled();
+
      /* Push our own identity for buffer locking calls (locality of accessor). */
      Core_PushIdentity( 0 );
 
+     if (queue)
+          Genefx_Queue_Locking( true );
+
      ret = gAcquireLockBuffers( state, accel );
+
+     if (queue)
+          Genefx_Queue_Locking( false );
+
      if (ret) {
           Core_PopIdentity();
           return false;
@@ -11180,13 +13054,118 @@ gAcquire( CardState           *state,
           return false;
      }
 
+     if (dfb_config->software_stats)
+          Genefx_Stats_Begin( state, accel );
+     else if (queue)
+          Genefx_Queue_Begin( state );
+
      return true;
 }
 
 void
 gRelease( CardState *state )
 {
-     gAcquireUnlockBuffers( state );
+     Genefx_Stats_End( state );
+
+     Genefx_Queue_End( state );
+
+     /* Keep the buffers locked for the next operation, see gReleaseLocks(). */
+     if (!state->gfxs->locked) {
+          state->gfxs->locked = true;
+
+          gLockedStatesAdd( state );
+     }
+
+     state->gfxs->locked_used = true;
+
+     Core_PopIdentity();
+}
+
+static void
+gUnlockKeptBuffers( CardState *state )
+{
+     /* Push our own identity for buffer locking calls (locality of accessor). */
+     Core_PushIdentity( 0 );
+
+     /* The surfaces may have been released already, the locks are sufficient for unlocking. */
+     dfb_surface_buffer_unlock( &state->dst );
+
+     if (state->flags & CSF_SOURCE_LOCKED) {
+          dfb_surface_buffer_unlock( &state->src );
+
+          state->flags &= ~CSF_SOURCE_LOCKED;
+     }
+
+     if (state->flags & CSF_SOURCE_MASK_LOCKED) {
+          dfb_surface_buffer_unlock( &state->src_mask );
+
+          state->flags &= ~CSF_SOURCE_MASK_LOCKED;
+     }
 
      Core_PopIdentity();
 }
+
+void
+gReleaseLocks( CardState *state )
+{
+     GenefxState *gfxs = state->gfxs;
+
+     if (!gfxs || !gfxs->locked)
+          return;
+
+     gfxs->locked = false;
+
+     gLockedStatesRemove( state );
+
+     gUnlockKeptBuffers( state );
+}
+
+void
+gReleaseIdleLocks( void )
+{
+     CardState  **link;
+     CardState   *state;
+     CardState   *idle = NULL;
+
+     direct_mutex_lock( &locked_lock );
+
+     link = &locked_states;
+
+     while ((state = *link) != NULL) {
+          GenefxState *gfxs = state->gfxs;
+
+          /* A state in use by another thread is not idle. */
+          if (direct_mutex_trylock( &state->lock )) {
+               link = &gfxs->locked_next;
+               continue;
+          }
+
+          if (gfxs->locked_used) {
+               gfxs->locked_used = false;
+
+               dfb_state_unlock( state );
+
+               link = &gfxs->locked_next;
+               continue;
+          }
+
+          /* Take the state off the list, it stays locked until its buffers are unlocked below. */
+          *link = gfxs->locked_next;
+
+          gfxs->locked      = false;
+          gfxs->locked_next = idle;
+          idle              = state;
+     }
+
+     direct_mutex_unlock( &locked_lock );
+
+     while ((state = idle) != NULL) {
+          idle = state->gfxs->locked_next;
+
+          state->gfxs->locked_next = NULL;
+
+          gUnlockKeptBuffers( state );
+
+          dfb_state_unlock( state );
+     }
+}
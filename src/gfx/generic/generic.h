@@ -25,6 +25,25 @@
 
 typedef void (*GenefxFunc)( GenefxState *gfxs );
 
+typedef struct _GenefxPipeline GenefxPipeline;
+
+typedef struct _GenefxScaleTable GenefxScaleTable;
+
+typedef struct _GenefxStats GenefxStats;
+
+typedef struct _GenefxJob GenefxJob;
+
+#define GENEFX_SCALE_TABLES 8
+
+typedef enum {
+     GSOF_NONE        = 0x00000000,  /* plain ARGB source */
+     GSOF_COLORIZE    = 0x00000001,  /* modulate the source color with the color */
+     GSOF_ALPHA_COLOR = 0x00000002,  /* replace the source alpha with the color alpha */
+     GSOF_ALPHA_MOD   = 0x00000004,  /* modulate the source alpha with the color alpha */
+     GSOF_PREMULTIPLY = 0x00000008,  /* premultiply the source color with the resulting alpha */
+     GSOF_SRCALPHA    = 0x00000010   /* source blend function is DSBF_SRCALPHA instead of DSBF_ONE */
+} GenefxSrcOverFlags;
+
 typedef union {
      struct {
           u16 b;
@@ -97,6 +116,7 @@ struct __DFB_GenefxState {
      int                      Mop_field;
 
      int                      AopY;
+     int                      BopX;
      int                      BopY;
      int                      MopY;
 
@@ -147,6 +167,49 @@ struct __DFB_GenefxState {
 
      int                     *trans;
      int                      num_trans;
+
+     GenefxSrcOverFlags       srcover_flags;     /* for fused SrcOver routines only */
+
+     /*
+      * source color matrix and convolution
+      */
+     s32                      CMcoef[12];        /* color matrix, 4.12 (16.16 if CMwide) */
+     bool                     CMwide;            /* coefficients do not fit into 16 bits */
+
+     int                      src_width;
+     GenefxFunc               Kload;             /* loads source lines for the convolution */
+     GenefxFunc               Kkey;              /* loads the center line to mark keyed pixels, or NULL */
+     s32                      Kcoef[9];          /* kernel multiplied by scale, 16.16 */
+     s32                      Kh[3];             /* horizontal factors of a separable kernel, 16.16 */
+     s32                      Kv[3];             /* vertical factors of a separable kernel, 16.16 */
+     s32                      Kbias;
+     bool                     Ksymmetric;        /* kernel is separable and symmetric */
+     bool                     need_convolution;
+     bool                     ABconv;            /* accumulator memory includes the convolution lines */
+     GenefxAccumulator       *Kacc[3];           /* converted source lines, ABsize + 2 each */
+     int                      Kline[3];          /* source line held by each Kacc */
+     int                      Kx;                /* first column held by the Kacc lines */
+     int                      Klen;              /* number of columns held by the Kacc lines */
+     s32                     *Ksum;              /* vertical sums of a separable kernel, 4 per column */
+
+     GenefxPipeline          *pipelines;         /* cache of function chains computed by gAcquireSetup() */
+
+     GenefxScaleTable        *scale_tables[GENEFX_SCALE_TABLES]; /* cache of smooth scaling coefficients */
+
+     GenefxJob               *job;               /* operations recorded for the render thread, see generic_queue.h */
+
+     bool                     locked;            /* buffer locks of the state are kept by gRelease() for reuse */
+     bool                     locked_used;       /* kept buffer locks were used since the last gReleaseIdleLocks() */
+     CardState               *locked_next;       /* next state with kept buffer locks */
+
+     /*
+      * profiling, see generic_stats.h
+      */
+     GenefxStats             *stats;             /* statistics of the acquired pipeline if enabled */
+     unsigned int             stats_calls;
+     unsigned long long       stats_pixels;
+     long long                stats_start;
+     unsigned int             stats_generation;   /* of the table at Genefx_Stats_Begin() */
 };
 
 /**********************************************************************************************************************/
@@ -160,4 +223,20 @@ bool gAcquire      ( CardState           *state,
 
 void gRelease      ( CardState           *state );
 
+/*
+ * Unlock the buffers kept locked by gRelease() for the following operations.
+ */
+void gReleaseLocks ( CardState           *state );
+
+/*
+ * Unlock the buffers kept locked by states that have not been used since the previous call.
+ */
+void gReleaseIdleLocks( void );
+
+/*
+ * Get the number of pipelines restored from the cache and the number of pipelines computed so far.
+ */
+void gGetPipelineCacheStats( unsigned int *ret_hits,
+                             unsigned int *ret_misses );
+
 #endif
@@ -16,6 +16,8 @@
    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
 */
 
+#if SIZEOF_LONG == 8
+
 static void
 Cop_to_Aop_32_64( GenefxState *gfxs )
 {
@@ -46,9 +48,15 @@ Bop_rgb32_toK_Aop_64( GenefxState *gfxs )
      int  w     = gfxs->length;
      u32 *S     = gfxs->Bop[0];
      u32 *D     = gfxs->Aop[0];
-     u32  Dkey  = gfxs->Dkey;
+     u32  Dkey  = gfxs->Dkey & 0x00ffffff;
      u64  DDkey = ((u64) Dkey << 32) | Dkey;
 
+     /* Rotated or backwards blits. */
+     if (gfxs->Astep != 1 || gfxs->Bstep != 1) {
+          Bop_32_toK_Aop( gfxs );
+          return;
+     }
+
      if ((long) D & 4) {
           if ((*D & 0x00ffffff) == Dkey)
                *D = *S;
@@ -98,9 +106,15 @@ Bop_rgb32_Kto_Aop_64( GenefxState *gfxs )
      int  w     = gfxs->length;
      u32 *S     = gfxs->Bop[0];
      u32 *D     = gfxs->Aop[0];
-     u32  Skey  = gfxs->Skey;
+     u32  Skey  = gfxs->Skey & 0x00ffffff;
      u64  DSkey = ((u64) Skey << 32) | Skey;
 
+     /* Rotated or backwards blits. */
+     if (gfxs->Astep != 1 || gfxs->Bstep != 1) {
+          Bop_32_Kto_Aop( gfxs );
+          return;
+     }
+
      if ((long) D & 4) {
           if ((*S & 0x00ffffff) != Skey)
                *D = *S;
@@ -200,3 +214,226 @@ Dacc_xor_64( GenefxState *gfxs )
           D++;
      }
 }
+
+#endif
+
+/**********************************************************************************************************************
+ ********************************* 16 bit formats *********************************************************************
+ **********************************************************************************************************************/
+
+/*
+ * The following functions process four 16 bit pixels per 64 bit word. They are used on 32 bit CPUs as well, which keep
+ * the words in register pairs, as this is the only acceleration for targets without a SIMD unit.
+ */
+
+#define LANES_64(v) ((u64) (v) * 0x0001000100010001ull)
+
+static inline u64
+load_64( const void *p )
+{
+     u64 v;
+
+     memcpy( &v, p, 8 );
+
+     return v;
+}
+
+/*
+ * Return 0xffff in each lane of 'x' equal to the same lane of 'y', zero in the other lanes.
+ */
+static inline u64
+lanes_equal_64( u64 x,
+                u64 y )
+{
+     u64 v = x ^ y;
+
+     v = (((v & 0x7fff7fff7fff7fffull) + 0x7fff7fff7fff7fffull) | v) >> 15;
+
+     return ((v & 0x0001000100010001ull) ^ 0x0001000100010001ull) * 0xffff;
+}
+
+/*
+ * Channels of a pixel expanded to eight bits like in the accumulator, one per 16 bit lane with the alpha in the top
+ * lane, and the truncation of such lanes back to the pixel. The layouts are named after their channel sizes.
+ */
+
+static inline u64
+expand_565_64( u32 p )
+{
+     u32 r = (p >> 11) & 0x1f;
+     u32 g = (p >>  5) & 0x3f;
+     u32 b =  p        & 0x1f;
+
+     return ((u64) ((r << 3) | (r >> 2)) << 32) | (((g << 2) | (g >> 4)) << 16) | ((b << 3) | (b >> 2));
+}
+
+static inline u32
+pack_565_64( u64 v )
+{
+     return ((v >> 24) & 0xf800) | ((v >> 13) & 0x07e0) | ((v >> 3) & 0x001f);
+}
+
+static inline u64
+expand_1555_64( u32 p )
+{
+     u32 r = (p >> 10) & 0x1f;
+     u32 g = (p >>  5) & 0x1f;
+     u32 b =  p        & 0x1f;
+
+     return ((p & 0x8000) ? 0x00ff000000000000ull : 0) |
+            ((u64) ((r << 3) | (r >> 2)) << 32) | (((g << 3) | (g >> 2)) << 16) | ((b << 3) | (b >> 2));
+}
+
+static inline u32
+pack_1555_64( u64 v )
+{
+     return ((v >> 40) & 0x8000) | ((v >> 25) & 0x7c00) | ((v >> 14) & 0x03e0) | ((v >> 3) & 0x001f);
+}
+
+static inline u64
+expand_4444_64( u32 p )
+{
+     u32 a = (p >> 12) & 0xf;
+     u32 r = (p >>  8) & 0xf;
+     u32 g = (p >>  4) & 0xf;
+     u32 b =  p        & 0xf;
+
+     return ((u64) (a * 0x11) << 48) | ((u64) (r * 0x11) << 32) | ((g * 0x11) << 16) | (b * 0x11);
+}
+
+static inline u32
+pack_4444_64( u64 v )
+{
+     return ((v >> 40) & 0xf000) | ((v >> 28) & 0x0f00) | ((v >> 16) & 0x00f0) | ((v >> 4) & 0x000f);
+}
+
+/*
+ * Blending of expanded lanes with the color alpha 'ca' (DSBF_SRCALPHA / DSBF_INVSRCALPHA), rounding and saturating
+ * each channel exactly like the accumulator pipeline. No lane overflows, as 0xff * 0x100 still fits in 16 bits.
+ */
+static inline u64
+blend_lanes_64( u64 s,
+                u64 d,
+                u32 ca )
+{
+     u64 v = ((s * (ca + 1) >> 8) & 0x00ff00ff00ff00ffull) + ((d * (0x100 - ca) >> 8) & 0x00ff00ff00ff00ffull);
+
+     return (v | (((v >> 8) & 0x0001000100010001ull) * 0xff)) & 0x00ff00ff00ff00ffull;
+}
+
+/**********************************************************************************************************************/
+
+static void
+Cop_to_Aop_16_64( GenefxState *gfxs )
+{
+     int  w    = gfxs->length;
+     u16 *D    = gfxs->Aop[0];
+     u16  Cop  = gfxs->Cop;
+     u64  DCop = LANES_64( Cop );
+
+     while (w && ((long) D & 7)) {
+          *D++ = Cop;
+          w--;
+     }
+
+     for (; w >= 4; w -= 4) {
+          *((u64*) D) = DCop;
+          D += 4;
+     }
+
+     while (w--)
+          *D++ = Cop;
+}
+
+static void
+Bop_16_Sto_Aop_64( GenefxState *gfxs )
+{
+     int  w     = gfxs->length;
+     int  i     = gfxs->Xphase;
+     u16 *D     = gfxs->Aop[0];
+     u16 *S     = gfxs->Bop[0];
+     int  SperD = gfxs->SperD;
+
+     while (w && ((long) D & 7)) {
+          *D++ = S[i>>16];
+          i += SperD;
+          w--;
+     }
+
+     for (; w >= 4; w -= 4) {
+          u64 p0 = S[i>>16];
+          u64 p1 = S[(i+SperD)>>16];
+          u64 p2 = S[(i+SperD*2)>>16];
+          u64 p3 = S[(i+SperD*3)>>16];
+
+#ifdef WORDS_BIGENDIAN
+          *((u64*) D) = (p0 << 48) | (p1 << 32) | (p2 << 16) | p3;
+#else
+          *((u64*) D) = (p3 << 48) | (p2 << 32) | (p1 << 16) | p0;
+#endif
+          D += 4;
+          i += SperD << 2;
+     }
+
+     while (w--) {
+          *D++ = S[i>>16];
+          i += SperD;
+     }
+}
+
+/*
+ * Blits and fills blending with the color alpha, the source alpha is replaced by the color alpha like in the
+ * accumulator pipeline. 'layout' selects the expansion, 'mask' the bits stored and 'hi' / 'lo' the color channels of
+ * the upper and lower lanes for fills.
+ */
+#define BLEND_COLORALPHA_64(format,layout,mask,hi,lo)                                                                  \
+                                                                                                                      \
+static void                                                                                                           \
+Bop_##format##_blend_coloralpha_Aop_64( GenefxState *gfxs )                                                           \
+{                                                                                                                     \
+     int  w  = gfxs->length;                                                                                          \
+     u16 *S  = gfxs->Bop[0];                                                                                          \
+     u16 *D  = gfxs->Aop[0];                                                                                          \
+     u32  ca = gfxs->color.a;                                                                                         \
+     u64  Sa = (u64) ca << 48;                                                                                        \
+     int  step = 1;                                                                                                   \
+                                                                                                                      \
+     /* Overlapping blits from right to left. */                                                                      \
+     if (gfxs->Astep < 0) {                                                                                           \
+          S += w - 1;                                                                                                 \
+          D += w - 1;                                                                                                 \
+          step = -1;                                                                                                  \
+     }                                                                                                                \
+                                                                                                                      \
+     while (w--) {                                                                                                    \
+          u64 s = (expand_##layout##_64( *S ) & 0x0000ffffffffffffull) | Sa;                                          \
+                                                                                                                      \
+          *D = pack_##layout##_64( blend_lanes_64( s, expand_##layout##_64( *D ), ca ) ) & (mask);                    \
+                                                                                                                      \
+          S += step;                                                                                                  \
+          D += step;                                                                                                  \
+     }                                                                                                                \
+}                                                                                                                     \
+                                                                                                                      \
+static void                                                                                                           \
+Cop_##format##_blend_coloralpha_Aop_64( GenefxState *gfxs )                                                           \
+{                                                                                                                     \
+     int       w  = gfxs->length;                                                                                     \
+     u16      *D  = gfxs->Aop[0];                                                                                     \
+     DFBColor  c  = gfxs->color;                                                                                      \
+     u64       C  = ((u64) c.a << 48) | ((u64) c.hi << 32) | (c.g << 16) | c.lo;                                      \
+                                                                                                                      \
+     while (w--) {                                                                                                    \
+          *D = pack_##layout##_64( blend_lanes_64( C, expand_##layout##_64( *D ), c.a ) ) & (mask);                   \
+          D++;                                                                                                        \
+     }                                                                                                                \
+}
+
+BLEND_COLORALPHA_64(rgb16,    565,  0xffff, r, b)
+BLEND_COLORALPHA_64(rgb555,   1555, 0x7fff, r, b)
+BLEND_COLORALPHA_64(bgr555,   1555, 0x7fff, b, r)
+BLEND_COLORALPHA_64(argb1555, 1555, 0xffff, r, b)
+BLEND_COLORALPHA_64(argb4444, 4444, 0xffff, r, b)
+BLEND_COLORALPHA_64(rgb444,   4444, 0x0fff, r, b)
+
+#undef BLEND_COLORALPHA_64
@@ -0,0 +1,268 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#include <core/state.h>
+#include <gfx/generic/generic.h>
+#include <gfx/generic/generic_affine_blit.h>
+#include <gfx/generic/generic_queue.h>
+#include <gfx/generic/generic_stats.h>
+#include <gfx/generic/generic_threads.h>
+#include <gfx/generic/generic_util.h>
+
+/**********************************************************************************************************************/
+
+/*
+ * Source coordinates as a linear function of the destination coordinates: s = s0 + sx * X + sy * Y, same for t.
+ */
+typedef struct {
+     DFBRectangle srect;
+
+     double       s0, sx, sy;
+     double       t0, tx, ty;
+} AffineBlitCtx;
+
+/*
+ * Narrow [lo,hi] to the pixel centers for which 'base + k * xc' lies within [min,max).
+ */
+static bool
+affine_limit( double  base,
+              double  k,
+              int     min,
+              int     max,
+              double *lo,
+              double *hi )
+{
+     double a, b;
+
+     if (k > -1e-9 && k < 1e-9)
+          return base >= min && base < max;
+
+     a = (min - base) / k;
+     b = (max - base) / k;
+
+     if (a > b) {
+          double tmp = a;
+
+          a = b;
+          b = tmp;
+     }
+
+     if (*lo < a)
+          *lo = a;
+
+     if (*hi > b)
+          *hi = b;
+
+     return *lo <= *hi;
+}
+
+static inline long long
+affine_floor( double v )
+{
+     long long i = v;
+
+     return i > v ? i - 1 : i;
+}
+
+static inline bool
+affine_inside( const DFBRectangle *srect,
+               long long           s,
+               long long           t )
+{
+     return (s >> 16) >= srect->x && (s >> 16) < srect->x + srect->w &&
+            (t >> 16) >= srect->y && (t >> 16) < srect->y + srect->h;
+}
+
+static void
+affine_blit_render( CardState           *state,
+                    GenefxState         *gfxs,
+                    const AffineBlitCtx *ctx,
+                    const DFBRegion     *area )
+{
+     const DFBRectangle *srect = &ctx->srect;
+     int                 SperD = affine_floor( ctx->sx * 0x10000 + 0.5 );
+     int                 TperD = affine_floor( ctx->tx * 0x10000 + 0.5 );
+     int                 y;
+
+     if (!Genefx_ABacc_prepare( gfxs, area->x2 - area->x1 + 1 ))
+          return;
+
+     /* Reset Bop to 0,0 as texture lookup accesses the whole buffer arbitrarily. */
+     Genefx_Bop_xy( gfxs, 0, 0 );
+
+     for (y = area->y1; y <= area->y2; y++) {
+          double    yc = y + 0.5;
+          double    bs = ctx->s0 + ctx->sy * yc;
+          double    bt = ctx->t0 + ctx->ty * yc;
+          double    lo = area->x1 + 0.5;
+          double    hi = area->x2 + 0.5;
+          int       x1, x2;
+          long long s, t;
+
+          /* Pixel centers mapping into the source rectangle. */
+          if (!affine_limit( bs, ctx->sx, srect->x, srect->x + srect->w, &lo, &hi ) ||
+              !affine_limit( bt, ctx->tx, srect->y, srect->y + srect->h, &lo, &hi ))
+               continue;
+
+          x1 = -affine_floor( 0.5 - lo );
+          x2 = affine_floor( hi - 0.5 );
+
+          if (x1 > x2)
+               continue;
+
+          s = affine_floor( (bs + ctx->sx * (x1 + 0.5)) * 0x10000 );
+          t = affine_floor( (bt + ctx->tx * (x1 + 0.5)) * 0x10000 );
+
+          /* Trim the ends to what the fixed point stepping actually reads. */
+          while (x1 <= x2 && !affine_inside( srect, s, t )) {
+               s += SperD;
+               t += TperD;
+               x1++;
+          }
+
+          while (x1 <= x2 && !affine_inside( srect, s + (long long) SperD * (x2 - x1),
+                                                    t + (long long) TperD * (x2 - x1) ))
+               x2--;
+
+          if (x1 > x2)
+               continue;
+
+          gfxs->Dlen   = x2 - x1 + 1;
+          gfxs->length = gfxs->Dlen;
+          gfxs->SperD  = SperD;
+          gfxs->TperD  = TperD;
+          gfxs->s      = s;
+          gfxs->t      = t;
+
+          GENEFX_STATS_PIXELS( gfxs, gfxs->Dlen );
+
+          Genefx_Aop_xy( gfxs, x1, y );
+
+          RUN_PIPELINE();
+     }
+
+     Genefx_ABacc_flush( gfxs );
+}
+
+static void
+affine_blit_band( CardState       *state,
+                  GenefxState     *gfxs,
+                  const DFBRegion *band,
+                  void            *ctx )
+{
+     affine_blit_render( state, gfxs, ctx, band );
+}
+
+void
+gAffineBlit( CardState    *state,
+             DFBRectangle *srect,
+             DFBRectangle *drect )
+{
+     GenefxState   *gfxs;
+     AffineBlitCtx  ctx;
+     DFBRegion      area;
+     double         a, b, c, d, e, f, det, kx, ky, ix, iy;
+     double         min_x = 1e9, min_y = 1e9;
+     double         max_x = -1e9, max_y = -1e9;
+     int            i;
+
+     D_ASSERT( state != NULL );
+     D_ASSERT( state->gfxs != NULL );
+     D_ASSERT( state->affine_matrix );
+
+     if (Genefx_Queue_AffineBlit( state, srect, drect ))
+          return;
+
+     gfxs = state->gfxs;
+
+     if (dfb_config->software_warn) {
+          D_WARN( "AffineBlit (%4d,%4d-%4dx%4d) %6s, flags 0x%08x, color 0x%02x%02x%02x%02x <- (%4d,%4d-%4dx%4d) %6s",
+                  drect->x, drect->y, drect->w, drect->h, dfb_pixelformat_name( gfxs->dst_format ),
+                  state->blittingflags, state->color.a, state->color.r, state->color.g, state->color.b,
+                  srect->x, srect->y, srect->w, srect->h, dfb_pixelformat_name( gfxs->src_format ) );
+     }
+
+     CHECK_PIPELINE();
+
+     GENEFX_STATS_COUNT( gfxs, 0 );
+
+     if (srect->w < 1 || srect->h < 1 || drect->w < 1 || drect->h < 1)
+          return;
+
+     a = state->matrix[0] / 65536.0;
+     b = state->matrix[1] / 65536.0;
+     e = state->matrix[2] / 65536.0;
+     c = state->matrix[3] / 65536.0;
+     d = state->matrix[4] / 65536.0;
+     f = state->matrix[5] / 65536.0;
+
+     det = a * d - b * c;
+     if (det > -1e-9 && det < 1e-9)
+          return;
+
+     /* Bounding box of the transformed destination rectangle. */
+     for (i = 0; i < 4; i++) {
+          double px = drect->x + ((i & 1) ? drect->w : 0);
+          double py = drect->y + ((i & 2) ? drect->h : 0);
+          double x  = a * px + b * py + e;
+          double y  = c * px + d * py + f;
+
+          min_x = MIN( min_x, x );
+          min_y = MIN( min_y, y );
+          max_x = MAX( max_x, x );
+          max_y = MAX( max_y, y );
+     }
+
+     area = state->clip;
+
+     if (min_x > area.x1)
+          area.x1 = affine_floor( min_x );
+
+     if (min_y > area.y1)
+          area.y1 = affine_floor( min_y );
+
+     if (max_x < area.x2)
+          area.x2 = -affine_floor( -max_x );
+
+     if (max_y < area.y2)
+          area.y2 = -affine_floor( -max_y );
+
+     if (area.x1 > area.x2 || area.y1 > area.y2)
+          return;
+
+     /* Invert the matrix and scale from the destination to the source rectangle. */
+     kx = (double) srect->w / drect->w;
+     ky = (double) srect->h / drect->h;
+     ix = (b * f - d * e) / det;
+     iy = (c * e - a * f) / det;
+
+     ctx.srect = *srect;
+
+     ctx.sx = kx *  d / det;
+     ctx.sy = kx * -b / det;
+     ctx.s0 = srect->x + kx * (ix - drect->x);
+
+     ctx.tx = ky * -c / det;
+     ctx.ty = ky *  a / det;
+     ctx.t0 = srect->y + ky * (iy - drect->y);
+
+     if (Genefx_Bands_Run( state, &area, affine_blit_band, &ctx ))
+          return;
+
+     affine_blit_render( state, gfxs, &ctx, &area );
+}
@@ -0,0 +1,35 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#ifndef __GENERIC_AFFINE_BLIT_H__
+#define __GENERIC_AFFINE_BLIT_H__
+
+#include <core/coretypes.h>
+
+/**********************************************************************************************************************/
+
+/*
+ * Blit 'srect' to the rectangle 'drect' transformed by the affine render matrix of the state, sampling the nearest
+ * texel or interpolating bilinearly with DSRO_SMOOTH_UPSCALE or DSRO_SMOOTH_DOWNSCALE.
+ * To be called with a pipeline acquired for DFXL_TEXTRIANGLES.
+ */
+void gAffineBlit( CardState    *state,
+                  DFBRectangle *srect,
+                  DFBRectangle *drect );
+
+#endif
@@ -0,0 +1,438 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#include <immintrin.h>
+
+/*
+ * Same as the SSE2 functions with four accumulators per register, the remaining pixels of a span are handed over to
+ * the SSE2 span helpers.
+ */
+#define AVX2_FUNC __attribute__((target("avx2")))
+
+static inline __m256i AVX2_FUNC
+acc_mask_AVX2( __m256i acc )
+{
+     const __m256i skip = _mm256_set_epi16( 0xf000, 0, 0, 0, 0xf000, 0, 0, 0, 0xf000, 0, 0, 0, 0xf000, 0, 0, 0 );
+     __m256i       mask = _mm256_cmpeq_epi16( _mm256_and_si256( acc, skip ), _mm256_setzero_si256() );
+
+     return _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( mask, 0xff ), 0xff );
+}
+
+static inline __m256i AVX2_FUNC
+acc_alpha_AVX2( __m256i acc )
+{
+     return _mm256_shufflehi_epi16( _mm256_shufflelo_epi16( acc, 0xff ), 0xff );
+}
+
+static inline __m256i AVX2_FUNC
+mul8_AVX2( __m256i a,
+           __m256i b )
+{
+     return _mm256_or_si256( _mm256_slli_epi16( _mm256_mulhi_epu16( a, b ), 8 ),
+                             _mm256_srli_epi16( _mm256_mullo_epi16( a, b ), 8 ) );
+}
+
+static inline __m256i AVX2_FUNC
+select_AVX2( __m256i mask,
+             __m256i a,
+             __m256i b )
+{
+     return _mm256_blendv_epi8( b, a, mask );
+}
+
+/* Saturates eight accumulators to 8 bits and packs them into eight ARGB pixels, 'mask' selects the pixels to write. */
+static inline __m256i AVX2_FUNC
+acc_to_argb_AVX2( const GenefxAccumulator *S,
+                  __m256i                 *mask )
+{
+     const __m256i max = _mm256_set1_epi16( 0xff );
+     __m256i       s0  = _mm256_loadu_si256( (const __m256i*) S );
+     __m256i       s1  = _mm256_loadu_si256( (const __m256i*) (S + 4) );
+
+     /* Packing works within 128 bit lanes, restore the order of the pixels afterwards. */
+     *mask = _mm256_permute4x64_epi64( _mm256_packs_epi16( acc_mask_AVX2( s0 ), acc_mask_AVX2( s1 ) ), 0xd8 );
+
+     s0 = _mm256_sub_epi16( s0, _mm256_subs_epu16( s0, max ) );
+     s1 = _mm256_sub_epi16( s1, _mm256_subs_epu16( s1, max ) );
+
+     return _mm256_permute4x64_epi64( _mm256_packus_epi16( s0, s1 ), 0xd8 );
+}
+
+static inline void AVX2_FUNC
+store_masked_AVX2( void    *D,
+                   __m256i  pixels,
+                   __m256i  mask )
+{
+     int bits = _mm256_movemask_epi8( mask );
+
+     if (bits == -1)
+          _mm256_storeu_si256( D, pixels );
+     else if (bits)
+          _mm256_storeu_si256( D, select_AVX2( mask, pixels, _mm256_loadu_si256( D ) ) );
+}
+
+static inline __m256i AVX2_FUNC
+argb_to_rgb16_AVX2( __m256i p )
+{
+     __m256i r = _mm256_and_si256( _mm256_srli_epi32( p, 8 ), _mm256_set1_epi32( 0xf800 ) );
+     __m256i g = _mm256_and_si256( _mm256_srli_epi32( p, 5 ), _mm256_set1_epi32( 0x07e0 ) );
+     __m256i b = _mm256_and_si256( _mm256_srli_epi32( p, 3 ), _mm256_set1_epi32( 0x001f ) );
+
+     return _mm256_srai_epi32( _mm256_slli_epi32( _mm256_or_si256( _mm256_or_si256( r, g ), b ), 16 ), 16 );
+}
+
+/**********************************************************************************************************************/
+
+static void AVX2_FUNC
+Sop_argb_to_Dacc_AVX2( GenefxState *gfxs )
+{
+     int                w = gfxs->length;
+     u32               *S = gfxs->Sop[0];
+     GenefxAccumulator *D = gfxs->Dacc;
+
+     if (gfxs->Ostep != 1) {
+          Sop_argb_to_Dacc( gfxs );
+          return;
+     }
+
+     for (; w >= 8; w -= 8) {
+          __m128i s0 = _mm_loadu_si128( (const __m128i*) S );
+          __m128i s1 = _mm_loadu_si128( (const __m128i*) (S + 4) );
+
+          _mm256_storeu_si256( (__m256i*) D,       _mm256_cvtepu8_epi16( s0 ) );
+          _mm256_storeu_si256( (__m256i*) (D + 4), _mm256_cvtepu8_epi16( s1 ) );
+
+          S += 8;
+          D += 8;
+     }
+
+     argb_to_acc_SSE2( S, D, w, 0 );
+}
+
+static void AVX2_FUNC
+Sop_rgb32_to_Dacc_AVX2( GenefxState *gfxs )
+{
+     int                w     = gfxs->length;
+     u32               *S     = gfxs->Sop[0];
+     GenefxAccumulator *D     = gfxs->Dacc;
+     const __m128i      alpha = _mm_set1_epi32( 0xff000000 );
+
+     if (gfxs->Ostep != 1) {
+          Sop_rgb32_to_Dacc( gfxs );
+          return;
+     }
+
+     for (; w >= 8; w -= 8) {
+          __m128i s0 = _mm_or_si128( _mm_loadu_si128( (const __m128i*) S ),       alpha );
+          __m128i s1 = _mm_or_si128( _mm_loadu_si128( (const __m128i*) (S + 4) ), alpha );
+
+          _mm256_storeu_si256( (__m256i*) D,       _mm256_cvtepu8_epi16( s0 ) );
+          _mm256_storeu_si256( (__m256i*) (D + 4), _mm256_cvtepu8_epi16( s1 ) );
+
+          S += 8;
+          D += 8;
+     }
+
+     argb_to_acc_SSE2( S, D, w, 0xff000000 );
+}
+
+static void AVX2_FUNC
+Sop_rgb16_to_Dacc_AVX2( GenefxState *gfxs )
+{
+     int                w = gfxs->length;
+     u16               *S = gfxs->Sop[0];
+     GenefxAccumulator *D = gfxs->Dacc;
+
+     if (gfxs->Ostep != 1) {
+          Sop_rgb16_to_Dacc( gfxs );
+          return;
+     }
+
+     for (; w >= 16; w -= 16) {
+          __m256i s = _mm256_loadu_si256( (const __m256i*) S );
+          __m256i r = _mm256_srli_epi16( s, 11 );
+          __m256i g = _mm256_and_si256( _mm256_srli_epi16( s, 5 ), _mm256_set1_epi16( 0x3f ) );
+          __m256i b = _mm256_and_si256( s, _mm256_set1_epi16( 0x1f ) );
+          __m256i a = _mm256_set1_epi16( 0xff );
+          __m256i bg, ra, lo, hi;
+
+          r = _mm256_or_si256( _mm256_slli_epi16( r, 3 ), _mm256_srli_epi16( r, 2 ) );
+          g = _mm256_or_si256( _mm256_slli_epi16( g, 2 ), _mm256_srli_epi16( g, 4 ) );
+          b = _mm256_or_si256( _mm256_slli_epi16( b, 3 ), _mm256_srli_epi16( b, 2 ) );
+
+          /* Unpacking works within 128 bit lanes, this gives pixels 0-3 and 8-11. */
+          bg = _mm256_unpacklo_epi16( b, g );
+          ra = _mm256_unpacklo_epi16( r, a );
+          lo = _mm256_unpacklo_epi32( bg, ra );
+          hi = _mm256_unpackhi_epi32( bg, ra );
+
+          _mm256_storeu_si256( (__m256i*) D,       _mm256_permute2x128_si256( lo, hi, 0x20 ) );
+          _mm256_storeu_si256( (__m256i*) (D + 8), _mm256_permute2x128_si256( lo, hi, 0x31 ) );
+
+          /* Pixels 4-7 and 12-15. */
+          bg = _mm256_unpackhi_epi16( b, g );
+          ra = _mm256_unpackhi_epi16( r, a );
+          lo = _mm256_unpacklo_epi32( bg, ra );
+          hi = _mm256_unpackhi_epi32( bg, ra );
+
+          _mm256_storeu_si256( (__m256i*) (D + 4),  _mm256_permute2x128_si256( lo, hi, 0x20 ) );
+          _mm256_storeu_si256( (__m256i*) (D + 12), _mm256_permute2x128_si256( lo, hi, 0x31 ) );
+
+          S += 16;
+          D += 16;
+     }
+
+     rgb16_to_acc_SSE2( S, D, w );
+}
+
+/**********************************************************************************************************************/
+
+static void AVX2_FUNC
+Sacc_to_Aop_argb_AVX2( GenefxState *gfxs )
+{
+     int                w = gfxs->length;
+     GenefxAccumulator *S = gfxs->Sacc;
+     u32               *D = gfxs->Aop[0];
+
+     if (gfxs->Astep != 1) {
+          Sacc_to_Aop_argb( gfxs );
+          return;
+     }
+
+     for (; w >= 8; w -= 8) {
+          __m256i mask;
+          __m256i pixels = acc_to_argb_AVX2( S, &mask );
+
+          store_masked_AVX2( D, pixels, mask );
+
+          S += 8;
+          D += 8;
+     }
+
+     acc_to_argb_span_SSE2( S, D, w, 0 );
+}
+
+static void AVX2_FUNC
+Sacc_to_Aop_rgb32_AVX2( GenefxState *gfxs )
+{
+     int                w = gfxs->length;
+     GenefxAccumulator *S = gfxs->Sacc;
+     u32               *D = gfxs->Aop[0];
+
+     if (gfxs->Astep != 1) {
+          Sacc_to_Aop_rgb32( gfxs );
+          return;
+     }
+
+     for (; w >= 8; w -= 8) {
+          __m256i mask;
+          __m256i pixels = acc_to_argb_AVX2( S, &mask );
+
+          store_masked_AVX2( D, _mm256_or_si256( pixels, _mm256_set1_epi32( 0xff000000 ) ), mask );
+
+          S += 8;
+          D += 8;
+     }
+
+     acc_to_argb_span_SSE2( S, D, w, 0xff000000 );
+}
+
+static void AVX2_FUNC
+Sacc_to_Aop_rgb16_AVX2( GenefxState *gfxs )
+{
+     int                w = gfxs->length;
+     GenefxAccumulator *S = gfxs->Sacc;
+     u16               *D = gfxs->Aop[0];
+
+     if (gfxs->Astep != 1) {
+          Sacc_to_Aop_rgb16( gfxs );
+          return;
+     }
+
+     for (; w >= 16; w -= 16) {
+          __m256i m0, m1;
+          __m256i p0 = argb_to_rgb16_AVX2( acc_to_argb_AVX2( S,     &m0 ) );
+          __m256i p1 = argb_to_rgb16_AVX2( acc_to_argb_AVX2( S + 8, &m1 ) );
+
+          store_masked_AVX2( D, _mm256_permute4x64_epi64( _mm256_packs_epi32( p0, p1 ), 0xd8 ),
+                                _mm256_permute4x64_epi64( _mm256_packs_epi32( m0, m1 ), 0xd8 ) );
+
+          S += 16;
+          D += 16;
+     }
+
+     acc_to_rgb16_span_SSE2( S, D, w );
+}
+
+/**********************************************************************************************************************/
+
+static inline void AVX2_FUNC
+Xacc_blend_span_AVX2( GenefxAccumulator       *X,
+                      const GenefxAccumulator *Y,
+                      const GenefxAccumulator *S,
+                      int                      w,
+                      u16                      base,
+                      bool                     invert )
+{
+     __m256i b  = _mm256_set1_epi16( base );
+     __m256i sa = b;
+
+     for (; w >= 4; w -= 4) {
+          __m256i y = _mm256_loadu_si256( (const __m256i*) Y );
+
+          if (S) {
+               __m256i a = acc_alpha_AVX2( _mm256_loadu_si256( (const __m256i*) S ) );
+
+               sa = invert ? _mm256_sub_epi16( b, a ) : _mm256_add_epi16( b, a );
+               S += 4;
+          }
+
+          _mm256_storeu_si256( (__m256i*) X, select_AVX2( acc_mask_AVX2( y ), mul8_AVX2( sa, y ), y ) );
+
+          X += 4;
+          Y += 4;
+     }
+
+     Xacc_blend_span_SSE2( X, Y, S, w, base, invert );
+}
+
+static void AVX2_FUNC
+Xacc_blend_srcalpha_AVX2( GenefxState *gfxs )
+{
+     if (gfxs->Sacc)
+          Xacc_blend_span_AVX2( gfxs->Xacc, gfxs->Yacc, gfxs->Sacc, gfxs->length, 1, false );
+     else
+          Xacc_blend_span_AVX2( gfxs->Xacc, gfxs->Yacc, NULL, gfxs->length, gfxs->color.a + 1, false );
+}
+
+static void AVX2_FUNC
+Xacc_blend_invsrcalpha_AVX2( GenefxState *gfxs )
+{
+     if (gfxs->Sacc)
+          Xacc_blend_span_AVX2( gfxs->Xacc, gfxs->Yacc, gfxs->Sacc, gfxs->length, 0x100, true );
+     else
+          Xacc_blend_span_AVX2( gfxs->Xacc, gfxs->Yacc, NULL, gfxs->length, 0x100 - gfxs->color.a, true );
+}
+
+/**********************************************************************************************************************/
+
+static inline void AVX2_FUNC
+Dacc_scale_AVX2( GenefxAccumulator *D,
+                 int                w,
+                 __m256i            factor )
+{
+     for (; w >= 4; w -= 4) {
+          __m256i d = _mm256_loadu_si256( (const __m256i*) D );
+
+          _mm256_storeu_si256( (__m256i*) D, select_AVX2( acc_mask_AVX2( d ), mul8_AVX2( factor, d ), d ) );
+
+          D += 4;
+     }
+
+     Dacc_scale_SSE2( D, w, _mm256_castsi256_si128( factor ) );
+}
+
+static void AVX2_FUNC
+Dacc_modulate_rgb_AVX2( GenefxState *gfxs )
+{
+     GenefxAccumulator *C = &gfxs->Cacc;
+
+     Dacc_scale_AVX2( gfxs->Dacc, gfxs->length,
+                      _mm256_set_epi16( 0x100, C->RGB.r, C->RGB.g, C->RGB.b, 0x100, C->RGB.r, C->RGB.g, C->RGB.b,
+                                        0x100, C->RGB.r, C->RGB.g, C->RGB.b, 0x100, C->RGB.r, C->RGB.g, C->RGB.b ) );
+}
+
+static void AVX2_FUNC
+Dacc_modulate_argb_AVX2( GenefxState *gfxs )
+{
+     GenefxAccumulator *C = &gfxs->Cacc;
+
+     Dacc_scale_AVX2( gfxs->Dacc, gfxs->length,
+                      _mm256_set_epi16( C->RGB.a, C->RGB.r, C->RGB.g, C->RGB.b,
+                                        C->RGB.a, C->RGB.r, C->RGB.g, C->RGB.b,
+                                        C->RGB.a, C->RGB.r, C->RGB.g, C->RGB.b,
+                                        C->RGB.a, C->RGB.r, C->RGB.g, C->RGB.b ) );
+}
+
+static void AVX2_FUNC
+Dacc_premultiply_color_alpha_AVX2( GenefxState *gfxs )
+{
+     u16 Ca = gfxs->Cacc.RGB.a;
+
+     Dacc_scale_AVX2( gfxs->Dacc, gfxs->length,
+                      _mm256_set_epi16( 0x100, Ca, Ca, Ca, 0x100, Ca, Ca, Ca, 0x100, Ca, Ca, Ca, 0x100, Ca, Ca, Ca ) );
+}
+
+static void AVX2_FUNC
+Dacc_premultiply_AVX2( GenefxState *gfxs )
+{
+     int                w     = gfxs->length;
+     GenefxAccumulator *D     = gfxs->Dacc;
+     const __m256i      rgb   = _mm256_set_epi16( 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1 );
+     const __m256i      alpha = _mm256_set_epi16( 0x100, 0, 0, 0, 0x100, 0, 0, 0, 0x100, 0, 0, 0, 0x100, 0, 0, 0 );
+
+     for (; w >= 4; w -= 4) {
+          __m256i d  = _mm256_loadu_si256( (const __m256i*) D );
+          __m256i da = _mm256_add_epi16( acc_alpha_AVX2( d ), _mm256_set1_epi16( 1 ) );
+
+          da = _mm256_or_si256( _mm256_and_si256( da, rgb ), alpha );
+
+          _mm256_storeu_si256( (__m256i*) D, select_AVX2( acc_mask_AVX2( d ), mul8_AVX2( da, d ), d ) );
+
+          D += 4;
+     }
+
+     Dacc_premultiply_span_SSE2( D, w );
+}
+
+/**********************************************************************************************************************/
+
+static inline void AVX2_FUNC
+Dacc_add_span_AVX2( GenefxAccumulator       *D,
+                    const GenefxAccumulator *S,
+                    int                      Sstep,
+                    int                      w )
+{
+     __m256i s = _mm256_broadcastq_epi64( _mm_loadl_epi64( (const __m128i*) S ) );
+
+     for (; w >= 4; w -= 4) {
+          __m256i d = _mm256_loadu_si256( (const __m256i*) D );
+
+          if (Sstep)
+               s = _mm256_loadu_si256( (const __m256i*) S );
+
+          _mm256_storeu_si256( (__m256i*) D, select_AVX2( acc_mask_AVX2( d ), _mm256_add_epi16( d, s ), d ) );
+
+          D += 4;
+          S += Sstep * 4;
+     }
+
+     Dacc_add_span_SSE2( D, S, Sstep, w );
+}
+
+static void AVX2_FUNC
+SCacc_add_to_Dacc_AVX2( GenefxState *gfxs )
+{
+     Dacc_add_span_AVX2( gfxs->Dacc, &gfxs->SCacc, 0, gfxs->length );
+}
+
+static void AVX2_FUNC
+Sacc_add_to_Dacc_AVX2( GenefxState *gfxs )
+{
+     Dacc_add_span_AVX2( gfxs->Dacc, gfxs->Sacc, 1, gfxs->length );
+}
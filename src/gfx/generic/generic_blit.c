@@ -16,63 +16,216 @@
    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
 */
 
+#include <config.h>
 #include <core/state.h>
 #include <gfx/generic/generic.h>
 #include <gfx/generic/generic_blit.h>
+#include <gfx/generic/generic_queue.h>
+#include <gfx/generic/generic_stats.h>
+#include <gfx/generic/generic_threads.h>
 #include <gfx/generic/generic_util.h>
 #include <gfx/util.h>
 
 /**********************************************************************************************************************/
 
+/*
+ * Rotated blits are done in tiles of ROTATE_TILE x ROTATE_TILE pixels, so that the destination lines written by a tile
+ * stay in the cache until they are complete, instead of walking the whole destination column by column.
+ */
+#define ROTATE_TILE 64
+
+/*
+ * Copies 'w' pixels from each of 'h' source lines 'sadv' bytes apart. The pixels of a source line go to destination
+ * lines 'dstep' bytes apart, the pixels of the next source line are 'dadv' bytes to the right or to the left.
+ */
+typedef void (*RotateTileFunc)( const u8 *S,
+                                int       sadv,
+                                u8       *D,
+                                int       dadv,
+                                int       dstep,
+                                int       w,
+                                int       h );
+
+static void
+rotate_tile_32( const u8 *S,
+                int       sadv,
+                u8       *D,
+                int       dadv,
+                int       dstep,
+                int       w,
+                int       h )
+{
+     int i;
+
+     while (h--) {
+          const u32 *s = (const u32*) S;
+          u8        *d = D;
+
+          for (i = 0; i < w; i++) {
+               *(u32*) d = s[i];
+
+               d += dstep;
+          }
+
+          S += sadv;
+          D += dadv;
+     }
+}
+
+static void
+rotate_tile_16( const u8 *S,
+                int       sadv,
+                u8       *D,
+                int       dadv,
+                int       dstep,
+                int       w,
+                int       h )
+{
+     int i;
+
+     while (h--) {
+          const u16 *s = (const u16*) S;
+          u8        *d = D;
+
+          for (i = 0; i < w; i++) {
+               *(u16*) d = s[i];
+
+               d += dstep;
+          }
+
+          S += sadv;
+          D += dadv;
+     }
+}
+
+#ifdef USE_SSE2
+#include "blit_rotate_sse2.h"
+#endif
+
+/* Indexed by the number of bytes per pixel. */
+static RotateTileFunc rotate_tiles[5] = {
+     [2] = rotate_tile_16,
+     [4] = rotate_tile_32
+};
+
+/**********************************************************************************************************************/
+
 typedef void (*XopAdvanceFunc)( GenefxState *gfxs );
 
-void
-gBlit( CardState    *state,
-       DFBRectangle *rect,
-       int           dx,
-       int           dy )
+typedef struct {
+     DFBRectangle            rect;
+     int                     dx;
+     int                     dy;
+     DFBSurfaceBlittingFlags rotflip_blittingflags;
+} BlitBandCtx;
+
+/*
+ * Returns true if a rotated blit can be done in tiles: each destination pixel has to depend only on its source pixel,
+ * and the formats must not pack several pixels into a byte or pair.
+ */
+static bool
+rotate_tileable( CardState   *state,
+                 GenefxState *gfxs )
 {
-     GenefxState             *gfxs;
-     XopAdvanceFunc           Aop_advance;
-     XopAdvanceFunc           Bop_advance;
-     int                      Aop_X;
-     int                      Aop_Y;
-     int                      Bop_X;
-     int                      Bop_Y;
-     XopAdvanceFunc           Mop_advance = NULL;
-     int                      Mop_X       = 0;
-     int                      Mop_Y       = 0;
-     int                      h;
-     int                      mask_h;
-     int                      mask_x;
-     int                      mask_y;
-     DFBSurfaceBlittingFlags  rotflip_blittingflags;
+     if (state->blittingflags & (DSBLIT_SRC_MASK_ALPHA | DSBLIT_SRC_MASK_COLOR | DSBLIT_DEINTERLACE))
+          return false;
 
-     D_ASSERT( state != NULL );
-     D_ASSERT( state->gfxs != NULL );
+     if ((gfxs->src_caps | gfxs->dst_caps) & DSCAPS_SEPARATED || gfxs->src_org[0] == gfxs->dst_org[0])
+          return false;
 
-     gfxs = state->gfxs;
+     if (DFB_PLANAR_PIXELFORMAT( gfxs->src_format ) || !DFB_BYTES_PER_PIXEL( gfxs->src_format ) ||
+         DFB_PIXELFORMAT_ALIGNMENT( gfxs->src_format ))
+          return false;
 
-     rotflip_blittingflags = state->blittingflags;
+     if (DFB_PLANAR_PIXELFORMAT( gfxs->dst_format ) || !DFB_BYTES_PER_PIXEL( gfxs->dst_format ) ||
+         DFB_PIXELFORMAT_ALIGNMENT( gfxs->dst_format ))
+          return false;
 
-     dfb_simplify_blittingflags( &rotflip_blittingflags );
-     rotflip_blittingflags &= (DSBLIT_FLIP_HORIZONTAL | DSBLIT_FLIP_VERTICAL | DSBLIT_ROTATE90 );
+     /* Some of the 8, 16 and 24 bit writers of the pipeline only step forward along a line. */
+     if (gfxs->dst_bpp < 2)
+          return false;
 
-     if (dfb_config->software_warn) {
-          D_WARN( "Blit (%4d,%4d-%4dx%4d) %6s, flags 0x%08x, funcs %u/%u, color 0x%02x%02x%02x%02x <- (%4d,%4d) %6s",
-                  dx, dy, rect->w, rect->h, dfb_pixelformat_name( gfxs->dst_format ), state->blittingflags,
-                  state->src_blend, state->dst_blend, state->color.a, state->color.r, state->color.g, state->color.b,
-                  rect->x, rect->y, dfb_pixelformat_name( gfxs->src_format ) );
+     if ((state->blittingflags & DSBLIT_SRC_COLORKEY) && gfxs->src_format == gfxs->dst_format && gfxs->dst_bpp != 4)
+          return false;
+
+     return true;
+}
+
+/*
+ * Runs a rotated blit tile by tile, starting at the current Aop and Bop. The lines of the blit are 'sadv' bytes apart
+ * in the source and 'dadv' bytes apart in the destination, where Astep advances along a line.
+ * Plain copies are transposed directly, other blits run the pipeline for the part of each line within a tile.
+ */
+static void
+Genefx_Blit_Tiles( CardState   *state,
+                   GenefxState *gfxs,
+                   int          w,
+                   int          h,
+                   int          sadv,
+                   int          dadv )
+{
+     DFBSurfaceBlittingFlags  flags = state->blittingflags;
+     RotateTileFunc           copy  = NULL;
+     u8                      *A     = gfxs->Aop[0];
+     u8                      *B     = gfxs->Bop[0];
+     int                      dstep = gfxs->Astep * gfxs->dst_bpp;
+     int                      tx, ty, j;
+
+     dfb_simplify_blittingflags( &flags );
+
+     if (!(flags & ~(DSBLIT_FLIP_HORIZONTAL | DSBLIT_FLIP_VERTICAL | DSBLIT_ROTATE90)) &&
+         gfxs->src_format == gfxs->dst_format && !DFB_PIXELFORMAT_IS_INDEXED( gfxs->src_format ) &&
+         gfxs->dst_bpp < D_ARRAY_SIZE(rotate_tiles))
+          copy = rotate_tiles[gfxs->dst_bpp];
+
+     for (ty = 0; ty < h; ty += ROTATE_TILE) {
+          int th = MIN( ROTATE_TILE, h - ty );
+
+          for (tx = 0; tx < w; tx += ROTATE_TILE) {
+               int  tw = MIN( ROTATE_TILE, w - tx );
+               u8  *S  = B + ty * sadv + tx * gfxs->src_bpp;
+               u8  *D  = A + ty * dadv + tx * dstep;
+
+               if (copy) {
+                    copy( S, sadv, D, dadv, dstep, tw, th );
+                    continue;
+               }
+
+               gfxs->length = tw;
+
+               for (j = 0; j < th; j++) {
+                    gfxs->Aop[0] = D + j * dadv;
+                    gfxs->Bop[0] = S + j * sadv;
+
+                    RUN_PIPELINE();
+               }
+          }
      }
 
-     D_ASSERT( state->clip.x1 <= dx );
-     D_ASSERT( state->clip.y1 <= dy );
-     D_ASSERT(  (rotflip_blittingflags & DSBLIT_ROTATE90) || state->clip.x2 >= (dx + rect->w - 1) );
-     D_ASSERT(  (rotflip_blittingflags & DSBLIT_ROTATE90) || state->clip.y2 >= (dy + rect->h - 1) );
-     D_ASSERT( !(rotflip_blittingflags & DSBLIT_ROTATE90) || state->clip.x2 >= (dx + rect->h - 1) );
-     D_ASSERT( !(rotflip_blittingflags & DSBLIT_ROTATE90) || state->clip.y2 >= (dy + rect->w - 1) );
+     gfxs->length = w;
+}
 
-     CHECK_PIPELINE();
+static void
+Genefx_Blit( CardState               *state,
+             GenefxState             *gfxs,
+             DFBRectangle            *rect,
+             int                      dx,
+             int                      dy,
+             DFBSurfaceBlittingFlags  rotflip_blittingflags )
+{
+     XopAdvanceFunc Aop_advance;
+     XopAdvanceFunc Bop_advance;
+     int            Aop_X;
+     int            Aop_Y;
+     int            Bop_X;
+     int            Bop_Y;
+     XopAdvanceFunc Mop_advance = NULL;
+     int            Mop_X       = 0;
+     int            Mop_Y       = 0;
+     int            h;
+     int            mask_h;
+     int            mask_x;
+     int            mask_y;
 
      if (!Genefx_ABacc_prepare( gfxs, rect->w ))
           return;
@@ -339,6 +492,11 @@ gBlit( CardState    *state,
                }
           }
      }
+     else if ((rotflip_blittingflags & DSBLIT_ROTATE90) && rotate_tileable( state, gfxs )) {
+          Genefx_Blit_Tiles( state, gfxs, rect->w, rect->h,
+                             (Bop_advance == Genefx_Bop_next) ? gfxs->src_pitch : -gfxs->src_pitch,
+                             (Aop_advance == Genefx_Aop_crab) ? gfxs->dst_bpp   : -gfxs->dst_bpp );
+     }
      else {
           for (h = rect->h; h; h--) {
                RUN_PIPELINE();
@@ -353,3 +511,94 @@ gBlit( CardState    *state,
 
      Genefx_ABacc_flush( gfxs );
 }
+
+static void
+blit_band( CardState       *state,
+           GenefxState     *gfxs,
+           const DFBRegion *band,
+           void            *ctx )
+{
+     BlitBandCtx  *blit = ctx;
+     DFBRectangle  rect = blit->rect;
+
+     /* Bands are destination lines, pick the source lines that end up in them. */
+     if (blit->rotflip_blittingflags & DSBLIT_FLIP_VERTICAL)
+          rect.y += blit->dy + blit->rect.h - 1 - band->y2;
+     else
+          rect.y += band->y1 - blit->dy;
+
+     rect.h = band->y2 - band->y1 + 1;
+
+     Genefx_Blit( state, gfxs, &rect, blit->dx, band->y1, blit->rotflip_blittingflags );
+}
+
+void
+gBlit( CardState    *state,
+       DFBRectangle *rect,
+       int           dx,
+       int           dy )
+{
+     GenefxState             *gfxs;
+     DFBSurfaceBlittingFlags  rotflip_blittingflags;
+
+     D_ASSERT( state != NULL );
+     D_ASSERT( state->gfxs != NULL );
+
+     if (Genefx_Queue_Blit( state, rect, dx, dy ))
+          return;
+
+     gfxs = state->gfxs;
+
+     rotflip_blittingflags = state->blittingflags;
+
+     dfb_simplify_blittingflags( &rotflip_blittingflags );
+     rotflip_blittingflags &= (DSBLIT_FLIP_HORIZONTAL | DSBLIT_FLIP_VERTICAL | DSBLIT_ROTATE90 );
+
+     if (dfb_config->software_warn) {
+          D_WARN( "Blit (%4d,%4d-%4dx%4d) %6s, flags 0x%08x, funcs %u/%u, color 0x%02x%02x%02x%02x <- (%4d,%4d) %6s",
+                  dx, dy, rect->w, rect->h, dfb_pixelformat_name( gfxs->dst_format ), state->blittingflags,
+                  state->src_blend, state->dst_blend, state->color.a, state->color.r, state->color.g, state->color.b,
+                  rect->x, rect->y, dfb_pixelformat_name( gfxs->src_format ) );
+     }
+
+     D_ASSERT( state->clip.x1 <= dx );
+     D_ASSERT( state->clip.y1 <= dy );
+     D_ASSERT(  (rotflip_blittingflags & DSBLIT_ROTATE90) || state->clip.x2 >= (dx + rect->w - 1) );
+     D_ASSERT(  (rotflip_blittingflags & DSBLIT_ROTATE90) || state->clip.y2 >= (dy + rect->h - 1) );
+     D_ASSERT( !(rotflip_blittingflags & DSBLIT_ROTATE90) || state->clip.x2 >= (dx + rect->h - 1) );
+     D_ASSERT( !(rotflip_blittingflags & DSBLIT_ROTATE90) || state->clip.y2 >= (dy + rect->w - 1) );
+
+     CHECK_PIPELINE();
+
+     GENEFX_STATS_COUNT( gfxs, rect->w * rect->h );
+
+     /* Overlapping, rotated, masked and deinterlacing blits depend on the line order and run in one piece, as well as
+        planar formats stepping backwards through their lines. */
+     if (!(rotflip_blittingflags & DSBLIT_ROTATE90) &&
+         !(state->blittingflags & (DSBLIT_SRC_MASK_ALPHA | DSBLIT_SRC_MASK_COLOR | DSBLIT_DEINTERLACE)) &&
+         !((rotflip_blittingflags & DSBLIT_FLIP_VERTICAL) &&
+           (DFB_PLANAR_PIXELFORMAT( gfxs->src_format ) || DFB_PLANAR_PIXELFORMAT( gfxs->dst_format ))) &&
+         !(gfxs->src_caps & DSCAPS_SEPARATED) && gfxs->src_org[0] != gfxs->dst_org[0]) {
+          BlitBandCtx ctx;
+          DFBRegion   area = { dx, dy, dx + rect->w - 1, dy + rect->h - 1 };
+
+          ctx.rect                  = *rect;
+          ctx.dx                    = dx;
+          ctx.dy                    = dy;
+          ctx.rotflip_blittingflags = rotflip_blittingflags;
+
+          if (Genefx_Bands_Run( state, &area, blit_band, &ctx ))
+               return;
+     }
+
+     Genefx_Blit( state, gfxs, rect, dx, dy, rotflip_blittingflags );
+}
+
+#ifdef USE_SSE2
+void
+gInitBlit_SSE2( void )
+{
+     rotate_tiles[2] = rotate_tile_16_SSE2;
+     rotate_tiles[4] = rotate_tile_32_SSE2;
+}
+#endif
@@ -28,4 +28,9 @@ void gBlit( CardState    *state,
             int           dx,
             int           dy );
 
+/*
+ * Enable the SSE2 rotated blit routines, called once the CPU has been checked.
+ */
+void gInitBlit_SSE2( void );
+
 #endif
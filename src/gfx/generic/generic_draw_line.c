@@ -20,6 +20,8 @@
 #include <gfx/generic/generic.h>
 #include <gfx/generic/generic_draw_line.h>
 #include <gfx/generic/generic_fill_rectangle.h>
+#include <gfx/generic/generic_queue.h>
+#include <gfx/generic/generic_stats.h>
 #include <gfx/generic/generic_util.h>
 
 /**********************************************************************************************************************/
@@ -34,6 +36,9 @@ gDrawLine( CardState *state,
      D_ASSERT( state != NULL );
      D_ASSERT( state->gfxs != NULL );
 
+     if (Genefx_Queue_DrawLine( state, line ))
+          return;
+
      gfxs = state->gfxs;
 
      CHECK_PIPELINE();
@@ -56,6 +61,8 @@ gDrawLine( CardState *state,
           return;
      }
 
+     GENEFX_STATS_COUNT( gfxs, MAX( dxabs, dyabs ) + 1 );
+
      if (dfb_config->software_warn) {
           D_WARN( "DrawLine (%4d,%4d-%4d,%4d) %6s, flags 0x%08x, color 0x%02x%02x%02x%02x",
                   DFB_RECTANGLE_VALS_FROM_REGION( line ), dfb_pixelformat_name( gfxs->dst_format ), state->drawingflags,
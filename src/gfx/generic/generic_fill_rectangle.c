@@ -16,19 +16,162 @@
    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
 */
 
+#include <config.h>
 #include <core/state.h>
+#include <direct/memcpy.h>
 #include <gfx/generic/generic.h>
 #include <gfx/generic/generic_fill_rectangle.h>
+#include <gfx/generic/generic_queue.h>
+#include <gfx/generic/generic_stats.h>
+#include <gfx/generic/generic_threads.h>
 #include <gfx/generic/generic_util.h>
 
 /**********************************************************************************************************************/
 
+/*
+ * Solid fills (the pipeline only writes the color) of at least FILL_COPY_BYTES have their first line written by the
+ * pipeline and copied to the other lines. Fills too large to stay in the cache use streaming stores where available.
+ * Full width fills with no padding at the end of the lines are done as a single pass over the memory, doubling the
+ * first line up to FILL_SEED_BYTES and copying that block to the rest.
+ */
+#define FILL_COPY_BYTES   4096
+#define FILL_SEED_BYTES   8192
+
+typedef void (*FillCopyFunc)( u8 *D, const u8 *S, int bytes );
+
+static void
+fill_copy( u8       *D,
+           const u8 *S,
+           int       bytes )
+{
+     direct_memcpy( D, S, bytes );
+}
+
+#ifdef USE_SSE2
+#include "fill_stream_sse2.h"
+#endif
+
+static FillCopyFunc fill_copy_stream  = fill_copy;
+static int          fill_stream_bytes = INT_MAX;
+
+/* The first line is already there, copy it until the block is complete. */
+static void
+fill_contiguous( u8           *D,
+                 int           bytes,
+                 int           total,
+                 FillCopyFunc  copy )
+{
+     int seed = bytes;
+     int n, offset;
+
+     while (seed < FILL_SEED_BYTES && seed < total) {
+          n = MIN( seed, total - seed );
+
+          direct_memcpy( D + seed, D, n );
+
+          seed += n;
+     }
+
+     for (offset = seed; offset < total; offset += n) {
+          n = MIN( seed, total - offset );
+
+          copy( D + offset, D, n );
+     }
+}
+
+static bool
+Genefx_FillRectangle_Copy( CardState          *state,
+                           GenefxState        *gfxs,
+                           const DFBRectangle *rect )
+{
+     DFBSurfacePixelFormat  format = gfxs->dst_format;
+     FillCopyFunc           copy   = fill_copy;
+     u8                    *S;
+     int                    bytes, total, h;
+
+     /* Any other flags need the pipeline to read the destination. */
+     if (state->drawingflags & ~(DSDRAW_SRC_PREMULTIPLY | DSDRAW_DST_PREMULTIPLY))
+          return false;
+
+     /* Lines of planar and 8 bit formats are filled with memset() already. */
+     if (DFB_PLANAR_PIXELFORMAT( format ) || DFB_BYTES_PER_PIXEL( format ) < 2 || rect->h < 2)
+          return false;
+
+     bytes = DFB_BYTES_PER_LINE( format, rect->w );
+     total = bytes * rect->h;
+
+     if (total < FILL_COPY_BYTES)
+          return false;
+
+     if (total >= fill_stream_bytes)
+          copy = fill_copy_stream;
+
+     gfxs->length = rect->w;
+
+     Genefx_Aop_xy( gfxs, rect->x, rect->y );
+
+     RUN_PIPELINE();
+
+     S = gfxs->Aop[0];
+
+     if (bytes == gfxs->dst_pitch && !(gfxs->dst_caps & DSCAPS_SEPARATED)) {
+          fill_contiguous( S, bytes, total, copy );
+          return true;
+     }
+
+     for (h = rect->h - 1; h; h--) {
+          Genefx_Aop_next( gfxs );
+
+          copy( gfxs->Aop[0], S, bytes );
+     }
+
+     return true;
+}
+
+static void
+Genefx_FillRectangle( CardState          *state,
+                      GenefxState        *gfxs,
+                      const DFBRectangle *rect )
+{
+     int h;
+
+     if (!Genefx_ABacc_prepare( gfxs, rect->w ))
+          return;
+
+     if (!Genefx_FillRectangle_Copy( state, gfxs, rect )) {
+          gfxs->length = rect->w;
+
+          Genefx_Aop_xy( gfxs, rect->x, rect->y );
+
+          h = rect->h;
+          while (h--) {
+               RUN_PIPELINE();
+
+               Genefx_Aop_next( gfxs );
+          }
+     }
+
+     Genefx_ABacc_flush( gfxs );
+}
+
+static void
+fill_rectangle_band( CardState       *state,
+                     GenefxState     *gfxs,
+                     const DFBRegion *band,
+                     void            *ctx )
+{
+     DFBRectangle rect = *(DFBRectangle*) ctx;
+
+     if (dfb_rectangle_intersect_by_region( &rect, band ))
+          Genefx_FillRectangle( state, gfxs, &rect );
+}
+
 void
 gFillRectangle( CardState    *state,
                 DFBRectangle *rect )
 {
      GenefxState *gfxs;
-     int          h;
+     DFBRegion    area;
 
      D_ASSERT( state != NULL );
      D_ASSERT( state->gfxs != NULL );
@@ -37,6 +180,9 @@ gFillRectangle( CardState    *state,
      D_ASSERT( state->clip.x2 >= (rect->x + rect->w - 1) );
      D_ASSERT( state->clip.y2 >= (rect->y + rect->h - 1) );
 
+     if (Genefx_Queue_FillRectangle( state, rect ))
+          return;
+
      gfxs = state->gfxs;
 
      if (dfb_config->software_warn) {
@@ -47,19 +193,30 @@ gFillRectangle( CardState    *state,
 
      CHECK_PIPELINE();
 
-     if (!Genefx_ABacc_prepare( gfxs, rect->w ))
-          return;
+     GENEFX_STATS_COUNT( gfxs, rect->w * rect->h );
 
-     gfxs->length = rect->w;
+     dfb_region_from_rectangle( &area, rect );
 
-     Genefx_Aop_xy( gfxs, rect->x, rect->y );
+     if (Genefx_Bands_Run( state, &area, fill_rectangle_band, rect ))
+          return;
 
-     h = rect->h;
-     while (h--) {
-          RUN_PIPELINE();
+     Genefx_FillRectangle( state, gfxs, rect );
+}
 
-          Genefx_Aop_next( gfxs );
-     }
+#ifdef USE_SSE2
+void
+gInitFillRectangle_SSE2( void )
+{
+     long cache = -1;
 
-     Genefx_ABacc_flush( gfxs );
+#ifdef _SC_LEVEL3_CACHE_SIZE
+     cache = sysconf( _SC_LEVEL3_CACHE_SIZE );
+     if (cache <= 0)
+          cache = sysconf( _SC_LEVEL2_CACHE_SIZE );
+#endif
+
+     /* Stream fills that would take most of the last level cache, or those of at least 4 MB if its size is unknown. */
+     fill_stream_bytes = cache > 0 ? MIN( cache * 3 / 4, INT_MAX ) : 4 * 1024 * 1024;
+     fill_copy_stream  = fill_copy_stream_SSE2;
 }
+#endif
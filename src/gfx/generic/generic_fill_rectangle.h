@@ -26,4 +26,9 @@
 void gFillRectangle( CardState    *state,
                      DFBRectangle *rect );
 
+/*
+ * Enable the SSE2 streaming stores for large fills, called once the CPU has been checked.
+ */
+void gInitFillRectangle_SSE2( void );
+
 #endif
@@ -0,0 +1,689 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#include <core/core.h>
+#include <core/state.h>
+#include <core/surface_allocation.h>
+#include <direct/memcpy.h>
+#include <direct/thread.h>
+#include <gfx/generic/generic.h>
+#include <gfx/generic/generic_affine_blit.h>
+#include <gfx/generic/generic_blit.h>
+#include <gfx/generic/generic_draw_line.h>
+#include <gfx/generic/generic_fill_rectangle.h>
+#include <gfx/generic/generic_queue.h>
+#include <gfx/generic/generic_stretch_blit.h>
+#include <misc/conf.h>
+
+D_DEBUG_DOMAIN( Genefx_Queue, "Genefx/Queue", "Genefx Render Queue" );
+
+/**********************************************************************************************************************/
+
+/* Jobs queued at most, before waiting for the render thread. */
+#define GENEFX_QUEUE_MAX_JOBS 64
+
+typedef enum {
+     GQOP_FILL_RECTANGLE,
+     GQOP_DRAW_LINE,
+     GQOP_BLIT,
+     GQOP_STRETCH_BLIT,
+     GQOP_AFFINE_BLIT,
+     GQOP_TEXTURE_TRIANGLES,
+     GQOP_TEXTURE_TRIANGLES_AFFINE
+} GenefxQueueOp;
+
+typedef struct {
+     u32                   op;             /* GenefxQueueOp */
+     u32                   size;           /* size of the arguments following */
+} GenefxQueueCommand;
+
+typedef struct {
+     DFBRectangle          rect;
+     int                   dx;
+     int                   dy;
+} GenefxQueueBlit;
+
+typedef struct {
+     DFBRectangle          srect;
+     DFBRectangle          drect;
+} GenefxQueueStretchBlit;
+
+typedef struct {
+     DFBRegion             clip;
+     int                   num;
+     DFBTriangleFormation  formation;
+     /* vertices follow */
+} GenefxQueueTriangles;
+
+/*
+ * Operations of one gAcquire() / gRelease() cycle.
+ */
+struct _GenefxJob {
+     DirectLink            link;
+
+     CoreGraphicsSerial    serial;
+
+     CardState             state;          /* copy of the state, rendering with the Genefx state of the render thread */
+     GenefxState           gfxs;           /* pipeline as set up by gAcquireSetup() */
+
+     u8                   *commands;
+     unsigned int          length;
+     unsigned int          size;
+};
+
+typedef struct {
+     DirectMutex           lock;           /* protects the fields below */
+     DirectWaitQueue       job_cond;       /* signaled when a job has been queued or on shutdown */
+     DirectWaitQueue       done_cond;      /* signaled when a job has been rendered */
+
+     bool                  initialized;
+     bool                  shutdown;
+
+     DirectThread         *thread;
+
+     DirectLink           *jobs;           /* queued jobs, oldest first */
+     int                   num_jobs;
+
+     CoreGraphicsSerial    serial;         /* serial of the last queued job */
+     CoreGraphicsSerial    done;           /* serial of the last rendered job */
+
+     GenefxState           gfxs;           /* render thread's state, keeping its own accumulators and scale tables */
+} GenefxQueue;
+
+/* Serializes the start and stop of the render thread. */
+static DirectMutex init_lock = DIRECT_MUTEX_INITIALIZER();
+
+static GenefxQueue queue;
+
+/**********************************************************************************************************************/
+
+static inline bool
+serial_done( const CoreGraphicsSerial *serial )
+{
+     if (serial->generation != queue.done.generation)
+          return serial->generation < queue.done.generation;
+
+     return serial->serial <= queue.done.serial;
+}
+
+static void
+queue_render( GenefxJob *job )
+{
+     GenefxState       *gfxs    = &queue.gfxs;
+     void              *ABstart = gfxs->ABstart;
+     int                ABsize  = gfxs->ABsize;
+     GenefxAccumulator *Aacc    = gfxs->Aacc;
+     GenefxAccumulator *Bacc    = gfxs->Bacc;
+     GenefxAccumulator *Tacc    = gfxs->Tacc;
+     bool               ABconv  = gfxs->ABconv;
+     GenefxAccumulator *Kacc[3] = { gfxs->Kacc[0], gfxs->Kacc[1], gfxs->Kacc[2] };
+     s32               *Ksum    = gfxs->Ksum;
+     GenefxScaleTable  *scale_tables[GENEFX_SCALE_TABLES];
+     unsigned int       offset  = 0;
+
+     direct_memcpy( scale_tables, gfxs->scale_tables, sizeof(scale_tables) );
+
+     /* Start from the pipeline of the job without touching the accumulators and tables of the render thread. */
+     direct_memcpy( gfxs, &job->gfxs, sizeof(GenefxState) );
+
+     gfxs->ABstart   = ABstart;
+     gfxs->ABsize    = ABsize;
+     gfxs->Aacc      = Aacc;
+     gfxs->Bacc      = Bacc;
+     gfxs->Tacc      = Tacc;
+     gfxs->ABconv    = ABconv;
+     gfxs->Kacc[0]   = Kacc[0];
+     gfxs->Kacc[1]   = Kacc[1];
+     gfxs->Kacc[2]   = Kacc[2];
+     gfxs->Ksum      = Ksum;
+     gfxs->pipelines = NULL;
+     gfxs->stats     = NULL;
+     gfxs->job       = NULL;
+
+     direct_memcpy( gfxs->scale_tables, scale_tables, sizeof(scale_tables) );
+
+     /* The source operand may point to an operand array of the job. */
+     if (job->gfxs.Sop == job->gfxs.Aop)
+          gfxs->Sop = gfxs->Aop;
+     else if (job->gfxs.Sop == job->gfxs.Bop)
+          gfxs->Sop = gfxs->Bop;
+
+     job->state.gfxs = gfxs;
+
+     while (offset < job->length) {
+          GenefxQueueCommand *command = (GenefxQueueCommand*) (job->commands + offset);
+          void               *args    = command + 1;
+
+          switch (command->op) {
+               case GQOP_FILL_RECTANGLE:
+                    gFillRectangle( &job->state, args );
+                    break;
+
+               case GQOP_DRAW_LINE:
+                    gDrawLine( &job->state, args );
+                    break;
+
+               case GQOP_BLIT: {
+                    GenefxQueueBlit *blit = args;
+
+                    gBlit( &job->state, &blit->rect, blit->dx, blit->dy );
+                    break;
+               }
+
+               case GQOP_STRETCH_BLIT: {
+                    GenefxQueueStretchBlit *blit = args;
+
+                    gStretchBlit( &job->state, &blit->srect, &blit->drect );
+                    break;
+               }
+
+               case GQOP_AFFINE_BLIT: {
+                    GenefxQueueStretchBlit *blit = args;
+
+                    gAffineBlit( &job->state, &blit->srect, &blit->drect );
+                    break;
+               }
+
+               case GQOP_TEXTURE_TRIANGLES: {
+                    GenefxQueueTriangles *tri = args;
+
+                    Genefx_TextureTriangles( &job->state, (const DFBVertex*) (tri + 1), tri->num, tri->formation,
+                                             &tri->clip );
+                    break;
+               }
+
+               case GQOP_TEXTURE_TRIANGLES_AFFINE: {
+                    GenefxQueueTriangles *tri = args;
+
+                    Genefx_TextureTrianglesAffine( &job->state, (GenefxVertexAffine*) (tri + 1), tri->num,
+                                                   tri->formation, &tri->clip );
+                    break;
+               }
+
+               default:
+                    D_BUG( "unexpected operation %u", command->op );
+                    break;
+          }
+
+          offset += sizeof(GenefxQueueCommand) + command->size;
+     }
+}
+
+static void *
+queue_thread_main( DirectThread *thread,
+                   void         *arg )
+{
+     D_DEBUG_AT( Genefx_Queue, "%s()\n", __FUNCTION__ );
+
+     direct_mutex_lock( &queue.lock );
+
+     /* Remaining jobs are rendered before stopping. */
+     while (queue.jobs || !queue.shutdown) {
+          GenefxJob *job = (GenefxJob*) queue.jobs;
+
+          if (!job) {
+               direct_waitqueue_wait( &queue.job_cond, &queue.lock );
+               continue;
+          }
+
+          direct_mutex_unlock( &queue.lock );
+
+          queue_render( job );
+
+          direct_mutex_lock( &queue.lock );
+
+          direct_list_remove( &queue.jobs, &job->link );
+
+          queue.num_jobs--;
+          queue.done = job->serial;
+
+          direct_waitqueue_broadcast( &queue.done_cond );
+
+          if (job->commands)
+               D_FREE( job->commands );
+
+          D_FREE( job );
+     }
+
+     direct_mutex_unlock( &queue.lock );
+
+     return NULL;
+}
+
+static bool
+queue_init( void )
+{
+     direct_mutex_lock( &init_lock );
+
+     if (!queue.initialized) {
+          D_DEBUG_AT( Genefx_Queue, "%s()\n", __FUNCTION__ );
+
+          memset( &queue, 0, sizeof(queue) );
+
+          direct_mutex_init( &queue.lock );
+          direct_waitqueue_init( &queue.job_cond );
+          direct_waitqueue_init( &queue.done_cond );
+
+          queue.thread = direct_thread_create( DTT_DEFAULT, queue_thread_main, NULL, "Genefx Queue" );
+          if (!queue.thread) {
+               D_ERROR( "Genefx/Queue: Could not create render thread, rendering synchronously!\n" );
+
+               direct_waitqueue_deinit( &queue.done_cond );
+               direct_waitqueue_deinit( &queue.job_cond );
+               direct_mutex_deinit( &queue.lock );
+
+               dfb_config->software_queue = false;
+
+               direct_mutex_unlock( &init_lock );
+
+               return false;
+          }
+
+          queue.initialized = true;
+     }
+
+     direct_mutex_unlock( &init_lock );
+
+     return true;
+}
+
+static void
+queue_submit( CardState *state,
+              GenefxJob *job )
+{
+     if (!job->length) {
+          D_FREE( job );
+          return;
+     }
+
+     direct_mutex_lock( &queue.lock );
+
+     while (queue.num_jobs >= GENEFX_QUEUE_MAX_JOBS)
+          direct_waitqueue_wait( &queue.done_cond, &queue.lock );
+
+     if (!++queue.serial.serial) {
+          queue.serial.serial = 1;
+          queue.serial.generation++;
+     }
+
+     job->serial = queue.serial;
+
+     D_DEBUG_AT( Genefx_Queue, "%s( %p ) <- serial %u, %u bytes\n", __FUNCTION__,
+                 state, job->serial.serial, job->length );
+
+     /* Locks of the destination wait for this job, locks of the sources only for writing. */
+     state->dst.allocation->sw_write_serial = job->serial;
+
+     if (state->flags & CSF_SOURCE_LOCKED)
+          state->src.allocation->sw_read_serial = job->serial;
+
+     if (state->flags & CSF_SOURCE_MASK_LOCKED)
+          state->src_mask.allocation->sw_read_serial = job->serial;
+
+     direct_list_append( &queue.jobs, &job->link );
+
+     queue.num_jobs++;
+
+     direct_waitqueue_signal( &queue.job_cond );
+
+     direct_mutex_unlock( &queue.lock );
+}
+
+/*
+ * Append a command to the job being recorded, returning the space for its arguments.
+ */
+static void *
+queue_record( CardState     *state,
+              GenefxQueueOp  op,
+              unsigned int   size )
+{
+     GenefxJob          *job;
+     GenefxQueueCommand *command;
+
+     D_ASSERT( state != NULL );
+     D_ASSERT( state->gfxs != NULL );
+
+     job = state->gfxs->job;
+     if (!job)
+          return NULL;
+
+     size = (size + 3) & ~3;
+
+     if (job->length + sizeof(GenefxQueueCommand) + size > job->size) {
+          unsigned int  new_size = MAX( job->size * 2, job->length + sizeof(GenefxQueueCommand) + size );
+          u8           *commands;
+
+          new_size = MAX( new_size, 256 );
+
+          commands = D_REALLOC( job->commands, new_size );
+          if (!commands) {
+               D_OOM();
+
+               /* Render the remaining operations synchronously, after the ones recorded so far. */
+               state->gfxs->job = NULL;
+
+               queue_submit( state, job );
+
+               Genefx_Queue_Sync();
+
+               return NULL;
+          }
+
+          job->commands = commands;
+          job->size     = new_size;
+     }
+
+     command = (GenefxQueueCommand*) (job->commands + job->length);
+
+     command->op   = op;
+     command->size = size;
+
+     job->length += sizeof(GenefxQueueCommand) + size;
+
+     return command + 1;
+}
+
+static bool
+queue_record_triangles( CardState            *state,
+                        GenefxQueueOp         op,
+                        const void           *vertices,
+                        unsigned int          vertex_size,
+                        int                   num,
+                        DFBTriangleFormation  formation,
+                        const DFBRegion      *clip )
+{
+     GenefxQueueTriangles *tri;
+
+     if (num < 0)
+          return false;
+
+     tri = queue_record( state, op, sizeof(GenefxQueueTriangles) + num * vertex_size );
+     if (!tri)
+          return false;
+
+     tri->clip      = *clip;
+     tri->num       = num;
+     tri->formation = formation;
+
+     direct_memcpy( tri + 1, vertices, num * vertex_size );
+
+     return true;
+}
+
+/**********************************************************************************************************************/
+
+bool
+Genefx_Queue_Enabled()
+{
+     /* Buffer locks of other processes are managed by the master, which has to be the one waiting for the queue. */
+     return dfb_config->software_queue && !dfb_config->software_stats && dfb_core_is_master( core_dfb );
+}
+
+void
+Genefx_Queue_Begin( CardState *state )
+{
+     GenefxState *gfxs;
+     GenefxJob   *job;
+
+     D_ASSERT( state != NULL );
+     D_ASSERT( state->gfxs != NULL );
+
+     gfxs = state->gfxs;
+
+     gfxs->job = NULL;
+
+     /* Palettes and index translation tables may change before the job is rendered. */
+     if (gfxs->Alut || gfxs->Blut || gfxs->trans || !queue_init()) {
+          Genefx_Queue_Sync();
+          return;
+     }
+
+     job = D_CALLOC( 1, sizeof(GenefxJob) );
+     if (!job) {
+          D_OOM();
+          Genefx_Queue_Sync();
+          return;
+     }
+
+     direct_memcpy( &job->state, state, sizeof(CardState) );
+     direct_memcpy( &job->gfxs, gfxs, sizeof(GenefxState) );
+
+     job->state.gfxs = NULL;
+
+     /* The source operand may point to an operand array of the state. */
+     if (gfxs->Sop == gfxs->Aop)
+          job->gfxs.Sop = job->gfxs.Aop;
+     else if (gfxs->Sop == gfxs->Bop)
+          job->gfxs.Sop = job->gfxs.Bop;
+
+     gfxs->job = job;
+}
+
+void
+Genefx_Queue_End( CardState *state )
+{
+     GenefxState *gfxs;
+     GenefxJob   *job;
+
+     D_ASSERT( state != NULL );
+     D_ASSERT( state->gfxs != NULL );
+
+     gfxs = state->gfxs;
+     job  = gfxs->job;
+
+     if (!job)
+          return;
+
+     gfxs->job = NULL;
+
+     queue_submit( state, job );
+}
+
+void
+Genefx_Queue_Locking( bool locking )
+{
+     CoreTLS *core_tls = Core_GetTLS();
+
+     if (core_tls)
+          core_tls->queue_locking = locking;
+}
+
+void
+Genefx_Queue_Wait( const CoreGraphicsSerial *serial )
+{
+     CoreTLS *core_tls;
+
+     D_ASSERT( serial != NULL );
+
+     if (!queue.initialized || !serial->serial)
+          return;
+
+     /* Queued operations are rendered in order, the ones being recorded don't need to wait. */
+     core_tls = Core_GetTLS();
+     if (core_tls && core_tls->queue_locking)
+          return;
+
+     direct_mutex_lock( &queue.lock );
+
+     if (!serial_done( serial )) {
+          D_DEBUG_AT( Genefx_Queue, "%s( %u ) <- done %u\n", __FUNCTION__, serial->serial, queue.done.serial );
+
+          while (!serial_done( serial ))
+               direct_waitqueue_wait( &queue.done_cond, &queue.lock );
+     }
+
+     direct_mutex_unlock( &queue.lock );
+}
+
+void
+Genefx_Queue_Sync()
+{
+     if (!queue.initialized)
+          return;
+
+     direct_mutex_lock( &queue.lock );
+
+     while (queue.jobs)
+          direct_waitqueue_wait( &queue.done_cond, &queue.lock );
+
+     direct_mutex_unlock( &queue.lock );
+}
+
+void
+Genefx_Queue_Shutdown()
+{
+     int i;
+
+     direct_mutex_lock( &init_lock );
+
+     if (queue.initialized) {
+          D_DEBUG_AT( Genefx_Queue, "%s()\n", __FUNCTION__ );
+
+          direct_mutex_lock( &queue.lock );
+
+          queue.shutdown = true;
+
+          direct_waitqueue_broadcast( &queue.job_cond );
+
+          direct_mutex_unlock( &queue.lock );
+
+          direct_thread_join( queue.thread );
+          direct_thread_destroy( queue.thread );
+
+          if (queue.gfxs.ABstart)
+               D_FREE( queue.gfxs.ABstart );
+
+          for (i = 0; i < GENEFX_SCALE_TABLES; i++) {
+               if (queue.gfxs.scale_tables[i])
+                    D_FREE( queue.gfxs.scale_tables[i] );
+          }
+
+          direct_waitqueue_deinit( &queue.done_cond );
+          direct_waitqueue_deinit( &queue.job_cond );
+          direct_mutex_deinit( &queue.lock );
+
+          memset( &queue, 0, sizeof(queue) );
+     }
+
+     direct_mutex_unlock( &init_lock );
+}
+
+bool
+Genefx_Queue_FillRectangle( CardState          *state,
+                            const DFBRectangle *rect )
+{
+     DFBRectangle *args;
+
+     args = queue_record( state, GQOP_FILL_RECTANGLE, sizeof(DFBRectangle) );
+     if (!args)
+          return false;
+
+     *args = *rect;
+
+     return true;
+}
+
+bool
+Genefx_Queue_DrawLine( CardState       *state,
+                       const DFBRegion *line )
+{
+     DFBRegion *args;
+
+     args = queue_record( state, GQOP_DRAW_LINE, sizeof(DFBRegion) );
+     if (!args)
+          return false;
+
+     *args = *line;
+
+     return true;
+}
+
+bool
+Genefx_Queue_Blit( CardState          *state,
+                   const DFBRectangle *rect,
+                   int                 dx,
+                   int                 dy )
+{
+     GenefxQueueBlit *args;
+
+     args = queue_record( state, GQOP_BLIT, sizeof(GenefxQueueBlit) );
+     if (!args)
+          return false;
+
+     args->rect = *rect;
+     args->dx   = dx;
+     args->dy   = dy;
+
+     return true;
+}
+
+bool
+Genefx_Queue_StretchBlit( CardState          *state,
+                          const DFBRectangle *srect,
+                          const DFBRectangle *drect )
+{
+     GenefxQueueStretchBlit *args;
+
+     args = queue_record( state, GQOP_STRETCH_BLIT, sizeof(GenefxQueueStretchBlit) );
+     if (!args)
+          return false;
+
+     args->srect = *srect;
+     args->drect = *drect;
+
+     return true;
+}
+
+bool
+Genefx_Queue_AffineBlit( CardState          *state,
+                         const DFBRectangle *srect,
+                         const DFBRectangle *drect )
+{
+     GenefxQueueStretchBlit *args;
+
+     args = queue_record( state, GQOP_AFFINE_BLIT, sizeof(GenefxQueueStretchBlit) );
+     if (!args)
+          return false;
+
+     args->srect = *srect;
+     args->drect = *drect;
+
+     return true;
+}
+
+bool
+Genefx_Queue_TextureTriangles( CardState            *state,
+                               const DFBVertex      *vertices,
+                               int                   num,
+                               DFBTriangleFormation  formation,
+                               const DFBRegion      *clip )
+{
+     return queue_record_triangles( state, GQOP_TEXTURE_TRIANGLES, vertices, sizeof(DFBVertex),
+                                    num, formation, clip );
+}
+
+bool
+Genefx_Queue_TextureTrianglesAffine( CardState                *state,
+                                     const GenefxVertexAffine *vertices,
+                                     int                       num,
+                                     DFBTriangleFormation      formation,
+                                     const DFBRegion          *clip )
+{
+     return queue_record_triangles( state, GQOP_TEXTURE_TRIANGLES_AFFINE, vertices, sizeof(GenefxVertexAffine),
+                                    num, formation, clip );
+}
@@ -0,0 +1,97 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#ifndef __GENERIC_QUEUE_H__
+#define __GENERIC_QUEUE_H__
+
+#include <gfx/generic/generic_texture_triangles.h>
+
+/**********************************************************************************************************************/
+
+/*
+ * Check whether operations are queued for the render thread, as enabled by the 'software-queue' option.
+ */
+bool      Genefx_Queue_Enabled               ( void );
+
+/*
+ * Called by gAcquire() with the pipeline set up, to start recording the operations for the render thread.
+ * If the operation can't be queued, all queued operations are finished first and the caller renders synchronously.
+ */
+void      Genefx_Queue_Begin                 ( CardState                *state );
+
+/*
+ * Called by gRelease() before unlocking the buffers, to queue the recorded operations and store their serial in the
+ * locked allocations.
+ */
+void      Genefx_Queue_End                   ( CardState                *state );
+
+/*
+ * Mark the buffer locks of the calling thread as being taken for queued operations, which don't wait for the queue.
+ */
+void      Genefx_Queue_Locking               ( bool                      locking );
+
+/*
+ * Wait until the queued operation with the specified serial has been rendered.
+ */
+void      Genefx_Queue_Wait                  ( const CoreGraphicsSerial *serial );
+
+/*
+ * Wait until all queued operations have been rendered.
+ */
+void      Genefx_Queue_Sync                  ( void );
+
+/*
+ * Render the remaining operations and stop the render thread.
+ */
+void      Genefx_Queue_Shutdown              ( void );
+
+/*
+ * Record an operation while recording for the render thread, returning false if the caller has to render it.
+ */
+bool      Genefx_Queue_FillRectangle         ( CardState                *state,
+                                               const DFBRectangle       *rect );
+
+bool      Genefx_Queue_DrawLine              ( CardState                *state,
+                                               const DFBRegion          *line );
+
+bool      Genefx_Queue_Blit                  ( CardState                *state,
+                                               const DFBRectangle       *rect,
+                                               int                       dx,
+                                               int                       dy );
+
+bool      Genefx_Queue_StretchBlit           ( CardState                *state,
+                                               const DFBRectangle       *srect,
+                                               const DFBRectangle       *drect );
+
+bool      Genefx_Queue_AffineBlit            ( CardState                *state,
+                                               const DFBRectangle       *srect,
+                                               const DFBRectangle       *drect );
+
+bool      Genefx_Queue_TextureTriangles      ( CardState                *state,
+                                               const DFBVertex          *vertices,
+                                               int                       num,
+                                               DFBTriangleFormation      formation,
+                                               const DFBRegion          *clip );
+
+bool      Genefx_Queue_TextureTrianglesAffine( CardState                *state,
+                                               const GenefxVertexAffine *vertices,
+                                               int                       num,
+                                               DFBTriangleFormation      formation,
+                                               const DFBRegion          *clip );
+
+#endif
@@ -0,0 +1,999 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#include <emmintrin.h>
+
+/*
+ * The functions below are only called after a runtime check of the CPU features, the target attribute allows them to
+ * be built without enabling SSE2 for the whole library (e.g. on 32 bit x86).
+ */
+#define SSE2_FUNC __attribute__((target("sse2")))
+
+/*
+ * Two accumulators per register, lanes are (b, g, r, a) for each of them.
+ */
+
+/* Returns all bits set in the four lanes of each accumulator not marked to be skipped. */
+static inline __m128i SSE2_FUNC
+acc_mask_SSE2( __m128i acc )
+{
+     const __m128i skip = _mm_set_epi16( 0xf000, 0, 0, 0, 0xf000, 0, 0, 0 );
+     __m128i       mask = _mm_cmpeq_epi16( _mm_and_si128( acc, skip ), _mm_setzero_si128() );
+
+     return _mm_shufflehi_epi16( _mm_shufflelo_epi16( mask, 0xff ), 0xff );
+}
+
+/* Returns the alpha lane of each accumulator replicated to all its lanes. */
+static inline __m128i SSE2_FUNC
+acc_alpha_SSE2( __m128i acc )
+{
+     return _mm_shufflehi_epi16( _mm_shufflelo_epi16( acc, 0xff ), 0xff );
+}
+
+/* Returns (a * b) >> 8 truncated to 16 bits, as the C code does when storing into an accumulator. */
+static inline __m128i SSE2_FUNC
+mul8_SSE2( __m128i a,
+           __m128i b )
+{
+     return _mm_or_si128( _mm_slli_epi16( _mm_mulhi_epu16( a, b ), 8 ), _mm_srli_epi16( _mm_mullo_epi16( a, b ), 8 ) );
+}
+
+static inline __m128i SSE2_FUNC
+select_SSE2( __m128i mask,
+             __m128i a,
+             __m128i b )
+{
+     return _mm_or_si128( _mm_and_si128( mask, a ), _mm_andnot_si128( mask, b ) );
+}
+
+/* Saturates four accumulators to 8 bits and packs them into four ARGB pixels, 'mask' selects the pixels to write. */
+static inline __m128i SSE2_FUNC
+acc_to_argb_SSE2( const GenefxAccumulator *S,
+                  __m128i                 *mask )
+{
+     const __m128i max = _mm_set1_epi16( 0xff );
+     __m128i       s0  = _mm_loadu_si128( (const __m128i*) S );
+     __m128i       s1  = _mm_loadu_si128( (const __m128i*) (S + 2) );
+
+     *mask = _mm_packs_epi16( acc_mask_SSE2( s0 ), acc_mask_SSE2( s1 ) );
+
+     s0 = _mm_sub_epi16( s0, _mm_subs_epu16( s0, max ) );
+     s1 = _mm_sub_epi16( s1, _mm_subs_epu16( s1, max ) );
+
+     return _mm_packus_epi16( s0, s1 );
+}
+
+static inline void SSE2_FUNC
+store_masked_SSE2( void    *D,
+                   __m128i  pixels,
+                   __m128i  mask )
+{
+     int bits = _mm_movemask_epi8( mask );
+
+     if (bits == 0xffff)
+          _mm_storeu_si128( D, pixels );
+     else if (bits)
+          _mm_storeu_si128( D, select_SSE2( mask, pixels, _mm_loadu_si128( D ) ) );
+}
+
+/* Converts four ARGB pixels into RGB16, leaving the results sign extended in the 32 bit lanes for packing. */
+static inline __m128i SSE2_FUNC
+argb_to_rgb16_SSE2( __m128i p )
+{
+     __m128i r = _mm_and_si128( _mm_srli_epi32( p, 8 ), _mm_set1_epi32( 0xf800 ) );
+     __m128i g = _mm_and_si128( _mm_srli_epi32( p, 5 ), _mm_set1_epi32( 0x07e0 ) );
+     __m128i b = _mm_and_si128( _mm_srli_epi32( p, 3 ), _mm_set1_epi32( 0x001f ) );
+
+     return _mm_srai_epi32( _mm_slli_epi32( _mm_or_si128( _mm_or_si128( r, g ), b ), 16 ), 16 );
+}
+
+
+/*
+ * Span helpers, also used by the AVX2 functions for the remaining pixels of a span.
+ */
+
+/* Loads ARGB or RGB32 pixels, 'alpha' is or'ed into each pixel before expanding it. */
+static inline void SSE2_FUNC
+argb_to_acc_SSE2( const u32         *S,
+                  GenefxAccumulator *D,
+                  int                w,
+                  u32                alpha )
+{
+     const __m128i a = _mm_set1_epi32( alpha );
+
+     for (; w >= 4; w -= 4) {
+          __m128i s = _mm_or_si128( _mm_loadu_si128( (const __m128i*) S ), a );
+
+          _mm_storeu_si128( (__m128i*) D,       _mm_unpacklo_epi8( s, _mm_setzero_si128() ) );
+          _mm_storeu_si128( (__m128i*) (D + 2), _mm_unpackhi_epi8( s, _mm_setzero_si128() ) );
+
+          S += 4;
+          D += 4;
+     }
+
+     while (w--) {
+          u32 s = *S++ | alpha;
+
+          D->RGB.a = s >> 24;
+          D->RGB.r = (s & 0xff0000) >> 16;
+          D->RGB.g = (s & 0x00ff00) >>  8;
+          D->RGB.b =  s & 0x0000ff;
+
+          ++D;
+     }
+}
+
+static inline void SSE2_FUNC
+rgb16_to_acc_SSE2( const u16         *S,
+                   GenefxAccumulator *D,
+                   int                w )
+{
+     for (; w >= 8; w -= 8) {
+          __m128i s = _mm_loadu_si128( (const __m128i*) S );
+          __m128i r = _mm_srli_epi16( s, 11 );
+          __m128i g = _mm_and_si128( _mm_srli_epi16( s, 5 ), _mm_set1_epi16( 0x3f ) );
+          __m128i b = _mm_and_si128( s, _mm_set1_epi16( 0x1f ) );
+          __m128i a = _mm_set1_epi16( 0xff );
+          __m128i bg, ra;
+
+          r = _mm_or_si128( _mm_slli_epi16( r, 3 ), _mm_srli_epi16( r, 2 ) );
+          g = _mm_or_si128( _mm_slli_epi16( g, 2 ), _mm_srli_epi16( g, 4 ) );
+          b = _mm_or_si128( _mm_slli_epi16( b, 3 ), _mm_srli_epi16( b, 2 ) );
+
+          bg = _mm_unpacklo_epi16( b, g );
+          ra = _mm_unpacklo_epi16( r, a );
+
+          _mm_storeu_si128( (__m128i*) D,       _mm_unpacklo_epi32( bg, ra ) );
+          _mm_storeu_si128( (__m128i*) (D + 2), _mm_unpackhi_epi32( bg, ra ) );
+
+          bg = _mm_unpackhi_epi16( b, g );
+          ra = _mm_unpackhi_epi16( r, a );
+
+          _mm_storeu_si128( (__m128i*) (D + 4), _mm_unpacklo_epi32( bg, ra ) );
+          _mm_storeu_si128( (__m128i*) (D + 6), _mm_unpackhi_epi32( bg, ra ) );
+
+          S += 8;
+          D += 8;
+     }
+
+     while (w--) {
+          u16 s = *S++;
+
+          D->RGB.a = 0xff;
+          D->RGB.r = EXPAND_5to8( s >> 11 );
+          D->RGB.g = EXPAND_6to8( (s & 0x07e0) >> 5 );
+          D->RGB.b = EXPAND_5to8( s & 0x001f );
+
+          ++D;
+     }
+}
+
+/* Stores ARGB or RGB32 pixels, 'alpha' is or'ed into each pixel after packing it. */
+static inline void SSE2_FUNC
+acc_to_argb_span_SSE2( const GenefxAccumulator *S,
+                       u32                     *D,
+                       int                      w,
+                       u32                      alpha )
+{
+     for (; w >= 4; w -= 4) {
+          __m128i mask;
+          __m128i pixels = acc_to_argb_SSE2( S, &mask );
+
+          store_masked_SSE2( D, _mm_or_si128( pixels, _mm_set1_epi32( alpha ) ), mask );
+
+          S += 4;
+          D += 4;
+     }
+
+     while (w--) {
+          if (!(S->RGB.a & 0xf000))
+               *D = PIXEL_ARGB( (S->RGB.a & 0xff00) ? 0xff : S->RGB.a,
+                                (S->RGB.r & 0xff00) ? 0xff : S->RGB.r,
+                                (S->RGB.g & 0xff00) ? 0xff : S->RGB.g,
+                                (S->RGB.b & 0xff00) ? 0xff : S->RGB.b ) | alpha;
+
+          ++S;
+          ++D;
+     }
+}
+
+static inline void SSE2_FUNC
+acc_to_rgb16_span_SSE2( const GenefxAccumulator *S,
+                        u16                     *D,
+                        int                      w )
+{
+     for (; w >= 8; w -= 8) {
+          __m128i m0, m1;
+          __m128i p0 = argb_to_rgb16_SSE2( acc_to_argb_SSE2( S,     &m0 ) );
+          __m128i p1 = argb_to_rgb16_SSE2( acc_to_argb_SSE2( S + 4, &m1 ) );
+
+          store_masked_SSE2( D, _mm_packs_epi32( p0, p1 ), _mm_packs_epi32( m0, m1 ) );
+
+          S += 8;
+          D += 8;
+     }
+
+     while (w--) {
+          if (!(S->RGB.a & 0xf000))
+               *D = PIXEL_RGB16( (S->RGB.r & 0xff00) ? 0xff : S->RGB.r,
+                                 (S->RGB.g & 0xff00) ? 0xff : S->RGB.g,
+                                 (S->RGB.b & 0xff00) ? 0xff : S->RGB.b );
+
+          ++S;
+          ++D;
+     }
+}
+
+/*
+ * Multiplies all accumulators not to be skipped by a factor. Without 'S' the factor is 'base', otherwise it is
+ * 'base' plus the alpha of 'S', or 'base' minus it if 'invert' is set.
+ */
+static inline void SSE2_FUNC
+Xacc_blend_span_SSE2( GenefxAccumulator       *X,
+                      const GenefxAccumulator *Y,
+                      const GenefxAccumulator *S,
+                      int                      w,
+                      u16                      base,
+                      bool                     invert )
+{
+     __m128i b  = _mm_set1_epi16( base );
+     __m128i sa = b;
+
+     for (; w >= 2; w -= 2) {
+          __m128i y = _mm_loadu_si128( (const __m128i*) Y );
+
+          if (S) {
+               __m128i a = acc_alpha_SSE2( _mm_loadu_si128( (const __m128i*) S ) );
+
+               sa = invert ? _mm_sub_epi16( b, a ) : _mm_add_epi16( b, a );
+               S += 2;
+          }
+
+          _mm_storeu_si128( (__m128i*) X, select_SSE2( acc_mask_SSE2( y ), mul8_SSE2( sa, y ), y ) );
+
+          X += 2;
+          Y += 2;
+     }
+
+     if (w) {
+          if (!(Y->RGB.a & 0xf000)) {
+               u16 Sa = S ? (invert ? base - S->RGB.a : base + S->RGB.a) : base;
+
+               X->RGB.r = (Sa * Y->RGB.r) >> 8;
+               X->RGB.g = (Sa * Y->RGB.g) >> 8;
+               X->RGB.b = (Sa * Y->RGB.b) >> 8;
+               X->RGB.a = (Sa * Y->RGB.a) >> 8;
+          }
+          else
+               *X = *Y;
+     }
+}
+
+/* Multiplies all accumulators not to be skipped by 'factor', lanes holding 0x100 are left unchanged. */
+static inline void SSE2_FUNC
+Dacc_scale_SSE2( GenefxAccumulator *D,
+                 int                w,
+                 __m128i            factor )
+{
+     for (; w >= 2; w -= 2) {
+          __m128i d = _mm_loadu_si128( (const __m128i*) D );
+
+          _mm_storeu_si128( (__m128i*) D, select_SSE2( acc_mask_SSE2( d ), mul8_SSE2( factor, d ), d ) );
+
+          D += 2;
+     }
+
+     if (w && !(D->RGB.a & 0xf000)) {
+          __m128i d = _mm_loadl_epi64( (const __m128i*) D );
+
+          _mm_storel_epi64( (__m128i*) D, mul8_SSE2( factor, d ) );
+     }
+}
+
+static inline void SSE2_FUNC
+Dacc_premultiply_span_SSE2( GenefxAccumulator *D,
+                            int                w )
+{
+     const __m128i rgb   = _mm_set_epi16( 0, -1, -1, -1, 0, -1, -1, -1 );
+     const __m128i alpha = _mm_set_epi16( 0x100, 0, 0, 0, 0x100, 0, 0, 0 );
+
+     for (; w >= 2; w -= 2) {
+          __m128i d  = _mm_loadu_si128( (const __m128i*) D );
+          __m128i da = _mm_add_epi16( acc_alpha_SSE2( d ), _mm_set1_epi16( 1 ) );
+
+          da = _mm_or_si128( _mm_and_si128( da, rgb ), alpha );
+
+          _mm_storeu_si128( (__m128i*) D, select_SSE2( acc_mask_SSE2( d ), mul8_SSE2( da, d ), d ) );
+
+          D += 2;
+     }
+
+     if (w && !(D->RGB.a & 0xf000)) {
+          u16 Da = D->RGB.a + 1;
+
+          D->RGB.r = (Da * D->RGB.r) >> 8;
+          D->RGB.g = (Da * D->RGB.g) >> 8;
+          D->RGB.b = (Da * D->RGB.b) >> 8;
+     }
+}
+
+/* Adds 'S' to all accumulators not to be skipped, advancing 'S' only if 'Sstep' is set. */
+static inline void SSE2_FUNC
+Dacc_add_span_SSE2( GenefxAccumulator       *D,
+                    const GenefxAccumulator *S,
+                    int                      Sstep,
+                    int                      w )
+{
+     __m128i s = _mm_loadl_epi64( (const __m128i*) S );
+
+     s = _mm_unpacklo_epi64( s, s );
+
+     for (; w >= 2; w -= 2) {
+          __m128i d = _mm_loadu_si128( (const __m128i*) D );
+
+          if (Sstep)
+               s = _mm_loadu_si128( (const __m128i*) S );
+
+          _mm_storeu_si128( (__m128i*) D, select_SSE2( acc_mask_SSE2( d ), _mm_add_epi16( d, s ), d ) );
+
+          D += 2;
+          S += Sstep * 2;
+     }
+
+     if (w && !(D->RGB.a & 0xf000)) {
+          D->RGB.a += S->RGB.a;
+          D->RGB.r += S->RGB.r;
+          D->RGB.g += S->RGB.g;
+          D->RGB.b += S->RGB.b;
+     }
+}
+
+/**********************************************************************************************************************/
+
+static void SSE2_FUNC
+Sop_argb_to_Dacc_SSE2( GenefxState *gfxs )
+{
+     if (gfxs->Ostep != 1)
+          Sop_argb_to_Dacc( gfxs );
+     else
+          argb_to_acc_SSE2( gfxs->Sop[0], gfxs->Dacc, gfxs->length, 0 );
+}
+
+static void SSE2_FUNC
+Sop_rgb32_to_Dacc_SSE2( GenefxState *gfxs )
+{
+     if (gfxs->Ostep != 1)
+          Sop_rgb32_to_Dacc( gfxs );
+     else
+          argb_to_acc_SSE2( gfxs->Sop[0], gfxs->Dacc, gfxs->length, 0xff000000 );
+}
+
+static void SSE2_FUNC
+Sop_rgb16_to_Dacc_SSE2( GenefxState *gfxs )
+{
+     if (gfxs->Ostep != 1)
+          Sop_rgb16_to_Dacc( gfxs );
+     else
+          rgb16_to_acc_SSE2( gfxs->Sop[0], gfxs->Dacc, gfxs->length );
+}
+
+/*
+ * Bilinear texture lookup, the four texels are interpolated with all channels in one register.
+ */
+static inline void SSE2_FUNC
+tex_smooth_span_SSE2( GenefxState *gfxs,
+                      __m128i      alpha )
+{
+     int                s     = gfxs->s;
+     int                t     = gfxs->t;
+     int                w     = gfxs->length;
+     const u8          *S     = gfxs->Sop[0];
+     GenefxAccumulator *D     = gfxs->Dacc;
+     int                pitch = gfxs->src_pitch;
+     const __m128i      zero  = _mm_setzero_si128();
+
+     while (w--) {
+          int        x, y, dx, dy, fx, fy;
+          const u32 *S0, *S1;
+          __m128i    p0, p1, wx;
+
+          tex_smooth_coords( gfxs, s, t, &x, &y, &dx, &dy, &fx, &fy );
+
+          S0 = (const u32*) (S + y * pitch) + x;
+          S1 = (const u32*) (S + (y + dy) * pitch) + x;
+
+          /* Left and right texel of both lines, unpacked to 16 bit lanes. */
+          p0 = _mm_unpacklo_epi8( _mm_unpacklo_epi32( _mm_cvtsi32_si128( S0[0] ), _mm_cvtsi32_si128( S0[dx] ) ), zero );
+          p1 = _mm_unpacklo_epi8( _mm_unpacklo_epi32( _mm_cvtsi32_si128( S1[0] ), _mm_cvtsi32_si128( S1[dx] ) ), zero );
+
+          /* Vertical, the weights sum up to 256, so the products fit into 16 bits. */
+          p0 = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( p0, _mm_set1_epi16( 256 - fy ) ),
+                                              _mm_mullo_epi16( p1, _mm_set1_epi16( fy ) ) ), 8 );
+
+          /* Horizontal. */
+          wx = _mm_set_epi16( fx, fx, fx, fx, 256 - fx, 256 - fx, 256 - fx, 256 - fx );
+          p0 = _mm_mullo_epi16( p0, wx );
+          p0 = _mm_srli_epi16( _mm_add_epi16( p0, _mm_srli_si128( p0, 8 ) ), 8 );
+
+          _mm_storel_epi64( (__m128i*) D, _mm_or_si128( p0, alpha ) );
+
+          ++D;
+          s += gfxs->SperD;
+          t += gfxs->TperD;
+     }
+}
+
+static void SSE2_FUNC
+Sop_argb_TEX_smooth_to_Dacc_SSE2( GenefxState *gfxs )
+{
+     tex_smooth_span_SSE2( gfxs, _mm_setzero_si128() );
+}
+
+static void SSE2_FUNC
+Sop_rgb32_TEX_smooth_to_Dacc_SSE2( GenefxState *gfxs )
+{
+     tex_smooth_span_SSE2( gfxs, _mm_set_epi16( 0, 0, 0, 0, 0xff, 0, 0, 0 ) );
+}
+
+/**********************************************************************************************************************/
+
+static void SSE2_FUNC
+Sacc_to_Aop_argb_SSE2( GenefxState *gfxs )
+{
+     if (gfxs->Astep != 1)
+          Sacc_to_Aop_argb( gfxs );
+     else
+          acc_to_argb_span_SSE2( gfxs->Sacc, gfxs->Aop[0], gfxs->length, 0 );
+}
+
+static void SSE2_FUNC
+Sacc_to_Aop_rgb32_SSE2( GenefxState *gfxs )
+{
+     if (gfxs->Astep != 1)
+          Sacc_to_Aop_rgb32( gfxs );
+     else
+          acc_to_argb_span_SSE2( gfxs->Sacc, gfxs->Aop[0], gfxs->length, 0xff000000 );
+}
+
+static void SSE2_FUNC
+Sacc_to_Aop_rgb16_SSE2( GenefxState *gfxs )
+{
+     if (gfxs->Astep != 1)
+          Sacc_to_Aop_rgb16( gfxs );
+     else
+          acc_to_rgb16_span_SSE2( gfxs->Sacc, gfxs->Aop[0], gfxs->length );
+}
+
+/**********************************************************************************************************************/
+
+static void SSE2_FUNC
+Xacc_blend_srcalpha_SSE2( GenefxState *gfxs )
+{
+     if (gfxs->Sacc)
+          Xacc_blend_span_SSE2( gfxs->Xacc, gfxs->Yacc, gfxs->Sacc, gfxs->length, 1, false );
+     else
+          Xacc_blend_span_SSE2( gfxs->Xacc, gfxs->Yacc, NULL, gfxs->length, gfxs->color.a + 1, false );
+}
+
+static void SSE2_FUNC
+Xacc_blend_invsrcalpha_SSE2( GenefxState *gfxs )
+{
+     if (gfxs->Sacc)
+          Xacc_blend_span_SSE2( gfxs->Xacc, gfxs->Yacc, gfxs->Sacc, gfxs->length, 0x100, true );
+     else
+          Xacc_blend_span_SSE2( gfxs->Xacc, gfxs->Yacc, NULL, gfxs->length, 0x100 - gfxs->color.a, true );
+}
+
+/**********************************************************************************************************************/
+
+static void SSE2_FUNC
+Dacc_modulate_rgb_SSE2( GenefxState *gfxs )
+{
+     GenefxAccumulator *C = &gfxs->Cacc;
+
+     Dacc_scale_SSE2( gfxs->Dacc, gfxs->length, _mm_set_epi16( 0x100, C->RGB.r, C->RGB.g, C->RGB.b,
+                                                                0x100, C->RGB.r, C->RGB.g, C->RGB.b ) );
+}
+
+static void SSE2_FUNC
+Dacc_modulate_argb_SSE2( GenefxState *gfxs )
+{
+     GenefxAccumulator *C = &gfxs->Cacc;
+
+     Dacc_scale_SSE2( gfxs->Dacc, gfxs->length, _mm_set_epi16( C->RGB.a, C->RGB.r, C->RGB.g, C->RGB.b,
+                                                                C->RGB.a, C->RGB.r, C->RGB.g, C->RGB.b ) );
+}
+
+static void SSE2_FUNC
+Dacc_premultiply_color_alpha_SSE2( GenefxState *gfxs )
+{
+     u16 Ca = gfxs->Cacc.RGB.a;
+
+     Dacc_scale_SSE2( gfxs->Dacc, gfxs->length, _mm_set_epi16( 0x100, Ca, Ca, Ca, 0x100, Ca, Ca, Ca ) );
+}
+
+static void SSE2_FUNC
+Dacc_premultiply_SSE2( GenefxState *gfxs )
+{
+     Dacc_premultiply_span_SSE2( gfxs->Dacc, gfxs->length );
+}
+
+/* Returns the 4.12 products of 'm' summed up for each accumulator in both 32 bit lanes of it, clamped to 8 bits. */
+static inline __m128i SSE2_FUNC
+colormatrix_row_SSE2( __m128i v,
+                      __m128i m,
+                      __m128i bias )
+{
+     __m128i p = _mm_madd_epi16( v, m );
+
+     p = _mm_add_epi32( p, _mm_shuffle_epi32( p, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+     p = _mm_srai_epi32( _mm_add_epi32( p, bias ), 12 );
+     p = _mm_packs_epi32( p, p );
+     p = _mm_min_epi16( _mm_max_epi16( p, _mm_setzero_si128() ), _mm_set1_epi16( 0xff ) );
+
+     return _mm_unpacklo_epi16( p, _mm_setzero_si128() );
+}
+
+static void SSE2_FUNC
+Dacc_colormatrix_SSE2( GenefxState *gfxs )
+{
+     int                w    = gfxs->length;
+     GenefxAccumulator *D    = gfxs->Dacc;
+     const s32         *M    = gfxs->CMcoef;
+     const __m128i      mr   = _mm_set_epi16( 0, M[0], M[1], M[2],  0, M[0], M[1], M[2] );
+     const __m128i      mg   = _mm_set_epi16( 0, M[4], M[5], M[6],  0, M[4], M[5], M[6] );
+     const __m128i      mb   = _mm_set_epi16( 0, M[8], M[9], M[10], 0, M[8], M[9], M[10] );
+     const __m128i      br   = _mm_set1_epi32( M[3]  + 0x800 );
+     const __m128i      bg   = _mm_set1_epi32( M[7]  + 0x800 );
+     const __m128i      bb   = _mm_set1_epi32( M[11] + 0x800 );
+     const __m128i      even = _mm_set_epi32( 0, -1, 0, -1 );
+     const __m128i      high = _mm_set1_epi32( 0xffff0000 );
+
+     while (w > 0) {
+          __m128i v, r, g, b, res;
+
+          v = w > 1 ? _mm_loadu_si128( (const __m128i*) D ) : _mm_loadl_epi64( (const __m128i*) D );
+
+          r = colormatrix_row_SSE2( v, mr, br );
+          g = colormatrix_row_SSE2( v, mg, bg );
+          b = colormatrix_row_SSE2( v, mb, bb );
+
+          /* Lanes (b, g) from the even 32 bit lanes, (r, a) from the odd ones keeping the alpha. */
+          res = select_SSE2( even, _mm_or_si128( b, _mm_slli_epi32( g, 16 ) ),
+                             _mm_or_si128( r, _mm_and_si128( v, high ) ) );
+          res = select_SSE2( acc_mask_SSE2( v ), res, v );
+
+          if (w > 1)
+               _mm_storeu_si128( (__m128i*) D, res );
+          else
+               _mm_storel_epi64( (__m128i*) D, res );
+
+          D += 2;
+          w -= 2;
+     }
+}
+
+/**********************************************************************************************************************/
+
+static void SSE2_FUNC
+SCacc_add_to_Dacc_SSE2( GenefxState *gfxs )
+{
+     Dacc_add_span_SSE2( gfxs->Dacc, &gfxs->SCacc, 0, gfxs->length );
+}
+
+static void SSE2_FUNC
+Sacc_add_to_Dacc_SSE2( GenefxState *gfxs )
+{
+     Dacc_add_span_SSE2( gfxs->Dacc, gfxs->Sacc, 1, gfxs->length );
+}
+
+/**********************************************************************************************************************/
+
+typedef struct {
+     GenefxSrcOverFlags flags;
+     __m128i            colorize;          /* color + 1 in the color lanes, 0x100 in the alpha lanes */
+     __m128i            color_alpha;       /* color alpha */
+     __m128i            color_alpha_mod;   /* color alpha + 1 */
+} SrcOverSSE2;
+
+static inline void SSE2_FUNC
+srcover_init_SSE2( SrcOverSSE2 *so,
+                   GenefxState *gfxs )
+{
+     GenefxAccumulator *C = &gfxs->Cacc;
+
+     so->flags           = gfxs->srcover_flags;
+     so->colorize        = _mm_set_epi16( 0x100, C->RGB.r, C->RGB.g, C->RGB.b, 0x100, C->RGB.r, C->RGB.g, C->RGB.b );
+     so->color_alpha     = _mm_set1_epi16( gfxs->color.a );
+     so->color_alpha_mod = _mm_set1_epi16( C->RGB.a );
+}
+
+/*
+ * Blends two ARGB source pixels over two destination pixels, both expanded to 16 bit lanes, returning the unclamped
+ * result in 16 bit lanes. Products of 8 bit values and factors up to 0x100 fit into 16 bits, so the low half of the
+ * multiplication is sufficient.
+ */
+static inline __m128i SSE2_FUNC
+srcover_2px_SSE2( const SrcOverSSE2 *so,
+                  __m128i            s,
+                  __m128i            d )
+{
+     const __m128i alpha = _mm_set_epi16( -1, 0, 0, 0, -1, 0, 0, 0 );
+     const __m128i one   = _mm_set1_epi16( 1 );
+     __m128i       sa;
+
+     if (so->flags & GSOF_COLORIZE)
+          s = _mm_srli_epi16( _mm_mullo_epi16( s, so->colorize ), 8 );
+
+     if (so->flags & GSOF_ALPHA_COLOR)
+          sa = so->color_alpha;
+     else if (so->flags & GSOF_ALPHA_MOD)
+          sa = _mm_srli_epi16( _mm_mullo_epi16( acc_alpha_SSE2( s ), so->color_alpha_mod ), 8 );
+     else
+          sa = acc_alpha_SSE2( s );
+
+     s = select_SSE2( alpha, sa, s );
+
+     if (so->flags & GSOF_PREMULTIPLY)
+          s = _mm_srli_epi16( _mm_mullo_epi16( s, select_SSE2( alpha, _mm_set1_epi16( 0x100 ),
+                                                               _mm_add_epi16( sa, one ) ) ), 8 );
+
+     if (so->flags & GSOF_SRCALPHA)
+          s = _mm_srli_epi16( _mm_mullo_epi16( s, _mm_add_epi16( sa, one ) ), 8 );
+
+     d = _mm_srli_epi16( _mm_mullo_epi16( d, _mm_sub_epi16( _mm_set1_epi16( 0x100 ), sa ) ), 8 );
+
+     return _mm_add_epi16( s, d );
+}
+
+/* Blends four ARGB source pixels over four destination pixels. */
+static inline __m128i SSE2_FUNC
+srcover_4px_SSE2( const SrcOverSSE2 *so,
+                  __m128i            s,
+                  __m128i            d )
+{
+     const __m128i zero = _mm_setzero_si128();
+
+     return _mm_packus_epi16( srcover_2px_SSE2( so, _mm_unpacklo_epi8( s, zero ), _mm_unpacklo_epi8( d, zero ) ),
+                              srcover_2px_SSE2( so, _mm_unpackhi_epi8( s, zero ), _mm_unpackhi_epi8( d, zero ) ) );
+}
+
+/*
+ * Blends ARGB source pixels over 32 bit destination pixels. The destination is read as ARGB after or'ing 'o' and
+ * xor'ing 'x', the result is written back the same way.
+ */
+static inline void SSE2_FUNC
+srcover_span_SSE2( GenefxState *gfxs,
+                   u32          o,
+                   u32          x )
+{
+     int          w  = gfxs->length;
+     u32         *S  = gfxs->Bop[0];
+     u32         *D  = gfxs->Aop[0];
+     __m128i      vo = _mm_set1_epi32( o );
+     __m128i      vx = _mm_set1_epi32( x );
+     SrcOverSSE2  so;
+
+     srcover_init_SSE2( &so, gfxs );
+
+     for (; w >= 4; w -= 4) {
+          __m128i d = _mm_xor_si128( _mm_or_si128( _mm_loadu_si128( (const __m128i*) D ), vo ), vx );
+
+          d = srcover_4px_SSE2( &so, _mm_loadu_si128( (const __m128i*) S ), d );
+
+          _mm_storeu_si128( (__m128i*) D, _mm_xor_si128( _mm_or_si128( d, vo ), vx ) );
+
+          S += 4;
+          D += 4;
+     }
+
+     while (w--) {
+          *D = (srcover_pixel( *S, (*D | o) ^ x, so.flags, &gfxs->Cacc, gfxs->color.a ) | o) ^ x;
+
+          S++;
+          D++;
+     }
+}
+
+static void SSE2_FUNC
+Bop_argb_srcover_Aop_argb_SSE2( GenefxState *gfxs )
+{
+     if (gfxs->Astep != 1 || gfxs->Bstep != 1)
+          Bop_argb_srcover_Aop_argb( gfxs );
+     else
+          srcover_span_SSE2( gfxs, 0, 0 );
+}
+
+static void SSE2_FUNC
+Bop_argb_srcover_Aop_rgb32_SSE2( GenefxState *gfxs )
+{
+     if (gfxs->Astep != 1 || gfxs->Bstep != 1)
+          Bop_argb_srcover_Aop_rgb32( gfxs );
+     else
+          srcover_span_SSE2( gfxs, 0xff000000, 0 );
+}
+
+static void SSE2_FUNC
+Bop_argb_srcover_Aop_airgb_SSE2( GenefxState *gfxs )
+{
+     if (gfxs->Astep != 1 || gfxs->Bstep != 1)
+          Bop_argb_srcover_Aop_airgb( gfxs );
+     else
+          srcover_span_SSE2( gfxs, 0, 0xff000000 );
+}
+
+static void SSE2_FUNC
+Bop_argb_srcover_Aop_rgb16_SSE2( GenefxState *gfxs )
+{
+     int          w = gfxs->length;
+     u32         *S = gfxs->Bop[0];
+     u16         *D = gfxs->Aop[0];
+     SrcOverSSE2  so;
+
+     if (gfxs->Astep != 1 || gfxs->Bstep != 1) {
+          Bop_argb_srcover_Aop_rgb16( gfxs );
+          return;
+     }
+
+     srcover_init_SSE2( &so, gfxs );
+
+     for (; w >= 8; w -= 8) {
+          GenefxAccumulator d[8];
+          __m128i           p0, p1;
+
+          rgb16_to_acc_SSE2( D, d, 8 );
+
+          p0 = _mm_packus_epi16( srcover_2px_SSE2( &so, _mm_unpacklo_epi8( _mm_loadu_si128( (const __m128i*) S ),
+                                                                           _mm_setzero_si128() ),
+                                                   _mm_loadu_si128( (const __m128i*) d ) ),
+                                 srcover_2px_SSE2( &so, _mm_unpackhi_epi8( _mm_loadu_si128( (const __m128i*) S ),
+                                                                           _mm_setzero_si128() ),
+                                                   _mm_loadu_si128( (const __m128i*) (d + 2) ) ) );
+          p1 = _mm_packus_epi16( srcover_2px_SSE2( &so, _mm_unpacklo_epi8( _mm_loadu_si128( (const __m128i*) (S + 4) ),
+                                                                           _mm_setzero_si128() ),
+                                                   _mm_loadu_si128( (const __m128i*) (d + 4) ) ),
+                                 srcover_2px_SSE2( &so, _mm_unpackhi_epi8( _mm_loadu_si128( (const __m128i*) (S + 4) ),
+                                                                           _mm_setzero_si128() ),
+                                                   _mm_loadu_si128( (const __m128i*) (d + 6) ) ) );
+
+          _mm_storeu_si128( (__m128i*) D, _mm_packs_epi32( argb_to_rgb16_SSE2( p0 ), argb_to_rgb16_SSE2( p1 ) ) );
+
+          S += 8;
+          D += 8;
+     }
+
+     while (w--) {
+          u16 d = *D;
+          u32 p = srcover_pixel( *S, 0xff000000                             |
+                                     EXPAND_5to8( d >> 11 )           << 16 |
+                                     EXPAND_6to8( (d & 0x07e0) >> 5 ) <<  8 |
+                                     EXPAND_5to8( d & 0x001f ), so.flags, &gfxs->Cacc, gfxs->color.a );
+
+          *D = ARGB_TO_RGB16( p );
+
+          S++;
+          D++;
+     }
+}
+
+/**********************************************************************************************************************/
+
+typedef struct {
+     __m128i y_cr;      /* (298, cr_r) pairs for red */
+     __m128i y_cb;      /* (298, cb_b) pairs for blue */
+     __m128i y_round;   /* (298, 128) pairs for green */
+     __m128i cb_cr;     /* (cb_g, cr_g) pairs for green */
+} YCbCrSSE2;
+
+static inline void SSE2_FUNC
+ycbcr_init_SSE2( YCbCrSSE2               *c,
+                 const GenefxYCbCrMatrix *m )
+{
+     c->y_cr    = _mm_set_epi16( m->cr_r, 298, m->cr_r, 298, m->cr_r, 298, m->cr_r, 298 );
+     c->y_cb    = _mm_set_epi16( m->cb_b, 298, m->cb_b, 298, m->cb_b, 298, m->cb_b, 298 );
+     c->y_round = _mm_set_epi16( 128, 298, 128, 298, 128, 298, 128, 298 );
+     c->cb_cr   = _mm_set_epi16( m->cr_g, m->cb_g, m->cr_g, m->cb_g, m->cr_g, m->cb_g, m->cr_g, m->cb_g );
+}
+
+/*
+ * Converts eight pixels with Y, Cb and Cr in 16 bit lanes to RGB32, the sums of two products per 32 bit lane are the
+ * same as in ycbcr_to_rgb32() and saturating to 8 bits does the clamping.
+ */
+static inline void SSE2_FUNC
+ycbcr_to_rgb32_8px_SSE2( const YCbCrSSE2 *c,
+                         __m128i          y,
+                         __m128i          cb,
+                         __m128i          cr,
+                         u32             *D )
+{
+     const __m128i round = _mm_set1_epi32( 128 );
+     const __m128i one   = _mm_set1_epi16( 1 );
+     const __m128i alpha = _mm_set1_epi16( 0xff );
+     __m128i       r, g, b, br, ga, bg, ra;
+
+     y  = _mm_sub_epi16( y,  _mm_set1_epi16( 16 ) );
+     cb = _mm_sub_epi16( cb, _mm_set1_epi16( 128 ) );
+     cr = _mm_sub_epi16( cr, _mm_set1_epi16( 128 ) );
+
+     r = _mm_packs_epi32(
+              _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( _mm_unpacklo_epi16( y, cr ), c->y_cr ), round ), 8 ),
+              _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( _mm_unpackhi_epi16( y, cr ), c->y_cr ), round ), 8 ) );
+
+     b = _mm_packs_epi32(
+              _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( _mm_unpacklo_epi16( y, cb ), c->y_cb ), round ), 8 ),
+              _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( _mm_unpackhi_epi16( y, cb ), c->y_cb ), round ), 8 ) );
+
+     g = _mm_packs_epi32(
+              _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( _mm_unpacklo_epi16( y, one ), c->y_round ),
+                                             _mm_madd_epi16( _mm_unpacklo_epi16( cb, cr ), c->cb_cr ) ), 8 ),
+              _mm_srai_epi32( _mm_add_epi32( _mm_madd_epi16( _mm_unpackhi_epi16( y, one ), c->y_round ),
+                                             _mm_madd_epi16( _mm_unpackhi_epi16( cb, cr ), c->cb_cr ) ), 8 ) );
+
+     br = _mm_packus_epi16( b, r );
+     ga = _mm_packus_epi16( g, alpha );
+     bg = _mm_unpacklo_epi8( br, ga );
+     ra = _mm_unpackhi_epi8( br, ga );
+
+     _mm_storeu_si128( (__m128i*) D,       _mm_unpacklo_epi16( bg, ra ) );
+     _mm_storeu_si128( (__m128i*) (D + 4), _mm_unpackhi_epi16( bg, ra ) );
+}
+
+/* Converts sixteen pixels from sixteen Y samples and eight Cb and Cr samples in 16 bit lanes. */
+static inline void SSE2_FUNC
+ycbcr_to_rgb32_16px_SSE2( const YCbCrSSE2 *c,
+                          __m128i          y,
+                          __m128i          cb,
+                          __m128i          cr,
+                          u32             *D )
+{
+     const __m128i zero = _mm_setzero_si128();
+
+     ycbcr_to_rgb32_8px_SSE2( c, _mm_unpacklo_epi8( y, zero ),
+                              _mm_unpacklo_epi16( cb, cb ), _mm_unpacklo_epi16( cr, cr ), D );
+     ycbcr_to_rgb32_8px_SSE2( c, _mm_unpackhi_epi8( y, zero ),
+                              _mm_unpackhi_epi16( cb, cb ), _mm_unpackhi_epi16( cr, cr ), D + 8 );
+}
+
+static void SSE2_FUNC
+yuy2_line_to_rgb32_SSE2( GenefxState             *gfxs,
+                         u32                     *D,
+                         int                      len,
+                         const GenefxYCbCrMatrix *m )
+{
+     const __m128i  lo = _mm_set1_epi32( 0x0000ffff );
+     const u8      *S  = gfxs->Bop[0];
+     YCbCrSSE2      c;
+
+     ycbcr_init_SSE2( &c, m );
+
+     for (; len >= 8; len -= 8) {
+          __m128i s  = _mm_loadu_si128( (const __m128i*) S );
+          __m128i uv = _mm_srli_epi16( s, 8 );
+          __m128i cb = _mm_and_si128( uv, lo );
+          __m128i cr = _mm_srli_epi32( uv, 16 );
+
+          ycbcr_to_rgb32_8px_SSE2( &c, _mm_and_si128( s, _mm_set1_epi16( 0xff ) ),
+                                   _mm_or_si128( cb, _mm_slli_epi32( cb, 16 ) ),
+                                   _mm_or_si128( cr, _mm_slli_epi32( cr, 16 ) ), D );
+
+          S += 16;
+          D += 8;
+     }
+
+     yuy2_to_rgb32( S, D, len, m );
+}
+
+static void SSE2_FUNC
+i420_line_to_rgb32_SSE2( GenefxState             *gfxs,
+                         u32                     *D,
+                         int                      len,
+                         const GenefxYCbCrMatrix *m )
+{
+     const __m128i  zero = _mm_setzero_si128();
+     const u8      *Sy   = gfxs->Bop[0];
+     const u8      *Su   = gfxs->Bop[1];
+     const u8      *Sv   = gfxs->Bop[2];
+     YCbCrSSE2      c;
+
+     ycbcr_init_SSE2( &c, m );
+
+     /* A span starting at an odd pixel, see planar_to_rgb32(). */
+     if (len && (gfxs->BopX & 1)) {
+          *D++ = ycbcr_to_rgb32( *Sy++, *Su++, *Sv++, m );
+          len--;
+     }
+
+     for (; len >= 16; len -= 16) {
+          ycbcr_to_rgb32_16px_SSE2( &c, _mm_loadu_si128( (const __m128i*) Sy ),
+                                    _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i*) Su ), zero ),
+                                    _mm_unpacklo_epi8( _mm_loadl_epi64( (const __m128i*) Sv ), zero ), D );
+
+          Sy += 16;
+          Su += 8;
+          Sv += 8;
+          D  += 16;
+     }
+
+     planar_to_rgb32( Sy, Su, Sv, 1, 0, D, len, m );
+}
+
+static inline void SSE2_FUNC
+nv_line_to_rgb32_SSE2( GenefxState             *gfxs,
+                       u32                     *D,
+                       int                      len,
+                       const GenefxYCbCrMatrix *m,
+                       bool                     vu )
+{
+     const __m128i  lo = _mm_set1_epi16( 0xff );
+     const u8      *Sy = gfxs->Bop[0];
+     const u8      *Sc = gfxs->Bop[1];
+     YCbCrSSE2      c;
+
+     ycbcr_init_SSE2( &c, m );
+
+     /* A span starting at an odd pixel, see planar_to_rgb32(). */
+     if (len && (gfxs->BopX & 1)) {
+          *D++ = ycbcr_to_rgb32( *Sy++, Sc[vu], Sc[!vu], m );
+          Sc  += 2;
+          len--;
+     }
+
+     for (; len >= 16; len -= 16) {
+          __m128i s = _mm_loadu_si128( (const __m128i*) Sc );
+          __m128i a = _mm_and_si128( s, lo );
+          __m128i b = _mm_srli_epi16( s, 8 );
+
+          ycbcr_to_rgb32_16px_SSE2( &c, _mm_loadu_si128( (const __m128i*) Sy ), vu ? b : a, vu ? a : b, D );
+
+          Sy += 16;
+          Sc += 16;
+          D  += 16;
+     }
+
+     if (vu)
+          planar_to_rgb32( Sy, Sc + 1, Sc, 2, 0, D, len, m );
+     else
+          planar_to_rgb32( Sy, Sc, Sc + 1, 2, 0, D, len, m );
+}
+
+static void SSE2_FUNC
+nv12_line_to_rgb32_SSE2( GenefxState             *gfxs,
+                         u32                     *D,
+                         int                      len,
+                         const GenefxYCbCrMatrix *m )
+{
+     nv_line_to_rgb32_SSE2( gfxs, D, len, m, false );
+}
+
+static void SSE2_FUNC
+nv21_line_to_rgb32_SSE2( GenefxState             *gfxs,
+                         u32                     *D,
+                         int                      len,
+                         const GenefxYCbCrMatrix *m )
+{
+     nv_line_to_rgb32_SSE2( gfxs, D, len, m, true );
+}
+
+BOP_YCBCR_TO_AOP_RGB32( yuy2, BT601, _SSE2, SSE2_FUNC )
+BOP_YCBCR_TO_AOP_RGB32( yuy2, BT709, _SSE2, SSE2_FUNC )
+BOP_YCBCR_TO_AOP_RGB32( i420, BT601, _SSE2, SSE2_FUNC )
+BOP_YCBCR_TO_AOP_RGB32( i420, BT709, _SSE2, SSE2_FUNC )
+BOP_YCBCR_TO_AOP_RGB32( nv12, BT601, _SSE2, SSE2_FUNC )
+BOP_YCBCR_TO_AOP_RGB32( nv12, BT709, _SSE2, SSE2_FUNC )
+BOP_YCBCR_TO_AOP_RGB32( nv21, BT601, _SSE2, SSE2_FUNC )
+BOP_YCBCR_TO_AOP_RGB32( nv21, BT709, _SSE2, SSE2_FUNC )
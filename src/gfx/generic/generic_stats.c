@@ -0,0 +1,346 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#include <core/state.h>
+#include <core/surface.h>
+#include <direct/clock.h>
+#include <direct/memcpy.h>
+#include <direct/thread.h>
+#include <direct/trace.h>
+#include <directfb_util.h>
+#include <gfx/generic/generic.h>
+#include <gfx/generic/generic_stats.h>
+#include <misc/conf.h>
+
+D_DEBUG_DOMAIN( Genefx_Stats, "Genefx/Stats", "Genefx Pipeline Statistics" );
+
+/**********************************************************************************************************************/
+
+#define GENEFX_STATS_SIZE 256
+
+struct _GenefxStats {
+     bool                     valid;
+
+     /* pipeline signature */
+     DFBAccelerationMask      accel;
+     DFBSurfacePixelFormat    dst_format;
+     DFBSurfacePixelFormat    src_format;
+     DFBSurfaceDrawingFlags   drawingflags;
+     DFBSurfaceBlittingFlags  blittingflags;
+     DFBSurfaceBlendFunction  src_blend;
+     DFBSurfaceBlendFunction  dst_blend;
+     GenefxFunc               funcs[32];
+
+     bool                     need_accumulator;
+
+     /* counters */
+     unsigned int             calls;
+     unsigned long long       pixels;
+     long long                time;
+};
+
+static DirectMutex  stats_lock = DIRECT_MUTEX_INITIALIZER();
+
+static GenefxStats  stats_table[GENEFX_STATS_SIZE];
+static unsigned int stats_num;
+static long long    stats_dumped;
+static unsigned int stats_generation;
+
+/**********************************************************************************************************************/
+
+static bool
+stats_match( const GenefxStats *stats,
+             const GenefxStats *key )
+{
+     return stats->accel         == key->accel         &&
+            stats->dst_format    == key->dst_format    &&
+            stats->src_format    == key->src_format    &&
+            stats->drawingflags  == key->drawingflags  &&
+            stats->blittingflags == key->blittingflags &&
+            stats->src_blend     == key->src_blend     &&
+            stats->dst_blend     == key->dst_blend     &&
+            !memcmp( stats->funcs, key->funcs, sizeof(key->funcs) );
+}
+
+static unsigned int
+stats_hash( const GenefxStats *key )
+{
+     unsigned int i;
+     u32          hash = 0x811c9dc5;
+
+     hash = (hash ^ key->accel)         * 0x01000193;
+     hash = (hash ^ key->dst_format)    * 0x01000193;
+     hash = (hash ^ key->src_format)    * 0x01000193;
+     hash = (hash ^ key->drawingflags)  * 0x01000193;
+     hash = (hash ^ key->blittingflags) * 0x01000193;
+     hash = (hash ^ key->src_blend)     * 0x01000193;
+     hash = (hash ^ key->dst_blend)     * 0x01000193;
+
+     for (i = 0; key->funcs[i]; i++)
+          hash = (hash ^ (u32)(unsigned long) key->funcs[i]) * 0x01000193;
+
+     return (hash ^ (hash >> 16)) % GENEFX_STATS_SIZE;
+}
+
+/*
+ * Write the names of the span functions separated by blanks, or their addresses if no symbols are available.
+ */
+static unsigned int
+stats_stages( const GenefxStats *stats,
+              char              *buf,
+              int                size )
+{
+     unsigned int i;
+     int          len = 0;
+
+     buf[0] = 0;
+
+     for (i = 0; stats->funcs[i]; i++) {
+          const char *name = direct_trace_lookup_symbol_at( stats->funcs[i] );
+
+          if (len < size) {
+               if (name)
+                    len += snprintf( buf + len, size - len, "%s%s", i ? " " : "", name );
+               else
+                    len += snprintf( buf + len, size - len, "%s%p", i ? " " : "", stats->funcs[i] );
+          }
+     }
+
+     return i;
+}
+
+/*
+ * Clear the table with 'stats_lock' held, operations still running on the old entries notice the new generation.
+ */
+static void
+stats_clear( void )
+{
+     memset( stats_table, 0, sizeof(stats_table) );
+
+     stats_num    = 0;
+     stats_dumped = 0;
+
+     stats_generation++;
+}
+
+/**********************************************************************************************************************/
+
+void
+Genefx_Stats_Begin( CardState           *state,
+                    DFBAccelerationMask  accel )
+{
+     GenefxState  *gfxs;
+     GenefxStats   key;
+     unsigned int  hash;
+     unsigned int  i;
+
+     D_ASSERT( state != NULL );
+     D_ASSERT( state->gfxs != NULL );
+
+     gfxs = state->gfxs;
+
+     memset( &key, 0, sizeof(key) );
+
+     key.accel      = accel;
+     key.dst_format = state->destination->config.format;
+     key.src_blend  = state->src_blend;
+     key.dst_blend  = state->dst_blend;
+
+     if (DFB_BLITTING_FUNCTION( accel )) {
+          key.src_format    = state->source->config.format;
+          key.blittingflags = state->blittingflags;
+     }
+     else
+          key.drawingflags = state->drawingflags;
+
+     direct_memcpy( key.funcs, gfxs->funcs, sizeof(key.funcs) );
+
+     hash = stats_hash( &key );
+
+     gfxs->stats = NULL;
+
+     direct_mutex_lock( &stats_lock );
+
+     gfxs->stats_generation = stats_generation;
+
+     /* Linear probing, the table only grows until it is reset. */
+     for (i = 0; i < GENEFX_STATS_SIZE; i++) {
+          GenefxStats *stats = &stats_table[(hash + i) % GENEFX_STATS_SIZE];
+
+          if (!stats->valid) {
+               *stats = key;
+
+               stats->valid            = true;
+               stats->need_accumulator = gfxs->need_accumulator;
+
+               stats_num++;
+
+               D_DEBUG_AT( Genefx_Stats, "  -> new pipeline #%u (accel 0x%08x, %s)\n",
+                           stats_num, accel, dfb_pixelformat_name( key.dst_format ) );
+
+               gfxs->stats = stats;
+               break;
+          }
+
+          if (stats_match( stats, &key )) {
+               gfxs->stats = stats;
+               break;
+          }
+     }
+
+     direct_mutex_unlock( &stats_lock );
+
+     if (!gfxs->stats) {
+          D_ONCE( "too many different pipelines, not collecting statistics for new ones" );
+          return;
+     }
+
+     gfxs->stats_calls  = 0;
+     gfxs->stats_pixels = 0;
+     gfxs->stats_start  = direct_clock_get_micros();
+}
+
+void
+Genefx_Stats_End( CardState *state )
+{
+     GenefxState *gfxs;
+     GenefxStats *stats;
+     long long    now;
+     bool         dump = false;
+
+     D_ASSERT( state != NULL );
+     D_ASSERT( state->gfxs != NULL );
+
+     gfxs  = state->gfxs;
+     stats = gfxs->stats;
+
+     if (!stats)
+          return;
+
+     now = direct_clock_get_micros();
+
+     direct_mutex_lock( &stats_lock );
+
+     /* The entry may have been cleared or even reused since Genefx_Stats_Begin(). */
+     if (gfxs->stats_generation == stats_generation) {
+          stats->calls  += gfxs->stats_calls;
+          stats->pixels += gfxs->stats_pixels;
+          stats->time   += now - gfxs->stats_start;
+     }
+
+     if (dfb_config->software_stats_dump) {
+          if (!stats_dumped)
+               stats_dumped = now;
+          else if (now - stats_dumped >= dfb_config->software_stats_dump * 1000LL) {
+               stats_dumped = now;
+               dump         = true;
+          }
+     }
+
+     direct_mutex_unlock( &stats_lock );
+
+     gfxs->stats = NULL;
+
+     if (dump)
+          Genefx_Stats_Dump();
+}
+
+unsigned int
+Genefx_Stats_Get( DFBSoftwarePipelineStats *ret_stats,
+                  unsigned int              max,
+                  bool                      reset )
+{
+     unsigned int i;
+     unsigned int num = 0;
+
+     direct_mutex_lock( &stats_lock );
+
+     for (i = 0; i < GENEFX_STATS_SIZE && num < max && ret_stats; i++) {
+          const GenefxStats        *stats = &stats_table[i];
+          DFBSoftwarePipelineStats *ret   = &ret_stats[num];
+
+          if (!stats->valid)
+               continue;
+
+          ret->accel         = stats->accel;
+          ret->dst_format    = stats->dst_format;
+          ret->src_format    = stats->src_format;
+          ret->drawingflags  = stats->drawingflags;
+          ret->blittingflags = stats->blittingflags;
+          ret->src_blend     = stats->src_blend;
+          ret->dst_blend     = stats->dst_blend;
+          ret->accumulator   = stats->need_accumulator ? DFB_TRUE : DFB_FALSE;
+          ret->num_stages    = stats_stages( stats, ret->stages, sizeof(ret->stages) );
+          ret->calls         = stats->calls;
+          ret->pixels        = stats->pixels;
+          ret->time          = stats->time;
+
+          num++;
+     }
+
+     num = stats_num;
+
+     if (reset)
+          stats_clear();
+
+     direct_mutex_unlock( &stats_lock );
+
+     return num;
+}
+
+void
+Genefx_Stats_Reset()
+{
+     D_DEBUG_AT( Genefx_Stats, "%s()\n", __FUNCTION__ );
+
+     direct_mutex_lock( &stats_lock );
+
+     stats_clear();
+
+     direct_mutex_unlock( &stats_lock );
+}
+
+void
+Genefx_Stats_Dump()
+{
+     unsigned int i;
+     char         buf[DFB_SOFTWARE_STATS_STAGES_LENGTH];
+
+     direct_mutex_lock( &stats_lock );
+
+     D_INFO( "DirectFB/Genefx: Stats: %u pipelines\n", stats_num );
+
+     for (i = 0; i < GENEFX_STATS_SIZE; i++) {
+          const GenefxStats *stats = &stats_table[i];
+
+          if (!stats->valid || !stats->calls)
+               continue;
+
+          stats_stages( stats, buf, sizeof(buf) );
+
+          D_INFO( "DirectFB/Genefx: Stats: accel 0x%08x %-8s <- %-8s flags 0x%08x/0x%08x blend %u/%u: "
+                  "%u calls, %llu pixels, %lld us (%s)\n    %s\n",
+                  stats->accel, dfb_pixelformat_name( stats->dst_format ),
+                  stats->src_format ? dfb_pixelformat_name( stats->src_format ) : "-",
+                  stats->drawingflags, stats->blittingflags, stats->src_blend, stats->dst_blend,
+                  stats->calls, stats->pixels, stats->time, stats->need_accumulator ? "accumulator" : "fast path",
+                  buf );
+     }
+
+     direct_mutex_unlock( &stats_lock );
+}
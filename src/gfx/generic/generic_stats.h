@@ -0,0 +1,75 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#ifndef __GENERIC_STATS_H__
+#define __GENERIC_STATS_H__
+
+#include <core/coretypes.h>
+
+/**********************************************************************************************************************/
+
+/*
+ * Account an operation of the acquired pipeline, called by the operation entry points.
+ */
+#define GENEFX_STATS_COUNT( gfxs, num_pixels )                    \
+     do {                                                         \
+          if ((gfxs)->stats) {                                    \
+               (gfxs)->stats_calls++;                             \
+               (gfxs)->stats_pixels += (unsigned int)(num_pixels); \
+          }                                                       \
+     } while (0)
+
+/*
+ * Account pixels only, for operations counting them span by span.
+ */
+#define GENEFX_STATS_PIXELS( gfxs, num_pixels )                   \
+     do {                                                         \
+          if ((gfxs)->stats)                                      \
+               (gfxs)->stats_pixels += (unsigned int)(num_pixels); \
+     } while (0)
+
+/*
+ * Look up the statistics of the pipeline just set up by gAcquire() and start timing.
+ */
+void         Genefx_Stats_Begin( CardState                *state,
+                                 DFBAccelerationMask       accel );
+
+/*
+ * Add the operations accounted since Genefx_Stats_Begin() and print all statistics if the dump period has elapsed.
+ */
+void         Genefx_Stats_End  ( CardState                *state );
+
+/*
+ * Fill up to 'max' entries of 'ret_stats' (which may be NULL) and return the total number of pipelines, forgetting all
+ * statistics in the same step if 'reset' is set.
+ */
+unsigned int Genefx_Stats_Get  ( DFBSoftwarePipelineStats *ret_stats,
+                                 unsigned int              max,
+                                 bool                      reset );
+
+/*
+ * Forget all statistics collected so far.
+ */
+void         Genefx_Stats_Reset( void );
+
+/*
+ * Print the statistics of all pipelines.
+ */
+void         Genefx_Stats_Dump ( void );
+
+#endif
@@ -21,6 +21,9 @@
 #include <core/palette.h>
 #include <gfx/convert.h>
 #include <gfx/generic/generic.h>
+#include <gfx/generic/generic_queue.h>
+#include <gfx/generic/generic_stats.h>
+#include <gfx/generic/generic_threads.h>
 #include <gfx/generic/generic_util.h>
 #include <gfx/util.h>
 
@@ -29,10 +32,14 @@
 #if DFB_SMOOTH_SCALING
 
 typedef struct {
-     DFBRegion      clip;
-     const void    *colors;
-     unsigned long  protect;
-     unsigned long  key;
+     DFBRegion               clip;
+     const void             *colors;
+     unsigned long           protect;
+     unsigned long           key;
+
+     int                     flags;    /* STRETCH_SRCKEY and STRETCH_PROTECT, for the vectorized scalers only */
+     const GenefxScaleTable *htable;   /* horizontal coefficients, for the vectorized scalers only */
+     const GenefxScaleTable *vtable;   /* vertical coefficients, for the vectorized scalers only */
 } StretchCtx;
 
 typedef void (*StretchHVx)( void             *dst,
@@ -237,6 +244,206 @@ static const StretchFunctionTable *stretch_tables[DFB_NUM_PIXELFORMATS] = {
      [DFB_PIXELFORMAT_INDEX(DSPF_BGR24)]      = NULL,
 };
 
+#ifdef USE_SSE2
+
+/**********************************************************************************************************************/
+/*** Coefficient tables ***********************************************************************************************/
+/**********************************************************************************************************************/
+
+/*
+ * The vectorized scalers look up the source position and the weights of each destination column and line in tables
+ * computed once per (source size, destination size, mode) and cached in the GenefxState.
+ *
+ * Bilinear tables hold the left/top source pixel and its ratio exactly as computed by the scalar code, using the ratio
+ * bits of the format in the low byte of the mode. 4-tap tables hold four clamped source pixels and their weights.
+ */
+
+#define SCALE_TABLE_DOWN 0x100   /* bilinear downscaling, otherwise upscaling */
+#define SCALE_TABLE_4TAP 0x200   /* Catmull-Rom weights (1.14 fixed point) */
+
+struct _GenefxScaleTable {
+     int  src_size;
+     int  dst_size;
+     int  mode;
+
+     int *index;                 /* first source pixel for each destination pixel (one or four per pixel) */
+     s16 *coeffs;                /* ratio or weights for each destination pixel (one or four per pixel) */
+};
+
+static void
+scale_table_bilinear( GenefxScaleTable *table )
+{
+     int  i;
+     long bits = table->mode & 0xff;
+
+     if (table->mode & SCALE_TABLE_DOWN) {
+          long fraq = ((long) table->src_size << 18) / table->dst_size;
+          long pos  = fraq;
+
+          for (i = 0; i < table->dst_size; i++, pos += fraq) {
+               table->index[i]  = ((pos - 1) >> 18) - 1;
+               table->coeffs[i] = (((pos & 0x3ffff) ?: 0x40000) << bits) / fraq;
+          }
+     }
+     else {
+          long fraq = ((long) (table->src_size - 1) << 18) / table->dst_size;
+          long pos  = 0;
+
+          for (i = 0; i < table->dst_size; i++, pos += fraq) {
+               table->index[i]  = pos >> 18;
+               table->coeffs[i] = (pos & 0x3ffff) >> (18 - bits);
+          }
+     }
+}
+
+static void
+scale_table_4tap( GenefxScaleTable *table )
+{
+     int i, n;
+
+     for (i = 0; i < table->dst_size; i++) {
+          /* Center of the destination pixel mapped to the source, in 16.16 fixed point. */
+          s64  pos = ((s64) (2 * i + 1) * table->src_size << 16) / (2 * table->dst_size) - 0x8000;
+          s64  t   = pos & 0xffff;
+          s64  t2  = t * t << 16;
+          s64  t3  = t * t * t;
+          int  j   = (int) (pos >> 16) - 1;
+          int *idx = &table->index[i*4];
+          s16 *w   = &table->coeffs[i*4];
+
+          /* Catmull-Rom spline with t in 16 bit, rounded to 1.14 fixed point. */
+          w[0] = (- t3 + 2 * t2 - (t << 32)            + (1LL << 34)) >> 35;
+          w[1] = (3 * t3 - 5 * t2 + (2LL << 48)         + (1LL << 34)) >> 35;
+          w[2] = (- 3 * t3 + 4 * t2 + (t << 32)         + (1LL << 34)) >> 35;
+          w[3] = (t3 - t2                               + (1LL << 34)) >> 35;
+
+          /* Keep the sum of the weights exact, correcting the nearest pixel's weight. */
+          w[t < 0x8000 ? 1 : 2] += 0x4000 - (w[0] + w[1] + w[2] + w[3]);
+
+          for (n = 0; n < 4; n++)
+               idx[n] = CLAMP( j + n, 0, table->src_size - 1 );
+     }
+}
+
+/*
+ * Tables are only added to the cache before rendering starts, band workers use a copy of the cache and only look up.
+ */
+static const GenefxScaleTable *
+scale_table_lookup( GenefxState *gfxs,
+                    int          src_size,
+                    int          dst_size,
+                    int          mode,
+                    bool         create )
+{
+     int               i;
+     int               taps = (mode & SCALE_TABLE_4TAP) ? 4 : 1;
+     GenefxScaleTable *table;
+
+     for (i = 0; i < GENEFX_SCALE_TABLES; i++) {
+          table = gfxs->scale_tables[i];
+          if (!table)
+               break;
+
+          if (table->src_size == src_size && table->dst_size == dst_size && table->mode == mode) {
+               if (create) {
+                    /* Move to front. */
+                    memmove( &gfxs->scale_tables[1], &gfxs->scale_tables[0], i * sizeof(GenefxScaleTable*) );
+
+                    gfxs->scale_tables[0] = table;
+               }
+
+               return table;
+          }
+     }
+
+     if (!create)
+          return NULL;
+
+     table = D_MALLOC( sizeof(GenefxScaleTable) + dst_size * taps * (sizeof(int) + sizeof(s16)) );
+     if (!table) {
+          D_OOM();
+          return NULL;
+     }
+
+     table->src_size = src_size;
+     table->dst_size = dst_size;
+     table->mode     = mode;
+     table->index    = (int*) (table + 1);
+     table->coeffs   = (s16*) (table->index + dst_size * taps);
+
+     if (mode & SCALE_TABLE_4TAP)
+          scale_table_4tap( table );
+     else
+          scale_table_bilinear( table );
+
+     /* Replace the least recently used table. */
+     if (gfxs->scale_tables[GENEFX_SCALE_TABLES-1])
+          D_FREE( gfxs->scale_tables[GENEFX_SCALE_TABLES-1] );
+
+     memmove( &gfxs->scale_tables[1], &gfxs->scale_tables[0], (GENEFX_SCALE_TABLES - 1) * sizeof(GenefxScaleTable*) );
+
+     gfxs->scale_tables[0] = table;
+
+     return table;
+}
+
+/**********************************************************************************************************************/
+/*** SSE2 scalers *****************************************************************************************************/
+/**********************************************************************************************************************/
+
+#include "stretch_hvx_sse2.h"
+
+typedef struct {
+     StretchHVx bilinear;
+     int        hbits;      /* ratio bits of the horizontal bilinear interpolation */
+     int        vbits;      /* ratio bits of the vertical bilinear interpolation */
+     StretchHVx filter_4tap;
+} StretchSIMDFuncs;
+
+static StretchSIMDFuncs stretch_simd[DFB_NUM_PIXELFORMATS];
+
+static StretchHVx
+stretch_hvx_simd( GenefxState        *gfxs,
+                  const DFBRectangle *srect,
+                  const DFBRectangle *drect,
+                  bool                down,
+                  bool                create,
+                  StretchCtx         *ctx )
+{
+     const StretchSIMDFuncs *simd;
+     StretchHVx              stretch;
+     int                     hmode;
+     int                     vmode;
+
+     if (gfxs->src_format != gfxs->dst_format || DFB_PIXELFORMAT_IS_INDEXED( gfxs->src_format ))
+          return NULL;
+
+     simd = &stretch_simd[DFB_PIXELFORMAT_INDEX(gfxs->dst_format)];
+
+     if (dfb_config->smooth_filter == DCSF_4TAP && simd->filter_4tap) {
+          stretch = simd->filter_4tap;
+          hmode   = SCALE_TABLE_4TAP;
+          vmode   = SCALE_TABLE_4TAP;
+     }
+     else if (simd->bilinear) {
+          stretch = simd->bilinear;
+          hmode   = (down ? SCALE_TABLE_DOWN : 0) | simd->hbits;
+          vmode   = (down ? SCALE_TABLE_DOWN : 0) | simd->vbits;
+     }
+     else
+          return NULL;
+
+     ctx->htable = scale_table_lookup( gfxs, srect->w, drect->w, hmode, create );
+     ctx->vtable = scale_table_lookup( gfxs, srect->h, drect->h, vmode, create );
+
+     if (!ctx->htable || !ctx->vtable)
+          return NULL;
+
+     return stretch;
+}
+
+#endif /* USE_SSE2 */
+
 /**********************************************************************************************************************/
 /*** NV12 / NV21 8 bit scalers ****************************************************************************************/
 /**********************************************************************************************************************/
@@ -255,21 +462,22 @@ static const StretchFunctionTable *stretch_tables[DFB_NUM_PIXELFORMATS] = {
 
 __attribute__((noinline))
 static bool
-stretch_hvx_planar( CardState    *state,
-                    DFBRectangle *srect,
-                    DFBRectangle *drect,
-                    bool          down )
+stretch_hvx_planar( CardState       *state,
+                    GenefxState     *gfxs,
+                    DFBRectangle    *srect,
+                    DFBRectangle    *drect,
+                    const DFBRegion *dclip,
+                    bool             down )
 {
-     GenefxState *gfxs;
-     void        *dst;
-     void        *src;
-     DFBRegion    clip;
+     void      *dst;
+     void      *src;
+     DFBRegion  clip;
 
      D_ASSERT( state != NULL );
+     D_ASSERT( gfxs != NULL );
      DFB_RECTANGLE_ASSERT( srect );
      DFB_RECTANGLE_ASSERT( drect );
-
-     gfxs = state->gfxs;
+     DFB_REGION_ASSERT( dclip );
 
      if (state->blittingflags)
           return false;
@@ -277,7 +485,7 @@ stretch_hvx_planar( CardState    *state,
      if (gfxs->dst_format != gfxs->src_format)
           return false;
 
-     clip = state->clip;
+     clip = *dclip;
 
      if (!dfb_region_rectangle_intersect( &clip, drect ))
           return false;
@@ -322,11 +530,12 @@ stretch_hvx_planar( CardState    *state,
 
 __attribute__((noinline))
 static bool
-stretch_hvx( CardState    *state,
-             DFBRectangle *srect,
-             DFBRectangle *drect )
+stretch_hvx( CardState       *state,
+             GenefxState     *gfxs,
+             DFBRectangle    *srect,
+             DFBRectangle    *drect,
+             const DFBRegion *clip )
 {
-     GenefxState                *gfxs;
      const StretchFunctionTable *table;
      StretchHVx                  stretch;
      void                       *dst;
@@ -337,10 +546,10 @@ stretch_hvx( CardState    *state,
      int                         idx  = STRETCH_NONE;
 
      D_ASSERT( state != NULL );
+     D_ASSERT( gfxs != NULL );
      DFB_RECTANGLE_ASSERT( srect );
      DFB_RECTANGLE_ASSERT( drect );
-
-     gfxs = state->gfxs;
+     DFB_REGION_ASSERT( clip );
 
      if (srect->w > drect->w && srect->h > drect->h)
           down = true;
@@ -357,7 +566,7 @@ stretch_hvx( CardState    *state,
      switch (gfxs->dst_format) {
           case DSPF_NV12:
           case DSPF_NV21:
-               return stretch_hvx_planar( state, srect, drect, down );
+               return stretch_hvx_planar( state, gfxs, srect, drect, clip, down );
 
           default:
                break;
@@ -393,7 +602,7 @@ stretch_hvx( CardState    *state,
      if (!stretch)
           return false;
 
-     ctx.clip = state->clip;
+     ctx.clip = *clip;
 
      if (!dfb_region_rectangle_intersect( &ctx.clip, drect ))
           return false;
@@ -618,6 +827,19 @@ stretch_hvx( CardState    *state,
           }
      }
 
+     ctx.flags  = idx;
+     ctx.htable = NULL;
+     ctx.vtable = NULL;
+
+#ifdef USE_SSE2
+     if (!ctx.colors) {
+          StretchHVx simd = stretch_hvx_simd( gfxs, srect, drect, down, false, &ctx );
+
+          if (simd)
+               stretch = simd;
+     }
+#endif
+
      dst = gfxs->dst_org[0] + drect->y * gfxs->dst_pitch + DFB_BYTES_PER_LINE( gfxs->dst_format, drect->x );
      src = gfxs->src_org[0] + srect->y * gfxs->src_pitch + DFB_BYTES_PER_LINE( gfxs->src_format, srect->x );
 
@@ -626,18 +848,50 @@ stretch_hvx( CardState    *state,
      return true;
 }
 
+#ifdef USE_SSE2
+/*
+ * Adds the coefficient tables used by stretch_hvx() to the cache, before the operation is split into bands.
+ */
+static void
+stretch_hvx_prepare( CardState    *state,
+                     GenefxState  *gfxs,
+                     DFBRectangle *srect,
+                     DFBRectangle *drect )
+{
+     StretchCtx ctx;
+     bool       down = false;
+
+     if (srect->w > drect->w && srect->h > drect->h)
+          down = true;
+
+     if (!(state->render_options & (down ? DSRO_SMOOTH_DOWNSCALE : DSRO_SMOOTH_UPSCALE)))
+          return;
+
+     if (state->blittingflags & ~(DSBLIT_COLORKEY_PROTECT | DSBLIT_SRC_COLORKEY))
+          return;
+
+     stretch_hvx_simd( gfxs, srect, drect, down, true, &ctx );
+}
+#endif
+
 #endif /* DFB_SMOOTH_SCALING */
 
 /**********************************************************************************************************************/
 
 typedef void (*XopAdvanceFunc)( GenefxState *gfxs );
 
-void
-gStretchBlit( CardState    *state,
-              DFBRectangle *srect,
-              DFBRectangle *drect )
+typedef struct {
+     DFBRectangle srect;
+     DFBRectangle drect;
+} StretchBandCtx;
+
+static void
+Genefx_StretchBlit( CardState       *state,
+                    GenefxState     *gfxs,
+                    DFBRectangle    *srect,
+                    DFBRectangle    *drect,
+                    const DFBRegion *clip )
 {
-     GenefxState             *gfxs;
      XopAdvanceFunc           Aop_advance;
      XopAdvanceFunc           Bop_advance;
      int                      Aop_X;
@@ -651,11 +905,6 @@ gStretchBlit( CardState    *state,
      bool                     rotated = false;
      DFBSurfaceBlittingFlags  rotflip_blittingflags;
 
-     D_ASSERT( state != NULL );
-     D_ASSERT( state->gfxs != NULL );
-
-     gfxs = state->gfxs;
-
      rotflip_blittingflags = state->blittingflags;
 
      dfb_simplify_blittingflags( &rotflip_blittingflags );
@@ -664,22 +913,14 @@ gStretchBlit( CardState    *state,
      if (rotflip_blittingflags & DSBLIT_ROTATE90)
           rotated = true;
 
-     if (dfb_config->software_warn) {
-          D_WARN( "StretchBlit (%4d,%4d-%4dx%4d) %6s, flags 0x%08x, color 0x%02x%02x%02x%02x <- (%4d,%4d-%4dx%4d) %6s",
-                  drect->x, drect->y, drect->w, drect->h, dfb_pixelformat_name( gfxs->dst_format ),
-                  state->blittingflags, state->color.a, state->color.r, state->color.g, state->color.b,
-                  srect->x, srect->y, srect->w, srect->h, dfb_pixelformat_name( gfxs->src_format ) );
-     }
-
-     CHECK_PIPELINE();
-
 #if DFB_SMOOTH_SCALING
-     if (state->render_options & (DSRO_SMOOTH_UPSCALE | DSRO_SMOOTH_DOWNSCALE) && stretch_hvx( state, srect, drect ))
+     if (state->render_options & (DSRO_SMOOTH_UPSCALE | DSRO_SMOOTH_DOWNSCALE) &&
+         stretch_hvx( state, gfxs, srect, drect, clip ))
           return;
 #endif
 
      /* Clip destination rectangle. */
-     if (!dfb_rectangle_intersect_by_region( drect, &state->clip ))
+     if (!dfb_rectangle_intersect_by_region( drect, clip ))
           return;
 
      /* Calculate fractions */
@@ -752,8 +993,8 @@ gStretchBlit( CardState    *state,
 
      D_ASSERT( srect->x + srect->w <= state->source->config.size.w );
      D_ASSERT( srect->y + srect->h <= state->source->config.size.h );
-     D_ASSERT( drect->x + drect->w <= state->clip.x2 + 1 );
-     D_ASSERT( drect->y + drect->h <= state->clip.y2 + 1 );
+     D_ASSERT( drect->x + drect->w <= clip->x2 + 1 );
+     D_ASSERT( drect->y + drect->h <= clip->y2 + 1 );
 
      if (!Genefx_ABacc_prepare( gfxs, MAX( srect->w, drect->w ) ))
           return;
@@ -870,3 +1111,98 @@ gStretchBlit( CardState    *state,
 
      Genefx_ABacc_flush( gfxs );
 }
+
+static void
+stretch_blit_band( CardState       *state,
+                   GenefxState     *gfxs,
+                   const DFBRegion *band,
+                   void            *ctx )
+{
+     StretchBandCtx *stretch = ctx;
+     DFBRectangle    srect   = stretch->srect;
+     DFBRectangle    drect   = stretch->drect;
+     DFBRegion       clip    = state->clip;
+
+     /* Scaling phases are derived from the unclipped rectangles, so each band renders exactly its part. */
+     if (dfb_region_region_intersect( &clip, band ))
+          Genefx_StretchBlit( state, gfxs, &srect, &drect, &clip );
+}
+
+void
+gStretchBlit( CardState    *state,
+              DFBRectangle *srect,
+              DFBRectangle *drect )
+{
+     GenefxState             *gfxs;
+     DFBSurfaceBlittingFlags  rotflip_blittingflags;
+
+     D_ASSERT( state != NULL );
+     D_ASSERT( state->gfxs != NULL );
+
+     if (Genefx_Queue_StretchBlit( state, srect, drect ))
+          return;
+
+     gfxs = state->gfxs;
+
+     rotflip_blittingflags = state->blittingflags;
+
+     dfb_simplify_blittingflags( &rotflip_blittingflags );
+
+     if (dfb_config->software_warn) {
+          D_WARN( "StretchBlit (%4d,%4d-%4dx%4d) %6s, flags 0x%08x, color 0x%02x%02x%02x%02x <- (%4d,%4d-%4dx%4d) %6s",
+                  drect->x, drect->y, drect->w, drect->h, dfb_pixelformat_name( gfxs->dst_format ),
+                  state->blittingflags, state->color.a, state->color.r, state->color.g, state->color.b,
+                  srect->x, srect->y, srect->w, srect->h, dfb_pixelformat_name( gfxs->src_format ) );
+     }
+
+     CHECK_PIPELINE();
+
+     GENEFX_STATS_COUNT( gfxs, drect->w * drect->h );
+
+#if DFB_SMOOTH_SCALING && defined(USE_SSE2)
+     if (state->render_options & (DSRO_SMOOTH_UPSCALE | DSRO_SMOOTH_DOWNSCALE))
+          stretch_hvx_prepare( state, gfxs, srect, drect );
+#endif
+
+     /* Rotated stretches and planar formats stepping backwards through their lines run in one piece. */
+     if (!(rotflip_blittingflags & DSBLIT_ROTATE90) &&
+         !((rotflip_blittingflags & DSBLIT_FLIP_VERTICAL) && DFB_PLANAR_PIXELFORMAT( gfxs->dst_format )) &&
+         !(gfxs->src_caps & DSCAPS_SEPARATED)) {
+          StretchBandCtx ctx;
+          DFBRegion      area = state->clip;
+
+          if (!dfb_region_rectangle_intersect( &area, drect ))
+               return;
+
+          ctx.srect = *srect;
+          ctx.drect = *drect;
+
+          if (Genefx_Bands_Run( state, &area, stretch_blit_band, &ctx ))
+               return;
+     }
+
+     Genefx_StretchBlit( state, gfxs, srect, drect, &state->clip );
+}
+
+#ifdef USE_SSE2
+void
+gInitStretchBlit_SSE2( void )
+{
+#if DFB_SMOOTH_SCALING
+     stretch_simd[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)].bilinear    = stretch_bilinear_RGB16_SSE2;
+     stretch_simd[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)].hbits       = 6;
+     stretch_simd[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)].vbits       = 5;
+     stretch_simd[DFB_PIXELFORMAT_INDEX(DSPF_RGB16)].filter_4tap = stretch_4tap_RGB16_SSE2;
+
+     stretch_simd[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)].bilinear    = stretch_bilinear_RGB32_SSE2;
+     stretch_simd[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)].hbits       = 8;
+     stretch_simd[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)].vbits       = 8;
+     stretch_simd[DFB_PIXELFORMAT_INDEX(DSPF_RGB32)].filter_4tap = stretch_4tap_RGB32_SSE2;
+
+     stretch_simd[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)].bilinear     = stretch_bilinear_ARGB_SSE2;
+     stretch_simd[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)].hbits        = 8;
+     stretch_simd[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)].vbits        = 8;
+     stretch_simd[DFB_PIXELFORMAT_INDEX(DSPF_ARGB)].filter_4tap  = stretch_4tap_ARGB_SSE2;
+#endif
+}
+#endif
@@ -27,4 +27,9 @@ void gStretchBlit( CardState    *state,
                    DFBRectangle *srect,
                    DFBRectangle *drect );
 
+/*
+ * Enable the SSE2 smooth scaling routines, called once the CPU has been checked.
+ */
+void gInitStretchBlit_SSE2( void );
+
 #endif
@@ -18,7 +18,10 @@
 
 #include <core/state.h>
 #include <gfx/generic/generic.h>
+#include <gfx/generic/generic_queue.h>
+#include <gfx/generic/generic_stats.h>
 #include <gfx/generic/generic_texture_triangles.h>
+#include <gfx/generic/generic_threads.h>
 #include <gfx/generic/generic_util.h>
 
 /**********************************************************************************************************************/
@@ -309,6 +312,8 @@ Genefx_TextureTriangleAffine( GenefxState        *gfxs,
                gfxs->s      = csl;
                gfxs->t      = ctl;
 
+               GENEFX_STATS_PIXELS( gfxs, gfxs->Dlen );
+
                Genefx_Aop_xy( gfxs, x1, y );
 
                RUN_PIPELINE();
@@ -325,6 +330,305 @@ Genefx_TextureTriangleAffine( GenefxState        *gfxs,
      }
 }
 
+/**********************************************************************************************************************/
+
+/*
+ * Vertex of a perspective correct triangle, texture coordinates and their weight are divided by w.
+ */
+typedef struct {
+     int   x;
+     int   y;
+     float s;
+     float t;
+     float q;
+} GenefxVertexPerspective;
+
+/* Number of pixels between two exact texture coordinates, the ones in between are interpolated linearly. */
+#define PERSPECTIVE_RUN 16
+
+/* Returns the 16.16 texture coordinate 'v' clamped to the texture of the size 'size'. */
+static inline int
+perspective_coord( float v,
+                   int   size )
+{
+     if (v <= 0.0f)
+          return 0;
+
+     if (v >= size)
+          return (size << 16) - 1;
+
+     return v * 0x10000;
+}
+
+static void
+Genefx_TextureTrianglePerspective( GenefxState             *gfxs,
+                                   GenefxVertexPerspective *v0,
+                                   GenefxVertexPerspective *v1,
+                                   GenefxVertexPerspective *v2,
+                                   const DFBRegion         *clip )
+{
+     GenefxVertexPerspective *v_tmp;
+     int                      y, y_top, y_bottom;
+     float                    det;
+     float                    dsdx, dsdy, dtdx, dtdy, dqdx, dqdy;
+     DDA                      dda1 = { .xi = 0 }, dda2 = { .xi = 0 };
+
+     /* Triangle sorting (vertical). */
+     if (v1->y < v0->y) {
+          v_tmp = v0;
+          v0    = v1;
+          v1    = v_tmp;
+     }
+     if (v2->y < v0->y) {
+          v_tmp = v2;
+          v2 = v1;
+          v1 = v0;
+          v0 = v_tmp;
+     }
+     else if (v2->y < v1->y) {
+          v_tmp = v1;
+          v1    = v2;
+          v2    = v_tmp;
+     }
+
+     y_top    = v0->y;
+     y_bottom = v2->y;
+
+     /* Totally clipped (vertical). */
+     if (y_top > clip->y2 || y_bottom < clip->y1)
+          return;
+
+     /* Totally clipped right or left. */
+     if ((v0->x > clip->x2 && v1->x > clip->x2 && v2->x > clip->x2) ||
+         (v0->x < clip->x1 && v1->x < clip->x1 && v2->x < clip->x1))
+          return;
+
+     /* Gradients of the attributes, which are linear in screen space after dividing them by w. */
+     det = (float) (v1->x - v0->x) * (v2->y - v0->y) - (float) (v2->x - v0->x) * (v1->y - v0->y);
+     if (det == 0.0f)
+          return;
+
+     dsdx = ((v1->s - v0->s) * (v2->y - v0->y) - (v2->s - v0->s) * (v1->y - v0->y)) / det;
+     dsdy = ((v2->s - v0->s) * (v1->x - v0->x) - (v1->s - v0->s) * (v2->x - v0->x)) / det;
+     dtdx = ((v1->t - v0->t) * (v2->y - v0->y) - (v2->t - v0->t) * (v1->y - v0->y)) / det;
+     dtdy = ((v2->t - v0->t) * (v1->x - v0->x) - (v1->t - v0->t) * (v2->x - v0->x)) / det;
+     dqdx = ((v1->q - v0->q) * (v2->y - v0->y) - (v2->q - v0->q) * (v1->y - v0->y)) / det;
+     dqdy = ((v2->q - v0->q) * (v1->x - v0->x) - (v1->q - v0->q) * (v2->x - v0->x)) / det;
+
+     /* Edges are walked as in the affine case, so that both cover the same pixels. */
+     SETUP_DDA( v0->x, v0->y, v2->x, v2->y, dda1 );
+     SETUP_DDA( v0->x, v0->y, v1->x, v1->y, dda2 );
+
+     if (y_top < clip->y1)
+          y_top = clip->y1;
+
+     if (y_bottom > clip->y2)
+          y_bottom = clip->y2;
+
+     for (y = v0->y; y < y_top; y++) {
+          if (y == v1->y)
+               SETUP_DDA( v1->x, v1->y, v2->x, v2->y, dda2 );
+
+          INC_DDA( dda1 );
+          INC_DDA( dda2 );
+     }
+
+     for (y = y_top; y <= y_bottom; y++) {
+          if (y == v1->y)
+               SETUP_DDA( v1->x, v1->y, v2->x, v2->y, dda2 );
+
+          int len = ABS( dda1.xi - dda2.xi );
+          int x1  = MAX( MIN( dda1.xi, dda2.xi ), clip->x1 );
+          int x2  = MIN( MIN( dda1.xi, dda2.xi ) + len - 1, clip->x2 );
+
+          if (len > 0 && x1 <= x2) {
+               float s  = v0->s + dsdx * (x1 - v0->x) + dsdy * (y - v0->y);
+               float t  = v0->t + dtdx * (x1 - v0->x) + dtdy * (y - v0->y);
+               float q  = v0->q + dqdx * (x1 - v0->x) + dqdy * (y - v0->y);
+               int   cs = perspective_coord( s / q, gfxs->src_width );
+               int   ct = perspective_coord( t / q, gfxs->src_height );
+               int   x;
+
+               GENEFX_STATS_PIXELS( gfxs, x2 - x1 + 1 );
+
+               /* Divide at the ends of each run only. */
+               for (x = x1; x <= x2; x += PERSPECTIVE_RUN) {
+                    int n = MIN( PERSPECTIVE_RUN, x2 - x + 1 );
+                    int ns, nt;
+
+                    s += dsdx * n;
+                    t += dtdx * n;
+                    q += dqdx * n;
+
+                    ns = perspective_coord( s / q, gfxs->src_width );
+                    nt = perspective_coord( t / q, gfxs->src_height );
+
+                    gfxs->Dlen   = n;
+                    gfxs->length = n;
+                    gfxs->SperD  = (ns - cs) / n;
+                    gfxs->TperD  = (nt - ct) / n;
+                    gfxs->s      = cs;
+                    gfxs->t      = ct;
+
+                    Genefx_Aop_xy( gfxs, x, y );
+
+                    RUN_PIPELINE();
+
+                    cs = ns;
+                    ct = nt;
+               }
+          }
+
+          INC_DDA( dda1 );
+          INC_DDA( dda2 );
+     }
+}
+
+/**********************************************************************************************************************/
+
+typedef struct {
+     const void           *vertices;
+     bool                  perspective;
+     int                   num;
+     DFBTriangleFormation  formation;
+     const DFBRegion      *clip;
+} TextureTrianglesCtx;
+
+/*
+ * Get the indices of the next triangle starting at 'index', returns the index following it or -1 at the end.
+ */
+static int
+next_triangle( int                   index,
+               int                   num,
+               DFBTriangleFormation  formation,
+               int                  *ret_v )
+{
+     if (index == 0 || formation == DTTF_LIST) {
+          if (index + 3 > num)
+               return -1;
+
+          ret_v[0] = index + 0;
+          ret_v[1] = index + 1;
+          ret_v[2] = index + 2;
+
+          return index + 3;
+     }
+
+     if (index >= num)
+          return -1;
+
+     switch (formation) {
+          case DTTF_STRIP:
+               ret_v[0] = index - 2;
+               ret_v[1] = index - 1;
+               ret_v[2] = index + 0;
+               break;
+
+          case DTTF_FAN:
+               ret_v[0] = 0;
+               ret_v[1] = index - 1;
+               ret_v[2] = index + 0;
+               break;
+
+          default:
+               D_BUG( "unknown formation %u", formation );
+               return -1;
+     }
+
+     return index + 1;
+}
+
+/*
+ * Render all triangles touching the lines of 'clip', keeping their order.
+ */
+static void
+texture_triangles_render( CardState                 *state,
+                          GenefxState               *gfxs,
+                          const TextureTrianglesCtx *tri,
+                          const DFBRegion           *clip )
+{
+     int index = 0;
+     int v[3];
+
+     if (!Genefx_ABacc_prepare( gfxs, state->destination->config.size.w ))
+          return;
+
+     /* Reset Bop to 0,0 as texture lookup accesses the whole buffer arbitrarily. */
+     Genefx_Bop_xy( gfxs, 0, 0 );
+
+     while ((index = next_triangle( index, tri->num, tri->formation, v )) >= 0) {
+          if (tri->perspective) {
+               GenefxVertexPerspective *vertices = (GenefxVertexPerspective*) tri->vertices;
+               GenefxVertexPerspective  p[3]     = { vertices[v[0]], vertices[v[1]], vertices[v[2]] };
+
+               /* Skip triangles outside of the band. */
+               if (MAX( MAX( p[0].y, p[1].y ), p[2].y ) < clip->y1 || MIN( MIN( p[0].y, p[1].y ), p[2].y ) > clip->y2)
+                    continue;
+
+               Genefx_TextureTrianglePerspective( gfxs, &p[0], &p[1], &p[2], clip );
+          }
+          else {
+               GenefxVertexAffine *vertices = (GenefxVertexAffine*) tri->vertices;
+               GenefxVertexAffine  a[3]     = { vertices[v[0]], vertices[v[1]], vertices[v[2]] };
+
+               if (MAX( MAX( a[0].y, a[1].y ), a[2].y ) < clip->y1 || MIN( MIN( a[0].y, a[1].y ), a[2].y ) > clip->y2)
+                    continue;
+
+               Genefx_TextureTriangleAffine( gfxs, &a[0], &a[1], &a[2], clip );
+          }
+     }
+
+     Genefx_ABacc_flush( gfxs );
+}
+
+static void
+texture_triangles_band( CardState       *state,
+                        GenefxState     *gfxs,
+                        const DFBRegion *band,
+                        void            *ctx )
+{
+     TextureTrianglesCtx *tri  = ctx;
+     DFBRegion            clip = *tri->clip;
+
+     clip.y1 = MAX( clip.y1, band->y1 );
+     clip.y2 = MIN( clip.y2, band->y2 );
+
+     texture_triangles_render( state, gfxs, tri, &clip );
+}
+
+/*
+ * Render a batch of triangles, split into bands of lines on multiple threads if it is large enough. Each band renders
+ * the triangles overlapping it in their original order.
+ */
+static void
+texture_triangles_run( CardState           *state,
+                       TextureTrianglesCtx *tri,
+                       int                  min_x,
+                       int                  min_y,
+                       int                  max_x,
+                       int                  max_y )
+{
+     GenefxState *gfxs = state->gfxs;
+     DFBRegion    area;
+
+     CHECK_PIPELINE();
+
+     GENEFX_STATS_COUNT( gfxs, 0 );
+
+     area.x1 = MAX( min_x, tri->clip->x1 );
+     area.y1 = MAX( min_y, tri->clip->y1 );
+     area.x2 = MIN( max_x, tri->clip->x2 );
+     area.y2 = MIN( max_y, tri->clip->y2 );
+
+     if (area.x1 > area.x2 || area.y1 > area.y2)
+          return;
+
+     if (Genefx_Bands_Run( state, &area, texture_triangles_band, tri ))
+          return;
+
+     texture_triangles_render( state, gfxs, tri, tri->clip );
+}
+
 void
 Genefx_TextureTrianglesAffine( CardState            *state,
                                GenefxVertexAffine   *vertices,
@@ -332,76 +636,123 @@ Genefx_TextureTrianglesAffine( CardState            *state,
                                DFBTriangleFormation  formation,
                                const DFBRegion      *clip )
 {
-     GenefxState *gfxs;
-     int          index = 0;
+     GenefxState         *gfxs;
+     TextureTrianglesCtx  tri;
+     int                  i;
+     int                  min_x = INT_MAX, min_y = INT_MAX;
+     int                  max_x = INT_MIN, max_y = INT_MIN;
 
      D_ASSERT( state != NULL );
      D_ASSERT( state->gfxs != NULL );
 
+     if (Genefx_Queue_TextureTrianglesAffine( state, vertices, num, formation, clip ))
+          return;
+
      gfxs = state->gfxs;
 
-     CHECK_PIPELINE();
+     for (i = 0; i < num; i++) {
+          min_x = MIN( min_x, vertices[i].x );
+          min_y = MIN( min_y, vertices[i].y );
+          max_x = MAX( max_x, vertices[i].x );
+          max_y = MAX( max_y, vertices[i].y );
+     }
 
-     if (!Genefx_ABacc_prepare( gfxs, state->destination->config.size.w ))
+     if (dfb_config->software_warn) {
+          D_WARN( "TexTriangles (%d,%d-%d,%d) x %d %6s, flags 0x%08x, color 0x%02x%02x%02x%02x <- (%4d,%4d) %6s",
+                  min_x, min_y, max_x, max_y, num, dfb_pixelformat_name( gfxs->dst_format ), state->blittingflags,
+                  state->color.a, state->color.r, state->color.g, state->color.b,
+                  state->source->config.size.w, state->source->config.size.h,
+                  dfb_pixelformat_name( gfxs->src_format ) );
+     }
+
+     tri.vertices    = vertices;
+     tri.perspective = false;
+     tri.num         = num;
+     tri.formation   = formation;
+     tri.clip        = clip;
+
+     texture_triangles_run( state, &tri, min_x, min_y, max_x, max_y );
+}
+
+void
+Genefx_TextureTriangles( CardState            *state,
+                         const DFBVertex      *vertices,
+                         int                   num,
+                         DFBTriangleFormation  formation,
+                         const DFBRegion      *clip )
+{
+     GenefxState *gfxs;
+     int          i;
+     int          sw, sh;
+     bool         perspective = false;
+
+     D_ASSERT( state != NULL );
+     D_ASSERT( state->gfxs != NULL );
+     D_ASSERT( vertices != NULL );
+
+     if (Genefx_Queue_TextureTriangles( state, vertices, num, formation, clip ))
           return;
 
-     /* Reset Bop to 0,0 as texture lookup accesses the whole buffer arbitrarily. */
-     Genefx_Bop_xy( gfxs, 0, 0 );
+     gfxs = state->gfxs;
+     sw   = state->source->config.size.w;
+     sh   = state->source->config.size.h;
 
-     /* Render triangles. */
-     for (index = 0; index < num;) {
-          GenefxVertexAffine *v[3];
+     /* Without different positive w the interpolation is affine. */
+     for (i = 1; i < num; i++) {
+          if (vertices[i].w != vertices[0].w)
+               perspective = true;
+     }
 
-          if (index == 0) {
-               v[0] = &vertices[index+0];
-               v[1] = &vertices[index+1];
-               v[2] = &vertices[index+2];
+     for (i = 0; i < num && perspective; i++) {
+          if (vertices[i].w <= 0.0f)
+               perspective = false;
+     }
 
-               index += 3;
-          }
-          else {
-               switch (formation) {
-                    case DTTF_LIST:
-                         v[0] = &vertices[index+0];
-                         v[1] = &vertices[index+1];
-                         v[2] = &vertices[index+2];
-
-                         index += 3;
-                         break;
-
-                    case DTTF_STRIP:
-                         v[0] = &vertices[index-2];
-                         v[1] = &vertices[index-1];
-                         v[2] = &vertices[index+0];
-
-                         index += 1;
-                         break;
-
-                    case DTTF_FAN:
-                         v[0] = &vertices[0];
-                         v[1] = &vertices[index-1];
-                         v[2] = &vertices[index+0];
-
-                         index += 1;
-                         break;
-
-                    default:
-                         D_BUG( "unknown formation %u", formation );
-                         Genefx_ABacc_flush( gfxs );
-                         return;
-               }
+     if (perspective) {
+          GenefxVertexPerspective v[num];
+          TextureTrianglesCtx     tri;
+          int                     min_x = INT_MAX, min_y = INT_MAX;
+          int                     max_x = INT_MIN, max_y = INT_MIN;
+
+          for (i = 0; i < num; i++) {
+               float q = 1.0f / vertices[i].w;
+
+               v[i].x = vertices[i].x;
+               v[i].y = vertices[i].y;
+               v[i].s = vertices[i].s * sw * q;
+               v[i].t = vertices[i].t * sh * q;
+               v[i].q = q;
+
+               min_x = MIN( min_x, v[i].x );
+               min_y = MIN( min_y, v[i].y );
+               max_x = MAX( max_x, v[i].x );
+               max_y = MAX( max_y, v[i].y );
           }
 
           if (dfb_config->software_warn) {
-               D_WARN( "TexTriangles (%d,%d-%d,%d-%d,%d) %6s, flags 0x%08x, color 0x%02x%02x%02x%02x <- (%4d,%4d) %6s",
-                       v[0]->x, v[0]->y, v[1]->x, v[1]->y, v[2]->x, v[2]->y, dfb_pixelformat_name( gfxs->dst_format ),
-                       state->blittingflags, state->color.a, state->color.r, state->color.g, state->color.b,
-                       state->source->config.size.w, state->source->config.size.h,
-                       dfb_pixelformat_name( gfxs->src_format ) );
+               D_WARN( "TexTriangles (%d,%d-%d,%d) x %d perspective %6s, flags 0x%08x <- (%4d,%4d) %6s",
+                       min_x, min_y, max_x, max_y, num, dfb_pixelformat_name( gfxs->dst_format ),
+                       state->blittingflags, sw, sh, dfb_pixelformat_name( gfxs->src_format ) );
           }
 
-          Genefx_TextureTriangleAffine( gfxs, v[0], v[1], v[2], clip );
+          tri.vertices    = v;
+          tri.perspective = true;
+          tri.num         = num;
+          tri.formation   = formation;
+          tri.clip        = clip;
+
+          texture_triangles_run( state, &tri, min_x, min_y, max_x, max_y );
      }
+     else {
+          GenefxVertexAffine v[num];
 
-     Genefx_ABacc_flush( gfxs );
+          for (i = 0; i < num; i++) {
+               v[i].x = vertices[i].x;
+               v[i].y = vertices[i].y;
+               v[i].s = vertices[i].s * sw * 0x10000;
+               v[i].t = vertices[i].t * sh * 0x10000;
+          }
+
+          Genefx_TextureTrianglesAffine( state, v, num, formation, clip );
+     }
 }
@@ -38,4 +38,10 @@ void Genefx_TextureTrianglesAffine( CardState            *state,
                                     DFBTriangleFormation  formation,
                                     const DFBRegion      *clip );
 
+void Genefx_TextureTriangles      ( CardState            *state,
+                                    const DFBVertex      *vertices,
+                                    int                   num,
+                                    DFBTriangleFormation  formation,
+                                    const DFBRegion      *clip );
+
 #endif
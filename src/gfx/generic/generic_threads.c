@@ -0,0 +1,313 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#include <core/state.h>
+#include <direct/memcpy.h>
+#include <direct/thread.h>
+#include <gfx/generic/generic.h>
+#include <gfx/generic/generic_threads.h>
+
+D_DEBUG_DOMAIN( Genefx_Bands, "Genefx/Bands", "Genefx Banded Rendering" );
+
+/**********************************************************************************************************************/
+
+#define GENEFX_MAX_BANDS      16
+#define GENEFX_MIN_BAND_LINES 8
+
+typedef struct {
+     DirectThread     *thread;
+
+     GenefxState       gfxs;           /* private copy of the pipeline, keeping its own accumulators */
+} BandWorker;
+
+typedef struct {
+     DirectMutex       lock;           /* protects the job fields below */
+     DirectWaitQueue   job_cond;       /* signaled when new bands are available or on shutdown */
+     DirectWaitQueue   done_cond;      /* signaled when the last band of a job has been rendered */
+
+     bool              initialized;
+     bool              shutdown;
+
+     int               num_workers;
+     BandWorker        workers[GENEFX_MAX_BANDS-1];
+
+     CardState        *state;
+     GenefxState       base;           /* pipeline as set up by gAcquireSetup(), copied into each band's state */
+     GenefxBandFunc    func;
+     void             *ctx;
+
+     DFBRegion         bands[GENEFX_MAX_BANDS];
+     int               num_bands;
+     int               next_band;
+     int               pending;
+} BandPool;
+
+/* Serializes jobs as well as the start and stop of the pool. */
+static DirectMutex run_lock = DIRECT_MUTEX_INITIALIZER();
+
+static BandPool    pool;
+
+/**********************************************************************************************************************/
+
+static void
+band_render( GenefxState *gfxs,
+             int          index )
+{
+     void              *ABstart = gfxs->ABstart;
+     int                ABsize  = gfxs->ABsize;
+     GenefxAccumulator *Aacc    = gfxs->Aacc;
+     GenefxAccumulator *Bacc    = gfxs->Bacc;
+     GenefxAccumulator *Tacc    = gfxs->Tacc;
+     bool               ABconv  = gfxs->ABconv;
+     GenefxAccumulator *Kacc[3] = { gfxs->Kacc[0], gfxs->Kacc[1], gfxs->Kacc[2] };
+     s32               *Ksum    = gfxs->Ksum;
+
+     /* Start from the pipeline state without touching the accumulators owned by 'gfxs'. */
+     direct_memcpy( gfxs, &pool.base, sizeof(GenefxState) );
+
+     gfxs->ABstart = ABstart;
+     gfxs->ABsize  = ABsize;
+     gfxs->Aacc    = Aacc;
+     gfxs->Bacc    = Bacc;
+     gfxs->Tacc    = Tacc;
+     gfxs->ABconv  = ABconv;
+     gfxs->Kacc[0] = Kacc[0];
+     gfxs->Kacc[1] = Kacc[1];
+     gfxs->Kacc[2] = Kacc[2];
+     gfxs->Ksum    = Ksum;
+
+     /* The source operand may point to an operand array of the original state. */
+     if (pool.base.Sop == pool.state->gfxs->Aop)
+          gfxs->Sop = gfxs->Aop;
+     else if (pool.base.Sop == pool.state->gfxs->Bop)
+          gfxs->Sop = gfxs->Bop;
+
+     pool.func( pool.state, gfxs, &pool.bands[index], pool.ctx );
+}
+
+static void
+band_loop( GenefxState *gfxs )
+{
+     while (pool.next_band < pool.num_bands) {
+          int index = pool.next_band++;
+
+          direct_mutex_unlock( &pool.lock );
+
+          band_render( gfxs, index );
+
+          direct_mutex_lock( &pool.lock );
+
+          if (!--pool.pending)
+               direct_waitqueue_broadcast( &pool.done_cond );
+     }
+}
+
+static void *
+band_worker_main( DirectThread *thread,
+                  void         *arg )
+{
+     BandWorker *worker = arg;
+
+     D_DEBUG_AT( Genefx_Bands, "%s( %p )\n", __FUNCTION__, worker );
+
+     direct_mutex_lock( &pool.lock );
+
+     while (!pool.shutdown) {
+          band_loop( &worker->gfxs );
+
+          if (!pool.shutdown)
+               direct_waitqueue_wait( &pool.job_cond, &pool.lock );
+     }
+
+     direct_mutex_unlock( &pool.lock );
+
+     return NULL;
+}
+
+static bool
+band_pool_init( int num_workers )
+{
+     int i;
+
+     D_DEBUG_AT( Genefx_Bands, "%s( %d )\n", __FUNCTION__, num_workers );
+
+     D_ASSERT( num_workers > 0 );
+     D_ASSERT( num_workers < GENEFX_MAX_BANDS );
+
+     memset( &pool, 0, sizeof(pool) );
+
+     direct_mutex_init( &pool.lock );
+     direct_waitqueue_init( &pool.job_cond );
+     direct_waitqueue_init( &pool.done_cond );
+
+     for (i = 0; i < num_workers; i++) {
+          char name[24];
+
+          snprintf( name, sizeof(name), "Genefx Band %d", i + 1 );
+
+          pool.workers[i].thread = direct_thread_create( DTT_DEFAULT, band_worker_main, &pool.workers[i], name );
+          if (!pool.workers[i].thread)
+               break;
+     }
+
+     pool.num_workers = i;
+     pool.initialized = true;
+
+     if (!pool.num_workers) {
+          D_ERROR( "Genefx/Bands: Could not create any worker thread, rendering single threaded!\n" );
+          return false;
+     }
+
+     return true;
+}
+
+/**********************************************************************************************************************/
+
+bool
+Genefx_Bands_Run( CardState       *state,
+                  const DFBRegion *area,
+                  GenefxBandFunc   func,
+                  void            *ctx )
+{
+     GenefxState *gfxs;
+     int          i;
+     int          num;
+     int          height;
+     int          y;
+
+     D_ASSERT( state != NULL );
+     D_ASSERT( state->gfxs != NULL );
+     DFB_REGION_ASSERT( area );
+     D_ASSERT( func != NULL );
+
+     if (dfb_config->software_threads < 2)
+          return false;
+
+     gfxs   = state->gfxs;
+     height = area->y2 - area->y1 + 1;
+
+     if ((area->x2 - area->x1 + 1) * height < dfb_config->software_threads_min)
+          return false;
+
+     if (gfxs->dst_caps & DSCAPS_SEPARATED)
+          return false;
+
+     if (height / GENEFX_MIN_BAND_LINES < 2)
+          return false;
+
+     /* Another thread is using the workers, render in one piece instead of waiting. */
+     if (direct_mutex_trylock( &run_lock ))
+          return false;
+
+     /* The pool is sized by the configuration, the height of each operation only limits the bands it uses. */
+     if (!pool.initialized && !band_pool_init( MIN( dfb_config->software_threads, GENEFX_MAX_BANDS ) - 1 )) {
+          direct_mutex_unlock( &run_lock );
+          return false;
+     }
+
+     num = MIN( pool.num_workers + 1, height / GENEFX_MIN_BAND_LINES );
+     if (num < 2) {
+          direct_mutex_unlock( &run_lock );
+          return false;
+     }
+
+     D_DEBUG_AT( Genefx_Bands, "%s( %p, "DFB_RECT_FORMAT" ) <- %d bands\n", __FUNCTION__,
+                 state, DFB_RECTANGLE_VALS_FROM_REGION( area ), num );
+
+     direct_mutex_lock( &pool.lock );
+
+     direct_memcpy( &pool.base, gfxs, sizeof(GenefxState) );
+
+     pool.state = state;
+     pool.func  = func;
+     pool.ctx   = ctx;
+
+     /* Inner band boundaries are kept on even lines, so that subsampled chroma lines are never shared by bands. */
+     for (i = 0, y = area->y1; i < num && y <= area->y2; i++) {
+          int y2 = (i == num - 1) ? area->y2 : ((area->y1 + height * (i + 1) / num) & ~1) - 1;
+
+          if (y2 < y)
+               continue;
+
+          pool.bands[pool.num_bands].x1 = area->x1;
+          pool.bands[pool.num_bands].y1 = y;
+          pool.bands[pool.num_bands].x2 = area->x2;
+          pool.bands[pool.num_bands].y2 = y2;
+
+          pool.num_bands++;
+
+          y = y2 + 1;
+     }
+
+     pool.next_band = 0;
+     pool.pending   = pool.num_bands;
+
+     direct_waitqueue_broadcast( &pool.job_cond );
+
+     /* The calling thread renders bands as well, using the original state. */
+     band_loop( gfxs );
+
+     while (pool.pending)
+          direct_waitqueue_wait( &pool.done_cond, &pool.lock );
+
+     pool.num_bands = 0;
+     pool.next_band = 0;
+     pool.state     = NULL;
+
+     direct_mutex_unlock( &pool.lock );
+
+     direct_mutex_unlock( &run_lock );
+
+     return true;
+}
+
+void
+Genefx_Bands_Shutdown()
+{
+     int i;
+
+     direct_mutex_lock( &run_lock );
+
+     if (pool.initialized) {
+          D_DEBUG_AT( Genefx_Bands, "%s()\n", __FUNCTION__ );
+
+          direct_mutex_lock( &pool.lock );
+
+          pool.shutdown = true;
+
+          direct_waitqueue_broadcast( &pool.job_cond );
+
+          direct_mutex_unlock( &pool.lock );
+
+          for (i = 0; i < pool.num_workers; i++) {
+               direct_thread_join( pool.workers[i].thread );
+               direct_thread_destroy( pool.workers[i].thread );
+
+               if (pool.workers[i].gfxs.ABstart)
+                    D_FREE( pool.workers[i].gfxs.ABstart );
+          }
+
+          direct_waitqueue_deinit( &pool.done_cond );
+          direct_waitqueue_deinit( &pool.job_cond );
+          direct_mutex_deinit( &pool.lock );
+
+          memset( &pool, 0, sizeof(pool) );
+     }
+
+     direct_mutex_unlock( &run_lock );
+}
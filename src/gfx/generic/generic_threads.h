@@ -0,0 +1,49 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#ifndef __GENERIC_THREADS_H__
+#define __GENERIC_THREADS_H__
+
+#include <core/coretypes.h>
+
+/**********************************************************************************************************************/
+
+/*
+ * Render the part of an operation that lies within the destination rows of 'band', using the private 'gfxs'.
+ */
+typedef void (*GenefxBandFunc)( CardState       *state,
+                                GenefxState     *gfxs,
+                                const DFBRegion *band,
+                                void            *ctx );
+
+/*
+ * Split the destination area into horizontal bands and render them on the worker threads and the calling thread.
+ * Returns false without rendering anything if the operation is too small or no workers are available, in which case
+ * the caller has to render the operation itself. All bands are finished when this function returns true.
+ */
+bool Genefx_Bands_Run     ( CardState       *state,
+                            const DFBRegion *area,
+                            GenefxBandFunc   func,
+                            void            *ctx );
+
+/*
+ * Stop the worker threads and free their accumulators.
+ */
+void Genefx_Bands_Shutdown( void );
+
+#endif
@@ -329,6 +329,7 @@ Genefx_Bop_xy( GenefxState *gfxs,
      int pitch = gfxs->src_pitch;
 
      gfxs->Bop[0] = gfxs->src_org[0];
+     gfxs->BopX   = x;
      gfxs->BopY   = y;
 
      if (gfxs->src_caps & DSCAPS_SEPARATED) {
@@ -903,8 +904,10 @@ Genefx_ABacc_prepare( GenefxState *gfxs, int width )
 
      size = (width + 31) & ~31;
 
-     if (gfxs->ABsize < size) {
-          void *ABstart = D_MALLOC( size * sizeof(GenefxAccumulator) * 3 + 31 );
+     if (gfxs->ABsize < size || (gfxs->need_convolution && !gfxs->ABconv)) {
+          /* The convolution needs three source lines and the vertical sums, each with one extra column per side. */
+          int   lines   = gfxs->need_convolution ? 3 + 5 : 3;
+          void *ABstart = D_MALLOC( (size + 2) * sizeof(GenefxAccumulator) * lines + 31 );
 
           if (!ABstart) {
                D_WARN( "out of memory" );
@@ -916,13 +919,25 @@ Genefx_ABacc_prepare( GenefxState *gfxs, int width )
 
           gfxs->ABstart = ABstart;
           gfxs->ABsize  = size;
+          gfxs->ABconv  = gfxs->need_convolution;
           gfxs->Aacc    = (GenefxAccumulator*) (((unsigned long) ABstart+31) & ~31);
           gfxs->Bacc    = gfxs->Aacc + size;
           gfxs->Tacc    = gfxs->Aacc + size + size;
+
+          if (gfxs->ABconv) {
+               gfxs->Kacc[0] = gfxs->Tacc    + size;
+               gfxs->Kacc[1] = gfxs->Kacc[0] + size + 2;
+               gfxs->Kacc[2] = gfxs->Kacc[1] + size + 2;
+               gfxs->Ksum    = (s32*) (gfxs->Kacc[2] + size + 2);
+          }
      }
 
      gfxs->Sacc = gfxs->Dacc = gfxs->Aacc;
 
+     /* Source lines are converted again for each operation. */
+     if (gfxs->need_convolution)
+          gfxs->Kline[0] = gfxs->Kline[1] = gfxs->Kline[2] = -1;
+
      return true;
 }
 
@@ -938,5 +953,6 @@ Genefx_ABacc_flush( GenefxState *gfxs )
           gfxs->Bacc    = NULL;
           gfxs->Sacc    = NULL;
           gfxs->Dacc    = NULL;
+          gfxs->ABconv  = false;
      }
 }
@@ -0,0 +1,748 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#include <emmintrin.h>
+
+/*
+ * The functions below are only called after a runtime check of the CPU features, the target attribute allows them to
+ * be built without enabling SSE2 for the whole library (e.g. on 32 bit x86).
+ */
+#define SSE2_FUNC __attribute__((target("sse2")))
+
+/**********************************************************************************************************************/
+/* Bilinear scalers
+ *
+ * The interpolation of the scalar code works on several channels packed into 32 bit, letting the borrows of one
+ * channel leak into the next one. The vectorized versions below do the same arithmetic in each 32 bit lane, their
+ * output is identical to the one of stretch_hvx_16.h and stretch_hvx_32.h.
+ */
+
+/* Returns the low 32 bits of a * b in each lane, with each lane of b holding a 16 bit factor twice. */
+static inline __m128i SSE2_FUNC
+stretch_mul_SSE2( __m128i a,
+                  __m128i b )
+{
+     return _mm_add_epi16( _mm_mullo_epi16( a, b ), _mm_slli_epi32( _mm_mulhi_epu16( a, b ), 16 ) );
+}
+
+static inline u32
+stretch_bilinear_32( u32 L,
+                     u32 R,
+                     u32 r,
+                     u32 hi )
+{
+     return ((((((R & 0x00ff00ff) - (L & 0x00ff00ff)) * r) >> 8) + (L & 0x00ff00ff)) & 0x00ff00ff) +
+            (((((R >> 8) & 0x00ff00ff) - ((L >> 8) & 0x00ff00ff)) * r + (L & hi)) & hi);
+}
+
+static inline __m128i SSE2_FUNC
+stretch_bilinear_32_SSE2( __m128i L,
+                          __m128i R,
+                          __m128i r,
+                          __m128i hi )
+{
+     const __m128i lo = _mm_set1_epi32( 0x00ff00ff );
+     __m128i       Ll = _mm_and_si128( L, lo );
+     __m128i       d1 = _mm_sub_epi32( _mm_and_si128( R, lo ), Ll );
+     __m128i       d2 = _mm_sub_epi32( _mm_and_si128( _mm_srli_epi32( R, 8 ), lo ),
+                                       _mm_and_si128( _mm_srli_epi32( L, 8 ), lo ) );
+
+     d1 = _mm_and_si128( _mm_add_epi32( _mm_srli_epi32( stretch_mul_SSE2( d1, r ), 8 ), Ll ), lo );
+     d2 = _mm_and_si128( _mm_add_epi32( stretch_mul_SSE2( d2, r ), _mm_and_si128( L, hi ) ), hi );
+
+     return _mm_add_epi32( d1, d2 );
+}
+
+/* Horizontal interpolation of one RGB16 pixel, as computed for the line buffers (see stretch_hvx_16.h). */
+static inline u32
+stretch_bilinear_h16( u32 L,
+                      u32 R,
+                      u32 r )
+{
+     return (((((R & 0xf81f) - (L & 0xf81f)) * r + ((L & 0xf81f) << 6)) & 0x003e07c0) +
+             ((((R & 0x07e0) - (L & 0x07e0)) * r + ((L & 0x07e0) << 6)) & 0x0001f800)) >> 6;
+}
+
+static inline __m128i SSE2_FUNC
+stretch_bilinear_h16_SSE2( __m128i L,
+                           __m128i R,
+                           __m128i r )
+{
+     const __m128i m1 = _mm_set1_epi32( 0xf81f );
+     const __m128i m2 = _mm_set1_epi32( 0x07e0 );
+     __m128i       L1 = _mm_and_si128( L, m1 );
+     __m128i       L2 = _mm_and_si128( L, m2 );
+     __m128i       d1 = stretch_mul_SSE2( _mm_sub_epi32( _mm_and_si128( R, m1 ), L1 ), r );
+     __m128i       d2 = stretch_mul_SSE2( _mm_sub_epi32( _mm_and_si128( R, m2 ), L2 ), r );
+
+     d1 = _mm_and_si128( _mm_add_epi32( d1, _mm_slli_epi32( L1, 6 ) ), _mm_set1_epi32( 0x003e07c0 ) );
+     d2 = _mm_and_si128( _mm_add_epi32( d2, _mm_slli_epi32( L2, 6 ) ), _mm_set1_epi32( 0x0001f800 ) );
+
+     return _mm_srli_epi32( _mm_add_epi32( d1, d2 ), 6 );
+}
+
+/* Vertical interpolation of one RGB16 pixel, used for the first and last column if not 32 bit aligned. */
+static inline u16
+stretch_bilinear_v16( u32 T,
+                      u32 B,
+                      u32 X )
+{
+     return ((((((B & 0xf81f) - (T & 0xf81f)) * X) >> 5) + (T & 0xf81f)) & 0xf81f) +
+            (((((B >> 5) & 0x003f) - ((T >> 5) & 0x003f)) * X + (T & 0x07e0)) & 0x07e0);
+}
+
+/* Vertical interpolation of two RGB16 pixels packed into 32 bit. */
+static inline u32
+stretch_bilinear_v16x2( u32 T,
+                        u32 B,
+                        u32 X )
+{
+     return ((((((B & 0x07e0f81f) - (T & 0x07e0f81f)) * X) >> 5) + (T & 0x07e0f81f)) & 0x07e0f81f) +
+            (((((B >> 5) & 0x07c0f83f) - ((T >> 5) & 0x07c0f83f)) * X + (T & 0xf81f07e0)) & 0xf81f07e0);
+}
+
+static inline __m128i SSE2_FUNC
+stretch_bilinear_v16x2_SSE2( __m128i T,
+                             __m128i B,
+                             __m128i X )
+{
+     const __m128i m1 = _mm_set1_epi32( 0x07e0f81f );
+     const __m128i m2 = _mm_set1_epi32( 0x07c0f83f );
+     const __m128i m3 = _mm_set1_epi32( 0xf81f07e0 );
+     __m128i       T1 = _mm_and_si128( T, m1 );
+     __m128i       d1 = _mm_sub_epi32( _mm_and_si128( B, m1 ), T1 );
+     __m128i       d2 = _mm_sub_epi32( _mm_and_si128( _mm_srli_epi32( B, 5 ), m2 ),
+                                       _mm_and_si128( _mm_srli_epi32( T, 5 ), m2 ) );
+
+     d1 = _mm_and_si128( _mm_add_epi32( _mm_srli_epi32( stretch_mul_SSE2( d1, X ), 5 ), T1 ), m1 );
+     d2 = _mm_and_si128( _mm_add_epi32( stretch_mul_SSE2( d2, X ), _mm_and_si128( T, m3 ) ), m3 );
+
+     return _mm_add_epi32( d1, d2 );
+}
+
+/**********************************************************************************************************************/
+/* Writing to the destination with source color keying and color key protection */
+
+typedef struct {
+     int     flags;
+     __m128i key;
+     __m128i protect;
+} StretchKeys;
+
+static inline void SSE2_FUNC
+stretch_keys_init_SSE2( StretchKeys      *keys,
+                        const StretchCtx *ctx,
+                        bool              rgb16 )
+{
+     keys->flags   = ctx->flags;
+     keys->key     = rgb16 ? _mm_set1_epi16( ctx->key )     : _mm_set1_epi32( ctx->key );
+     keys->protect = rgb16 ? _mm_set1_epi16( ctx->protect ) : _mm_set1_epi32( ctx->protect );
+}
+
+static inline void
+stretch_put_32( u32              *d,
+                u32               dt,
+                const StretchCtx *ctx )
+{
+     if ((ctx->flags & STRETCH_SRCKEY) && dt == ctx->key)
+          return;
+
+     if ((ctx->flags & STRETCH_PROTECT) && (dt & 0x00ffffff) == ctx->protect)
+          dt ^= 1;
+
+     *d = dt;
+}
+
+static inline void
+stretch_put_16( u16              *d,
+                u16               dt,
+                const StretchCtx *ctx )
+{
+     if ((ctx->flags & STRETCH_SRCKEY) && dt == ctx->key)
+          return;
+
+     if ((ctx->flags & STRETCH_PROTECT) && dt == ctx->protect)
+          dt ^= 1;
+
+     *d = dt;
+}
+
+/* Stores four 32 bit pixels. */
+static inline void SSE2_FUNC
+stretch_store_32_SSE2( u32               *d,
+                       __m128i            dt,
+                       const StretchKeys *keys )
+{
+     if (keys->flags) {
+          __m128i skip = _mm_setzero_si128();
+
+          if (keys->flags & STRETCH_SRCKEY)
+               skip = _mm_cmpeq_epi32( dt, keys->key );
+
+          if (keys->flags & STRETCH_PROTECT)
+               dt = _mm_xor_si128( dt, _mm_and_si128( _mm_cmpeq_epi32( _mm_and_si128( dt, _mm_set1_epi32( 0x00ffffff ) ),
+                                                                       keys->protect ),
+                                                      _mm_set1_epi32( 1 ) ) );
+
+          dt = _mm_or_si128( _mm_and_si128( skip, _mm_loadu_si128( (const __m128i*) d ) ), _mm_andnot_si128( skip, dt ) );
+     }
+
+     _mm_storeu_si128( (__m128i*) d, dt );
+}
+
+/* Stores eight 16 bit pixels. */
+static inline void SSE2_FUNC
+stretch_store_16_SSE2( u32               *d,
+                       __m128i            dt,
+                       const StretchKeys *keys )
+{
+     if (keys->flags) {
+          __m128i skip = _mm_setzero_si128();
+
+          if (keys->flags & STRETCH_SRCKEY)
+               skip = _mm_cmpeq_epi16( dt, keys->key );
+
+          if (keys->flags & STRETCH_PROTECT)
+               dt = _mm_xor_si128( dt, _mm_and_si128( _mm_cmpeq_epi16( dt, keys->protect ), _mm_set1_epi16( 1 ) ) );
+
+          dt = _mm_or_si128( _mm_and_si128( skip, _mm_loadu_si128( (const __m128i*) d ) ), _mm_andnot_si128( skip, dt ) );
+     }
+
+     _mm_storeu_si128( (__m128i*) d, dt );
+}
+
+/**********************************************************************************************************************/
+/* Bilinear 32 bit scalers */
+
+static inline void SSE2_FUNC
+stretch_bilinear_line_32_SSE2( u32       *lb,
+                               const u32 *src,
+                               const int *index,
+                               const s16 *ratio,
+                               long       cw,
+                               u32        hi )
+{
+     long    x;
+     __m128i vhi = _mm_set1_epi32( hi );
+
+     for (x = 0; x < cw - 3; x += 4) {
+          __m128i p0 = _mm_loadl_epi64( (const __m128i*) (src + index[x]) );
+          __m128i p1 = _mm_loadl_epi64( (const __m128i*) (src + index[x+1]) );
+          __m128i p2 = _mm_loadl_epi64( (const __m128i*) (src + index[x+2]) );
+          __m128i p3 = _mm_loadl_epi64( (const __m128i*) (src + index[x+3]) );
+          __m128i r  = _mm_loadl_epi64( (const __m128i*) (ratio + x) );
+          __m128i a  = _mm_unpacklo_epi32( p0, p1 );
+          __m128i b  = _mm_unpacklo_epi32( p2, p3 );
+
+          _mm_storeu_si128( (__m128i*) (lb + x),
+                            stretch_bilinear_32_SSE2( _mm_unpacklo_epi64( a, b ), _mm_unpackhi_epi64( a, b ),
+                                                      _mm_unpacklo_epi16( r, r ), vhi ) );
+     }
+
+     for (; x < cw; x++)
+          lb[x] = stretch_bilinear_32( src[index[x]], src[index[x]+1], ratio[x], hi );
+}
+
+static inline void SSE2_FUNC
+stretch_bilinear_32_generic_SSE2( void             *dst,
+                                  int               dpitch,
+                                  const void       *src,
+                                  int               spitch,
+                                  int               height,
+                                  const StretchCtx *ctx,
+                                  u32               hi )
+{
+     long        x, y;
+     long        cw    = ctx->clip.x2 - ctx->clip.x1 + 1;
+     long        ch    = ctx->clip.y2 - ctx->clip.y1 + 1;
+     const int  *index = ctx->htable->index  + ctx->clip.x1;
+     const s16  *ratio = ctx->htable->coeffs + ctx->clip.x1;
+     u32         _lbT[cw+4];
+     u32         _lbB[cw+4];
+     u32        *lbT   = _lbT;
+     u32        *lbB   = _lbB;
+     u32        *lbX;
+     u32        *dst32 = dst + ctx->clip.x1 * 4 + ctx->clip.y1 * dpitch;
+     long        lineT = -2000;
+     StretchKeys keys;
+
+     stretch_keys_init_SSE2( &keys, ctx, false );
+
+     for (y = ctx->clip.y1; y < ctx->clip.y1 + ch; y++) {
+          long    nlT = ctx->vtable->index[y];
+          u32     X   = ctx->vtable->coeffs[y];
+          __m128i vX  = _mm_set1_epi16( X );
+
+          D_ASSERT( nlT >= 0 );
+          D_ASSERT( nlT < height - 1 );
+
+          /* Fill line buffer(s). */
+          if (nlT != lineT) {
+               if (nlT - lineT > 1)
+                    stretch_bilinear_line_32_SSE2( lbT, src + spitch * nlT, index, ratio, cw, hi );
+               else {
+                    /* Swap. */
+                    lbX = lbT;
+                    lbT = lbB;
+                    lbB = lbX;
+               }
+
+               stretch_bilinear_line_32_SSE2( lbB, src + spitch * (nlT + 1), index, ratio, cw, hi );
+
+               lineT = nlT;
+          }
+
+          /* Vertical interpolation. */
+          for (x = 0; x < cw - 3; x += 4)
+               stretch_store_32_SSE2( dst32 + x, stretch_bilinear_32_SSE2( _mm_loadu_si128( (const __m128i*) (lbT + x) ),
+                                                                           _mm_loadu_si128( (const __m128i*) (lbB + x) ),
+                                                                           vX, _mm_set1_epi32( hi ) ), &keys );
+
+          for (; x < cw; x++)
+               stretch_put_32( dst32 + x, stretch_bilinear_32( lbT[x], lbB[x], X, hi ), ctx );
+
+          dst32 += dpitch / 4;
+     }
+}
+
+static void SSE2_FUNC
+stretch_bilinear_ARGB_SSE2( void             *dst,
+                            int               dpitch,
+                            const void       *src,
+                            int               spitch,
+                            int               width,
+                            int               height,
+                            int               dst_width,
+                            int               dst_height,
+                            const StretchCtx *ctx )
+{
+     stretch_bilinear_32_generic_SSE2( dst, dpitch, src, spitch, height, ctx, 0xff00ff00 );
+}
+
+static void SSE2_FUNC
+stretch_bilinear_RGB32_SSE2( void             *dst,
+                             int               dpitch,
+                             const void       *src,
+                             int               spitch,
+                             int               width,
+                             int               height,
+                             int               dst_width,
+                             int               dst_height,
+                             const StretchCtx *ctx )
+{
+     stretch_bilinear_32_generic_SSE2( dst, dpitch, src, spitch, height, ctx, 0x0000ff00 );
+}
+
+/**********************************************************************************************************************/
+/* Bilinear 16 bit scaler */
+
+static inline u32
+stretch_load_u32( const u16 *src )
+{
+     u32 v;
+
+     memcpy( &v, src, 4 );
+
+     return v;
+}
+
+/* Fills a line buffer with pairs of pixels, the columns are given by 'index' and 'ratio' for each pixel. */
+static void SSE2_FUNC
+stretch_bilinear_line_16_SSE2( u32       *lb,
+                               const u16 *src,
+                               const int *index,
+                               const s16 *ratio,
+                               long       w2 )
+{
+     long          x;
+     const __m128i m = _mm_set1_epi32( 0xffff );
+
+     for (x = 0; x < w2 - 3; x += 4) {
+          const int *i  = index + x * 2;
+          const s16 *rp = ratio + x * 2;
+          __m128i    v0 = _mm_set_epi32( stretch_load_u32( src + i[3] ), stretch_load_u32( src + i[2] ),
+                                         stretch_load_u32( src + i[1] ), stretch_load_u32( src + i[0] ) );
+          __m128i    v1 = _mm_set_epi32( stretch_load_u32( src + i[7] ), stretch_load_u32( src + i[6] ),
+                                         stretch_load_u32( src + i[5] ), stretch_load_u32( src + i[4] ) );
+          __m128i    r  = _mm_loadu_si128( (const __m128i*) rp );
+          __m128i    d0 = stretch_bilinear_h16_SSE2( _mm_and_si128( v0, m ), _mm_srli_epi32( v0, 16 ),
+                                                     _mm_unpacklo_epi16( r, r ) );
+          __m128i    d1 = stretch_bilinear_h16_SSE2( _mm_and_si128( v1, m ), _mm_srli_epi32( v1, 16 ),
+                                                     _mm_unpackhi_epi16( r, r ) );
+
+          /* Combine two pixels in the low half of each 64 bit lane and gather them. */
+          d0 = _mm_shuffle_epi32( _mm_or_si128( d0, _mm_srli_epi64( d0, 16 ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+          d1 = _mm_shuffle_epi32( _mm_or_si128( d1, _mm_srli_epi64( d1, 16 ) ), _MM_SHUFFLE( 3, 1, 2, 0 ) );
+
+          _mm_storeu_si128( (__m128i*) (lb + x), _mm_unpacklo_epi64( d0, d1 ) );
+     }
+
+     for (; x < w2; x++) {
+          const int *i  = index + x * 2;
+          const s16 *rp = ratio + x * 2;
+
+          lb[x] = stretch_bilinear_h16( src[i[0]], src[i[0]+1], rp[0] ) |
+                  stretch_bilinear_h16( src[i[1]], src[i[1]+1], rp[1] ) << 16;
+     }
+}
+
+/* Scales a single column, the first or last one if not part of a pair of pixels. */
+static void
+stretch_bilinear_column_16( u16              *dst16,
+                            int               dpitch,
+                            const u16        *src,
+                            int               spitch,
+                            long              column,
+                            const StretchCtx *ctx )
+{
+     long y;
+     long pl = ctx->htable->index[column];
+     u32  r  = ctx->htable->coeffs[column];
+
+     for (y = ctx->clip.y1; y <= ctx->clip.y2; y++) {
+          const u16 *srcT = (const void*) src + spitch * ctx->vtable->index[y];
+          const u16 *srcB = (const void*) srcT + spitch;
+          u32        dpT  = stretch_bilinear_h16( srcT[pl], srcT[pl+1], r );
+          u32        dpB  = stretch_bilinear_h16( srcB[pl], srcB[pl+1], r );
+
+          stretch_put_16( dst16, stretch_bilinear_v16( dpT, dpB, ctx->vtable->coeffs[y] ), ctx );
+
+          dst16 = (void*) dst16 + dpitch;
+     }
+}
+
+static void SSE2_FUNC
+stretch_bilinear_RGB16_SSE2( void             *dst,
+                             int               dpitch,
+                             const void       *src,
+                             int               spitch,
+                             int               width,
+                             int               height,
+                             int               dst_width,
+                             int               dst_height,
+                             const StretchCtx *ctx )
+{
+     long        x, y;
+     long        head  = ((((unsigned long) dst) & 2) >> 1) ^ (ctx->clip.x1 & 1);
+     long        cw    = ctx->clip.x2 - ctx->clip.x1 + 1;
+     long        ch    = ctx->clip.y2 - ctx->clip.y1 + 1;
+     long        tail  = (cw - head) & 1;
+     long        w2    = (cw - head) / 2;
+     const int  *index = ctx->htable->index  + ctx->clip.x1 + head;
+     const s16  *ratio = ctx->htable->coeffs + ctx->clip.x1 + head;
+     u32         _lbT[w2+4];
+     u32         _lbB[w2+4];
+     u32        *lbT   = _lbT;
+     u32        *lbB   = _lbB;
+     u32        *lbX;
+     u16        *dst16 = dst + ctx->clip.x1 * 2 + ctx->clip.y1 * dpitch;
+     u32        *dst32 = (u32*) (dst16 + head);
+     long        lineT = -2000;
+     StretchKeys keys;
+
+     stretch_keys_init_SSE2( &keys, ctx, true );
+
+     if (head)
+          stretch_bilinear_column_16( dst16, dpitch, src, spitch, ctx->clip.x1, ctx );
+
+     if (tail)
+          stretch_bilinear_column_16( dst16 + cw - 1, dpitch, src, spitch, ctx->clip.x2, ctx );
+
+     for (y = ctx->clip.y1; y < ctx->clip.y1 + ch; y++) {
+          long    nlT = ctx->vtable->index[y];
+          u32     X   = ctx->vtable->coeffs[y];
+          __m128i vX  = _mm_set1_epi16( X );
+
+          D_ASSERT( nlT >= 0 );
+          D_ASSERT( nlT < height - 1 );
+
+          /* Fill line buffer(s). */
+          if (nlT != lineT) {
+               if (nlT - lineT > 1)
+                    stretch_bilinear_line_16_SSE2( lbT, src + spitch * nlT, index, ratio, w2 );
+               else {
+                    /* Swap. */
+                    lbX = lbT;
+                    lbT = lbB;
+                    lbB = lbX;
+               }
+
+               stretch_bilinear_line_16_SSE2( lbB, src + spitch * (nlT + 1), index, ratio, w2 );
+
+               lineT = nlT;
+          }
+
+          /* Vertical interpolation. */
+          for (x = 0; x < w2 - 3; x += 4)
+               stretch_store_16_SSE2( dst32 + x, stretch_bilinear_v16x2_SSE2( _mm_loadu_si128( (const __m128i*) (lbT + x) ),
+                                                                              _mm_loadu_si128( (const __m128i*) (lbB + x) ),
+                                                                              vX ), &keys );
+
+          for (; x < w2; x++) {
+               u32 dt = stretch_bilinear_v16x2( lbT[x], lbB[x], X );
+
+               stretch_put_16( (u16*) (dst32 + x),     dt,       ctx );
+               stretch_put_16( (u16*) (dst32 + x) + 1, dt >> 16, ctx );
+          }
+
+          dst32 = (void*) dst32 + dpitch;
+     }
+}
+
+/**********************************************************************************************************************/
+/* 4-tap scalers
+ *
+ * Each line is filtered horizontally into a buffer of 16 bit channels with 6 fractional bits, four of these buffers
+ * are then combined for each destination line. Weights are in 1.14 fixed point.
+ */
+
+/* Returns four RGB16 pixels converted to ARGB. */
+static inline __m128i SSE2_FUNC
+stretch_rgb16_to_argb_SSE2( __m128i p )
+{
+     __m128i r = _mm_and_si128( p, _mm_set1_epi32( 0xf800 ) );
+     __m128i g = _mm_and_si128( p, _mm_set1_epi32( 0x07e0 ) );
+     __m128i b = _mm_and_si128( p, _mm_set1_epi32( 0x001f ) );
+
+     r = _mm_slli_epi32( _mm_or_si128( r, _mm_srli_epi32( r, 5 ) ), 8 );
+     g = _mm_slli_epi32( _mm_or_si128( g, _mm_srli_epi32( g, 6 ) ), 5 );
+     b = _mm_or_si128( _mm_slli_epi32( b, 3 ), _mm_srli_epi32( b, 2 ) );
+
+     return _mm_or_si128( _mm_or_si128( _mm_and_si128( r, _mm_set1_epi32( 0xff0000 ) ),
+                                        _mm_and_si128( g, _mm_set1_epi32( 0x00ff00 ) ) ),
+                          _mm_or_si128( b, _mm_set1_epi32( 0xff000000 ) ) );
+}
+
+/* Returns four ARGB pixels converted to RGB16 in the low half of each lane. */
+static inline __m128i SSE2_FUNC
+stretch_argb_to_rgb16_SSE2( __m128i p )
+{
+     return _mm_or_si128( _mm_or_si128( _mm_and_si128( _mm_srli_epi32( p, 8 ), _mm_set1_epi32( 0xf800 ) ),
+                                        _mm_and_si128( _mm_srli_epi32( p, 5 ), _mm_set1_epi32( 0x07e0 ) ) ),
+                          _mm_and_si128( _mm_srli_epi32( p, 3 ), _mm_set1_epi32( 0x001f ) ) );
+}
+
+static inline void SSE2_FUNC
+stretch_4tap_line_SSE2( s16        *lb,
+                        const void *src,
+                        const int  *index,
+                        const s16  *coeffs,
+                        long        cw,
+                        bool        rgb16 )
+{
+     long          x;
+     const __m128i zero  = _mm_setzero_si128();
+     const __m128i round = _mm_set1_epi32( 1 << 7 );
+
+     for (x = 0; x < cw; x++) {
+          const int *i = index + x * 4;
+          __m128i    w = _mm_loadl_epi64( (const __m128i*) (coeffs + x * 4) );
+          __m128i    p, lo, hi;
+
+          if (rgb16) {
+               const u16 *s = src;
+
+               p = stretch_rgb16_to_argb_SSE2( _mm_set_epi32( s[i[3]], s[i[2]], s[i[1]], s[i[0]] ) );
+          }
+          else {
+               const u32 *s = src;
+
+               p = _mm_set_epi32( s[i[3]], s[i[2]], s[i[1]], s[i[0]] );
+          }
+
+          /* Interleave the channels of the first/second and the third/fourth pixel. */
+          lo = _mm_unpacklo_epi8( p, zero );
+          hi = _mm_unpackhi_epi8( p, zero );
+          lo = _mm_unpacklo_epi16( lo, _mm_srli_si128( lo, 8 ) );
+          hi = _mm_unpacklo_epi16( hi, _mm_srli_si128( hi, 8 ) );
+
+          p = _mm_add_epi32( _mm_madd_epi16( lo, _mm_shuffle_epi32( w, 0x00 ) ),
+                             _mm_madd_epi16( hi, _mm_shuffle_epi32( w, 0x55 ) ) );
+          p = _mm_srai_epi32( _mm_add_epi32( p, round ), 8 );
+
+          _mm_storel_epi64( (__m128i*) (lb + x * 4), _mm_packs_epi32( p, p ) );
+     }
+}
+
+/* Returns two ARGB pixels in the low half, filtered vertically from two pixels of four line buffers. */
+static inline __m128i SSE2_FUNC
+stretch_4tap_vertical_SSE2( __m128i a,
+                            __m128i b,
+                            __m128i c,
+                            __m128i d,
+                            __m128i w01,
+                            __m128i w23 )
+{
+     const __m128i round = _mm_set1_epi32( 1 << 19 );
+     __m128i       p0    = _mm_add_epi32( _mm_madd_epi16( _mm_unpacklo_epi16( a, b ), w01 ),
+                                          _mm_madd_epi16( _mm_unpacklo_epi16( c, d ), w23 ) );
+     __m128i       p1    = _mm_add_epi32( _mm_madd_epi16( _mm_unpackhi_epi16( a, b ), w01 ),
+                                          _mm_madd_epi16( _mm_unpackhi_epi16( c, d ), w23 ) );
+
+     p0 = _mm_srai_epi32( _mm_add_epi32( p0, round ), 20 );
+     p1 = _mm_srai_epi32( _mm_add_epi32( p1, round ), 20 );
+
+     return _mm_packus_epi16( _mm_packs_epi32( p0, p1 ), p0 );
+}
+
+static inline void SSE2_FUNC
+stretch_4tap_generic_SSE2( void             *dst,
+                           int               dpitch,
+                           const void       *src,
+                           int               spitch,
+                           const StretchCtx *ctx,
+                           DFBSurfacePixelFormat format )
+{
+     long        x, y;
+     int         n;
+     bool        rgb16 = (format == DSPF_RGB16);
+     long        cw    = ctx->clip.x2 - ctx->clip.x1 + 1;
+     const int  *index = ctx->htable->index  + ctx->clip.x1 * 4;
+     const s16  *hw    = ctx->htable->coeffs + ctx->clip.x1 * 4;
+     s16        *buffer;
+     s16        *lb[4];
+     long        lines[4] = { -1, -1, -1, -1 };
+     void       *dst_line = dst + DFB_BYTES_PER_LINE( format, ctx->clip.x1 ) + ctx->clip.y1 * dpitch;
+     __m128i     mask     = _mm_set1_epi32( format == DSPF_RGB32 ? 0x00ffffff : 0xffffffff );
+
+     buffer = D_MALLOC( cw * 4 * 4 * sizeof(s16) );
+     if (!buffer) {
+          D_OOM();
+          return;
+     }
+
+     for (n = 0; n < 4; n++)
+          lb[n] = buffer + n * cw * 4;
+
+     for (y = ctx->clip.y1; y <= ctx->clip.y2; y++) {
+          const int *vi = ctx->vtable->index  + y * 4;
+          __m128i    vw = _mm_loadl_epi64( (const __m128i*) (ctx->vtable->coeffs + y * 4) );
+          __m128i    w01 = _mm_shuffle_epi32( vw, 0x00 );
+          __m128i    w23 = _mm_shuffle_epi32( vw, 0x55 );
+          const s16 *l0, *l1, *l2, *l3;
+
+          /* Horizontal filtering of the source lines not in the buffers, each one having its fixed buffer. */
+          for (n = 0; n < 4; n++) {
+               long line = vi[n];
+
+               if (lines[line & 3] != line) {
+                    stretch_4tap_line_SSE2( lb[line & 3], src + spitch * line, index, hw, cw, rgb16 );
+
+                    lines[line & 3] = line;
+               }
+          }
+
+          l0 = lb[vi[0] & 3];
+          l1 = lb[vi[1] & 3];
+          l2 = lb[vi[2] & 3];
+          l3 = lb[vi[3] & 3];
+
+          /* Vertical filtering, two pixels per step. */
+          for (x = 0; x < cw; x += 2) {
+               __m128i p;
+               u32     p0, p1;
+
+               if (x < cw - 1)
+                    p = stretch_4tap_vertical_SSE2( _mm_loadu_si128( (const __m128i*) (l0 + x * 4) ),
+                                                    _mm_loadu_si128( (const __m128i*) (l1 + x * 4) ),
+                                                    _mm_loadu_si128( (const __m128i*) (l2 + x * 4) ),
+                                                    _mm_loadu_si128( (const __m128i*) (l3 + x * 4) ), w01, w23 );
+               else
+                    p = stretch_4tap_vertical_SSE2( _mm_loadl_epi64( (const __m128i*) (l0 + x * 4) ),
+                                                    _mm_loadl_epi64( (const __m128i*) (l1 + x * 4) ),
+                                                    _mm_loadl_epi64( (const __m128i*) (l2 + x * 4) ),
+                                                    _mm_loadl_epi64( (const __m128i*) (l3 + x * 4) ), w01, w23 );
+
+               p = _mm_and_si128( p, mask );
+
+               if (rgb16)
+                    p = stretch_argb_to_rgb16_SSE2( p );
+
+               p0 = _mm_cvtsi128_si32( p );
+               p1 = _mm_cvtsi128_si32( _mm_srli_si128( p, 4 ) );
+
+               if (rgb16) {
+                    u16 *d = dst_line;
+
+                    stretch_put_16( d + x, p0, ctx );
+
+                    if (x < cw - 1)
+                         stretch_put_16( d + x + 1, p1, ctx );
+               }
+               else {
+                    u32 *d = dst_line;
+
+                    if (!ctx->flags && x < cw - 1) {
+                         _mm_storel_epi64( (__m128i*) (d + x), p );
+                         continue;
+                    }
+
+                    stretch_put_32( d + x, p0, ctx );
+
+                    if (x < cw - 1)
+                         stretch_put_32( d + x + 1, p1, ctx );
+               }
+          }
+
+          dst_line += dpitch;
+     }
+
+     D_FREE( buffer );
+}
+
+static void SSE2_FUNC
+stretch_4tap_ARGB_SSE2( void             *dst,
+                        int               dpitch,
+                        const void       *src,
+                        int               spitch,
+                        int               width,
+                        int               height,
+                        int               dst_width,
+                        int               dst_height,
+                        const StretchCtx *ctx )
+{
+     stretch_4tap_generic_SSE2( dst, dpitch, src, spitch, ctx, DSPF_ARGB );
+}
+
+static void SSE2_FUNC
+stretch_4tap_RGB32_SSE2( void             *dst,
+                         int               dpitch,
+                         const void       *src,
+                         int               spitch,
+                         int               width,
+                         int               height,
+                         int               dst_width,
+                         int               dst_height,
+                         const StretchCtx *ctx )
+{
+     stretch_4tap_generic_SSE2( dst, dpitch, src, spitch, ctx, DSPF_RGB32 );
+}
+
+static void SSE2_FUNC
+stretch_4tap_RGB16_SSE2( void             *dst,
+                         int               dpitch,
+                         const void       *src,
+                         int               spitch,
+                         int               width,
+                         int               height,
+                         int               dst_width,
+                         int               dst_height,
+                         const StretchCtx *ctx )
+{
+     stretch_4tap_generic_SSE2( dst, dpitch, src, spitch, ctx, DSPF_RGB16 );
+}
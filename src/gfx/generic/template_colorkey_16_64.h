@@ -0,0 +1,238 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+/*
+ * 64 bit versions of the functions in template_colorkey_16.h, four pixels are compared at once and only written back
+ * if at least one of them passes the key test. Backwards and rotated blits are left to the 32 bit functions.
+ */
+
+#define MASK_RGB(p)  ((p) & RGB_MASK)
+#define MASK_RGB_64  LANES_64( RGB_MASK )
+
+#define NAME_64(f)  NAME_64_(f)
+#define NAME_64_(f) f##_64
+
+/**********************************************************************************************************************
+ ********************************* Cop_toK_Aop_PFI ********************************************************************
+ **********************************************************************************************************************/
+
+static void
+NAME_64(Cop_OP_Aop_PFI(toK))( GenefxState *gfxs )
+{
+     int  w    = gfxs->length;
+     u16 *D    = gfxs->Aop[0];
+     u16  Cop  = gfxs->Cop;
+     u16  Dkey = gfxs->Dkey;
+     u64  cop  = LANES_64( Cop );
+     u64  key  = LANES_64( Dkey );
+
+     while (w && ((long) D & 7)) {
+          if (MASK_RGB( *D ) == Dkey)
+               *D = Cop;
+
+          D++;
+          w--;
+     }
+
+     for (; w >= 4; w -= 4) {
+          u64 d = *((u64*) D);
+          u64 m = lanes_equal_64( d & MASK_RGB_64, key );
+
+          if (m)
+               *((u64*) D) = (d & ~m) | (cop & m);
+
+          D += 4;
+     }
+
+     while (w--) {
+          if (MASK_RGB( *D ) == Dkey)
+               *D = Cop;
+
+          D++;
+     }
+}
+
+/**********************************************************************************************************************
+ ********************************* Bop_PFI_toK_Aop_PFI ****************************************************************
+ **********************************************************************************************************************/
+
+static void
+NAME_64(Bop_PFI_OP_Aop_PFI(toK))( GenefxState *gfxs )
+{
+     int  w    = gfxs->length;
+     u16 *S    = gfxs->Bop[0];
+     u16 *D    = gfxs->Aop[0];
+     u16  Dkey = gfxs->Dkey;
+     u64  key  = LANES_64( Dkey );
+
+     if (gfxs->Astep != 1 || gfxs->Bstep != 1) {
+          Bop_PFI_OP_Aop_PFI(toK)( gfxs );
+          return;
+     }
+
+     while (w && ((long) D & 7)) {
+          if (MASK_RGB( *D ) == Dkey)
+               *D = *S;
+
+          S++;
+          D++;
+          w--;
+     }
+
+     for (; w >= 4; w -= 4) {
+          u64 d = *((u64*) D);
+          u64 m = lanes_equal_64( d & MASK_RGB_64, key );
+
+          /* Nothing to load if no pixel is keyed. */
+          if (m)
+               *((u64*) D) = (d & ~m) | (load_64( S ) & m);
+
+          S += 4;
+          D += 4;
+     }
+
+     while (w--) {
+          if (MASK_RGB( *D ) == Dkey)
+               *D = *S;
+
+          S++;
+          D++;
+     }
+}
+
+/**********************************************************************************************************************
+ ********************************* Bop_PFI_Kto_Aop_PFI ****************************************************************
+ **********************************************************************************************************************/
+
+static void
+NAME_64(Bop_PFI_OP_Aop_PFI(Kto))( GenefxState *gfxs )
+{
+     int  w    = gfxs->length;
+     u16 *S    = gfxs->Bop[0];
+     u16 *D    = gfxs->Aop[0];
+     u16  Skey = gfxs->Skey;
+     u64  key  = LANES_64( Skey );
+
+     if (gfxs->Astep != 1 || gfxs->Bstep != 1) {
+          Bop_PFI_OP_Aop_PFI(Kto)( gfxs );
+          return;
+     }
+
+     while (w && ((long) D & 7)) {
+          u16 s = *S;
+
+          if (MASK_RGB( s ) != Skey)
+               *D = s;
+
+          S++;
+          D++;
+          w--;
+     }
+
+     for (; w >= 4; w -= 4) {
+          u64 s = load_64( S );
+          u64 m = lanes_equal_64( s & MASK_RGB_64, key );
+
+          if (!m)
+               *((u64*) D) = s;
+          else if (~m)
+               *((u64*) D) = (*((u64*) D) & m) | (s & ~m);
+
+          S += 4;
+          D += 4;
+     }
+
+     while (w--) {
+          u16 s = *S;
+
+          if (MASK_RGB( s ) != Skey)
+               *D = s;
+
+          S++;
+          D++;
+     }
+}
+
+/**********************************************************************************************************************
+ ********************************* Bop_PFI_KtoK_Aop_PFI ***************************************************************
+ **********************************************************************************************************************/
+
+static void
+NAME_64(Bop_PFI_OP_Aop_PFI(KtoK))( GenefxState *gfxs )
+{
+     int  w    = gfxs->length;
+     u16 *S    = gfxs->Bop[0];
+     u16 *D    = gfxs->Aop[0];
+     u16  Skey = gfxs->Skey;
+     u16  Dkey = gfxs->Dkey;
+     u64  skey = LANES_64( Skey );
+     u64  dkey = LANES_64( Dkey );
+
+     if (gfxs->Astep != 1 || gfxs->Bstep != 1) {
+          Bop_PFI_OP_Aop_PFI(KtoK)( gfxs );
+          return;
+     }
+
+     while (w && ((long) D & 7)) {
+          u16 s = *S;
+
+          if (MASK_RGB( s ) != Skey && MASK_RGB( *D ) == Dkey)
+               *D = s;
+
+          S++;
+          D++;
+          w--;
+     }
+
+     for (; w >= 4; w -= 4) {
+          u64 d = *((u64*) D);
+          u64 m = lanes_equal_64( d & MASK_RGB_64, dkey );
+
+          if (m) {
+               u64 s = load_64( S );
+
+               m &= ~lanes_equal_64( s & MASK_RGB_64, skey );
+
+               *((u64*) D) = (d & ~m) | (s & m);
+          }
+
+          S += 4;
+          D += 4;
+     }
+
+     while (w--) {
+          u16 s = *S;
+
+          if (MASK_RGB( s ) != Skey && MASK_RGB( *D ) == Dkey)
+               *D = s;
+
+          S++;
+          D++;
+     }
+}
+
+/**********************************************************************************************************************/
+
+#undef MASK_RGB
+#undef MASK_RGB_64
+#undef NAME_64
+#undef NAME_64_
+
+#undef RGB_MASK
+#undef Cop_OP_Aop_PFI
+#undef Bop_PFI_OP_Aop_PFI
@@ -0,0 +1,173 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+/*
+ * SSE2 versions of the functions in template_colorkey_16.h, eight pixels are compared at once and only written back
+ * if at least one of them passes the key test. Backwards and rotated blits are left to the C functions.
+ */
+
+#define MASK_RGB(p) ((p) & RGB_MASK)
+
+#define SSE2_NAME(f)  SSE2_NAME_(f)
+#define SSE2_NAME_(f) f##_SSE2
+
+/**********************************************************************************************************************
+ ********************************* Cop_toK_Aop_PFI ********************************************************************
+ **********************************************************************************************************************/
+
+static void SSE2_FUNC
+SSE2_NAME(Cop_OP_Aop_PFI(toK))( GenefxState *gfxs )
+{
+     int            i    = 0;
+     int            w    = gfxs->length;
+     u16           *D    = gfxs->Aop[0];
+     u16            Cop  = gfxs->Cop;
+     u16            Dkey = gfxs->Dkey;
+     const __m128i  mask = _mm_set1_epi16( RGB_MASK );
+     const __m128i  key  = _mm_set1_epi16( Dkey );
+     const __m128i  cop  = _mm_set1_epi16( Cop );
+
+     for (; i + 8 <= w; i += 8) {
+          __m128i d = _mm_loadu_si128( (const __m128i*) (D + i) );
+
+          store_masked_SSE2( D + i, cop, _mm_cmpeq_epi16( _mm_and_si128( d, mask ), key ) );
+     }
+
+     for (; i < w; i++) {
+          if (MASK_RGB( D[i] ) == Dkey)
+               D[i] = Cop;
+     }
+}
+
+/**********************************************************************************************************************
+ ********************************* Bop_PFI_toK_Aop_PFI ****************************************************************
+ **********************************************************************************************************************/
+
+static void SSE2_FUNC
+SSE2_NAME(Bop_PFI_OP_Aop_PFI(toK))( GenefxState *gfxs )
+{
+     int            i    = 0;
+     int            w    = gfxs->length;
+     u16           *S    = gfxs->Bop[0];
+     u16           *D    = gfxs->Aop[0];
+     u16            Dkey = gfxs->Dkey;
+     const __m128i  mask = _mm_set1_epi16( RGB_MASK );
+     const __m128i  key  = _mm_set1_epi16( Dkey );
+
+     if (gfxs->Astep != 1 || gfxs->Bstep != 1) {
+          Bop_PFI_OP_Aop_PFI(toK)( gfxs );
+          return;
+     }
+
+     for (; i + 8 <= w; i += 8) {
+          __m128i d = _mm_loadu_si128( (const __m128i*) (D + i) );
+          __m128i m = _mm_cmpeq_epi16( _mm_and_si128( d, mask ), key );
+
+          /* Nothing to load if no pixel is keyed. */
+          if (_mm_movemask_epi8( m ))
+               store_masked_SSE2( D + i, _mm_loadu_si128( (const __m128i*) (S + i) ), m );
+     }
+
+     for (; i < w; i++) {
+          if (MASK_RGB( D[i] ) == Dkey)
+               D[i] = S[i];
+     }
+}
+
+/**********************************************************************************************************************
+ ********************************* Bop_PFI_Kto_Aop_PFI ****************************************************************
+ **********************************************************************************************************************/
+
+static void SSE2_FUNC
+SSE2_NAME(Bop_PFI_OP_Aop_PFI(Kto))( GenefxState *gfxs )
+{
+     int            i    = 0;
+     int            w    = gfxs->length;
+     u16           *S    = gfxs->Bop[0];
+     u16           *D    = gfxs->Aop[0];
+     u16            Skey = gfxs->Skey;
+     const __m128i  mask = _mm_set1_epi16( RGB_MASK );
+     const __m128i  key  = _mm_set1_epi16( Skey );
+     const __m128i  ones = _mm_set1_epi16( 0xffff );
+
+     if (gfxs->Astep != 1 || gfxs->Bstep != 1) {
+          Bop_PFI_OP_Aop_PFI(Kto)( gfxs );
+          return;
+     }
+
+     for (; i + 8 <= w; i += 8) {
+          __m128i s = _mm_loadu_si128( (const __m128i*) (S + i) );
+
+          store_masked_SSE2( D + i, s, _mm_xor_si128( _mm_cmpeq_epi16( _mm_and_si128( s, mask ), key ), ones ) );
+     }
+
+     for (; i < w; i++) {
+          u16 s = S[i];
+
+          if (MASK_RGB( s ) != Skey)
+               D[i] = s;
+     }
+}
+
+/**********************************************************************************************************************
+ ********************************* Bop_PFI_KtoK_Aop_PFI ***************************************************************
+ **********************************************************************************************************************/
+
+static void SSE2_FUNC
+SSE2_NAME(Bop_PFI_OP_Aop_PFI(KtoK))( GenefxState *gfxs )
+{
+     int            i    = 0;
+     int            w    = gfxs->length;
+     u16           *S    = gfxs->Bop[0];
+     u16           *D    = gfxs->Aop[0];
+     u16            Skey = gfxs->Skey;
+     u16            Dkey = gfxs->Dkey;
+     const __m128i  mask = _mm_set1_epi16( RGB_MASK );
+     const __m128i  skey = _mm_set1_epi16( Skey );
+     const __m128i  dkey = _mm_set1_epi16( Dkey );
+
+     if (gfxs->Astep != 1 || gfxs->Bstep != 1) {
+          Bop_PFI_OP_Aop_PFI(KtoK)( gfxs );
+          return;
+     }
+
+     for (; i + 8 <= w; i += 8) {
+          __m128i s = _mm_loadu_si128( (const __m128i*) (S + i) );
+          __m128i d = _mm_loadu_si128( (const __m128i*) (D + i) );
+
+          store_masked_SSE2( D + i, s, _mm_andnot_si128( _mm_cmpeq_epi16( _mm_and_si128( s, mask ), skey ),
+                                                         _mm_cmpeq_epi16( _mm_and_si128( d, mask ), dkey ) ) );
+     }
+
+     for (; i < w; i++) {
+          u16 s = S[i];
+
+          if (MASK_RGB( s ) != Skey && MASK_RGB( D[i] ) == Dkey)
+               D[i] = s;
+     }
+}
+
+/**********************************************************************************************************************/
+
+#undef MASK_RGB
+#undef SSE2_NAME
+#undef SSE2_NAME_
+
+#undef RGB_MASK
+#undef Cop_OP_Aop_PFI
+#undef Bop_PFI_OP_Aop_PFI
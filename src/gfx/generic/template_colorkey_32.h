@@ -26,7 +26,7 @@ Cop_OP_Aop_PFI(toK)( GenefxState *gfxs )
      int  w    = gfxs->length + 1;
      u32 *D    = gfxs->Aop[0];
      u32  Cop  = gfxs->Cop;
-     u32  Dkey = gfxs->Dkey;
+     u32  Dkey = gfxs->Dkey & RGB_MASK;
 
      while (--w) {
           if ((*D & RGB_MASK) == Dkey)
@@ -46,13 +46,13 @@ Bop_PFI_OP_Aop_PFI(toK)( GenefxState *gfxs )
      int  w     = gfxs->length + 1;
      u32 *S     = gfxs->Bop[0];
      u32 *D     = gfxs->Aop[0];
-     u32  Dkey  = gfxs->Dkey;
+     u32  Dkey  = gfxs->Dkey & RGB_MASK;
      int  Sstep = gfxs->Bstep;
      int  Dstep = gfxs->Astep;
 
      if (Sstep < 0) {
           S +=  gfxs->length - 1;
-          D += (gfxs->length - 1) * Dstep;
+          D -= (gfxs->length - 1) * Dstep;
      }
 
      while (--w) {
@@ -75,13 +75,13 @@ Bop_PFI_OP_Aop_PFI(Kto)( GenefxState *gfxs )
      int  w     = gfxs->length + 1;
      u32 *S     = gfxs->Bop[0];
      u32 *D     = gfxs->Aop[0];
-     u32  Skey  = gfxs->Skey;
+     u32  Skey  = gfxs->Skey & RGB_MASK;
      int  Sstep = gfxs->Bstep;
      int  Dstep = gfxs->Astep;
 
      if (Sstep < 0) {
           S +=  gfxs->length - 1;
-          D += (gfxs->length - 1) * Dstep;
+          D -= (gfxs->length - 1) * Dstep;
      }
 
      while (--w) {
@@ -105,14 +105,14 @@ Bop_PFI_OP_Aop_PFI(KtoK)( GenefxState *gfxs )
      int  w     = gfxs->length + 1;
      u32 *S     = gfxs->Bop[0];
      u32 *D     = gfxs->Aop[0];
-     u32  Skey  = gfxs->Skey;
-     u32  Dkey  = gfxs->Dkey;
+     u32  Skey  = gfxs->Skey & RGB_MASK;
+     u32  Dkey  = gfxs->Dkey & RGB_MASK;
      int  Sstep = gfxs->Bstep;
      int  Dstep = gfxs->Astep;
 
      if (Sstep < 0) {
           S +=  gfxs->length - 1;
-          D += (gfxs->length - 1) * Dstep;
+          D -= (gfxs->length - 1) * Dstep;
      }
 
      while (--w) {
@@ -137,7 +137,7 @@ Bop_PFI_OP_Aop_PFI(SKto)( GenefxState *gfxs )
      int  w     = gfxs->length + 1;
      u32 *S     = gfxs->Bop[0];
      u32 *D     = gfxs->Aop[0];
-     u32  Skey  = gfxs->Skey;
+     u32  Skey  = gfxs->Skey & RGB_MASK;
      int  Dstep = gfxs->Astep;
      int  SperD = gfxs->SperD;
 
@@ -163,7 +163,7 @@ Bop_PFI_OP_Aop_PFI(StoK)( GenefxState *gfxs )
      int  w     = gfxs->length + 1;
      u32 *S     = gfxs->Bop[0];
      u32 *D     = gfxs->Aop[0];
-     u32  Dkey  = gfxs->Dkey;
+     u32  Dkey  = gfxs->Dkey & RGB_MASK;
      int  Dstep = gfxs->Astep;
      int  SperD = gfxs->SperD;
 
@@ -187,8 +187,8 @@ Bop_PFI_OP_Aop_PFI(SKtoK)( GenefxState *gfxs )
      int  w     = gfxs->length + 1;
      u32 *S     = gfxs->Bop[0];
      u32 *D     = gfxs->Aop[0];
-     u32  Skey  = gfxs->Skey;
-     u32  Dkey  = gfxs->Dkey;
+     u32  Skey  = gfxs->Skey & RGB_MASK;
+     u32  Dkey  = gfxs->Dkey & RGB_MASK;
      int  Dstep = gfxs->Astep;
      int  SperD = gfxs->SperD;
 
@@ -22,14 +22,83 @@
 
 /**********************************************************************************************************************/
 
-static bool      copy_state_inited;
-static CardState copy_state;
+/*
+ * States used by the copy functions, so that copies from different threads do not serialize on a single state.
+ * A caller has to wait only if all of them are in use.
+ */
+#define UTIL_STATES 4
+
+static CardState       util_states[UTIL_STATES];
+static unsigned int    util_states_inited;           /* mask of initialized states */
+static unsigned int    util_states_busy;             /* mask of states in use */
+static unsigned int    util_states_uses;
+static unsigned int    util_states_waits;
+
+static bool            util_wq_inited;
+static DirectWaitQueue util_wq;
+static DirectMutex     util_lock = DIRECT_MUTEX_INITIALIZER();
+
+static CardState *
+util_state_get( void )
+{
+     int        i;
+     CardState *state;
+
+     direct_mutex_lock( &util_lock );
+
+     if (!util_wq_inited) {
+          direct_waitqueue_init( &util_wq );
+          util_wq_inited = true;
+     }
+
+     util_states_uses++;
+
+     if (util_states_busy == (1 << UTIL_STATES) - 1) {
+          util_states_waits++;
+
+          do {
+               direct_waitqueue_wait( &util_wq, &util_lock );
+          } while (util_states_busy == (1 << UTIL_STATES) - 1);
+     }
+
+     for (i = 0; util_states_busy & (1 << i); i++);
 
-static bool      btf_state_inited;
-static CardState btf_state;
+     util_states_busy |= 1 << i;
 
-static DirectMutex copy_lock = DIRECT_MUTEX_INITIALIZER();
-static DirectMutex btf_lock  = DIRECT_MUTEX_INITIALIZER();
+     state = &util_states[i];
+
+     if (!(util_states_inited & (1 << i))) {
+          dfb_state_init( state, NULL );
+          util_states_inited |= 1 << i;
+     }
+
+     direct_mutex_unlock( &util_lock );
+
+     state->modified      |= SMF_CLIP | SMF_BLITTING_FLAGS;
+     state->clip.x1        = 0;
+     state->clip.y1        = 0;
+     state->blittingflags  = DSBLIT_NOFX;
+
+     return state;
+}
+
+static void
+util_state_put( CardState *state )
+{
+     /* Do not keep the buffers of the copy locked while the state is unused. */
+     dfb_gfxcard_state_release_locks( state );
+
+     state->destination = NULL;
+     state->source      = NULL;
+
+     direct_mutex_lock( &util_lock );
+
+     util_states_busy &= ~(1 << (state - util_states));
+
+     direct_waitqueue_signal( &util_wq );
+
+     direct_mutex_unlock( &util_lock );
+}
 
 void
 dfb_gfx_copy_stereo( CoreSurface         *source,
@@ -41,78 +110,65 @@ dfb_gfx_copy_stereo( CoreSurface         *source,
                      int                  y,
                      bool                 from_back )
 {
-     DFBRectangle sourcerect = { 0, 0, source->config.size.w, source->config.size.h };
+     DFBRectangle  sourcerect = { 0, 0, source->config.size.w, source->config.size.h };
+     CardState    *state;
 
-     direct_mutex_lock( &copy_lock );
+     state = util_state_get();
 
-     if (!copy_state_inited) {
-          dfb_state_init( &copy_state, NULL );
-          copy_state_inited = true;
-     }
-
-     copy_state.modified   |= SMF_CLIP | SMF_SOURCE | SMF_DESTINATION | SMF_FROM | SMF_TO;
-     copy_state.clip.x2     = destination->config.size.w - 1;
-     copy_state.clip.y2     = destination->config.size.h - 1;
-     copy_state.source      = source;
-     copy_state.destination = destination;
-     copy_state.from        = from_back ? DSBR_BACK : DSBR_FRONT;
-     copy_state.from_eye    = source_eye;
-     copy_state.to          = DSBR_BACK;
-     copy_state.to_eye      = destination_eye;
+     state->modified    |= SMF_CLIP | SMF_SOURCE | SMF_DESTINATION | SMF_FROM | SMF_TO;
+     state->clip.x2      = destination->config.size.w - 1;
+     state->clip.y2      = destination->config.size.h - 1;
+     state->source       = source;
+     state->destination  = destination;
+     state->from         = from_back ? DSBR_BACK : DSBR_FRONT;
+     state->from_eye     = source_eye;
+     state->to           = DSBR_BACK;
+     state->to_eye       = destination_eye;
 
      if (rect) {
           if (dfb_rectangle_intersect( &sourcerect, rect ))
-               dfb_gfxcard_blit( &sourcerect, x + sourcerect.x - rect->x, y + sourcerect.y - rect->y, &copy_state );
+               dfb_gfxcard_blit( &sourcerect, x + sourcerect.x - rect->x, y + sourcerect.y - rect->y, state );
      }
      else
-          dfb_gfxcard_blit( &sourcerect, x, y, &copy_state );
+          dfb_gfxcard_blit( &sourcerect, x, y, state );
 
      dfb_gfxcard_flush();
 
      /* Signal end of sequence. */
-     dfb_state_stop_drawing( &copy_state );
-
-     copy_state.destination = NULL;
-     copy_state.source      = NULL;
+     dfb_state_stop_drawing( state );
 
-     direct_mutex_unlock( &copy_lock );
+     util_state_put( state );
 }
 
 void
 dfb_gfx_clear( CoreSurface          *surface,
                DFBSurfaceBufferRole  role )
 {
-     DFBRectangle rect = { 0, 0, surface->config.size.w, surface->config.size.h };
+     DFBRectangle  rect = { 0, 0, surface->config.size.w, surface->config.size.h };
+     CardState    *state;
 
-     direct_mutex_lock( &copy_lock );
+     state = util_state_get();
 
-     if (!copy_state_inited) {
-          dfb_state_init( &copy_state, NULL );
-          copy_state_inited = true;
-     }
+     state->modified    |= SMF_CLIP | SMF_COLOR | SMF_DESTINATION | SMF_TO;
+     state->clip.x2      = surface->config.size.w - 1;
+     state->clip.y2      = surface->config.size.h - 1;
+     state->destination  = surface;
+     state->to           = role;
+     state->to_eye       = DSSE_LEFT;
+     state->color.a      = 0;
+     state->color.r      = 0;
+     state->color.g      = 0;
+     state->color.b      = 0;
+     state->color_index  = 0;
 
-     copy_state.modified   |= SMF_CLIP | SMF_COLOR | SMF_DESTINATION | SMF_TO;
-     copy_state.clip.x2     = surface->config.size.w - 1;
-     copy_state.clip.y2     = surface->config.size.h - 1;
-     copy_state.destination = surface;
-     copy_state.to          = role;
-     copy_state.to_eye      = DSSE_LEFT;
-     copy_state.color.a     = 0;
-     copy_state.color.r     = 0;
-     copy_state.color.g     = 0;
-     copy_state.color.b     = 0;
-     copy_state.color_index = 0;
-
-     dfb_gfxcard_fillrectangles( &rect, 1, &copy_state );
+     dfb_gfxcard_fillrectangles( &rect, 1, state );
 
      dfb_gfxcard_flush();
 
      /* Signal end of sequence. */
-     dfb_state_stop_drawing( &copy_state );
-
-     copy_state.destination = NULL;
+     dfb_state_stop_drawing( state );
 
-     direct_mutex_unlock( &copy_lock );
+     util_state_put( state );
 }
 
 void
@@ -124,8 +180,9 @@ dfb_gfx_stretch_stereo( CoreSurface         *source,
                         const DFBRectangle  *drect,
                         bool                 from_back )
 {
-     DFBRectangle sourcerect = { 0, 0, source->config.size.w, source->config.size.h };
-     DFBRectangle destrect   = { 0, 0, destination->config.size.w, destination->config.size.h };
+     DFBRectangle  sourcerect = { 0, 0, source->config.size.w, source->config.size.h };
+     DFBRectangle  destrect   = { 0, 0, destination->config.size.w, destination->config.size.h };
+     CardState    *state;
 
      if (srect) {
           if (!dfb_rectangle_intersect( &sourcerect, srect ))
@@ -137,34 +194,26 @@ dfb_gfx_stretch_stereo( CoreSurface         *source,
                return;
      }
 
-     direct_mutex_lock( &copy_lock );
-
-     if (!copy_state_inited) {
-          dfb_state_init( &copy_state, NULL );
-          copy_state_inited = true;
-     }
+     state = util_state_get();
 
-     copy_state.modified   |= SMF_CLIP | SMF_SOURCE | SMF_DESTINATION | SMF_FROM | SMF_TO;
-     copy_state.clip.x2     = destination->config.size.w - 1;
-     copy_state.clip.y2     = destination->config.size.h - 1;
-     copy_state.source      = source;
-     copy_state.destination = destination;
-     copy_state.from        = from_back ? DSBR_BACK : DSBR_FRONT;
-     copy_state.from_eye    = source_eye;
-     copy_state.to          = DSBR_BACK;
-     copy_state.to_eye      = destination_eye;
+     state->modified    |= SMF_CLIP | SMF_SOURCE | SMF_DESTINATION | SMF_FROM | SMF_TO;
+     state->clip.x2      = destination->config.size.w - 1;
+     state->clip.y2      = destination->config.size.h - 1;
+     state->source       = source;
+     state->destination  = destination;
+     state->from         = from_back ? DSBR_BACK : DSBR_FRONT;
+     state->from_eye     = source_eye;
+     state->to           = DSBR_BACK;
+     state->to_eye       = destination_eye;
 
-     dfb_gfxcard_stretchblit( &sourcerect, &destrect, &copy_state );
+     dfb_gfxcard_stretchblit( &sourcerect, &destrect, state );
 
      dfb_gfxcard_flush();
 
      /* Signal end of sequence. */
-     dfb_state_stop_drawing( &copy_state );
-
-     copy_state.destination = NULL;
-     copy_state.source      = NULL;
+     dfb_state_stop_drawing( state );
 
-     direct_mutex_unlock( &copy_lock );
+     util_state_put( state );
 }
 
 void
@@ -201,16 +250,8 @@ dfb_gfx_copy_regions_client( CoreSurface             *source,
      }
 
      if (n > 0) {
-          if (!client) {
-               direct_mutex_lock( &copy_lock );
-
-               if (!copy_state_inited) {
-                    dfb_state_init( &copy_state, NULL );
-                    copy_state_inited = true;
-               }
-
-               state = &copy_state;
-          }
+          if (!client)
+               state = util_state_get();
           else
                state = client->state;
 
@@ -237,7 +278,7 @@ dfb_gfx_copy_regions_client( CoreSurface             *source,
           state->blittingflags = DSBLIT_NOFX;
 
           if (!client) {
-               dfb_gfxcard_batchblit( rects, points, n, &copy_state );
+               dfb_gfxcard_batchblit( rects, points, n, state );
 
                dfb_gfxcard_flush();
           }
@@ -258,85 +299,75 @@ dfb_gfx_copy_regions_client( CoreSurface             *source,
           state->blittingflags = backup.blittingflags;
 
           if (!client)
-               direct_mutex_unlock( &copy_lock );
+               util_state_put( state );
      }
 }
 
 static void
 back_to_front_copy( CoreSurface             *surface,
                     DFBSurfaceStereoEye      eye,
-                    const DFBRegion         *region,
+                    const DFBRegion         *regions,
+                    int                      num,
                     DFBSurfaceBlittingFlags  flags,
                     int                      rotation )
 {
-     DFBRectangle  rect;
-     int           dx, dy;
-     CardState    *state = &btf_state;
-
-     if (region) {
-          rect.x = region->x1;
-          rect.y = region->y1;
-          rect.w = region->x2 - region->x1 + 1;
-          rect.h = region->y2 - region->y1 + 1;
-     }
-     else {
-          rect.x = 0;
-          rect.y = 0;
-          rect.w = surface->config.size.w;
-          rect.h = surface->config.size.h;
-     }
+     int        i;
+     DFBRegion  full = DFB_REGION_INIT_FROM_DIMENSION( &surface->config.size );
+     CardState *state;
 
-     dx = rect.x;
-     dy = rect.y;
-
-     direct_mutex_lock( &btf_lock );
-
-     if (!btf_state_inited) {
-          dfb_state_init( state, NULL );
-
-          state->from = DSBR_BACK;
-          state->to   = DSBR_FRONT;
-
-          btf_state_inited = true;
+     if (!regions) {
+          regions = &full;
+          num     = 1;
      }
 
-     state->modified   |= SMF_CLIP | SMF_SOURCE | SMF_DESTINATION | SMF_FROM | SMF_TO;
-     state->clip.x2     = surface->config.size.w - 1;
-     state->clip.y2     = surface->config.size.h - 1;
-     state->source      = surface;
-     state->destination = surface;
-     state->from_eye    = eye;
-     state->to_eye      = eye;
+     state = util_state_get();
 
-     if (rotation == 90) {
-          dx = rect.y;
-          dy = surface->config.size.w - rect.w - rect.x;
+     state->modified    |= SMF_CLIP | SMF_SOURCE | SMF_DESTINATION | SMF_FROM | SMF_TO;
+     state->clip.x2      = surface->config.size.w - 1;
+     state->clip.y2      = surface->config.size.h - 1;
+     state->source       = surface;
+     state->destination  = surface;
+     state->from         = DSBR_BACK;
+     state->from_eye     = eye;
+     state->to           = DSBR_FRONT;
+     state->to_eye       = eye;
 
+     if (rotation == 90)
           flags |= DSBLIT_ROTATE90;
-     }
-     else if (rotation == 180) {
-          dx = surface->config.size.w - rect.w - rect.x;
-          dy = surface->config.size.h - rect.h - rect.y;
-
+     else if (rotation == 180)
           flags |= DSBLIT_ROTATE180;
-     }
-     else if (rotation == 270) {
-          dx = surface->config.size.h - rect.h - rect.y;
-          dy = rect.x;
-
+     else if (rotation == 270)
           flags |= DSBLIT_ROTATE270;
-     }
 
      dfb_state_set_blitting_flags( state, flags );
 
-     dfb_gfxcard_blit( &rect, dx, dy, state );
+     for (i = 0; i < num; i++) {
+          DFBRectangle rect = DFB_RECTANGLE_INIT_FROM_REGION( &regions[i] );
+          int          dx   = rect.x;
+          int          dy   = rect.y;
+
+          if (rotation == 90) {
+               dx = rect.y;
+               dy = surface->config.size.w - rect.w - rect.x;
+          }
+          else if (rotation == 180) {
+               dx = surface->config.size.w - rect.w - rect.x;
+               dy = surface->config.size.h - rect.h - rect.y;
+          }
+          else if (rotation == 270) {
+               dx = surface->config.size.h - rect.h - rect.y;
+               dy = rect.x;
+          }
+
+          dfb_gfxcard_blit( &rect, dx, dy, state );
+     }
 
      dfb_gfxcard_flush();
 
      /* Signal end of sequence. */
      dfb_state_stop_drawing( state );
 
-     direct_mutex_unlock( &btf_lock );
+     util_state_put( state );
 }
 
 void
@@ -346,11 +377,39 @@ dfb_back_to_front_copy_stereo( CoreSurface         *surface,
                                const DFBRegion     *right_region,
                                int                  rotation )
 {
-     if (eyes & DSSE_LEFT)
-          back_to_front_copy( surface, DSSE_LEFT, left_region, DSBLIT_NOFX, rotation );
+     DFBRegion regions[CORE_SURFACE_DAMAGE_REGIONS];
+     int       num;
+     bool      complete = false;
+
+     /* Copy only what has been rendered since the front buffer was up to date. */
+     if (eyes == DSSE_LEFT && dfb_surface_damage_get( surface, left_region, regions, &num, &complete )) {
+          if (num)
+               back_to_front_copy( surface, DSSE_LEFT, regions, num, DSBLIT_NOFX, rotation );
+     }
+     else {
+          if (eyes & DSSE_LEFT)
+               back_to_front_copy( surface, DSSE_LEFT, left_region, 1, DSBLIT_NOFX, rotation );
+
+          if (eyes & DSSE_RIGHT)
+               back_to_front_copy( surface, DSSE_RIGHT, right_region, 1, DSBLIT_NOFX, rotation );
+     }
+
+     dfb_surface_damage_next( surface, complete );
+}
+
+void
+dfb_gfx_get_copy_stats( unsigned int *ret_uses,
+                        unsigned int *ret_waits )
+{
+     D_ASSERT( ret_uses != NULL );
+     D_ASSERT( ret_waits != NULL );
+
+     direct_mutex_lock( &util_lock );
+
+     *ret_uses  = util_states_uses;
+     *ret_waits = util_states_waits;
 
-     if (eyes & DSSE_RIGHT)
-          back_to_front_copy( surface, DSSE_RIGHT, right_region, DSBLIT_NOFX, rotation );
+     direct_mutex_unlock( &util_lock );
 }
 
 void
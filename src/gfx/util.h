@@ -61,6 +61,12 @@ void dfb_back_to_front_copy_stereo( CoreSurface             *surface,
                                     const DFBRegion         *right_region,
                                     int                      rotation );
 
+/*
+ * Get the number of copies done by the functions above and the number of them that had to wait for a state.
+ */
+void dfb_gfx_get_copy_stats       ( unsigned int            *ret_uses,
+                                    unsigned int            *ret_waits );
+
 void dfb_sort_triangle            ( DFBTriangle             *tri );
 
 void dfb_sort_trapezoid           ( DFBTrapezoid            *trap );
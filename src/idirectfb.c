@@ -44,6 +44,7 @@
 #include <display/idirectfbsurface.h>
 #include <display/idirectfbsurface_layer.h>
 #include <display/idirectfbsurface_window.h>
+#include <gfx/generic/generic_stats.h>
 #include <idirectfb.h>
 #include <input/idirectfbeventbuffer.h>
 #include <input/idirectfbinputdevice.h>
@@ -583,7 +584,7 @@ IDirectFB_CreateSurface( IDirectFB                    *thiz,
           format     = dfb_config->font_format;
           colorspace = DFB_COLORSPACE_DEFAULT( format );
 
-          if (dfb_config->font_premult)
+          if (dfb_config->font_premult || dfb_config->premultiplied)
                caps  = DSCAPS_PREMULTIPLIED;
      }
      else {
@@ -990,6 +991,11 @@ IDirectFB_CreateSurface( IDirectFB                    *thiz,
      if ((caps & DSCAPS_FLIPPING) == DSCAPS_FLIPPING)
           caps &= ~DSCAPS_TRIPLE;
 
+     /* Keep the contents premultiplied for composition, except for memory provided by the application. */
+     if (dfb_config->premultiplied && dfb_surface_format_can_premultiply( format ) &&
+         !(desc->flags & DSDESC_PREALLOCATED))
+          caps |= DSCAPS_PREMULTIPLIED;
+
      if (desc->flags & DSDESC_PREALLOCATED) {
           int               min_pitch;
           CoreSurfaceConfig surface_config;
@@ -1775,6 +1781,32 @@ IDirectFB_GetFontSurfaceFormat( IDirectFB             *thiz,
      return DFB_OK;
 }
 
+static DFBResult
+IDirectFB_GetSoftwareStats( IDirectFB                *thiz,
+                            DFBSoftwarePipelineStats *ret_stats,
+                            unsigned int              max,
+                            unsigned int             *ret_num,
+                            DFBBoolean                reset )
+{
+     unsigned int num;
+
+     DIRECT_INTERFACE_GET_DATA( IDirectFB )
+
+     D_DEBUG_AT( DirectFB, "%s( %p, %u )\n", __FUNCTION__, thiz, max );
+
+     if ((!ret_stats && max) || !ret_num)
+          return DFB_INVARG;
+
+     if (!dfb_config->software_stats)
+          return DFB_UNSUPPORTED;
+
+     num = Genefx_Stats_Get( ret_stats, max, reset );
+
+     *ret_num = num;
+
+     return DFB_OK;
+}
+
 static void
 LoadBackgroundImage( IDirectFB       *dfb,
                      CoreWindowStack *stack,
@@ -2114,6 +2146,7 @@ IDirectFB_Construct( IDirectFB *thiz )
      thiz->GetInterface           = IDirectFB_GetInterface;
      thiz->GetSurface             = IDirectFB_GetSurface;
      thiz->GetFontSurfaceFormat   = IDirectFB_GetFontSurfaceFormat;
+     thiz->GetSoftwareStats       = IDirectFB_GetSoftwareStats;
 
      direct_mutex_init( &data->init_lock );
      direct_waitqueue_init( &data->init_wq );
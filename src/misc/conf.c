@@ -85,16 +85,23 @@ const char *dfb_config_usage =
      "  [no-]software                  Enable software fallbacks (default enabled)\n"
      "  [no-]software-warn             Show warnings when doing/dropping software operations\n"
      "  [no-]software-trace            Show every stage of the software rendering pipeline\n"
+     "  [no-]software-stats=[<ms>]     Collect software pipeline statistics and print them periodically (0 to only collect)\n"
      "  [no-]gfxcard-stats=[<ms>]      Print GPU usage statistics periodically (1000 ms if no period is specified)\n"
      "  videoram-limit=<amount>        Limit the amount of Video RAM used (kilobytes)\n"
      "  [no-]gfx-emit-early            Early emit GFX commands to prevent being IDLE\n"
      "  [no-]startstop                 Issue StartDrawing/StopDrawing to driver\n"
      "  [no-]smooth-upscale            Enable smooth upscaling\n"
      "  [no-]smooth-downscale          Enable smooth downscaling\n"
+     "  smooth-filter=<filter>         Filter used for smooth scaling [ bilinear | 4tap ] (default = bilinear)\n"
      "  keep-accumulators=<limit>      Free accumulators above the limit (default = 1024)\n"
      "                                 Setting -1 never frees accumulators until the state is destroyed\n"
+     "  software-threads=<num>         Split software operations into bands rendered by <num> threads (default = 1)\n"
+     "  software-threads-min=<pixels>  Render software operations below this size in one piece (default = 65536)\n"
+     "  [no-]software-queue            Render software operations asynchronously on a separate thread\n"
      "  [no-]mmx                       Enable MMX assembly support (enabled by default if available)\n"
      "  [no-]neon                      Enable NEON assembly support (enabled by default if available)\n"
+     "  [no-]sse2                      Enable SSE2 support (enabled by default if available)\n"
+     "  [no-]avx2                      Enable AVX2 support on top of SSE2 (enabled by default if available)\n"
      "  warn=<type[:<width>x<height>]> Print warnings on surface/window creations or surface buffer allocations\n"
      "                                 [ create-surface | create-window | allocate-buffer ]\n"
      "  [no-]surface-clear             Clear all surface buffers after creation\n"
@@ -113,6 +120,8 @@ const char *dfb_config_usage =
      "  max-frame-advance=<us>         Set the maximum time ahead for rendering frames (default 100000)\n"
      "  [no-]force-frametime           Call GetFrameTime() before each Flip() automatically\n"
      "  [no-]subsurface-caching        Optimize the recreation of sub-surfaces\n"
+     "  [no-]damage-tracking           Copy only areas rendered since the last flip to the front buffer\n"
+     "                                 (default enabled)\n"
      "  window-surface-policy=<policy> Specify the swapping policy for window surfaces (default = auto)\n"
      "                                 [ auto | videohigh | videolow | systemonly | videoonly ]\n"
      "                                 auto:       DirectFB decides depending on hardware capabilities\n"
@@ -122,6 +131,7 @@ const char *dfb_config_usage =
      "                                 videoonly:  Window surfaces are stored in video memory\n"
      "  [no-]single-window             Set configuration on region when window changes its attributes\n"
      "  [no-]translucent-windows       Allow translucent windows (default enabled)\n"
+     "  [no-]premultiplied             Create surfaces and windows with an alpha channel premultiplied\n"
      "  [no-]force-windowed            Force the primary surface to be a window\n"
      "  scaled=<width>x<height>        Scale the window to this size for 'force-windowed' apps\n"
      "  [no-]autoflip-window           Auto flip non-flipping windowed primary surfaces (default enabled)\n"
@@ -270,12 +280,18 @@ config_allocate( void )
 
      dfb_config->keep_accumulators                     = 1024;
 
+     dfb_config->software_threads                      = 1;
+     dfb_config->software_threads_min                  = 65536;
+
      dfb_config->mmx                                   = true;
      dfb_config->neon                                  = true;
+     dfb_config->sse2                                  = true;
+     dfb_config->avx2                                  = true;
 
      dfb_config->surface_shmpool_size                  = 64 * 1024 * 1024;
 
      dfb_config->max_frame_advance                     = 100000;
+     dfb_config->damage_tracking                       = true;
 
      dfb_config->window_policy                         = -1;
      dfb_config->translucent_windows                   = true;
@@ -970,6 +986,26 @@ dfb_config_set( const char *name,
      if (strcmp( name, "no-software-trace" ) == 0) {
           dfb_config->software_trace = false;
      } else
+     if (strcmp( name, "software-stats" ) == 0) {
+          if (value) {
+               unsigned int interval;
+
+               if (sscanf( value, "%u", &interval ) < 1) {
+                    D_ERROR( "DirectFB/Config: '%s': Could not parse value!\n", name );
+                    return DFB_INVARG;
+               }
+
+               dfb_config->software_stats_dump = interval;
+          }
+          else
+               dfb_config->software_stats_dump = 1000;
+
+          dfb_config->software_stats = true;
+     } else
+     if (strcmp( name, "no-software-stats" ) == 0) {
+          dfb_config->software_stats      = false;
+          dfb_config->software_stats_dump = 0;
+     } else
      if (strcmp( name, "gfxcard-stats" ) == 0) {
           if (value) {
                unsigned int interval;
@@ -1027,6 +1063,24 @@ dfb_config_set( const char *name,
      if (strcmp( name, "no-smooth-downscale" ) == 0) {
           dfb_config->render_options &= ~DSRO_SMOOTH_DOWNSCALE;
      } else
+     if (strcmp( name, "smooth-filter" ) == 0) {
+          if (value) {
+               if (strcmp( value, "bilinear" ) == 0) {
+                    dfb_config->smooth_filter = DCSF_BILINEAR;
+               }
+               else if (strcmp( value, "4tap" ) == 0) {
+                    dfb_config->smooth_filter = DCSF_4TAP;
+               }
+               else {
+                    D_ERROR( "DirectFB/Config: '%s': Unknown filter '%s'!\n", name, value );
+                    return DFB_INVARG;
+               }
+          }
+          else {
+               D_ERROR( "DirectFB/Config: '%s': No filter specified!\n", name );
+               return DFB_INVARG;
+          }
+     } else
      if (strcmp( name, "keep-accumulators" ) == 0) {
           if (value) {
                int limit;
@@ -1043,6 +1097,49 @@ dfb_config_set( const char *name,
                return DFB_INVARG;
           }
      } else
+     if (strcmp( name, "software-threads" ) == 0) {
+          if (value) {
+               int threads;
+
+               if (sscanf( value, "%d", &threads ) < 1) {
+                    D_ERROR( "DirectFB/Config: '%s': Could not parse value!\n", name );
+                    return DFB_INVARG;
+               }
+
+               if (threads < 1) {
+                    D_ERROR( "DirectFB/Config: '%s': Value must be positive!\n", name );
+                    return DFB_INVARG;
+               }
+
+               dfb_config->software_threads = threads;
+          }
+          else {
+               D_ERROR( "DirectFB/Config: '%s': No value specified!\n", name );
+               return DFB_INVARG;
+          }
+     } else
+     if (strcmp( name, "software-threads-min" ) == 0) {
+          if (value) {
+               int pixels;
+
+               if (sscanf( value, "%d", &pixels ) < 1) {
+                    D_ERROR( "DirectFB/Config: '%s': Could not parse value!\n", name );
+                    return DFB_INVARG;
+               }
+
+               dfb_config->software_threads_min = pixels;
+          }
+          else {
+               D_ERROR( "DirectFB/Config: '%s': No value specified!\n", name );
+               return DFB_INVARG;
+          }
+     } else
+     if (strcmp( name, "software-queue" ) == 0) {
+          dfb_config->software_queue = true;
+     } else
+     if (strcmp( name, "no-software-queue" ) == 0) {
+          dfb_config->software_queue = false;
+     } else
      if (strcmp( name, "mmx" ) == 0) {
           dfb_config->mmx = true;
      } else
@@ -1055,6 +1152,18 @@ dfb_config_set( const char *name,
      if (strcmp( name, "no-neon" ) == 0) {
           dfb_config->neon = false;
      } else
+     if (strcmp( name, "sse2" ) == 0) {
+          dfb_config->sse2 = true;
+     } else
+     if (strcmp( name, "no-sse2" ) == 0) {
+          dfb_config->sse2 = false;
+     } else
+     if (strcmp( name, "avx2" ) == 0) {
+          dfb_config->avx2 = true;
+     } else
+     if (strcmp( name, "no-avx2" ) == 0) {
+          dfb_config->avx2 = false;
+     } else
      if (strcmp( name, "warn" ) == 0 || strcmp( name, "no-warn" ) == 0) {
           DFBConfigWarnFlags flags = DCWF_ALL;
 
@@ -1193,6 +1302,12 @@ dfb_config_set( const char *name,
      if (strcmp( name, "no-subsurface-caching" ) == 0) {
           dfb_config->subsurface_caching = false;
      } else
+     if (strcmp( name, "damage-tracking" ) == 0) {
+          dfb_config->damage_tracking = true;
+     } else
+     if (strcmp( name, "no-damage-tracking" ) == 0) {
+          dfb_config->damage_tracking = false;
+     } else
      if (strcmp( name, "window-surface-policy" ) == 0) {
           if (value) {
                if (strcmp( value, "auto" ) == 0) {
@@ -1232,6 +1347,12 @@ dfb_config_set( const char *name,
      if (strcmp( name, "no-translucent-windows" ) == 0) {
           dfb_config->translucent_windows = false;
      } else
+     if (strcmp( name, "premultiplied" ) == 0) {
+          dfb_config->premultiplied = true;
+     } else
+     if (strcmp( name, "no-premultiplied" ) == 0) {
+          dfb_config->premultiplied = false;
+     } else
      if (strcmp( name, "force-windowed" ) == 0) {
           dfb_config->force_windowed = true;
      } else
@@ -60,6 +60,11 @@ typedef enum {
      DCWF_ALL             = 0x00000013
 } DFBConfigWarnFlags;
 
+typedef enum {
+     DCSF_BILINEAR        = 0x00000000,  /* interpolate between the two nearest pixels in each direction */
+     DCSF_4TAP            = 0x00000001   /* sharper cubic filter using four pixels in each direction */
+} DFBConfigSmoothFilter;
+
 typedef struct
 {
      char                       *system;
@@ -90,14 +95,22 @@ typedef struct
      bool                        hardware_only;
      bool                        software_warn;
      bool                        software_trace;
+     bool                        software_stats;
+     unsigned int                software_stats_dump;
      unsigned int                gfxcard_stats;
      unsigned int                videoram_limit;
      bool                        gfx_emit_early;
      bool                        startstop;
      DFBSurfaceRenderOptions     render_options;
+     DFBConfigSmoothFilter       smooth_filter;
      int                         keep_accumulators;
+     int                         software_threads;
+     int                         software_threads_min;
+     bool                        software_queue;
      bool                        mmx;
      bool                        neon;
+     bool                        sse2;
+     bool                        avx2;
      struct {
           DFBConfigWarnFlags     flags;
           struct {
@@ -115,9 +128,11 @@ typedef struct
      long long                   max_frame_advance;
      bool                        force_frametime;
      bool                        subsurface_caching;
+     bool                        damage_tracking;
      int                         window_policy;
      bool                        single_window;
      bool                        translucent_windows;
+     bool                        premultiplied;
      bool                        force_windowed;
      struct {
           int                    width;
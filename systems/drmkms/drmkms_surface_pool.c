@@ -492,7 +492,8 @@ drmkmsDeallocateBuffer( CoreSurfacePool       *pool,
      D_MAGIC_ASSERT( local, DRMKMSPoolLocalData );
      D_MAGIC_ASSERT( alloc, DRMKMSAllocationData );
 
-     dfb_gfxcard_sync();
+     /* Wait for the operations accessing the allocation, not for the whole engine. */
+     dfb_surface_allocation_wait( allocation, CSAID_CPU, CSAF_READ | CSAF_WRITE );
 
      D_DEBUG_AT( DRMKMS_Surfaces, "  -> handle   %u\n", alloc->handle );
      D_DEBUG_AT( DRMKMS_Surfaces, "  -> pitch    %u\n", alloc->pitch );
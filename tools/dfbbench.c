@@ -0,0 +1,1031 @@
+/*
+   This file is part of DirectFB.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+*/
+
+#include <dgiff.h>
+#include <direct/util.h>
+#include <directfb_strings.h>
+#include <getopt.h>
+#include <time.h>
+
+/*
+ * Headless benchmark of the graphics operations, running on the dummy system by default.
+ */
+
+/**********************************************************************************************************************/
+
+#define MAX_ITEMS       32
+#define MAX_RESULTS     4096
+#define DST_SIZE        512
+#define BATCH_RECTS     16
+
+#define FONT_SIZE       16
+#define FONT_ADVANCE    9
+#define FONT_FIRST      32
+#define FONT_GLYPHS     95
+
+typedef enum {
+     TEST_FILL,
+     TEST_BLIT,
+     TEST_BATCHBLIT,
+     TEST_STRETCH,
+     TEST_STRETCH_SMOOTH,
+     TEST_TRIANGLES,
+     TEST_TEXT,
+     NUM_TESTS
+} TestID;
+
+static const char *test_names[NUM_TESTS] = {
+     [TEST_FILL]           = "fill",
+     [TEST_BLIT]           = "blit",
+     [TEST_BATCHBLIT]      = "batchblit",
+     [TEST_STRETCH]        = "stretch",
+     [TEST_STRETCH_SMOOTH] = "stretch-smooth",
+     [TEST_TRIANGLES]      = "triangles",
+     [TEST_TEXT]           = "text"
+};
+
+typedef struct {
+     char   name[128];
+
+     double ops;        /* operations per second */
+     double mpixels;    /* megapixels per second */
+} Result;
+
+typedef struct {
+     bool                    tests[NUM_TESTS];
+
+     DFBSurfacePixelFormat   dst_formats[MAX_ITEMS];
+     int                     num_dst_formats;
+
+     DFBSurfacePixelFormat   src_formats[MAX_ITEMS];
+     int                     num_src_formats;
+
+     DFBSurfaceBlittingFlags blittingflags[MAX_ITEMS];
+     int                     num_blittingflags;
+
+     int                     sizes[MAX_ITEMS];
+     int                     num_sizes;
+
+     int                     duration;   /* per benchmark in milliseconds */
+     const char             *system;
+     const char             *json;
+     const char             *font;
+} Options;
+
+static DirectFBPixelFormatNames( format_names );
+static DirectFBSurfaceBlittingFlagsNames( blittingflag_names );
+
+static IDirectFB *dfb;
+static Options    options;
+static Result     results[MAX_RESULTS];
+static int        num_results;
+
+/**********************************************************************************************************************/
+
+static long long
+now_us( void )
+{
+     struct timespec ts;
+
+     clock_gettime( CLOCK_MONOTONIC, &ts );
+
+     return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static const char *
+format_name( DFBSurfacePixelFormat format )
+{
+     int i;
+
+     for (i = 0; i < D_ARRAY_SIZE(format_names); i++) {
+          if (format_names[i].format == format)
+               return format_names[i].name;
+     }
+
+     return "UNKNOWN";
+}
+
+static DFBSurfacePixelFormat
+parse_format( const char *name )
+{
+     int i;
+
+     for (i = 0; i < D_ARRAY_SIZE(format_names); i++) {
+          if (!strcasecmp( format_names[i].name, name ))
+               return format_names[i].format;
+     }
+
+     return DSPF_UNKNOWN;
+}
+
+static void
+blittingflags_name( DFBSurfaceBlittingFlags  flags,
+                    char                    *buf,
+                    size_t                   size )
+{
+     int i;
+
+     if (flags == DSBLIT_NOFX) {
+          snprintf( buf, size, "NOFX" );
+          return;
+     }
+
+     buf[0] = 0;
+
+     for (i = 0; i < D_ARRAY_SIZE(blittingflag_names); i++) {
+          DFBSurfaceBlittingFlags flag = blittingflag_names[i].flag;
+
+          if (flag != DSBLIT_NOFX && (flags & flag) == flag) {
+               if (buf[0])
+                    strncat( buf, "+", size - strlen( buf ) - 1 );
+
+               strncat( buf, blittingflag_names[i].name, size - strlen( buf ) - 1 );
+          }
+     }
+}
+
+/* Parse flag names joined by '+', e.g. "BLEND_ALPHACHANNEL+COLORIZE". */
+static bool
+parse_blittingflags( const char              *arg,
+                     DFBSurfaceBlittingFlags *ret_flags )
+{
+     DFBSurfaceBlittingFlags  flags = DSBLIT_NOFX;
+     char                     buf[256];
+     char                    *name;
+     char                    *save;
+     int                      i;
+
+     snprintf( buf, sizeof(buf), "%s", arg );
+
+     for (name = strtok_r( buf, "+", &save ); name; name = strtok_r( NULL, "+", &save )) {
+          for (i = 0; i < D_ARRAY_SIZE(blittingflag_names); i++) {
+               if (!strcasecmp( blittingflag_names[i].name, name )) {
+                    flags |= blittingflag_names[i].flag;
+                    break;
+               }
+          }
+
+          if (i == D_ARRAY_SIZE(blittingflag_names))
+               return false;
+     }
+
+     *ret_flags = flags;
+
+     return true;
+}
+
+/**********************************************************************************************************************/
+
+static void
+add_result( const char *name,
+            long long   ops,
+            long long   pixels,
+            long long   us )
+{
+     Result *result;
+
+     if (num_results == MAX_RESULTS)
+          return;
+
+     result = &results[num_results++];
+
+     snprintf( result->name, sizeof(result->name), "%s", name );
+
+     result->ops     = ops * 1000000.0 / us;
+     result->mpixels = pixels / (double) us;
+
+     printf( "%-72s %10.2f MPixel/s %12.1f ops/s\n", result->name, result->mpixels, result->ops );
+     fflush( stdout );
+}
+
+static IDirectFBSurface *
+create_surface( DFBSurfacePixelFormat format,
+                int                   width,
+                int                   height )
+{
+     DFBResult              ret;
+     DFBSurfaceDescription  desc;
+     IDirectFBSurface      *surface;
+     u8                    *data;
+     int                    pitch;
+     int                    x, y;
+     unsigned int           seed = 0x12345678;
+
+     desc.flags       = DSDESC_WIDTH | DSDESC_HEIGHT | DSDESC_PIXELFORMAT | DSDESC_CAPS;
+     desc.width       = width;
+     desc.height      = height;
+     desc.pixelformat = format;
+     desc.caps        = DSCAPS_NONE;
+
+     ret = dfb->CreateSurface( dfb, &desc, &surface );
+     if (ret) {
+          DirectFBError( "dfbbench: CreateSurface() failed", ret );
+          return NULL;
+     }
+
+     /* Fill with noise, including fully transparent and opaque pixels. */
+     if (surface->Lock( surface, DSLF_WRITE, (void**) &data, &pitch ) == DFB_OK) {
+          for (y = 0; y < DFB_PLANE_MULTIPLY( format, height ); y++) {
+               for (x = 0; x < pitch; x++) {
+                    seed = seed * 1103515245 + 12345;
+
+                    data[y * pitch + x] = (seed & 0x300000) ? seed >> 24 : ((seed & 0x400000) ? 0xff : 0x00);
+               }
+          }
+
+          surface->Unlock( surface );
+     }
+
+     surface->SetSrcColorKey( surface, 0x00, 0x00, 0x00 );
+
+     return surface;
+}
+
+/*
+ * Build a DGIFF font with an A8 glyph row for the printable ASCII characters, so that text rendering can be measured
+ * without any font file.
+ */
+static IDirectFBFont *
+create_font( void )
+{
+     DFBResult                 ret;
+     DFBFontDescription        fdesc;
+     DFBDataBufferDescription  bdesc;
+     IDirectFBDataBuffer      *buffer;
+     IDirectFBFont            *font;
+     DGIFFHeader              *header;
+     DGIFFFaceHeader          *face;
+     DGIFFGlyphInfo           *glyphs;
+     DGIFFGlyphRow            *row;
+     u8                       *data;
+     u8                       *pixels;
+     size_t                    length;
+     int                       i, x, y;
+
+     fdesc.flags  = DFDESC_HEIGHT;
+     fdesc.height = FONT_SIZE;
+
+     if (options.font) {
+          ret = dfb->CreateFont( dfb, options.font, &fdesc, &font );
+          if (ret) {
+               DirectFBError( "dfbbench: CreateFont() failed", ret );
+               return NULL;
+          }
+
+          return font;
+     }
+
+     length = sizeof(DGIFFHeader) + sizeof(DGIFFFaceHeader) + FONT_GLYPHS * sizeof(DGIFFGlyphInfo) +
+              sizeof(DGIFFGlyphRow) + FONT_GLYPHS * FONT_ADVANCE * FONT_SIZE;
+
+     data = calloc( 1, length );
+     if (!data)
+          return NULL;
+
+     header = (DGIFFHeader*) data;
+     face   = (DGIFFFaceHeader*) (header + 1);
+     glyphs = (DGIFFGlyphInfo*) (face + 1);
+     row    = (DGIFFGlyphRow*) (glyphs + FONT_GLYPHS);
+     pixels = (u8*) (row + 1);
+
+     memcpy( header->magic, "DGIFF", 5 );
+     header->major     = 0;
+     header->minor     = 0;
+     header->num_faces = 1;
+
+     face->next_face   = sizeof(DGIFFFaceHeader);
+     face->size        = FONT_SIZE;
+     face->ascender    = FONT_SIZE - 3;
+     face->descender   = -3;
+     face->height      = FONT_SIZE;
+     face->max_advance = FONT_ADVANCE;
+     face->pixelformat = DSPF_A8;
+     face->num_glyphs  = FONT_GLYPHS;
+     face->num_rows    = 1;
+
+     row->width  = FONT_GLYPHS * FONT_ADVANCE;
+     row->height = FONT_SIZE;
+     row->pitch  = FONT_GLYPHS * FONT_ADVANCE;
+
+     for (i = 0; i < FONT_GLYPHS; i++) {
+          glyphs[i].unicode = FONT_FIRST + i;
+          glyphs[i].row     = 0;
+          glyphs[i].offset  = i * FONT_ADVANCE;
+          glyphs[i].width   = FONT_ADVANCE - 1;
+          glyphs[i].height  = FONT_SIZE - 2;
+          glyphs[i].left    = 0;
+          glyphs[i].top     = 2 - face->ascender;
+          glyphs[i].advance = FONT_ADVANCE;
+
+          /* Some coverage pattern with antialiased edges per glyph. */
+          for (y = 0; y < FONT_SIZE - 2; y++) {
+               for (x = 0; x < FONT_ADVANCE - 1; x++) {
+                    int bit = ((FONT_FIRST + i) >> ((x + y) % 7)) & 1;
+
+                    pixels[y * row->pitch + i * FONT_ADVANCE + x] = bit ? 0xff : ((x ^ y) & 1) ? 0x60 : 0x00;
+               }
+          }
+     }
+
+     bdesc.flags         = DBDESC_MEMORY;
+     bdesc.memory.data   = data;
+     bdesc.memory.length = length;
+
+     ret = dfb->CreateDataBuffer( dfb, &bdesc, &buffer );
+     if (ret) {
+          DirectFBError( "dfbbench: CreateDataBuffer() failed", ret );
+          free( data );
+          return NULL;
+     }
+
+     ret = buffer->CreateFont( buffer, &fdesc, &font );
+
+     buffer->Release( buffer );
+
+     free( data );
+
+     if (ret) {
+          DirectFBError( "dfbbench: Could not create the builtin DGIFF font", ret );
+          return NULL;
+     }
+
+     return font;
+}
+
+/**********************************************************************************************************************/
+
+typedef struct {
+     TestID            test;
+
+     IDirectFBSurface *dst;
+     IDirectFBSurface *src;
+     IDirectFBFont    *font;
+
+     int               size;
+     int               src_w;
+     int               src_h;
+
+     const char       *text;
+     int               text_width;
+} Bench;
+
+/* Run one operation at the n-th position, adding the number of operations and pixels. */
+static DFBResult
+bench_op( Bench     *bench,
+          int        n,
+          long long *ops,
+          long long *pixels )
+{
+     DFBResult         ret;
+     IDirectFBSurface *dst  = bench->dst;
+     int               size = bench->size;
+     int               x    = (n * 37) % (DST_SIZE - size + 1);
+     int               y    = (n * 53) % (DST_SIZE - size + 1);
+
+     switch (bench->test) {
+          case TEST_FILL:
+               ret = dst->FillRectangle( dst, x, y, size, size );
+               break;
+
+          case TEST_BLIT: {
+               DFBRectangle rect = { 0, 0, size, size };
+
+               ret = dst->Blit( dst, bench->src, &rect, x, y );
+               break;
+          }
+
+          case TEST_BATCHBLIT: {
+               DFBRectangle rects[BATCH_RECTS];
+               DFBPoint     points[BATCH_RECTS];
+               int          i;
+
+               for (i = 0; i < BATCH_RECTS; i++) {
+                    rects[i].x  = 0;
+                    rects[i].y  = 0;
+                    rects[i].w  = size;
+                    rects[i].h  = size;
+                    points[i].x = ((n + i) * 37) % (DST_SIZE - size + 1);
+                    points[i].y = ((n + i) * 53) % (DST_SIZE - size + 1);
+               }
+
+               ret = dst->BatchBlit( dst, bench->src, rects, points, BATCH_RECTS );
+
+               *ops    += BATCH_RECTS;
+               *pixels += (long long) BATCH_RECTS * size * size;
+               return ret;
+          }
+
+          case TEST_STRETCH:
+          case TEST_STRETCH_SMOOTH: {
+               DFBRectangle srect = { 0, 0, bench->src_w, bench->src_h };
+               DFBRectangle drect = { x, y, size, size };
+
+               ret = dst->StretchBlit( dst, bench->src, &srect, &drect );
+               break;
+          }
+
+          case TEST_TRIANGLES: {
+               DFBVertex v[4] = {
+                    { x,        y,        0, 1, 0, 0 },
+                    { x + size, y,        0, 1, 1, 0 },
+                    { x,        y + size, 0, 1, 0, 1 },
+                    { x + size, y + size, 0, 1, 1, 1 }
+               };
+
+               ret = dst->TextureTriangles( dst, bench->src, v, NULL, 4, DTTF_STRIP );
+               break;
+          }
+
+          case TEST_TEXT:
+               x = (n * 37) % (DST_SIZE - bench->text_width + 1);
+
+               ret = dst->DrawString( dst, bench->text, -1, x, y, DSTF_TOPLEFT );
+
+               *ops    += 1;
+               *pixels += (long long) bench->text_width * FONT_SIZE;
+               return ret;
+
+          default:
+               return DFB_BUG;
+     }
+
+     *ops    += 1;
+     *pixels += (long long) size * size;
+
+     return ret;
+}
+
+static void
+bench_run( Bench      *bench,
+           const char *name )
+{
+     long long start, elapsed;
+     long long ops    = 0;
+     long long pixels = 0;
+     long long dummy  = 0;
+     int       n;
+
+     /* Warm up, e.g. for glyph caches and pipeline setup. */
+     if (bench_op( bench, 0, &dummy, &dummy )) {
+          printf( "%-72s %10s\n", name, "unsupported" );
+          return;
+     }
+
+     dfb->WaitIdle( dfb );
+
+     start = now_us();
+
+     for (n = 0; ; n++) {
+          bench_op( bench, n, &ops, &pixels );
+
+          if (!(n & 7) && now_us() - start >= options.duration * 1000LL)
+               break;
+     }
+
+     dfb->WaitIdle( dfb );
+
+     elapsed = now_us() - start;
+
+     add_result( name, ops, pixels, elapsed ? elapsed : 1 );
+}
+
+static void
+run_source_tests( IDirectFBSurface      *dst,
+                  DFBSurfacePixelFormat  dst_format,
+                  TestID                 test )
+{
+     int i, j, k;
+
+     for (i = 0; i < options.num_src_formats; i++) {
+          DFBSurfacePixelFormat  src_format = options.src_formats[i];
+          IDirectFBSurface      *src;
+
+          src = create_surface( src_format, DST_SIZE, DST_SIZE );
+          if (!src)
+               continue;
+
+          for (j = 0; j < options.num_blittingflags; j++) {
+               DFBSurfaceBlittingFlags flags = options.blittingflags[j];
+               char                    flagname[128];
+
+               if (dst->SetBlittingFlags( dst, flags ))
+                    continue;
+
+               blittingflags_name( flags, flagname, sizeof(flagname) );
+
+               dst->SetRenderOptions( dst, test == TEST_STRETCH_SMOOTH ?
+                                           (DSRO_SMOOTH_UPSCALE | DSRO_SMOOTH_DOWNSCALE) : DSRO_NONE );
+
+               for (k = 0; k < options.num_sizes; k++) {
+                    Bench bench = { .test = test, .dst = dst, .src = src, .size = options.sizes[k] };
+                    char  name[128];
+
+                    if (bench.size > DST_SIZE)
+                         continue;
+
+                    /* Stretch from 3/4 of the size, i.e. upscaling by a non integer factor. */
+                    bench.src_w = bench.size * 3 / 4 ? bench.size * 3 / 4 : 1;
+                    bench.src_h = bench.src_w;
+
+                    snprintf( name, sizeof(name), "%s/%s->%s/%s/%dx%d", test_names[test],
+                              format_name( src_format ), format_name( dst_format ), flagname, bench.size, bench.size );
+
+                    bench_run( &bench, name );
+               }
+          }
+
+          dst->SetRenderOptions( dst, DSRO_NONE );
+          dst->SetBlittingFlags( dst, DSBLIT_NOFX );
+
+          src->Release( src );
+     }
+}
+
+static void
+run_tests( IDirectFBFont *font )
+{
+     static const struct {
+          DFBSurfaceDrawingFlags  flags;
+          const char             *name;
+     } drawingflags[] = {
+          { DSDRAW_NOFX,  "NOFX"  },
+          { DSDRAW_BLEND, "BLEND" }
+     };
+
+     int i, j, k;
+
+     for (i = 0; i < options.num_dst_formats; i++) {
+          DFBSurfacePixelFormat  dst_format = options.dst_formats[i];
+          IDirectFBSurface      *dst;
+          TestID                 test;
+
+          dst = create_surface( dst_format, DST_SIZE, DST_SIZE );
+          if (!dst)
+               continue;
+
+          dst->SetColor( dst, 0x80, 0xc0, 0x40, 0xa0 );
+
+          for (test = 0; test < NUM_TESTS; test++) {
+               if (!options.tests[test])
+                    continue;
+
+               switch (test) {
+                    case TEST_FILL:
+                         for (j = 0; j < D_ARRAY_SIZE(drawingflags); j++) {
+                              dst->SetDrawingFlags( dst, drawingflags[j].flags );
+
+                              for (k = 0; k < options.num_sizes; k++) {
+                                   Bench bench = { .test = test, .dst = dst, .size = options.sizes[k] };
+                                   char  name[128];
+
+                                   if (bench.size > DST_SIZE)
+                                        continue;
+
+                                   snprintf( name, sizeof(name), "%s/%s/%s/%dx%d", test_names[test],
+                                             format_name( dst_format ), drawingflags[j].name, bench.size, bench.size );
+
+                                   bench_run( &bench, name );
+                              }
+                         }
+
+                         dst->SetDrawingFlags( dst, DSDRAW_NOFX );
+                         break;
+
+                    case TEST_TEXT:
+                         if (font) {
+                              Bench bench = { .test = test, .dst = dst, .font = font, .size = FONT_SIZE };
+                              char  name[128];
+
+                              bench.text = "The quick brown fox jumps over the lazy dog.";
+
+                              font->GetStringWidth( font, bench.text, -1, &bench.text_width );
+
+                              if (bench.text_width > DST_SIZE)
+                                   break;
+
+                              dst->SetFont( dst, font );
+
+                              snprintf( name, sizeof(name), "%s/%s/%d", test_names[test],
+                                        format_name( dst_format ), FONT_SIZE );
+
+                              bench_run( &bench, name );
+                         }
+                         break;
+
+                    default:
+                         run_source_tests( dst, dst_format, test );
+                         break;
+               }
+          }
+
+          dst->Release( dst );
+     }
+}
+
+/**********************************************************************************************************************/
+
+static bool
+write_json( const char *filename )
+{
+     FILE *file;
+     int   i;
+
+     file = fopen( filename, "w" );
+     if (!file) {
+          fprintf( stderr, "dfbbench: Could not open '%s' for writing!\n", filename );
+          return false;
+     }
+
+     fprintf( file, "{\n" );
+     fprintf( file, "  \"version\": 1,\n" );
+     fprintf( file, "  \"system\": \"%s\",\n", options.system );
+     fprintf( file, "  \"duration_ms\": %d,\n", options.duration );
+     fprintf( file, "  \"results\": [\n" );
+
+     for (i = 0; i < num_results; i++)
+          fprintf( file, "    { \"name\": \"%s\", \"mpixels_per_sec\": %.3f, \"ops_per_sec\": %.3f }%s\n",
+                   results[i].name, results[i].mpixels, results[i].ops, i < num_results - 1 ? "," : "" );
+
+     fprintf( file, "  ]\n" );
+     fprintf( file, "}\n" );
+
+     fclose( file );
+
+     return true;
+}
+
+/* Read the results of a JSON file as written by write_json(), one result per line. */
+static int
+read_json( const char  *filename,
+           Result     **ret_results )
+{
+     FILE   *file;
+     char    line[512];
+     Result *list = NULL;
+     int     num  = 0;
+
+     file = fopen( filename, "r" );
+     if (!file) {
+          fprintf( stderr, "dfbbench: Could not open '%s'!\n", filename );
+          return -1;
+     }
+
+     while (fgets( line, sizeof(line), file )) {
+          Result  result;
+          char   *p;
+
+          p = strstr( line, "\"name\": \"" );
+          if (!p)
+               continue;
+
+          if (sscanf( p, "\"name\": \"%127[^\"]\", \"mpixels_per_sec\": %lf, \"ops_per_sec\": %lf",
+                      result.name, &result.mpixels, &result.ops ) != 3)
+               continue;
+
+          list = realloc( list, (num + 1) * sizeof(Result) );
+          if (!list) {
+               fclose( file );
+               return -1;
+          }
+
+          list[num++] = result;
+     }
+
+     fclose( file );
+
+     *ret_results = list;
+
+     return num;
+}
+
+static int
+compare( const char *old_file,
+         const char *new_file,
+         double      threshold )
+{
+     Result *old_results;
+     Result *new_results;
+     int     num_old;
+     int     num_new;
+     int     i, j;
+     int     regressions  = 0;
+     int     improvements = 0;
+     int     compared     = 0;
+
+     num_old = read_json( old_file, &old_results );
+     if (num_old < 0)
+          return 2;
+
+     num_new = read_json( new_file, &new_results );
+     if (num_new < 0)
+          return 2;
+
+     printf( "%-72s %10s %10s %8s\n", "benchmark", "old", "new", "change" );
+
+     for (i = 0; i < num_new; i++) {
+          for (j = 0; j < num_old; j++) {
+               if (!strcmp( new_results[i].name, old_results[j].name ))
+                    break;
+          }
+
+          if (j == num_old || old_results[j].mpixels <= 0)
+               continue;
+
+          {
+               double      change = (new_results[i].mpixels / old_results[j].mpixels - 1.0) * 100.0;
+               const char *mark   = "";
+
+               if (change < -threshold) {
+                    mark = "  REGRESSION";
+                    regressions++;
+               }
+               else if (change > threshold) {
+                    mark = "  improved";
+                    improvements++;
+               }
+
+               printf( "%-72s %10.2f %10.2f %+7.1f%%%s\n", new_results[i].name,
+                       old_results[j].mpixels, new_results[i].mpixels, change, mark );
+
+               compared++;
+          }
+     }
+
+     printf( "\n%d benchmarks compared, %d regressions and %d improvements beyond %.1f%%\n",
+             compared, regressions, improvements, threshold );
+
+     free( old_results );
+     free( new_results );
+
+     return regressions ? 1 : 0;
+}
+
+/**********************************************************************************************************************/
+
+static void
+print_usage( void )
+{
+     int i;
+
+     fprintf( stderr, "\nDirectFB Graphics Benchmark\n\n" );
+     fprintf( stderr, "Usage: dfbbench [options]\n" );
+     fprintf( stderr, "       dfbbench --compare <old.json> <new.json> [--threshold <percent>]\n\n" );
+     fprintf( stderr, "Options:\n\n" );
+     fprintf( stderr, "  -t, --tests <list>        Tests to run (default all):" );
+     for (i = 0; i < NUM_TESTS; i++)
+          fprintf( stderr, " %s", test_names[i] );
+     fprintf( stderr, "\n" );
+     fprintf( stderr, "  -d, --dst <list>          Destination pixel formats (default ARGB,RGB32,RGB16,ARGB4444)\n" );
+     fprintf( stderr, "  -s, --src <list>          Source pixel formats (default ARGB,RGB32,RGB16,A8,YUY2)\n" );
+     fprintf( stderr, "  -f, --flags <list>        Blitting flags, each joined by '+' (default NOFX,\n" );
+     fprintf( stderr, "                            BLEND_ALPHACHANNEL, BLEND_ALPHACHANNEL+COLORIZE,\n" );
+     fprintf( stderr, "                            BLEND_ALPHACHANNEL+BLEND_COLORALPHA+SRC_PREMULTIPLY,\n" );
+     fprintf( stderr, "                            SRC_COLORKEY)\n" );
+     fprintf( stderr, "  -z, --sizes <list>        Rectangle sizes (default 16,64,256)\n" );
+     fprintf( stderr, "  -T, --duration <ms>       Duration of each benchmark (default 100)\n" );
+     fprintf( stderr, "  -j, --json <file>         Write the results as JSON\n" );
+     fprintf( stderr, "      --font <file>         Use a font file instead of the builtin font\n" );
+     fprintf( stderr, "      --system <name>       System module to use (default dummy)\n" );
+     fprintf( stderr, "  -c, --compare             Compare two JSON files, flagging regressions\n" );
+     fprintf( stderr, "  -r, --threshold <percent> Change in MPixel/s considered a regression (default 5)\n" );
+     fprintf( stderr, "  -h, --help                Show this help message\n\n" );
+}
+
+static bool
+parse_list( const char  *arg,
+            bool       (*parse)( const char *item, void *ctx ),
+            void        *ctx )
+{
+     char  buf[1024];
+     char *item;
+     char *save;
+
+     snprintf( buf, sizeof(buf), "%s", arg );
+
+     for (item = strtok_r( buf, ",", &save ); item; item = strtok_r( NULL, ",", &save )) {
+          if (!parse( item, ctx )) {
+               fprintf( stderr, "dfbbench: Invalid item '%s'!\n", item );
+               return false;
+          }
+     }
+
+     return true;
+}
+
+static bool
+parse_test( const char *item,
+            void       *ctx )
+{
+     int i;
+
+     for (i = 0; i < NUM_TESTS; i++) {
+          if (!strcmp( test_names[i], item )) {
+               options.tests[i] = true;
+               return true;
+          }
+     }
+
+     return false;
+}
+
+static bool
+parse_format_item( const char *item,
+                   void       *ctx )
+{
+     DFBSurfacePixelFormat *formats = ctx;
+     int                   *num     = (formats == options.dst_formats) ? &options.num_dst_formats :
+                                                                         &options.num_src_formats;
+
+     if (*num == MAX_ITEMS)
+          return false;
+
+     formats[*num] = parse_format( item );
+
+     return formats[(*num)++] != DSPF_UNKNOWN;
+}
+
+static bool
+parse_flags_item( const char *item,
+                  void       *ctx )
+{
+     if (options.num_blittingflags == MAX_ITEMS)
+          return false;
+
+     return parse_blittingflags( item, &options.blittingflags[options.num_blittingflags++] );
+}
+
+static bool
+parse_size_item( const char *item,
+                 void       *ctx )
+{
+     if (options.num_sizes == MAX_ITEMS)
+          return false;
+
+     options.sizes[options.num_sizes] = atoi( item );
+
+     return options.sizes[options.num_sizes++] > 0;
+}
+
+static void
+default_options( void )
+{
+     int i;
+
+     for (i = 0; i < NUM_TESTS; i++) {
+          if (options.tests[i])
+               break;
+     }
+
+     if (i == NUM_TESTS) {
+          for (i = 0; i < NUM_TESTS; i++)
+               options.tests[i] = true;
+     }
+
+     if (!options.num_dst_formats)
+          parse_list( "ARGB,RGB32,RGB16,ARGB4444", parse_format_item, options.dst_formats );
+
+     if (!options.num_src_formats)
+          parse_list( "ARGB,RGB32,RGB16,A8,YUY2", parse_format_item, options.src_formats );
+
+     if (!options.num_blittingflags)
+          parse_list( "NOFX,BLEND_ALPHACHANNEL,BLEND_ALPHACHANNEL+COLORIZE,"
+                      "BLEND_ALPHACHANNEL+BLEND_COLORALPHA+SRC_PREMULTIPLY,SRC_COLORKEY", parse_flags_item, NULL );
+
+     if (!options.num_sizes)
+          parse_list( "16,64,256", parse_size_item, NULL );
+}
+
+int
+main( int argc, char *argv[] )
+{
+     DFBResult      ret;
+     IDirectFBFont *font      = NULL;
+     bool           comparing = false;
+     double         threshold = 5.0;
+     int            opt;
+
+     static const struct option long_options[] = {
+          { "tests",     required_argument, NULL, 't' },
+          { "dst",       required_argument, NULL, 'd' },
+          { "src",       required_argument, NULL, 's' },
+          { "flags",     required_argument, NULL, 'f' },
+          { "sizes",     required_argument, NULL, 'z' },
+          { "duration",  required_argument, NULL, 'T' },
+          { "json",      required_argument, NULL, 'j' },
+          { "font",      required_argument, NULL, 'F' },
+          { "system",    required_argument, NULL, 'S' },
+          { "compare",   no_argument,       NULL, 'c' },
+          { "threshold", required_argument, NULL, 'r' },
+          { "help",      no_argument,       NULL, 'h' },
+          { NULL,        0,                 NULL, 0   }
+     };
+
+     options.duration = 100;
+     options.system   = "dummy";
+
+     /* Initialize DirectFB command line parsing. */
+     ret = DirectFBInit( &argc, &argv );
+     if (ret) {
+          DirectFBError( "DirectFBInit() failed", ret );
+          return 1;
+     }
+
+     while ((opt = getopt_long( argc, argv, "t:d:s:f:z:T:j:cr:h", long_options, NULL )) != -1) {
+          switch (opt) {
+               case 't':
+                    if (!parse_list( optarg, parse_test, NULL ))
+                         return 1;
+                    break;
+               case 'd':
+                    if (!parse_list( optarg, parse_format_item, options.dst_formats ))
+                         return 1;
+                    break;
+               case 's':
+                    if (!parse_list( optarg, parse_format_item, options.src_formats ))
+                         return 1;
+                    break;
+               case 'f':
+                    if (!parse_list( optarg, parse_flags_item, NULL ))
+                         return 1;
+                    break;
+               case 'z':
+                    if (!parse_list( optarg, parse_size_item, NULL ))
+                         return 1;
+                    break;
+               case 'T':
+                    options.duration = atoi( optarg );
+                    break;
+               case 'j':
+                    options.json = optarg;
+                    break;
+               case 'F':
+                    options.font = optarg;
+                    break;
+               case 'S':
+                    options.system = optarg;
+                    break;
+               case 'c':
+                    comparing = true;
+                    break;
+               case 'r':
+                    threshold = atof( optarg );
+                    break;
+               case 'h':
+               default:
+                    print_usage();
+                    return opt == 'h' ? 0 : 1;
+          }
+     }
+
+     if (comparing) {
+          if (argc - optind != 2) {
+               print_usage();
+               return 1;
+          }
+
+          return compare( argv[optind], argv[optind + 1], threshold );
+     }
+
+     default_options();
+
+     DirectFBSetOption( "system", options.system );
+
+     /* Create the main interface. */
+     ret = DirectFBCreate( &dfb );
+     if (ret) {
+          DirectFBError( "DirectFBCreate() failed", ret );
+          return 1;
+     }
+
+     if (options.tests[TEST_TEXT])
+          font = create_font();
+
+     run_tests( font );
+
+     if (font)
+          font->Release( font );
+
+     dfb->Release( dfb );
+
+     printf( "\n%d benchmarks run\n", num_results );
+
+     if (options.json && !write_json( options.json ))
+          return 1;
+
+     return 0;
+}
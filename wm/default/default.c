@@ -40,6 +40,7 @@ DFB_WINDOW_MANAGER( default )
 #define MAX_UPDATING_REGIONS  8 /* updated region to be scheduled for display */
 #define MAX_UPDATED_REGIONS   8 /* updated region scheduled for display */
 #define MAX_KEYS             16 /* maximum number of grabbed keys */
+#define MAX_CLIP_REGIONS     64 /* maximum number of fragments drawn with one operation */
 
 typedef struct {
      DirectLink                  link;
@@ -114,6 +115,18 @@ typedef struct {
      bool                              wm_fullscreen_updates; /* force fullscreen updates in window manager */
 } StackData;
 
+typedef struct {
+     int                               index;                 /* index of the window, -1 for the background */
+     bool                              alpha_channel;
+     DFBRegion                         region;
+} UpdateFragment;
+
+typedef struct {
+     UpdateFragment                   *fragments;             /* visible fragments of the region being updated */
+     int                               num;
+     int                               max;
+} UpdateFragments;
+
 typedef struct {
      int                    magic;
 
@@ -1119,10 +1132,54 @@ draw_background( CoreWindowStack *stack,
      }
 }
 
+static void
+add_fragment( UpdateFragments *fragments,
+              int              index,
+              const DFBRegion *region,
+              bool             alpha_channel )
+{
+     UpdateFragment *fragment;
+
+     D_ASSERT( fragments != NULL );
+     DFB_REGION_ASSERT( region );
+
+     if (fragments->num == fragments->max) {
+          int             max           = fragments->max ? fragments->max * 2 : 32;
+          UpdateFragment *new_fragments = D_REALLOC( fragments->fragments, max * sizeof(UpdateFragment) );
+
+          if (!new_fragments) {
+               D_OOM();
+               return;
+          }
+
+          fragments->fragments = new_fragments;
+          fragments->max       = max;
+     }
+
+     fragment = &fragments->fragments[fragments->num++];
+
+     fragment->index         = index;
+     fragment->alpha_channel = alpha_channel;
+     fragment->region        = *region;
+}
+
+static int
+fragments_compare( const void *fragment1,
+                   const void *fragment2 )
+{
+     const UpdateFragment *f1 = fragment1;
+     const UpdateFragment *f2 = fragment2;
+
+     if (f1->index != f2->index)
+          return f1->index - f2->index;
+
+     return f1->alpha_channel - f2->alpha_channel;
+}
+
 static void
 update_region( CoreWindowStack *stack,
                StackData       *data,
-               CardState       *state,
+               UpdateFragments *fragments,
                int              start,
                int              x1,
                int              y1,
@@ -1134,7 +1191,7 @@ update_region( CoreWindowStack *stack,
 
      D_ASSERT( stack != NULL );
      D_ASSERT( data != NULL );
-     D_MAGIC_ASSERT( state, CardState );
+     D_ASSERT( fragments != NULL );
      D_ASSERT( start < fusion_vector_size( &data->windows ) );
      D_ASSERT( x1 <= x2 );
      D_ASSERT( y1 <= y2 );
@@ -1164,89 +1221,147 @@ update_region( CoreWindowStack *stack,
                DFBRegion opaque = DFB_REGION_INIT_TRANSLATED( &config->opaque, config->bounds.x, config->bounds.y );
 
                if (!dfb_region_region_intersect( &opaque, &region )) {
-                    update_region( stack, data, state, i - 1, x1, y1, x2, y2 );
+                    update_region( stack, data, fragments, i - 1, x1, y1, x2, y2 );
 
-                    draw_window( window, state, &region, true );
+                    add_fragment( fragments, i, &region, true );
                }
                else {
                     if ((config->opacity < 0xff) || (config->options & DWOP_COLORKEYING)) {
                          /* Draw everything below. */
-                         update_region( stack, data, state, i - 1, x1, y1, x2, y2 );
+                         update_region( stack, data, fragments, i - 1, x1, y1, x2, y2 );
                     }
                     else {
                          /* left */
                          if (opaque.x1 != x1)
-                              update_region( stack, data, state, i - 1, x1, opaque.y1, opaque.x1 - 1, opaque.y2 );
+                              update_region( stack, data, fragments, i - 1, x1, opaque.y1, opaque.x1 - 1, opaque.y2 );
 
                          /* upper */
                          if (opaque.y1 != y1)
-                              update_region( stack, data, state, i - 1, x1, y1, x2, opaque.y1 - 1 );
+                              update_region( stack, data, fragments, i - 1, x1, y1, x2, opaque.y1 - 1 );
 
                          /* right */
                          if (opaque.x2 != x2)
-                              update_region( stack, data, state, i - 1, opaque.x2 + 1, opaque.y1, x2, opaque.y2 );
+                              update_region( stack, data, fragments, i - 1, opaque.x2 + 1, opaque.y1, x2, opaque.y2 );
 
                          /* lower */
                          if (opaque.y2 != y2)
-                              update_region( stack, data, state, i - 1, x1, opaque.y2 + 1, x2, y2 );
+                              update_region( stack, data, fragments, i - 1, x1, opaque.y2 + 1, x2, y2 );
                     }
 
                     /* left */
                     if (opaque.x1 != region.x1) {
                          DFBRegion r = { region.x1, opaque.y1, opaque.x1 - 1, opaque.y2 };
-                         draw_window( window, state, &r, true );
+                         add_fragment( fragments, i, &r, true );
                     }
 
                     /* upper */
                     if (opaque.y1 != region.y1) {
                          DFBRegion r = { region.x1, region.y1, region.x2, opaque.y1 - 1 };
-                         draw_window( window, state, &r, true );
+                         add_fragment( fragments, i, &r, true );
                     }
 
                     /* right */
                     if (opaque.x2 != region.x2) {
                          DFBRegion r = { opaque.x2 + 1, opaque.y1, region.x2, opaque.y2 };
-                         draw_window( window, state, &r, true );
+                         add_fragment( fragments, i, &r, true );
                     }
 
                     /* lower */
                     if (opaque.y2 != region.y2) {
                          DFBRegion r = { region.x1, opaque.y2 + 1, region.x2, region.y2 };
-                         draw_window( window, state, &r, true );
+                         add_fragment( fragments, i, &r, true );
                     }
 
                     /* inner */
-                    draw_window( window, state, &opaque, false );
+                    add_fragment( fragments, i, &opaque, false );
                }
           }
           else {
                if (TRANSLUCENT_WINDOW( window )) {
                     /* Draw everything below. */
-                    update_region( stack, data, state, i - 1, x1, y1, x2, y2 );
+                    update_region( stack, data, fragments, i - 1, x1, y1, x2, y2 );
                }
                else {
                     /* left */
                     if (region.x1 != x1)
-                         update_region( stack, data, state, i - 1, x1, region.y1, region.x1 - 1, region.y2 );
+                         update_region( stack, data, fragments, i - 1, x1, region.y1, region.x1 - 1, region.y2 );
 
                     /* upper */
                     if (region.y1 != y1)
-                         update_region( stack, data, state, i - 1, x1, y1, x2, region.y1 - 1 );
+                         update_region( stack, data, fragments, i - 1, x1, y1, x2, region.y1 - 1 );
 
                     /* right */
                     if (region.x2 != x2)
-                         update_region( stack, data, state, i - 1, region.x2 + 1, region.y1, x2, region.y2 );
+                         update_region( stack, data, fragments, i - 1, region.x2 + 1, region.y1, x2, region.y2 );
 
                     /* lower */
                     if (region.y2 != y2)
-                         update_region( stack, data, state, i - 1, x1, region.y2 + 1, x2, y2 );
+                         update_region( stack, data, fragments, i - 1, x1, region.y2 + 1, x2, y2 );
                }
 
-               draw_window( window, state, &region, true );
+               add_fragment( fragments, i, &region, true );
           }
      }
      else
-          draw_background( stack, state, &region );
+          add_fragment( fragments, -1, &region, false );
+}
+
+/*
+ * Draw the fragments collected by update_region() from bottom to top. The fragments of a window (or the background)
+ * do not overlap, they are drawn with one operation clipped to the set of fragments.
+ */
+static void
+draw_fragments( CoreWindowStack *stack,
+                StackData       *data,
+                CardState       *state,
+                UpdateFragments *fragments )
+{
+     int i, j, k;
+
+     D_ASSERT( stack != NULL );
+     D_ASSERT( data != NULL );
+     D_MAGIC_ASSERT( state, CardState );
+     D_ASSERT( fragments != NULL );
+
+     qsort( fragments->fragments, fragments->num, sizeof(UpdateFragment), fragments_compare );
+
+     for (i = 0; i < fragments->num; i = j) {
+          const UpdateFragment *first   = &fragments->fragments[i];
+          DFBRegion             bounds  = first->region;
+          bool                  clipped = false;
+
+          for (j = i + 1; j < fragments->num && j - i < MAX_CLIP_REGIONS; j++) {
+               const UpdateFragment *fragment = &fragments->fragments[j];
+
+               if (fragment->index != first->index || fragment->alpha_channel != first->alpha_channel)
+                    break;
+
+               dfb_region_region_union( &bounds, &fragment->region );
+          }
+
+          if (j - i > 1) {
+               DFBRegion clips[MAX_CLIP_REGIONS];
+
+               for (k = i; k < j; k++)
+                    transform_stack_to_dest( stack, &fragments->fragments[k].region, &clips[k - i] );
+
+               clipped = dfb_state_set_clip_regions( state, clips, j - i ) == DFB_OK;
+
+               /* Draw the fragments one by one otherwise. */
+               if (!clipped) {
+                    bounds = first->region;
+                    j      = i + 1;
+               }
+          }
+
+          if (first->index < 0)
+               draw_background( stack, state, &bounds );
+          else
+               draw_window( fusion_vector_at( &data->windows, first->index ), state, &bounds, first->alpha_channel );
+
+          if (clipped)
+               dfb_state_set_clip_regions( state, NULL, 0 );
+     }
 }
 
 static void
@@ -1320,6 +1435,7 @@ repaint_stack( CoreWindowStack     *stack,
      CoreSurface     *surface;
      DFBRegion        flips[num_updates];
      int              num_flips = 0;
+     UpdateFragments  fragments = { NULL, 0, 0 };
 
      D_ASSERT( stack != NULL );
      D_ASSERT( data != NULL );
@@ -1360,10 +1476,14 @@ repaint_stack( CoreWindowStack     *stack,
           dfb_state_set_clip( state, &dest );
 
           /* Compose updated region. */
-          update_region( stack, data, state,
+          fragments.num = 0;
+
+          update_region( stack, data, &fragments,
                          fusion_vector_size( &data->windows ) - 1,
                          DFB_REGION_VALS( update ) );
 
+          draw_fragments( stack, data, state, &fragments );
+
           CoreGraphicsStateClient_Flush( &wmdata->client );
 
           flips[num_flips++] = dest;
@@ -1398,6 +1518,9 @@ repaint_stack( CoreWindowStack     *stack,
 
      CoreGraphicsStateClient_Flush( &wmdata->client );
 
+     if (fragments.fragments)
+          D_FREE( fragments.fragments );
+
      switch (region->config.buffermode) {
           case DLBM_TRIPLE:
                /* Add the updated region. */